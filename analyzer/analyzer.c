@@ -34,196 +34,1078 @@
 
 #include "mq.h"
 #include "msg.h"
+#include "planner.h"
 
 /*********************** Performance measurement *****************************/
 SUPRIVATE void
-suscan_analyzer_read_start(suscan_analyzer_t *analyzer)
+suscan_analyzer_stage_start(struct suscan_analyzer_stage_stats *stats)
 {
-  clock_gettime(CLOCK_MONOTONIC_RAW, &analyzer->read_start);
+  clock_gettime(CLOCK_MONOTONIC_RAW, &stats->start);
 }
 
 SUPRIVATE void
-suscan_analyzer_process_start(suscan_analyzer_t *analyzer)
+suscan_analyzer_stage_ready(struct suscan_analyzer_stage_stats *stats)
 {
-  clock_gettime(CLOCK_MONOTONIC_RAW, &analyzer->process_start);
+  clock_gettime(CLOCK_MONOTONIC_RAW, &stats->ready);
 }
 
 SUPRIVATE void
-suscan_analyzer_process_end(suscan_analyzer_t *analyzer)
+suscan_analyzer_stage_end(struct suscan_analyzer_stage_stats *stats)
 {
+  struct timespec end;
   struct timespec sub;
-  uint64_t total, cpu;
+  uint64_t total, busy;
 
-  clock_gettime(CLOCK_MONOTONIC_RAW, &analyzer->process_end);
+  clock_gettime(CLOCK_MONOTONIC_RAW, &end);
 
-  if (analyzer->read_start.tv_sec > 0) {
-    timespecsub(&analyzer->process_end, &analyzer->read_start, &sub);
-    total = sub.tv_sec * 1000000000 + sub.tv_nsec;
+  timespecsub(&end, &stats->start, &sub);
+  total = sub.tv_sec * 1000000000 + sub.tv_nsec;
 
-    timespecsub(&analyzer->process_end, &analyzer->process_start, &sub);
-    cpu = sub.tv_sec * 1000000000 + sub.tv_nsec;
+  timespecsub(&end, &stats->ready, &sub);
+  busy = sub.tv_sec * 1000000000 + sub.tv_nsec;
 
-    /* Update CPU usage */
-    if (total == 0)
-      analyzer->cpu_usage +=
-          SUSCAN_ANALYZER_CPU_USAGE_UPDATE_ALPHA
-          * (1. - analyzer->cpu_usage);
+  stats->last_busy_ns  = busy;
+  stats->last_total_ns = total;
+
+  if (total == 0) {
+    stats->busy +=
+        SUSCAN_ANALYZER_CPU_USAGE_UPDATE_ALPHA * (1. - stats->busy);
+    stats->stall +=
+        SUSCAN_ANALYZER_CPU_USAGE_UPDATE_ALPHA * (0. - stats->stall);
+  } else {
+    stats->busy +=
+        SUSCAN_ANALYZER_CPU_USAGE_UPDATE_ALPHA
+        * ((SUFLOAT) busy / (SUFLOAT) total - stats->busy);
+    stats->stall +=
+        SUSCAN_ANALYZER_CPU_USAGE_UPDATE_ALPHA
+        * ((SUFLOAT) (total - busy) / (SUFLOAT) total - stats->stall);
+  }
+}
+
+SUINLINE unsigned int
+suscan_analyzer_latency_bin(uint64_t ns)
+{
+  unsigned int msb;
+
+  if (ns < 4)
+    return ns;
+
+  msb = 63 - __builtin_clzll(ns);
+
+  return 4 * msb + ((ns >> (msb - 2)) & 3);
+}
+
+SUPRIVATE void
+suscan_analyzer_latency_feed(
+    struct suscan_analyzer_latency *latency,
+    uint64_t ns)
+{
+  ++latency->bins[suscan_analyzer_latency_bin(ns)];
+}
+
+uint64_t
+suscan_analyzer_latency_get_percentile(
+    const struct suscan_analyzer_latency *latency,
+    SUFLOAT p)
+{
+  uint64_t bins[SUSCAN_ANALYZER_LATENCY_BINS];
+  uint64_t total = 0;
+  uint64_t acc = 0;
+  unsigned int msb;
+  unsigned int i;
+
+  memcpy(bins, latency->bins, sizeof(bins));
+
+  for (i = 0; i < SUSCAN_ANALYZER_LATENCY_BINS; ++i)
+    total += bins[i];
+
+  if (total == 0)
+    return 0;
+
+  for (i = 0; i < SUSCAN_ANALYZER_LATENCY_BINS; ++i)
+    if ((acc += bins[i]) >= p * total)
+      break;
+
+  if (i < 8)
+    return i;
+
+  /* Middle of the bin */
+  msb = i / 4;
+  return ((uint64_t) (4 + i % 4) << (msb - 2)) + (1ull << (msb - 2)) / 2;
+}
+
+/************************ Source worker callbacks ****************************/
+#ifdef SUSCAN_DEBUG_THROTTLE
+SUBOOL   dbg_rate_set;
+struct timespec dbg_rate_source_start;
+SUSCOUNT dbg_rate_counter;
+SUFLOAT  dbg_rate_mean;
+SUSCOUNT dbg_rate_last_second;
+#endif
+
+/*
+ * Acquire stage: runs on the source worker. Reads samples from the source
+ * into a free pipeline slot and hands it to the detect stage. Read errors
+ * are forwarded too, so that the detect stage reports them after
+ * processing all pending samples.
+ */
+SUPRIVATE SUBOOL
+suscan_source_wk_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  struct suscan_analyzer_source *source =
+      (struct suscan_analyzer_source *) wk_private;
+  struct suscan_pipeline_slot *slot;
+  SUSDIFF got;
+  SUSCOUNT read_size = suscan_pipeline_get_read_size(&source->pipeline);
+#ifdef SUSCAN_DEBUG_THROTTLE
+  struct timespec sub;
+#endif
+
+  /*
+   * With non-real time sources, use throttle to control CPU usage. When
+   * unthrottled, the BARRIER flow controller makes us wait for the
+   * slowest consumer.
+   */
+  if (suscan_analyzer_source_is_throttled(source))
+    read_size = suscan_throttle_get_portion(&source->throttle, read_size);
+
+  suscan_analyzer_stage_start(&source->acquire_stats);
+
+#ifdef SUSCAN_DEBUG_THROTTLE
+  if (!dbg_rate_set) {
+    dbg_rate_set = SU_TRUE;
+    dbg_rate_source_start = source->acquire_stats.start;
+  }
+#endif
+
+  /* Wait for the detect stage to release a buffer */
+  if ((slot = suscan_pipeline_get_free(&source->pipeline)) == NULL)
+    return SU_FALSE;
+
+  /* Ready to read */
+  suscan_analyzer_stage_ready(&source->acquire_stats);
+
+  got = su_block_port_read(&source->port, slot->data, read_size);
+
+  slot->got = got;
+  slot->pos = source->read_pos;
+
+  /* First samples after a retune: let the detect stage know */
+  slot->retune = source->retune_pending;
+  source->retune_pending = NULL;
+
+  suscan_pipeline_commit(&source->pipeline);
+
+  if (got <= 0) {
+    memset(&source->acquire_stats, 0, sizeof(source->acquire_stats));
+    source->eos = SU_TRUE;
+    return SU_FALSE;
+  }
+
+  if (suscan_analyzer_source_is_throttled(source))
+    suscan_throttle_advance(&source->throttle, got);
+
+  source->read_pos += got;
+
+  /* Report sample loss (network sources, etc) */
+  if (source->lost != NULL && *source->lost != source->lost_reported) {
+    suscan_analyzer_send_source_status(
+        source,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST,
+        (int) SU_MIN(*source->lost - source->lost_reported, INT32_MAX),
+        "%llu samples lost",
+        (unsigned long long) (*source->lost - source->lost_reported));
+    source->lost_reported = *source->lost;
+  }
+
+  suscan_analyzer_stage_end(&source->acquire_stats);
+
+  pthread_mutex_lock(&source->counter_lock);
+  suscan_analyzer_latency_feed(
+      &source->acquire_latency,
+      source->acquire_stats.last_busy_ns);
+  pthread_mutex_unlock(&source->counter_lock);
+
+#ifdef SUSCAN_DEBUG_THROTTLE
+  dbg_rate_counter += got;
+  timespecsub(
+      &source->acquire_stats.start,
+      &dbg_rate_source_start,
+      &sub);
+
+  if (sub.tv_sec != dbg_rate_last_second) {
+    dbg_rate_mean += ((SUFLOAT) dbg_rate_counter / (SUFLOAT) sub.tv_sec - dbg_rate_mean);
+    SU_INFO("Current read rate: %lg\n", dbg_rate_mean);
+    dbg_rate_last_second = sub.tv_sec;
+  }
+#endif
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+suscan_analyzer_report_read_error(
+    struct suscan_analyzer_source *source,
+    SUSDIFF got)
+{
+  switch (got) {
+    case SU_BLOCK_PORT_READ_END_OF_STREAM:
+      suscan_analyzer_send_source_status(
+          source,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
+          got,
+          "End of stream reached");
+      break;
+
+    case SU_BLOCK_PORT_READ_ERROR_NOT_INITIALIZED:
+      suscan_analyzer_send_source_status(
+          source,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
+          got,
+          "Port not initialized");
+      break;
+
+    case SU_BLOCK_PORT_READ_ERROR_ACQUIRE:
+      suscan_analyzer_send_source_status(
+          source,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
+          got,
+          "Acquire failed (source I/O error)");
+      break;
+
+    case SU_BLOCK_PORT_READ_ERROR_PORT_DESYNC:
+      suscan_analyzer_send_source_status(
+          source,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
+          got,
+          "Port desync");
+      break;
+
+    default:
+      suscan_analyzer_send_source_status(
+          source,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
+          got,
+          "Unexpected read result %d", got);
+  }
+}
+
+SUPRIVATE void
+suscan_analyzer_get_detector_params(
+    const struct suscan_analyzer_params *analyzer_params,
+    SUSCOUNT samp_rate,
+    struct sigutils_channel_detector_params *params)
+{
+  *params = analyzer_params->detector_params;
+
+  params->mode = SU_CHANNEL_DETECTOR_MODE_DISCOVERY;
+  params->samp_rate = samp_rate;
+
+  /* Adjust parameters that depend on sample rate */
+  su_channel_params_adjust(params);
+
+#if 0
+  /* Make alpha a little bigger, to provide a more dynamic spectrum */
+  if (params->alpha <= .05)
+    params->alpha *= 20;
+#endif
+
+  params->alpha = analyzer_params->detector_params.alpha;
+}
+
+/*
+ * Sweep steps are requested by the detect stage through the analyzer
+ * thread, like any other retune. Samples are discarded until the detect
+ * stage gets the request back.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_source_request_sweep_step(
+    struct suscan_analyzer_source *source)
+{
+  struct suscan_source_tuning tuning;
+  struct suscan_analyzer_retune_msg *msg = NULL;
+
+  memset(&tuning, 0, sizeof(struct suscan_source_tuning));
+
+  tuning.mask = SUSCAN_SOURCE_TUNING_FC;
+  tuning.fc = suscan_sweep_get_fc(source->sweep);
+  tuning.samp_rate = source->detector->params.samp_rate;
+
+  SU_TRYCATCH(msg = suscan_analyzer_retune_msg_new(&tuning, 0), goto fail);
+
+  /* Zero is for client requests */
+  if (++source->sweep_serial == 0)
+    ++source->sweep_serial;
+
+  msg->source_id = source->id;
+  msg->sweep = source->sweep_serial;
+  msg->sweep_req = source->sweep_req_active;
+
+  SU_TRYCATCH(
+      suscan_mq_write(
+          &source->analyzer->mq_in,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_RETUNE,
+          msg),
+      goto fail);
+
+  return SU_TRUE;
+
+fail:
+  if (msg != NULL)
+    suscan_analyzer_retune_msg_destroy(msg);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE void
+suscan_analyzer_source_abort_sweep(
+    struct suscan_analyzer_source *source,
+    const char *reason)
+{
+  suscan_sweep_destroy(source->sweep);
+  source->sweep = NULL;
+
+  (void) suscan_analyzer_send_source_status(
+      source,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+      -1,
+      "Sweep aborted: %s",
+      reason);
+}
+
+/*
+ * sigutils has no call to reset a channel detector. Planning a new one
+ * is the slow part of a retune, so retunes that keep the window size and
+ * the sample rate (fc changes, sweep steps) restart the window and forget
+ * the averaged spectrum and the channels found by hand.
+ */
+SUPRIVATE void
+suscan_analyzer_reset_detector(su_channel_detector_t *detector)
+{
+  struct sigutils_channel **channel_list;
+  unsigned int channel_count;
+  unsigned int i;
+
+  su_channel_detector_get_channel_list(
+      detector,
+      &channel_list,
+      &channel_count);
+
+  for (i = 0; i < channel_count; ++i)
+    if (channel_list[i] != NULL) {
+      su_channel_destroy(channel_list[i]);
+      channel_list[i] = NULL;
+    }
+
+  memset(detector->spect, 0, detector->params.window_size * sizeof(SUFLOAT));
+
+  detector->N0 = 0;
+  detector->ptr = 0;
+  detector->iters = 0;
+}
+
+/*
+ * The averaged spectrum and channels of the channel detector belong to
+ * the previous tuning. The detector is reset in place when its window
+ * size and sample rate still hold, and replaced otherwise.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_source_replace_detector(
+    struct suscan_analyzer_source *source,
+    const struct suscan_analyzer_retune_msg *msg)
+{
+  suscan_analyzer_t *analyzer = source->analyzer;
+  struct sigutils_channel_detector_params params;
+  su_channel_detector_t *detector;
+
+  /* The acquire stage counts samples from zero at the new rate */
+  if (msg->tuning.samp_rate != source->detector->params.samp_rate) {
+    suscan_analyzer_source_get_time(source, &source->vt0);
+    pthread_mutex_lock(&source->counter_lock);
+    source->consumed = 0;
+    pthread_mutex_unlock(&source->counter_lock);
+  }
+
+  suscan_analyzer_get_detector_params(
+      &analyzer->params,
+      msg->tuning.samp_rate,
+      &params);
+
+  suscan_autotune_set_samp_rate(&source->autotune, msg->tuning.samp_rate);
+
+  if (params.samp_rate == source->detector->params.samp_rate
+      && params.window_size == source->detector->params.window_size
+      && params.window == source->detector->params.window) {
+    suscan_analyzer_reset_detector(source->detector);
+  } else {
+    if ((detector = suscan_planner_channel_detector_new(&params)) == NULL)
+      return SU_FALSE;
+
+    suscan_planner_channel_detector_destroy(source->detector);
+    source->detector = detector;
+  }
+
+  source->fc = msg->tuning.fc;
+  source->per_cnt_channels = 0;
+  source->per_cnt_psd = 0;
+  source->psd_hold_size = 0;
+
+  if (source->psd != NULL)
+    suscan_psd_reset(source->psd);
+
+  /*
+   * Tell delta clients that the channels of the old tuning are gone.
+   * Sweep steps don't: clients get the channels of the whole sweep.
+   */
+  if (source->channel_deltas && msg->sweep == 0)
+    (void) suscan_analyzer_send_channel_deltas(analyzer, source);
+
+  return SU_TRUE;
+}
+
+/*
+ * Runs on the detect stage, right before the first samples after a
+ * retune. Inspectors are retuned by the analyzer thread afterwards.
+ */
+SUPRIVATE void
+suscan_analyzer_source_apply_retune(
+    struct suscan_analyzer_source *source,
+    struct suscan_analyzer_retune_msg *msg)
+{
+  suscan_analyzer_t *analyzer = source->analyzer;
+
+  /* Failed sweep steps get here too, so the sweep can be stopped */
+  if (msg->status == 0)
+    if (!suscan_analyzer_source_replace_detector(source, msg))
+      msg->status = -1;
+
+  /* Steps of previous sweeps are applied, but ignored */
+  if (source->sweep != NULL
+      && msg->sweep != 0
+      && msg->sweep == source->sweep_serial) {
+    if (msg->status == 0)
+      suscan_sweep_begin_step(source->sweep);
     else
-      analyzer->cpu_usage +=
-          SUSCAN_ANALYZER_CPU_USAGE_UPDATE_ALPHA
-          * ((SUFLOAT) cpu / (SUFLOAT) total - analyzer->cpu_usage);
+      suscan_analyzer_source_abort_sweep(source, "cannot retune source");
   }
+
+  msg->applied = SU_TRUE;
+
+  if (!suscan_mq_write(
+      &analyzer->mq_in,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_RETUNE,
+      msg))
+    suscan_analyzer_retune_msg_destroy(msg);
+}
+
+/*
+ * Sweep samples: discarded until the source settles after a retune, then
+ * fed to the channel detector for the dwell time of the step.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_source_feed_sweep(
+    struct suscan_analyzer_source *source,
+    const SUCOMPLEX *data,
+    SUSCOUNT size)
+{
+  suscan_analyzer_t *analyzer = source->analyzer;
+  suscan_sweep_t *sweep = source->sweep;
+  SUSCOUNT chunk;
+  SUBOOL done;
+
+  while (size > 0) {
+    /* Still with the previous tuning */
+    if (sweep->state == SUSCAN_SWEEP_STATE_RETUNING)
+      break;
+
+    chunk = MIN(size, sweep->left);
+
+    if (sweep->state == SUSCAN_SWEEP_STATE_DWELLING)
+      if (su_channel_detector_feed_bulk(source->detector, data, chunk)
+          < chunk)
+        return SU_FALSE;
+
+    data += chunk;
+    size -= chunk;
+
+    if ((sweep->left -= chunk) > 0)
+      continue;
+
+    if (sweep->state == SUSCAN_SWEEP_STATE_SETTLING) {
+      sweep->state = SUSCAN_SWEEP_STATE_DWELLING;
+      sweep->left  = sweep->dwell_samples;
+    } else {
+      if (!suscan_sweep_end_step(sweep, source->detector, &done)) {
+        suscan_analyzer_source_abort_sweep(source, "cannot save step");
+        break;
+      }
+
+      if (done)
+        (void) suscan_analyzer_send_sweep(analyzer, source);
+
+      if (!suscan_analyzer_source_request_sweep_step(source)) {
+        suscan_analyzer_source_abort_sweep(source, "cannot request step");
+        break;
+      }
+    }
+  }
+
+  return SU_TRUE;
 }
 
-/************************ Source worker callback *****************************/
-#ifdef SUSCAN_DEBUG_THROTTLE
-SUBOOL   dbg_rate_set;
-struct timespec dbg_rate_source_start;
-SUSCOUNT dbg_rate_counter;
-SUFLOAT  dbg_rate_mean;
-SUSCOUNT dbg_rate_last_second;
-#endif
+/*
+ * Regular detect stage work: channel detector, Welch estimator and
+ * periodic channel and spectrum updates.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_source_feed_detector(
+    struct suscan_analyzer_source *source,
+    const SUCOMPLEX *data,
+    SUSCOUNT size)
+{
+  suscan_analyzer_t *analyzer = source->analyzer;
+  struct timespec start, end, sub;
+
+  clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
+  if (su_channel_detector_feed_bulk(source->detector, data, size) < size)
+    return SU_FALSE;
+
+  clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+  timespecsub(&end, &start, &sub);
+
+  source->detector_samples += size;
+  source->detector_ns += sub.tv_sec * 1000000000ull + sub.tv_nsec;
+
+  if (source->psd != NULL)
+    suscan_psd_feed_bulk(source->psd, data, size);
+
+  source->per_cnt_channels += size;
+  source->per_cnt_psd += size;
+
+  /* Check channel update */
+  if (source->interval_channels > 0) {
+    if (source->per_cnt_channels
+        >= source->interval_channels * source->detector->params.samp_rate) {
+      source->per_cnt_channels = 0;
+
+      if (source->channel_deltas) {
+        if (!suscan_analyzer_send_channel_deltas(analyzer, source))
+          return SU_FALSE;
+      } else {
+        if (!suscan_analyzer_send_detector_channels(analyzer, source))
+          return SU_FALSE;
+      }
+    }
+  }
+
+  /* Check spectrum update */
+  if (source->interval_psd > 0) {
+    if (source->per_cnt_psd
+        >= source->interval_psd * source->detector->params.samp_rate) {
+      source->per_cnt_psd = 0;
+
+      if (!suscan_analyzer_send_psd(analyzer, source))
+        return SU_FALSE;
+    }
+  }
+
+  return SU_TRUE;
+}
+
+/*
+ * Detect stage: runs on the detector worker. Feeds the channel detector
+ * and sends PSD and channel updates, while the acquire stage is already
+ * reading the next buffer.
+ */
+SUPRIVATE SUBOOL
+suscan_detect_wk_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  struct suscan_analyzer_source *source =
+      (struct suscan_analyzer_source *) wk_private;
+  struct suscan_pipeline_slot *slot;
+  unsigned int waiting;
+  SUSDIFF got;
+  SUBOOL restart = SU_FALSE;
+
+  suscan_analyzer_stage_start(&source->detect_stats);
+
+  /* Wait for the acquire stage to fill a buffer */
+  if ((slot = suscan_pipeline_get_ready(&source->pipeline)) == NULL)
+    return SU_FALSE;
+
+  waiting = suscan_pipeline_get_queued(&source->pipeline) - 1;
+
+  suscan_analyzer_stage_ready(&source->detect_stats);
+
+  if (slot->retune != NULL) {
+    suscan_analyzer_source_apply_retune(source, slot->retune);
+    slot->retune = NULL;
+  }
+
+  if ((got = slot->got) <= 0) {
+    memset(&source->detect_stats, 0, sizeof(source->detect_stats));
+
+    suscan_analyzer_report_read_error(source, got);
+    goto done;
+  }
+
+  pthread_mutex_lock(&source->counter_lock);
+  source->consumed = slot->pos + got;
+  pthread_mutex_unlock(&source->counter_lock);
+
+  /* While sweeping, sweep messages replace channel and PSD updates */
+  if (source->sweep != NULL) {
+    if (!suscan_analyzer_source_feed_sweep(source, slot->data, got))
+      goto done;
+  } else if (!suscan_analyzer_source_feed_detector(source, slot->data, got)) {
+    goto done;
+  }
+
+  /* Finish processing */
+  suscan_analyzer_stage_end(&source->detect_stats);
+
+  pthread_mutex_lock(&source->counter_lock);
+  suscan_analyzer_latency_feed(
+      &source->detect_latency,
+      source->detect_stats.last_busy_ns);
+  pthread_mutex_unlock(&source->counter_lock);
+
+  suscan_autotune_feed(
+      &source->autotune,
+      got,
+      source->detect_stats.last_busy_ns,
+      source->detect_stats.last_total_ns,
+      waiting);
+
+  suscan_pipeline_set_read_size(
+      &source->pipeline,
+      suscan_autotune_get_size(&source->autotune));
+
+  restart = SU_TRUE;
+
+done:
+  suscan_pipeline_release(&source->pipeline);
+
+  return restart;
+}
+
+SUPRIVATE void
+suscan_analyzer_source_reset_throttle(struct suscan_analyzer_source *source)
+{
+  if (suscan_analyzer_source_is_throttled(source))
+    suscan_throttle_init_with_speed(
+        &source->throttle,
+        source->samp_rate,
+        source->speed);
+}
+
+SUPRIVATE SUBOOL
+suscan_detect_send_channels_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  struct suscan_analyzer_source *source =
+      (struct suscan_analyzer_source *) wk_private;
+
+  /* Receivers of deltas need the tracker IDs to apply the next ones */
+  if (source->channel_deltas)
+    (void) suscan_analyzer_send_channel_snapshot(source->analyzer, source);
+  else
+    (void) suscan_analyzer_send_detector_channels(source->analyzer, source);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE SUBOOL
+suscan_detect_set_psd_format_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  struct suscan_analyzer_source *source =
+      (struct suscan_analyzer_source *) wk_private;
+  struct suscan_psd_format *format = (struct suscan_psd_format *) cb_private;
+
+  source->psd_format = *format;
+  source->psd_hold_size = 0; /* Start holding from scratch */
+
+  free(format);
+
+  return SU_FALSE;
+}
+
+/*
+ * Sweep starts and stops are numbered by the thread that requests them.
+ * Steps are tagged with the number their sweep started on, and the
+ * analyzer thread drops the ones that arrive after a newer request, so
+ * steps already on their way cannot retune the source afterwards.
+ */
+struct suscan_sweep_request {
+  struct suscan_sweep_params params;
+  uint32_t req;
+  const char *reason; /* Stops only. Reported to the client if not NULL */
+};
+
+SUPRIVATE uint32_t
+suscan_analyzer_source_new_sweep_req(struct suscan_analyzer_source *source)
+{
+  uint32_t req;
+
+  pthread_mutex_lock(&source->counter_lock);
+  req = ++source->sweep_req;
+  pthread_mutex_unlock(&source->counter_lock);
+
+  return req;
+}
+
+SUPRIVATE SUBOOL
+suscan_analyzer_source_sweep_step_is_stale(
+    struct suscan_analyzer_source *source,
+    const struct suscan_analyzer_retune_msg *msg)
+{
+  SUBOOL stale;
+
+  pthread_mutex_lock(&source->counter_lock);
+  stale = msg->sweep_req != source->sweep_req;
+  pthread_mutex_unlock(&source->counter_lock);
+
+  return stale;
+}
+
+/* A sweep in progress is replaced. Its last step request is ignored */
+SUPRIVATE SUBOOL
+suscan_detect_start_sweep_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  struct suscan_analyzer_source *source =
+      (struct suscan_analyzer_source *) wk_private;
+  struct suscan_sweep_request *request =
+      (struct suscan_sweep_request *) cb_private;
+  suscan_sweep_t *sweep;
+
+  if ((sweep = suscan_sweep_new(
+      &request->params,
+      &source->detector->params)) == NULL) {
+    (void) suscan_analyzer_send_source_status(
+        source,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot start sweep");
+    goto done;
+  }
+
+  if (source->sweep != NULL)
+    suscan_sweep_destroy(source->sweep);
+
+  source->sweep = sweep;
+  source->sweep_req_active = request->req;
+
+  if (!suscan_analyzer_source_request_sweep_step(source))
+    suscan_analyzer_source_abort_sweep(source, "cannot request step");
+
+done:
+  free(request);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE SUBOOL
+suscan_detect_stop_sweep_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  struct suscan_analyzer_source *source =
+      (struct suscan_analyzer_source *) wk_private;
+  const char *reason = (const char *) cb_private;
+
+  /* The source stays tuned to the last step */
+  if (source->sweep != NULL) {
+    if (reason != NULL) {
+      suscan_analyzer_source_abort_sweep(source, reason);
+    } else {
+      suscan_sweep_destroy(source->sweep);
+      source->sweep = NULL;
+    }
+  }
+
+  return SU_FALSE;
+}
+
+/* Sweep steps that never reached the source worker */
+SUPRIVATE SUBOOL
+suscan_detect_fail_sweep_step_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  struct suscan_analyzer_source *source =
+      (struct suscan_analyzer_source *) wk_private;
+  struct suscan_analyzer_retune_msg *msg =
+      (struct suscan_analyzer_retune_msg *) cb_private;
+
+  if (source->sweep != NULL && msg->sweep == source->sweep_serial)
+    suscan_analyzer_source_abort_sweep(source, "cannot retune source");
+
+  suscan_analyzer_retune_msg_destroy(msg);
 
+  return SU_FALSE;
+}
+
+/*
+ * Parameter updates are applied by the detect stage, between two
+ * buffers. Averaging factors and the SNR threshold are read by the
+ * detector on every update and are changed in place, keeping the
+ * averaged spectrum. A different window needs a new detector. The
+ * message goes back to the analyzer thread, which passes it to the
+ * next source.
+ */
 SUPRIVATE SUBOOL
-suscan_source_wk_cb(
+suscan_detect_set_params_cb(
     struct suscan_mq *mq_out,
     void *wk_private,
     void *cb_private)
 {
-  suscan_analyzer_t *analyzer = (suscan_analyzer_t *) wk_private;
   struct suscan_analyzer_source *source =
-      (struct suscan_analyzer_source *) cb_private;
-  SUSDIFF got;
-  SUSCOUNT read_size;
-  SUBOOL restart = SU_FALSE;
+      (struct suscan_analyzer_source *) wk_private;
+  suscan_analyzer_t *analyzer = source->analyzer;
+  struct suscan_analyzer_params_msg *msg =
+      (struct suscan_analyzer_params_msg *) cb_private;
+  struct sigutils_channel_detector_params params;
+  struct suscan_psd_params psd_params;
+  su_channel_detector_t *detector = NULL;
+  suscan_psd_t *psd = NULL;
+  SUFLOAT *psd_scratch;
+
+  suscan_analyzer_get_detector_params(
+      &msg->params,
+      source->detector->params.samp_rate,
+      &params);
+
+  if (params.window_size != source->detector->params.window_size
+      || params.window != source->detector->params.window) {
+    if ((detector = suscan_planner_channel_detector_new(&params)) == NULL)
+      goto fail;
 
-#ifdef SUSCAN_DEBUG_THROTTLE
-  if (!dbg_rate_set) {
-    dbg_rate_set = SU_TRUE;
-    dbg_rate_source_start = read_start;
+    /* Welch estimator follows the FFT size, unless set explicitly */
+    if (source->psd != NULL
+        && analyzer->params.psd_params.size == 0
+        && params.window_size != source->psd->params.size) {
+      psd_params = analyzer->params.psd_params;
+      psd_params.size = params.window_size;
+
+      if ((psd = suscan_psd_new(&psd_params)) == NULL)
+        goto fail;
+
+      if ((psd_scratch = realloc(
+          source->psd_scratch,
+          psd_params.size * sizeof(SUFLOAT))) == NULL)
+        goto fail;
+
+      source->psd_scratch = psd_scratch;
+
+      suscan_psd_destroy(source->psd);
+      source->psd = psd;
+    }
+
+    suscan_planner_channel_detector_destroy(source->detector);
+    source->detector = detector;
+
+    source->psd_hold_size = 0;
+
+    /* Steps already stitched have a different resolution */
+    if (source->sweep != NULL)
+      suscan_analyzer_source_abort_sweep(source, "FFT size changed");
+  } else {
+    source->detector->params.alpha = params.alpha;
+    source->detector->params.beta  = params.beta;
+    source->detector->params.gamma = params.gamma;
+    source->detector->params.snr   = params.snr;
   }
-#endif
 
-  /* With non-real time sources, use throttle to control CPU usage */
-  if (source->config->source->real_time)
-    read_size = analyzer->read_size;
+  source->interval_channels = msg->params.channel_update_int;
+  source->interval_psd = msg->params.psd_update_int;
+
+  if (msg->rollback)
+    --msg->next_source;
   else
-    read_size = suscan_throttle_get_portion(
-        &source->throttle,
-        analyzer->read_size);
+    ++msg->next_source;
 
-  /* Ready to read */
-  suscan_analyzer_read_start(analyzer);
+  goto done;
 
-  if ((got = su_block_port_read(
-      &source->port,
-      analyzer->read_buf,
-      read_size)) > 0) {
-    suscan_analyzer_process_start(analyzer);
-#ifdef SUSCAN_DEBUG_THROTTLE
-    dbg_rate_counter += got;
-#endif
+fail:
+  if (detector != NULL)
+    suscan_planner_channel_detector_destroy(detector);
 
-    if (!source->config->source->real_time)
-      suscan_throttle_advance(&source->throttle, got);
+  if (psd != NULL)
+    suscan_psd_destroy(psd);
 
-    if (su_channel_detector_feed_bulk(
-        source->detector,
-        analyzer->read_buf,
-        got) < got)
-      goto done;
+  if (msg->rollback) {
+    SU_WARNING("Cannot restore parameters of source %u\n", source->id);
+    --msg->next_source;
+  } else {
+    msg->status = -1;
+  }
 
-    source->per_cnt_channels += got;
-    source->per_cnt_psd += got;
+done:
+  if (!suscan_mq_write(
+      &analyzer->mq_in,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS,
+      msg))
+    suscan_analyzer_params_msg_destroy(msg);
 
-    /* Check channel update */
-    if (source->interval_channels > 0) {
-      if (source->per_cnt_channels
-          >= source->interval_channels * source->detector->params.samp_rate) {
-        source->per_cnt_channels = 0;
+  return SU_FALSE;
+}
 
-        if (!suscan_analyzer_send_detector_channels(analyzer, source->detector))
-          goto done;
-      }
-    }
+SUPRIVATE SUBOOL
+suscan_source_set_speed_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  struct suscan_analyzer_source *source =
+      (struct suscan_analyzer_source *) wk_private;
+  SUFLOAT *speed = (SUFLOAT *) cb_private;
 
-    /* Check spectrum update */
-    if (source->interval_psd > 0) {
-      if (source->per_cnt_psd
-          >= source->interval_psd * source->detector->params.samp_rate) {
-        source->per_cnt_psd = 0;
+  source->speed = *speed;
+  suscan_analyzer_source_reset_throttle(source);
 
-        if (!suscan_analyzer_send_psd(analyzer, source->detector))
-          goto done;
-      }
-    }
+  free(speed);
 
-#ifdef SUSCAN_DEBUG_THROTTLE
-    timespecsub(&process_end, &dbg_rate_source_start, &sub);
+  return SU_FALSE;
+}
 
-    if (sub.tv_sec != dbg_rate_last_second) {
-      dbg_rate_mean += ((SUFLOAT) dbg_rate_counter / (SUFLOAT) sub.tv_sec - dbg_rate_mean);
-      SU_INFO("Current read rate: %lg\n", dbg_rate_mean);
-      dbg_rate_last_second = sub.tv_sec;
-    }
-#endif
-  } else {
-    analyzer->eos = SU_TRUE;
-    analyzer->cpu_usage = 0;
-
-    switch (got) {
-      case SU_BLOCK_PORT_READ_END_OF_STREAM:
-        suscan_analyzer_send_status(
-            analyzer,
-            SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
-            got,
-            "End of stream reached");
-        break;
+/*
+ * Seek requests are executed by the source worker itself, between reads,
+ * so the source block is never accessed concurrently.
+ */
+SUPRIVATE SUBOOL
+suscan_source_seek_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  struct suscan_analyzer_source *source =
+      (struct suscan_analyzer_source *) wk_private;
+  suscan_analyzer_t *analyzer = source->analyzer;
+  struct suscan_analyzer_seek_msg *msg =
+      (struct suscan_analyzer_seek_msg *) cb_private;
+  const uint64_t *start_sample;
 
-      case SU_BLOCK_PORT_READ_ERROR_NOT_INITIALIZED:
-        suscan_analyzer_send_status(
-            analyzer,
-            SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
-            got,
-            "Port not initialized");
-        break;
+  if (!source->eos
+      && (source->config->source->seek) (source->block, msg->offset)) {
+    msg->status = 0;
 
-      case SU_BLOCK_PORT_READ_ERROR_ACQUIRE:
-        suscan_analyzer_send_status(
-            analyzer,
-            SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
-            got,
-            "Acquire failed (source I/O error)");
-        break;
+    /* Start counting from here */
+    suscan_analyzer_source_reset_throttle(source);
 
-      case SU_BLOCK_PORT_READ_ERROR_PORT_DESYNC:
-        suscan_analyzer_send_status(
-            analyzer,
-            SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
-            got,
-            "Port desync");
-        break;
+    /* Sources may resolve the offset to a slightly different sample */
+    if ((start_sample = su_block_get_property_ref(
+        source->block,
+        SU_PROPERTY_TYPE_INTEGER,
+        "start_sample")) != NULL)
+      source->read_pos = *start_sample;
+    else
+      source->read_pos = msg->offset * source->samp_rate;
+  } else {
+    msg->status = -1;
+  }
 
-      default:
-        suscan_analyzer_send_status(
-            analyzer,
-            SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
-            got,
-            "Unexpected read result %d", got);
-    }
+  if (!suscan_mq_write(
+      analyzer->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_SEEK,
+      msg))
+    suscan_analyzer_seek_msg_destroy(msg);
+
+  return SU_FALSE;
+}
 
+/*
+ * Retune requests are executed by the source worker too. The request is
+ * handed to the detect stage along with the first samples read with the
+ * new tuning.
+ */
+SUPRIVATE SUBOOL
+suscan_source_retune_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  struct suscan_analyzer_source *source =
+      (struct suscan_analyzer_source *) wk_private;
+  suscan_analyzer_t *analyzer = source->analyzer;
+  struct suscan_analyzer_retune_msg *msg =
+      (struct suscan_analyzer_retune_msg *) cb_private;
+  struct suscan_analyzer_retune_msg *pending;
+  const uint64_t *samp_rate;
+  const uint64_t *fc;
+
+  if (source->eos
+      || !(source->config->source->retune) (source->block, &msg->tuning)) {
+    msg->status = -1;
     goto done;
   }
 
-  /* Finish processing */
-  suscan_analyzer_process_end(analyzer);
+  msg->status = 0;
 
-  restart = SU_TRUE;
+  /* Devices may not support the exact values requested */
+  if ((samp_rate = su_block_get_property_ref(
+      source->block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "samp_rate")) != NULL)
+    msg->tuning.samp_rate = *samp_rate;
+
+  if ((fc = su_block_get_property_ref(
+      source->block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "fc")) != NULL)
+    msg->tuning.fc = *fc;
+
+  if (msg->tuning.samp_rate != source->samp_rate) {
+    source->samp_rate = msg->tuning.samp_rate;
+    source->read_pos = 0; /* Virtual clock is rebased by the detect stage */
+  }
+
+  suscan_analyzer_source_reset_throttle(source);
 
 done:
-  return restart;
-}
+  /* Failed sweep steps must reach the detect stage, to stop the sweep */
+  if (msg->status != 0 && msg->sweep == 0) {
+    if (!suscan_mq_write(
+        analyzer->mq_out,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_RETUNE,
+        msg))
+      suscan_analyzer_retune_msg_destroy(msg);
+
+    return SU_FALSE;
+  }
+
+  /* Superseded before reaching the detect stage. Nothing left to do */
+  if (source->retune_pending != NULL) {
+    pending = (struct suscan_analyzer_retune_msg *) source->retune_pending;
+
+    if (pending->sweep != 0
+        || !suscan_mq_write(
+            analyzer->mq_out,
+            SUSCAN_ANALYZER_MESSAGE_TYPE_RETUNE,
+            pending))
+      suscan_analyzer_retune_msg_destroy(pending);
+  }
+
+  source->retune_pending = msg;
 
+  return SU_FALSE;
+}
 
 /************************* Main analyzer thread *******************************/
 void
@@ -264,24 +1146,95 @@ suscan_wait_for_halt(suscan_analyzer_t *analyzer)
 }
 
 
+/*
+ * Parameter updates visit the detect stage of every source, in order.
+ * Once all of them have been updated, the message is sent back to the
+ * client. If one of them fails, the message visits the sources already
+ * updated in reverse order with the parameters in effect, so that all
+ * sources keep running with the same parameters.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_forward_params_msg(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_params_msg *msg)
+{
+  struct suscan_analyzer_source *source;
+  uint32_t index;
+
+  for (;;) {
+    if (msg->status != 0 && !msg->rollback) {
+      msg->rollback = SU_TRUE;
+      msg->params = analyzer->params;
+    }
+
+    if (msg->rollback) {
+      if (msg->next_source == 0)
+        break;
+      index = msg->next_source - 1;
+    } else {
+      index = msg->next_source;
+    }
+
+    if ((source = suscan_analyzer_get_source(analyzer, index)) == NULL)
+      break;
+
+    if (suscan_worker_push(
+        source->detect_wk,
+        suscan_detect_set_params_cb,
+        msg))
+      return SU_TRUE;
+
+    if (msg->rollback) {
+      SU_WARNING("Cannot restore parameters of source %u\n", index);
+      --msg->next_source;
+    } else {
+      msg->status = -1;
+    }
+  }
+
+  if (msg->status == 0) {
+    analyzer->params.detector_params = msg->params.detector_params;
+    analyzer->params.channel_update_int = msg->params.channel_update_int;
+    analyzer->params.psd_update_int = msg->params.psd_update_int;
+  }
+
+  msg->params = analyzer->params;
+
+  return suscan_mq_write(
+      analyzer->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS,
+      msg);
+}
+
 SUPRIVATE void *
 suscan_analyzer_thread(void *data)
 {
   suscan_analyzer_t *analyzer = (suscan_analyzer_t *) data;
+  struct suscan_analyzer_source *source;
+  struct suscan_analyzer_retune_msg *retune;
   void *private;
   uint32_t type;
+  unsigned int i;
   SUBOOL halt_acked = SU_FALSE;
 
-  if (!suscan_worker_push(
-      analyzer->source_wk,
-      suscan_source_wk_cb,
-      &analyzer->source)) {
-    suscan_analyzer_send_status(
-        analyzer,
-        SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT,
-        SUSCAN_ANALYZER_INIT_FAILURE,
-        "Failed to push async callback to worker");
-    goto done;
+  for (i = 0; i < analyzer->source_count; ++i) {
+    source = analyzer->source_list[i];
+
+    if (!suscan_worker_push(
+        source->detect_wk,
+        suscan_detect_wk_cb,
+        NULL)
+        || !suscan_worker_push(
+        source->source_wk,
+        suscan_source_wk_cb,
+        NULL)) {
+      suscan_analyzer_send_status(
+          analyzer,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT,
+          SUSCAN_ANALYZER_INIT_FAILURE,
+          "Failed to push async callback to worker");
+      goto done;
+    }
   }
 
   /* Signal initialization success */
@@ -320,6 +1273,104 @@ suscan_analyzer_thread(void *data)
 
           break;
 
+        case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR_BATCH:
+          /* Comes twice for OPEN: before and after building inspectors */
+          if (!suscan_analyzer_parse_inspector_batch_msg(analyzer, private)) {
+            suscan_analyzer_dispose_message(type, private);
+            goto done;
+          }
+
+          private = NULL;
+
+          break;
+
+        case SUSCAN_ANALYZER_MESSAGE_TYPE_SEEK:
+          source = suscan_analyzer_get_source(
+              analyzer,
+              ((struct suscan_analyzer_seek_msg *) private)->source_id);
+
+          if (source != NULL
+              && source->config->source->seek != NULL
+              && suscan_worker_push(
+                  source->source_wk,
+                  suscan_source_seek_cb,
+                  private)) {
+            /* Owned by the source worker now */
+            private = NULL;
+          } else {
+            ((struct suscan_analyzer_seek_msg *) private)->status = -1;
+            if (!suscan_mq_write(analyzer->mq_out, type, private))
+              goto done;
+            private = NULL;
+          }
+
+          break;
+
+        case SUSCAN_ANALYZER_MESSAGE_TYPE_RETUNE:
+          retune = (struct suscan_analyzer_retune_msg *) private;
+          source = suscan_analyzer_get_source(analyzer, retune->source_id);
+
+          if (source == NULL) {
+            retune->status = -1;
+          } else if (retune->applied) {
+            /* Back from the detect stage */
+            if (retune->status == 0) {
+              source->tuning.fc = retune->tuning.fc;
+              source->tuning.samp_rate = retune->tuning.samp_rate;
+              if (retune->tuning.mask & SUSCAN_SOURCE_TUNING_GAIN)
+                source->tuning.gain = retune->tuning.gain;
+
+              if (!suscan_analyzer_retune_inspectors(analyzer, source))
+                retune->status = -1;
+            }
+          } else if (retune->sweep != 0
+              && suscan_analyzer_source_sweep_step_is_stale(source, retune)) {
+            /* Its sweep was stopped or replaced. Nobody waits for it */
+            break;
+          } else if (source->config->source->retune != NULL
+              && suscan_worker_push(
+                  source->source_wk,
+                  suscan_source_retune_cb,
+                  private)) {
+            /* Owned by the source worker now */
+            private = NULL;
+            break;
+          } else {
+            retune->status = -1;
+          }
+
+          /*
+           * Sweep steps are not reported to the client. The ones that
+           * failed here are waited for by the detect stage, which must
+           * abort the sweep.
+           */
+          if (retune->sweep != 0) {
+            if (source != NULL && !retune->applied && retune->status != 0) {
+              if (suscan_worker_push(
+                  source->detect_wk,
+                  suscan_detect_fail_sweep_step_cb,
+                  private))
+                private = NULL;
+              else
+                SU_ERROR("Cannot abort sweep of source %u\n", source->id);
+            }
+            break;
+          }
+
+          if (!suscan_mq_write(analyzer->mq_out, type, private))
+            goto done;
+          private = NULL;
+
+          break;
+
+        case SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS:
+          /* Owned by a detect stage or the client now */
+          if (!suscan_analyzer_forward_params_msg(analyzer, private))
+            goto done;
+          private = NULL;
+
+          break;
+
         /* Forward these messages to output */
         case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
         case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
@@ -365,6 +1416,19 @@ suscan_analyzer_read_inspector_msg(suscan_analyzer_t *analyzer)
       SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR);
 }
 
+uint32_t
+suscan_analyzer_alloc_req_id(suscan_analyzer_t *analyzer)
+{
+  uint32_t req_id;
+
+  /* Unsolicited messages (e.g. inspectors closed by retune) have req_id 0 */
+  do
+    req_id = __sync_fetch_and_add(&analyzer->next_req_id, 1);
+  while (req_id == 0);
+
+  return req_id;
+}
+
 SUBOOL
 suscan_analyzer_write(suscan_analyzer_t *analyzer, uint32_t type, void *priv)
 {
@@ -411,31 +1475,177 @@ suscan_analyzer_halt_worker(suscan_worker_t *worker)
 
 /******************* Suscan analyzer source methods **************************/
 SUPRIVATE void
-suscan_analyzer_source_finalize(struct suscan_analyzer_source *source)
+suscan_analyzer_source_destroy(struct suscan_analyzer_source *source)
 {
+  unsigned int i;
+
+  /* Retune requests that never reached the detect stage */
+  if (source->retune_pending != NULL)
+    suscan_analyzer_retune_msg_destroy(source->retune_pending);
+
+  for (i = 0; i < SUSCAN_PIPELINE_DEPTH; ++i)
+    if (source->pipeline.slots[i].retune != NULL)
+      suscan_analyzer_retune_msg_destroy(source->pipeline.slots[i].retune);
+
+  /* Free pipeline buffers */
+  suscan_pipeline_finalize(&source->pipeline);
+
   su_block_port_unplug(&source->port);
 
   if (source->detector != NULL)
-    su_channel_detector_destroy(source->detector);
+    suscan_planner_channel_detector_destroy(source->detector);
+
+  /* Welch estimator cost is logged by suscan_psd_destroy */
+  if (source->psd != NULL && source->detector_samples > 0)
+    SU_INFO(
+        "Channel detector: %llu samples, %.1lf ns/sample\n",
+        (unsigned long long) source->detector_samples,
+        (double) source->detector_ns / source->detector_samples);
+
+  if (source->psd != NULL)
+    suscan_psd_destroy(source->psd);
+
+  if (source->psd_scratch != NULL)
+    free(source->psd_scratch);
+
+  if (source->psd_hold != NULL)
+    free(source->psd_hold);
+
+  if (source->sweep != NULL)
+    suscan_sweep_destroy(source->sweep);
+
+  suscan_tracker_finalize(&source->tracker);
 
   if (source->block != NULL)
     su_block_destroy(source->block);
+
+  pthread_mutex_destroy(&source->counter_lock);
+
+  free(source);
 }
 
+/*
+ * Wakes up and stops the workers of a source. The source object is
+ * destroyed later, once no consumer worker can be reading from it.
+ */
 SUPRIVATE SUBOOL
-suscan_analyzer_source_init_from_block_properties(
+suscan_analyzer_source_halt(struct suscan_analyzer_source *source)
+{
+  /* We attempt to wakeup all threads by marking the source as EOS */
+  if (source->block != NULL)
+    su_block_force_eos(source->block, 0);
+
+  /* Stages waiting for each other must be woken up too */
+  suscan_pipeline_cancel(&source->pipeline);
+
+  if (source->source_wk != NULL) {
+    if (!suscan_analyzer_halt_worker(source->source_wk)) {
+      SU_ERROR("Source worker destruction failed, memory leak ahead\n");
+      return SU_FALSE;
+    }
+
+    source->source_wk = NULL;
+  }
+
+  if (source->detect_wk != NULL) {
+    if (!suscan_analyzer_halt_worker(source->detect_wk)) {
+      SU_ERROR("Detector worker destruction failed, memory leak ahead\n");
+      return SU_FALSE;
+    }
+
+    source->detect_wk = NULL;
+  }
+
+  return SU_TRUE;
+}
+
+void
+suscan_analyzer_source_get_time(
+    const struct suscan_analyzer_source *source,
+    struct timespec *ts)
+{
+  uint64_t samp_rate = source->detector->params.samp_rate;
+
+  if (samp_rate == 0) {
+    *ts = source->vt0;
+    return;
+  }
+
+  ts->tv_sec  = source->vt0.tv_sec + source->consumed / samp_rate;
+  ts->tv_nsec = source->vt0.tv_nsec
+      + ((source->consumed % samp_rate) * 1000000000ull) / samp_rate;
+
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_nsec -= 1000000000;
+    ++ts->tv_sec;
+  }
+}
+
+void
+suscan_analyzer_source_get_counters(
     struct suscan_analyzer_source *source,
-    struct sigutils_channel_detector_params *params)
+    uint64_t *consumed,
+    struct suscan_analyzer_latency *acquire_latency,
+    struct suscan_analyzer_latency *detect_latency)
+{
+  pthread_mutex_lock(&source->counter_lock);
+
+  if (consumed != NULL)
+    *consumed = source->consumed;
+
+  if (acquire_latency != NULL)
+    *acquire_latency = source->acquire_latency;
+
+  if (detect_latency != NULL)
+    *detect_latency = source->detect_latency;
+
+  pthread_mutex_unlock(&source->counter_lock);
+}
+
+SUBOOL
+suscan_analyzer_source_prepare_psd_hold(
+    struct suscan_analyzer_source *source,
+    SUSCOUNT size)
+{
+  SUSCOUNT bins = source->psd_format.bins;
+  SUFLOAT *hold;
+
+  if (source->psd_format.reduction != SUSCAN_PSD_REDUCTION_PEAK_HOLD)
+    return SU_TRUE;
+
+  if (bins == 0 || bins > size)
+    bins = size;
+
+  if (bins != source->psd_hold_size) {
+    SU_TRYCATCH(
+        hold = realloc(source->psd_hold, bins * sizeof(SUFLOAT)),
+        return SU_FALSE);
+
+    memset(hold, 0, bins * sizeof(SUFLOAT));
+
+    source->psd_hold = hold;
+    source->psd_hold_size = bins;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_analyzer_source_init_from_block_properties(
+    struct suscan_analyzer_source *source)
 {
   const uint64_t *samp_rate;
   const uint64_t *fc;
+  const uint64_t *t0;
+  const uint64_t *start_sample;
+  const SUBOOL *throttle;
 
   /* Retrieve sample rate. All source blocks must expose this property */
   if ((samp_rate = su_block_get_property_ref(
       source->block,
       SU_PROPERTY_TYPE_INTEGER,
       "samp_rate")) != NULL) {
-    params->samp_rate = *samp_rate;
+    source->samp_rate = *samp_rate;
   } else {
     SU_ERROR("Failed to get sample rate");
     return SU_FALSE;
@@ -445,24 +1655,69 @@ suscan_analyzer_source_init_from_block_properties(
   if ((fc = su_block_get_property_ref(
       source->block,
       SU_PROPERTY_TYPE_INTEGER,
-      "fc")) != NULL)
-    source->fc = *fc;
+      "fc")) != NULL)
+    source->fc = *fc;
+
+  /*
+   * Recordings know when their first sample was taken. Otherwise, the
+   * virtual clock starts now.
+   */
+  if ((t0 = su_block_get_property_ref(
+      source->block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "t0")) != NULL && *t0 != 0) {
+    source->vt0.tv_sec  = *t0 / 1000000000ull;
+    source->vt0.tv_nsec = *t0 % 1000000000ull;
+  } else {
+    clock_gettime(CLOCK_REALTIME, &source->vt0);
+  }
+
+  /* Playback may not start at the beginning of the recording */
+  if ((start_sample = su_block_get_property_ref(
+      source->block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "start_sample")) != NULL)
+    source->consumed = source->read_pos = *start_sample;
+
+  /* Sources that may lose samples report them here */
+  source->lost = su_block_get_property_ref(
+      source->block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "lost");
+
+  /* Synthetic sources may ask to be read as fast as possible */
+  if ((throttle = su_block_get_property_ref(
+      source->block,
+      SU_PROPERTY_TYPE_BOOL,
+      "throttle")) != NULL)
+    source->throttle_enabled = source->throttle_enabled && *throttle;
 
   return SU_TRUE;
 }
 
-SUPRIVATE SUBOOL
-suscan_analyzer_source_init(
-    const struct suscan_analyzer_params *analyzer_params,
-    struct suscan_analyzer_source *source,
+SUPRIVATE struct suscan_analyzer_source *
+suscan_analyzer_source_new(
+    suscan_analyzer_t *analyzer,
+    uint32_t id,
     struct suscan_source_config *config)
 {
-  struct sigutils_channel_detector_params params =
-      analyzer_params->detector_params;
-  SUBOOL ok = SU_FALSE;
-
-  params.mode = SU_CHANNEL_DETECTOR_MODE_DISCOVERY;
+  const struct suscan_analyzer_params *analyzer_params = &analyzer->params;
+  struct suscan_analyzer_source *source = NULL;
+  struct sigutils_channel_detector_params params;
+  struct suscan_psd_params psd_params;
+
+  SU_TRYCATCH(
+      source = calloc(1, sizeof(struct suscan_analyzer_source)),
+      goto fail);
+
+  if (pthread_mutex_init(&source->counter_lock, NULL) != 0) {
+    SU_ERROR("Cannot initialize counter lock\n");
+    free(source);
+    return NULL;
+  }
 
+  source->id = id;
+  source->analyzer = analyzer;
   source->config = config;
 
   source->per_cnt_channels  = 0;
@@ -471,32 +1726,55 @@ suscan_analyzer_source_init(
   source->interval_channels = analyzer_params->channel_update_int;
   source->interval_psd      = analyzer_params->psd_update_int;
 
+  source->throttle_enabled  = !config->source->real_time;
+  source->consumed          = 0;
+  source->read_pos          = 0;
+
+  source->speed = analyzer_params->playback_speed;
+  if (source->speed > 0 && source->speed < SUSCAN_THROTTLE_MIN_SPEED)
+    source->speed = SUSCAN_THROTTLE_MIN_SPEED;
+
   if ((source->block = (config->source->ctor)(config)) == NULL)
-    goto done;
+    goto fail;
 
   /*
    * Analyze block properties, and initialize source and detector
    * parameters accordingly.
    */
-  if (!suscan_analyzer_source_init_from_block_properties(source, &params))
-    goto done;
+  if (!suscan_analyzer_source_init_from_block_properties(source))
+    goto fail;
 
-  /* Adjust parameters that depend on sample rate */
-  su_channel_params_adjust(&params);
+  suscan_analyzer_get_detector_params(
+      analyzer_params,
+      source->samp_rate,
+      &params);
 
-#if 0
-  /* Make alpha a little bigger, to provide a more dynamic spectrum */
-  if (params.alpha <= .05)
-    params.alpha *= 20;
-#endif
+  /* Wideband detectors use threaded FFTs */
+  if ((source->detector = suscan_planner_channel_detector_new(&params))
+      == NULL)
+    goto fail;
 
-  params.alpha = analyzer_params->detector_params.alpha;
+  /* Welch estimator is fed with the same samples as the detector */
+  if (analyzer_params->psd_mode == SUSCAN_ANALYZER_PSD_MODE_WELCH) {
+    psd_params = analyzer_params->psd_params;
+    if (psd_params.size == 0)
+      psd_params.size = params.window_size;
 
-  if ((source->detector = su_channel_detector_new(&params)) == NULL)
-    goto done;
+    if ((source->psd = suscan_psd_new(&psd_params)) == NULL)
+      goto fail;
+
+    if ((source->psd_scratch = malloc(psd_params.size * sizeof(SUFLOAT)))
+        == NULL)
+      goto fail;
+  }
+
+  source->psd_format = analyzer_params->psd_format;
+
+  source->channel_deltas = analyzer_params->channel_deltas;
+  suscan_tracker_init(&source->tracker);
 
   if (!su_block_port_plug(&source->port, source->block, 0))
-    goto done;
+    goto fail;
 
   if (config->source->real_time) {
     /*
@@ -508,14 +1786,14 @@ suscan_analyzer_source_init(
         source->block,
         0,
         SU_FLOW_CONTROL_KIND_MASTER_SLAVE))
-      goto done;
+      goto fail;
 
     /*
      * This is the master port. Other readers must wait for this reader
      * to complete before asking block for additional samples.
      */
     if (!su_block_set_master_port(source->block, 0, &source->port))
-      goto done;
+      goto fail;
   } else {
     /*
      * If source is not realtime (e.g. iqfile or wavfile) we can afford
@@ -527,20 +1805,69 @@ suscan_analyzer_source_init(
         source->block,
         0,
         SU_FLOW_CONTROL_KIND_BARRIER))
-      goto done;
+      goto fail;
 
     /*
      * To avoid CPU hogging by unlimited input rate, we setup a throttle
      * object to deliver samples at a constat rate specified by the
-     * sample rate;
+     * sample rate, scaled by the playback speed. If the speed is not
+     * positive, samples are delivered as fast as the slowest consumer
+     * is able to process them.
      */
-    suscan_throttle_init(&source->throttle, params.samp_rate);
+    if (suscan_analyzer_source_is_throttled(source))
+      suscan_throttle_init_with_speed(
+          &source->throttle,
+          params.samp_rate,
+          source->speed);
   }
 
-  ok = SU_TRUE;
+  /* Allocate pipeline buffers, big enough for the autotuner */
+  if (!suscan_pipeline_init(
+      &source->pipeline,
+      suscan_autotune_get_capacity(
+          analyzer_params->read_profile,
+          config->bufsiz))) {
+    SU_ERROR("Failed to allocate read buffers\n");
+    goto fail;
+  }
 
-done:
-  return ok;
+  suscan_autotune_init(
+      &source->autotune,
+      analyzer_params->read_profile,
+      config->bufsiz,
+      source->pipeline.size,
+      source->samp_rate);
+
+  suscan_pipeline_set_read_size(
+      &source->pipeline,
+      suscan_autotune_get_size(&source->autotune));
+
+  source->tuning.fc = source->fc;
+  source->tuning.samp_rate = source->samp_rate;
+
+  /* Create source worker */
+  if ((source->source_wk = suscan_worker_new(&analyzer->mq_in, source))
+      == NULL) {
+    SU_ERROR("Cannot create source worker thread\n");
+    goto fail;
+  }
+
+  /* Create detector worker */
+  if ((source->detect_wk = suscan_worker_new(&analyzer->mq_in, source))
+      == NULL) {
+    SU_ERROR("Cannot create detector worker thread\n");
+    goto fail;
+  }
+
+  return source;
+
+fail:
+  if (source != NULL) {
+    if (suscan_analyzer_source_halt(source))
+      suscan_analyzer_source_destroy(source);
+  }
+
+  return NULL;
 }
 
 /********************** Suscan analyzer public API ***************************/
@@ -555,31 +1882,377 @@ suscan_get_min_consumer_workers(void)
   return count - 1;
 }
 
+/*
+ * Consumers read from one source at a time. Tasks go to the next consumer
+ * that is either idle or already reading from the task's source. If all
+ * of them are busy with other sources, a new consumer is created.
+ */
 SUBOOL
 suscan_analyzer_push_task(
     suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_source *source,
     SUBOOL (*func) (
           struct suscan_mq *mq_out,
           void *wk_private,
           void *cb_private),
     void *private)
 {
-  if (!suscan_consumer_push_task(
-      analyzer->consumer_list[analyzer->next_consumer],
-      func,
-      private))
+  suscan_consumer_t *consumer;
+  unsigned int i;
+  unsigned int n;
+
+  for (i = 0; i < analyzer->consumer_count; ++i) {
+    n = (analyzer->next_consumer + i) % analyzer->consumer_count;
+
+    if (suscan_consumer_push_task(
+        analyzer->consumer_list[n],
+        source,
+        func,
+        private)) {
+      /* Increment next consumer counter */
+      analyzer->next_consumer = (n + 1) % analyzer->consumer_count;
+      return SU_TRUE;
+    }
+  }
+
+  SU_TRYCATCH(consumer = suscan_consumer_new(analyzer), return SU_FALSE);
+
+  if (PTR_LIST_APPEND_CHECK(analyzer->consumer, consumer) == -1) {
+    SU_ERROR("Cannot append consumer to list\n");
+    suscan_consumer_destroy(consumer);
+    return SU_FALSE;
+  }
+
+  return suscan_consumer_push_task(consumer, source, func, private);
+}
+
+SUBOOL
+suscan_analyzer_seek_async(
+    suscan_analyzer_t *analyzer,
+    uint32_t source_id,
+    SUFLOAT offset,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_source *source;
+  struct suscan_analyzer_seek_msg *msg;
+
+  if ((source = suscan_analyzer_get_source(analyzer, source_id)) == NULL) {
+    SU_ERROR("No such source: %u\n", source_id);
+    return SU_FALSE;
+  }
+
+  if (source->config->source->seek == NULL) {
+    SU_ERROR(
+        "Source `%s' does not support seeking\n",
+        source->config->source->name);
+    return SU_FALSE;
+  }
+
+  SU_TRYCATCH(msg = suscan_analyzer_seek_msg_new(offset, req_id), return SU_FALSE);
+
+  msg->source_id = source_id;
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_SEEK,
+      msg)) {
+    suscan_analyzer_seek_msg_destroy(msg);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_analyzer_retune_async(
+    suscan_analyzer_t *analyzer,
+    uint32_t source_id,
+    const struct suscan_source_tuning *tuning,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_source *source;
+  struct suscan_analyzer_retune_msg *msg;
+
+  if ((source = suscan_analyzer_get_source(analyzer, source_id)) == NULL) {
+    SU_ERROR("No such source: %u\n", source_id);
+    return SU_FALSE;
+  }
+
+  if (source->config->source->retune == NULL) {
+    SU_ERROR(
+        "Source `%s' cannot be retuned\n",
+        source->config->source->name);
+    return SU_FALSE;
+  }
+
+  /* Captures are written with a single tuning */
+  if (analyzer->recorder != NULL
+      && analyzer->recorder_source_id == source_id) {
+    SU_ERROR("Cannot retune source while recording\n");
+    return SU_FALSE;
+  }
+
+  /*
+   * A sweep in progress would undo this retune with its next step, and
+   * stitch the samples of this tuning into its own. It is stopped first:
+   * the detect stage gets the stop before the retuned samples.
+   */
+  (void) suscan_analyzer_source_new_sweep_req(source);
+
+  SU_TRYCATCH(
+      suscan_worker_push(
+          source->detect_wk,
+          suscan_detect_stop_sweep_cb,
+          (void *) "source retuned by client"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      msg = suscan_analyzer_retune_msg_new(tuning, req_id),
+      return SU_FALSE);
+
+  msg->source_id = source_id;
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_RETUNE,
+      msg)) {
+    suscan_analyzer_retune_msg_destroy(msg);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_analyzer_start_sweep(
+    suscan_analyzer_t *analyzer,
+    uint32_t source_id,
+    const struct suscan_sweep_params *params)
+{
+  struct suscan_analyzer_source *source;
+  struct suscan_sweep_request *request;
+
+  if ((source = suscan_analyzer_get_source(analyzer, source_id)) == NULL) {
+    SU_ERROR("No such source: %u\n", source_id);
+    return SU_FALSE;
+  }
+
+  if (source->config->source->retune == NULL) {
+    SU_ERROR(
+        "Source `%s' cannot be retuned\n",
+        source->config->source->name);
+    return SU_FALSE;
+  }
+
+  /* Captures are written with a single tuning */
+  if (analyzer->recorder != NULL
+      && analyzer->recorder_source_id == source_id) {
+    SU_ERROR("Cannot sweep source while recording\n");
+    return SU_FALSE;
+  }
+
+  SU_TRYCATCH(
+      request = calloc(1, sizeof(struct suscan_sweep_request)),
+      return SU_FALSE);
+
+  request->params = *params;
+  request->req = suscan_analyzer_source_new_sweep_req(source);
+
+  /* Sweeps are driven by the detect stage */
+  if (!suscan_worker_push(
+      source->detect_wk,
+      suscan_detect_start_sweep_cb,
+      request)) {
+    free(request);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_analyzer_stop_sweep(suscan_analyzer_t *analyzer, uint32_t source_id)
+{
+  struct suscan_analyzer_source *source;
+
+  if ((source = suscan_analyzer_get_source(analyzer, source_id)) == NULL) {
+    SU_ERROR("No such source: %u\n", source_id);
+    return SU_FALSE;
+  }
+
+  (void) suscan_analyzer_source_new_sweep_req(source);
+
+  return suscan_worker_push(
+      source->detect_wk,
+      suscan_detect_stop_sweep_cb,
+      NULL);
+}
+
+SUBOOL
+suscan_analyzer_set_params_async(
+    suscan_analyzer_t *analyzer,
+    const struct suscan_analyzer_params *params,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_params_msg *msg;
+
+  SU_TRYCATCH(
+      msg = suscan_analyzer_params_msg_new(params, req_id),
+      return SU_FALSE);
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS,
+      msg)) {
+    suscan_analyzer_params_msg_destroy(msg);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_analyzer_request_channels(suscan_analyzer_t *analyzer)
+{
+  unsigned int i;
+
+  /* Sent by the detect stages, between two updates */
+  for (i = 0; i < analyzer->source_count; ++i)
+    if (!suscan_worker_push(
+        analyzer->source_list[i]->detect_wk,
+        suscan_detect_send_channels_cb,
+        NULL))
+      return SU_FALSE;
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_analyzer_set_psd_format(
+    suscan_analyzer_t *analyzer,
+    const struct suscan_psd_format *format)
+{
+  struct suscan_psd_format *copy;
+  unsigned int i;
+
+  for (i = 0; i < analyzer->source_count; ++i) {
+    SU_TRYCATCH(
+        copy = malloc(sizeof(struct suscan_psd_format)),
+        return SU_FALSE);
+
+    *copy = *format;
+
+    /* Applied by the detect stage, between two PSD updates */
+    if (!suscan_worker_push(
+        analyzer->source_list[i]->detect_wk,
+        suscan_detect_set_psd_format_cb,
+        copy)) {
+      free(copy);
+      return SU_FALSE;
+    }
+  }
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_analyzer_set_playback_speed(suscan_analyzer_t *analyzer, SUFLOAT speed)
+{
+  struct suscan_analyzer_source *source;
+  SUFLOAT *copy;
+  unsigned int i;
+  unsigned int changed = 0;
+
+  if (speed > 0 && speed < SUSCAN_THROTTLE_MIN_SPEED)
+    speed = SUSCAN_THROTTLE_MIN_SPEED;
+
+  /* Real time sources keep their own pace */
+  for (i = 0; i < analyzer->source_count; ++i) {
+    source = analyzer->source_list[i];
+
+    if (!source->throttle_enabled)
+      continue;
+
+    SU_TRYCATCH(copy = malloc(sizeof(SUFLOAT)), return SU_FALSE);
+
+    *copy = speed;
+
+    if (!suscan_worker_push(
+        source->source_wk,
+        suscan_source_set_speed_cb,
+        copy)) {
+      free(copy);
+      return SU_FALSE;
+    }
+
+    ++changed;
+  }
+
+  if (changed == 0) {
+    SU_ERROR("Playback speed of analyzer sources cannot be changed\n");
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_analyzer_start_recording(
+    suscan_analyzer_t *analyzer,
+    uint32_t source_id,
+    const struct suscan_recorder_params *params)
+{
+  struct suscan_analyzer_source *source;
+
+  if (analyzer->recorder != NULL) {
+    SU_ERROR("Analyzer is already recording\n");
+    return SU_FALSE;
+  }
+
+  if ((source = suscan_analyzer_get_source(analyzer, source_id)) == NULL) {
+    SU_ERROR("No such source: %u\n", source_id);
+    return SU_FALSE;
+  }
+
+  if ((analyzer->recorder = suscan_recorder_new(
+      params,
+      source->block,
+      source->tuning.fc,
+      source->tuning.samp_rate,
+      analyzer->read_size)) == NULL) {
+    SU_ERROR("Failed to create recorder\n");
     return SU_FALSE;
+  }
 
-  /* Increment next consumer counter */
-  analyzer->next_consumer =
-      (analyzer->next_consumer + 1) % analyzer->consumer_count;
+  analyzer->recorder_source_id = source_id;
 
   return SU_TRUE;
 }
 
+SUBOOL
+suscan_analyzer_stop_recording(suscan_analyzer_t *analyzer)
+{
+  suscan_recorder_t *recorder = analyzer->recorder;
+  uint64_t dropped;
+
+  if (recorder == NULL)
+    return SU_TRUE;
+
+  analyzer->recorder = NULL;
+
+  if ((dropped = suscan_recorder_get_dropped(recorder)) > 0)
+    SU_WARNING(
+        "Recorder dropped %llu samples\n",
+        (unsigned long long) dropped);
+
+  return suscan_recorder_destroy(recorder);
+}
+
 void
 suscan_analyzer_destroy(suscan_analyzer_t *analyzer)
 {
+  struct suscan_handle_table *table = &analyzer->inspector_table;
+  suscan_inspector_t *insp;
   uint32_t type;
   unsigned int i;
 
@@ -603,15 +2276,9 @@ suscan_analyzer_destroy(suscan_analyzer_t *analyzer)
     }
   }
 
-  /* We attempt to wakeup all threads by marking the source as EOS */
-  if (analyzer->source.block != NULL)
-    su_block_force_eos(analyzer->source.block, 0);
-
-  if (analyzer->source_wk != NULL)
-    if (!suscan_analyzer_halt_worker(analyzer->source_wk)) {
-      SU_ERROR("Source worker destruction failed, memory leak ahead\n");
+  for (i = 0; i < analyzer->source_count; ++i)
+    if (!suscan_analyzer_source_halt(analyzer->source_list[i]))
       return;
-    }
 
   for (i = 0; i < analyzer->consumer_count; ++i)
     if (analyzer->consumer_list[i] != NULL)
@@ -627,20 +2294,26 @@ suscan_analyzer_destroy(suscan_analyzer_t *analyzer)
   if (analyzer->consumer_list != NULL)
     free(analyzer->consumer_list);
 
-  /* Free read buffer */
-  if (analyzer->read_buf != NULL)
-    free(analyzer->read_buf);
+  /* Source is at EOS now: recorder can be flushed safely */
+  if (analyzer->recorder != NULL)
+    if (!suscan_recorder_destroy(analyzer->recorder)) {
+      SU_ERROR("Recorder destruction failed, memory leak ahead\n");
+      return;
+    }
 
-  /* Remove all channel analyzers */
-  for (i = 0; i < analyzer->inspector_count; ++i)
-    if (analyzer->inspector_list[i] != NULL)
-      suscan_inspector_destroy(analyzer->inspector_list[i]);
+  /* Remove all channel analyzers, including those being closed */
+  for (i = 0; i < suscan_handle_table_get_size(table); ++i)
+    if ((insp = suscan_handle_table_at(table, i, NULL)) != NULL)
+      suscan_inspector_destroy(insp);
 
-  if (analyzer->inspector_list != NULL)
-    free(analyzer->inspector_list);
+  suscan_handle_table_finalize(table);
 
   /* Delete source information */
-  suscan_analyzer_source_finalize(&analyzer->source);
+  for (i = 0; i < analyzer->source_count; ++i)
+    suscan_analyzer_source_destroy(analyzer->source_list[i]);
+
+  if (analyzer->source_list != NULL)
+    free(analyzer->source_list);
 
   suscan_mq_finalize(&analyzer->mq_in);
 
@@ -648,16 +2321,23 @@ suscan_analyzer_destroy(suscan_analyzer_t *analyzer)
 }
 
 suscan_analyzer_t *
-suscan_analyzer_new(
+suscan_analyzer_new_multi(
     const struct suscan_analyzer_params *params,
-    struct suscan_source_config *config,
+    struct suscan_source_config **config_list,
+    unsigned int config_count,
     struct suscan_mq *mq)
 {
   suscan_analyzer_t *analyzer = NULL;
+  struct suscan_analyzer_source *source;
   suscan_consumer_t *consumer;
   unsigned int worker_count;
   unsigned int i;
 
+  if (config_count == 0) {
+    SU_ERROR("Analyzer needs at least one source\n");
+    goto fail;
+  }
+
   if ((analyzer = calloc(1, sizeof (suscan_analyzer_t))) == NULL) {
     SU_ERROR("Cannot allocate analyzer\n");
     goto fail;
@@ -665,14 +2345,12 @@ suscan_analyzer_new(
 
   analyzer->params = *params;
 
-  /* Allocate read buffer */
-  if ((analyzer->read_buf = malloc(config->bufsiz * sizeof(SUCOMPLEX)))
-      == NULL) {
-    SU_ERROR("Failed to allocate read buffer\n");
-    goto fail;
-  }
+  suscan_handle_table_init(&analyzer->inspector_table);
 
-  analyzer->read_size = config->bufsiz;
+  /* Consumer buffers must fit a read of any source */
+  for (i = 0; i < config_count; ++i)
+    if (config_list[i]->bufsiz > analyzer->read_size)
+      analyzer->read_size = config_list[i]->bufsiz;
 
   /* Create input message queue */
   if (!suscan_mq_init(&analyzer->mq_in)) {
@@ -680,21 +2358,28 @@ suscan_analyzer_new(
     goto fail;
   }
 
-  /* Initialize source */
-  if (!suscan_analyzer_source_init(params, &analyzer->source, config)) {
-    SU_ERROR("Failed to initialize source\n");
-    goto fail;
-  }
+  /* Initialize sources */
+  for (i = 0; i < config_count; ++i) {
+    if ((source = suscan_analyzer_source_new(analyzer, i, config_list[i]))
+        == NULL) {
+      SU_ERROR("Failed to initialize source #%u\n", i);
+      goto fail;
+    }
 
-  /* Create source worker */
-  if ((analyzer->source_wk = suscan_worker_new(&analyzer->mq_in, analyzer))
-      == NULL) {
-    SU_ERROR("Cannot create source worker thread\n");
-    goto fail;
+    if (PTR_LIST_APPEND_CHECK(analyzer->source, source) == -1) {
+      SU_ERROR("Cannot append source to list\n");
+      if (suscan_analyzer_source_halt(source))
+        suscan_analyzer_source_destroy(source);
+      goto fail;
+    }
   }
 
   /* Create consumer workers */
-  worker_count = suscan_get_min_consumer_workers();
+  if ((worker_count = params->consumer_count) == 0)
+    worker_count = suscan_get_min_consumer_workers();
+  if (worker_count < config_count)
+    worker_count = config_count;
+
   for (i = 0; i < worker_count; ++i) {
     if ((consumer = suscan_consumer_new(analyzer)) == NULL) {
       SU_ERROR("Failed to create consumer object\n");
@@ -729,3 +2414,12 @@ fail:
 
   return NULL;
 }
+
+suscan_analyzer_t *
+suscan_analyzer_new(
+    const struct suscan_analyzer_params *params,
+    struct suscan_source_config *config,
+    struct suscan_mq *mq)
+{
+  return suscan_analyzer_new_multi(params, &config, 1, mq);
+}
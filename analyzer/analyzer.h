@@ -27,27 +27,100 @@
 #include "worker.h"
 #include "source.h"
 #include "throttle.h"
+#include "pipeline.h"
+#include "psd.h"
+#include "tracker.h"
+#include "autotune.h"
+#include "sweep.h"
 #include "inspector.h"
 #include "consumer.h"
+#include "recorder.h"
+
+enum suscan_analyzer_psd_mode {
+  SUSCAN_ANALYZER_PSD_MODE_DETECTOR, /* Channel detector spectrum */
+  SUSCAN_ANALYZER_PSD_MODE_WELCH     /* Overlapped, averaged periodograms */
+};
 
 struct suscan_analyzer_params {
   struct sigutils_channel_detector_params detector_params;
   SUFLOAT  channel_update_int;
   SUFLOAT  psd_update_int;
+  SUFLOAT  playback_speed; /* Non-real time sources. <= 0: unthrottled */
+  enum suscan_analyzer_psd_mode psd_mode;
+  struct suscan_psd_params psd_params; /* Welch mode only */
+  struct suscan_psd_format psd_format;
+  SUBOOL   channel_deltas; /* Send changes instead of full channel lists */
+  enum suscan_autotune_profile read_profile; /* Read size autotuning */
+  unsigned int consumer_count; /* Initial consumers. 0: one per CPU, minus 1 */
 };
 
 #define suscan_analyzer_params_INITIALIZER {                                \
   sigutils_channel_detector_params_INITIALIZER, /* detector_params */       \
   .1,                                           /* channel_update_int */    \
-  .04                                           /* psd_update_int */        \
+  .04,                                          /* psd_update_int */        \
+  1,                                            /* playback_speed */        \
+  SUSCAN_ANALYZER_PSD_MODE_DETECTOR,            /* psd_mode */              \
+  suscan_psd_params_INITIALIZER,                /* psd_params */            \
+  suscan_psd_format_INITIALIZER,                /* psd_format */            \
+  SU_TRUE,                                      /* channel_deltas */        \
+  SUSCAN_AUTOTUNE_PROFILE_NONE,                 /* read_profile */          \
+  0                                             /* consumer_count */        \
 }
 
+/*
+ * Timing of a pipeline stage. Each iteration is split in the time spent
+ * waiting for the other stage (stall) and the time spent working (busy).
+ * For the acquire stage, busy time includes waiting for the device.
+ */
+struct suscan_analyzer_stage_stats {
+  SUFLOAT busy;  /* Fraction of time working (EWMA) */
+  SUFLOAT stall; /* Fraction of time waiting for the other stage (EWMA) */
+  struct timespec start;
+  struct timespec ready;
+  uint64_t last_busy_ns;  /* Of the last iteration */
+  uint64_t last_total_ns;
+};
+
+/*
+ * Distribution of the busy time of a pipeline stage, per iteration, in
+ * quarter-octave bins of nanoseconds. Unlike usage statistics, it is
+ * never reset: it covers the whole life of the source. Other threads
+ * read it through suscan_analyzer_source_get_counters.
+ */
+#define SUSCAN_ANALYZER_LATENCY_BINS 256
+
+struct suscan_analyzer_latency {
+  uint64_t bins[SUSCAN_ANALYZER_LATENCY_BINS];
+};
+
+/* Busy time below which a fraction p (0 to 1) of the iterations fall */
+uint64_t suscan_analyzer_latency_get_percentile(
+    const struct suscan_analyzer_latency *latency,
+    SUFLOAT p);
+
+struct suscan_analyzer;
+
+/*
+ * Each source has its own acquire and detect stages. Sources of the same
+ * analyzer share its consumer workers, inspectors and output queue.
+ */
 struct suscan_analyzer_source {
+  uint32_t id; /* Index in the source list, used to tag messages */
+  struct suscan_analyzer *analyzer;
   struct suscan_source_config *config;
   su_block_t *block;
   su_block_port_t port; /* Master reading port */
   suscan_throttle_t throttle; /* Throttle object */
+  SUBOOL throttle_enabled; /* Non-real time sources only */
+  SUFLOAT speed; /* Playback speed. <= 0: as fast as consumers allow */
   su_channel_detector_t *detector; /* Channel detector */
+  SUBOOL channel_deltas;
+  suscan_tracker_t tracker; /* Stable channel IDs, for deltas */
+  suscan_psd_t *psd; /* Welch estimator (if enabled) */
+  SUFLOAT *psd_scratch; /* Welch estimator output */
+  struct suscan_psd_format psd_format; /* Of PSD messages */
+  SUFLOAT *psd_hold; /* Peak hold state */
+  SUSCOUNT psd_hold_size;
   struct xsig_source *instance;
 
   SUFLOAT interval_channels;
@@ -55,47 +128,105 @@ struct suscan_analyzer_source {
 
   SUSCOUNT per_cnt_channels;
   SUSCOUNT per_cnt_psd;
+  uint64_t detector_samples; /* Fed to the detector outside sweeps */
+  uint64_t detector_ns; /* Time spent feeding them */
   uint64_t fc; /* Center frequency of source */
+  uint64_t samp_rate; /* Acquire stage. Detect stage uses detector params */
+  void *retune_pending; /* Retune message, for the next pipeline slot */
+
+  const uint64_t *lost; /* Samples lost by the source, if reported */
+  uint64_t lost_reported;
+
+  /* Virtual clock: time of the first sample plus samples consumed */
+  struct timespec vt0;
+  uint64_t consumed; /* Detect stage */
+  uint64_t read_pos; /* Acquire stage */
+
+  /* Current tuning, as seen by the analyzer thread and inspectors */
+  struct suscan_source_tuning tuning;
+  SUBOOL eos;
+
+  /* Usage statistics, per pipeline stage */
+  struct suscan_analyzer_stage_stats acquire_stats;
+  struct suscan_analyzer_stage_stats detect_stats;
+  struct suscan_analyzer_latency acquire_latency;
+  struct suscan_analyzer_latency detect_latency;
+  pthread_mutex_t counter_lock; /* Of consumed, latencies and sweep_req */
+
+  suscan_worker_t *source_wk; /* Acquire stage */
+  suscan_worker_t *detect_wk; /* Detect stage: channel detector and PSD */
+  suscan_pipeline_t pipeline; /* Buffers from acquire to detect stage */
+  suscan_autotune_t autotune; /* Acquire stage read size */
+  suscan_sweep_t *sweep; /* Wideband sweep in progress (detect stage) */
+  uint32_t sweep_serial; /* Of the last sweep step requested */
+  uint32_t sweep_req; /* Sweep starts, stops and client retunes so far */
+  uint32_t sweep_req_active; /* The one the sweep in progress started on */
 };
 
-struct suscan_analyzer;
+SUINLINE SUBOOL
+suscan_analyzer_source_is_throttled(
+    const struct suscan_analyzer_source *source)
+{
+  return source->throttle_enabled && source->speed > 0;
+}
+
+void suscan_analyzer_source_get_time(
+    const struct suscan_analyzer_source *source,
+    struct timespec *ts);
+
+/* Snapshot of the counters of a source, from any thread. NULL skips */
+void suscan_analyzer_source_get_counters(
+    struct suscan_analyzer_source *source,
+    uint64_t *consumed,
+    struct suscan_analyzer_latency *acquire_latency,
+    struct suscan_analyzer_latency *detect_latency);
+
+SUBOOL suscan_analyzer_source_prepare_psd_hold(
+    struct suscan_analyzer_source *source,
+    SUSCOUNT size);
 
 struct suscan_analyzer {
   struct suscan_mq mq_in;   /* To-thread messages */
   struct suscan_mq *mq_out; /* From-thread messages */
   SUBOOL running;
   SUBOOL halt_requested;
-  SUBOOL eos;
 
   /* Analyzer parameters */
   struct suscan_analyzer_params params;
 
-  /* Usage statistics (CPU, etc) */
-  SUFLOAT cpu_usage;
-  struct timespec read_start;
-  struct timespec process_start;
-  struct timespec process_end;
+  /* Source objects, with their own workers */
+  PTR_LIST(struct suscan_analyzer_source, source);
+  SUSCOUNT   read_size; /* Consumer and recorder buffers */
 
-  /* Source worker objects */
-  struct suscan_analyzer_source source;
-  suscan_worker_t *source_wk; /* Used by one source only */
-  SUCOMPLEX *read_buf;
-  SUSCOUNT   read_size;
+  /* Sample recorder (optional) */
+  suscan_recorder_t *recorder;
+  uint32_t recorder_source_id;
 
-  /* Inspector objects */
-  PTR_LIST(suscan_inspector_t, inspector);
+  /* Inspector objects. Only touched by the analyzer thread */
+  struct suscan_handle_table inspector_table;
 
   /* Consumer workers (initially idle) */
   PTR_LIST(suscan_consumer_t, consumer);
 
   unsigned int next_consumer; /* Next consumer worker to use */
 
+  uint32_t next_req_id; /* See suscan_analyzer_alloc_req_id */
+
   /* Analyzer thread */
   pthread_t thread;
 };
 
 typedef struct suscan_analyzer suscan_analyzer_t;
 
+SUINLINE struct suscan_analyzer_source *
+suscan_analyzer_get_source(const suscan_analyzer_t *analyzer, uint32_t id)
+{
+  if (id >= analyzer->source_count)
+    return NULL;
+
+  return analyzer->source_list[id];
+}
+
 void *suscan_analyzer_read(suscan_analyzer_t *analyzer, uint32_t *type);
 struct suscan_analyzer_inspector_msg *suscan_analyzer_read_inspector_msg(
     suscan_analyzer_t *analyzer);
@@ -103,6 +234,9 @@ SUBOOL suscan_analyzer_write(
     suscan_analyzer_t *analyzer,
     uint32_t type,
     void *priv);
+
+/* Request IDs for responses that must be told apart. Never 0 */
+uint32_t suscan_analyzer_alloc_req_id(suscan_analyzer_t *analyzer);
 void suscan_analyzer_consume_mq(struct suscan_mq *mq);
 void suscan_analyzer_dispose_message(uint32_t type, void *ptr);
 void suscan_analyzer_destroy(suscan_analyzer_t *analyzer);
@@ -112,22 +246,146 @@ suscan_analyzer_t *suscan_analyzer_new(
     const struct suscan_analyzer_params *params,
     struct suscan_source_config *config,
     struct suscan_mq *mq);
+suscan_analyzer_t *suscan_analyzer_new_multi(
+    const struct suscan_analyzer_params *params,
+    struct suscan_source_config **config_list,
+    unsigned int config_count,
+    struct suscan_mq *mq);
 SUBOOL suscan_analyzer_push_task(
     suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_source *source,
     SUBOOL (*func) (
           struct suscan_mq *mq_out,
           void *wk_private,
           void *cb_private),
     void *private);
 
+/* Playback control (seekable sources only) */
+SUBOOL suscan_analyzer_seek_async(
+    suscan_analyzer_t *analyzer,
+    uint32_t source_id,
+    SUFLOAT offset,
+    uint32_t req_id);
+
+/* Source retune (sources with retune method only) */
+SUBOOL suscan_analyzer_retune_async(
+    suscan_analyzer_t *analyzer,
+    uint32_t source_id,
+    const struct suscan_source_tuning *tuning,
+    uint32_t req_id);
+
+/*
+ * Wideband sweep (sources with retune method only). While sweeping,
+ * regular channel and PSD updates of the source are replaced by one
+ * sweep message per completed sweep. Retuning the source stops the sweep.
+ */
+SUBOOL suscan_analyzer_start_sweep(
+    suscan_analyzer_t *analyzer,
+    uint32_t source_id,
+    const struct suscan_sweep_params *params);
+SUBOOL suscan_analyzer_stop_sweep(
+    suscan_analyzer_t *analyzer,
+    uint32_t source_id);
+
+/* Update intervals and channel detector parameters (all sources) */
+SUBOOL suscan_analyzer_set_params_async(
+    suscan_analyzer_t *analyzer,
+    const struct suscan_analyzer_params *params,
+    uint32_t req_id);
+
+/* Full channel list of every source, for clients receiving deltas */
+SUBOOL suscan_analyzer_request_channels(suscan_analyzer_t *analyzer);
+
+/* Spectrum message format */
+SUBOOL suscan_analyzer_set_psd_format(
+    suscan_analyzer_t *analyzer,
+    const struct suscan_psd_format *format);
+
+/* Playback control (all non-real time sources) */
+SUBOOL suscan_analyzer_set_playback_speed(
+    suscan_analyzer_t *analyzer,
+    SUFLOAT speed);
+
+/* Sample recording */
+SUBOOL suscan_analyzer_start_recording(
+    suscan_analyzer_t *analyzer,
+    uint32_t source_id,
+    const struct suscan_recorder_params *params);
+
+SUBOOL suscan_analyzer_stop_recording(suscan_analyzer_t *analyzer);
+
+/*
+ * Inspector futures. Requests are sent right away, and each future picks
+ * its own response from the output queue, leaving other messages in
+ * place. Many requests may be in flight at once, and their futures may be
+ * waited for in any order. Responses must not be read from the queue by
+ * other means (e.g. suscan_analyzer_read) while futures wait for them.
+ */
+struct suscan_inspector_future {
+  suscan_analyzer_t *analyzer;
+  uint32_t req_id;
+  uint32_t kind; /* Expected response kind (from msg.h) */
+  struct suscan_analyzer_inspector_msg *resp; /* NULL until resolved */
+};
+
+typedef struct suscan_inspector_future suscan_inspector_future_t;
+
+SUBOOL suscan_inspector_open_begin(
+    suscan_analyzer_t *analyzer,
+    uint32_t source_id,
+    const struct sigutils_channel *channel,
+    suscan_inspector_future_t *future);
+
+SUBOOL suscan_inspector_close_begin(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    suscan_inspector_future_t *future);
+
+SUBOOL suscan_inspector_get_info_begin(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    suscan_inspector_future_t *future);
+
+SUBOOL suscan_inspector_set_params_begin(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    const struct suscan_inspector_params *params,
+    suscan_inspector_future_t *future);
+
+/* Non-blocking. SU_TRUE once the response is in future->resp */
+SUBOOL suscan_inspector_future_poll(suscan_inspector_future_t *future);
+
+/*
+ * Blocks until the response arrives. Returns SU_FALSE if the analyzer
+ * refused the request (e.g. wrong handle)
+ */
+SUBOOL suscan_inspector_future_wait(suscan_inspector_future_t *future);
+
+/* Releases the response. Futures must be waited for before */
+void suscan_inspector_future_finalize(suscan_inspector_future_t *future);
+
+/*
+ * Inspector batches. The request is sent to the analyzer, and its reply
+ * (the same message, with per-entry results) is returned. Other messages
+ * are left in the output queue. Ownership of req is taken, even on
+ * failure. Entries are filled by the caller: see msg.h.
+ */
+struct suscan_analyzer_inspector_batch_msg;
+
+struct suscan_analyzer_inspector_batch_msg *suscan_inspector_batch_call(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_inspector_batch_msg *req);
+
 /* Baud inspector operations */
 SUBOOL suscan_inspector_open_async(
     suscan_analyzer_t *analyzer,
+    uint32_t source_id,
     const struct sigutils_channel *channel,
     uint32_t req_id);
 
 SUHANDLE suscan_inspector_open(
     suscan_analyzer_t *analyzer,
+    uint32_t source_id,
     const struct sigutils_channel *channel);
 
 SUBOOL suscan_inspector_close_async(
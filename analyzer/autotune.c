@@ -0,0 +1,190 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#define SU_LOG_DOMAIN "autotune"
+
+#include "autotune.h"
+
+SUSCOUNT
+suscan_autotune_get_capacity(
+    enum suscan_autotune_profile profile,
+    SUSCOUNT size)
+{
+  if (profile == SUSCAN_AUTOTUNE_PROFILE_NONE)
+    return size;
+
+  return SU_MAX(size, SUSCAN_AUTOTUNE_MAX_SIZE);
+}
+
+SUPRIVATE void
+suscan_autotune_reset_window(suscan_autotune_t *autotune)
+{
+  autotune->blocks   = 0;
+  autotune->backlog  = 0;
+  autotune->samples  = 0;
+  autotune->busy_ns  = 0;
+  autotune->total_ns = 0;
+}
+
+SUPRIVATE SUSCOUNT
+suscan_autotune_clamp(const suscan_autotune_t *autotune, SUSCOUNT size)
+{
+  if (size < autotune->min_size)
+    return autotune->min_size;
+
+  if (size > autotune->max_size)
+    return autotune->max_size;
+
+  return size;
+}
+
+void
+suscan_autotune_set_samp_rate(
+    suscan_autotune_t *autotune,
+    SUSCOUNT samp_rate)
+{
+  SUSCOUNT bound;
+
+  if (autotune->profile == SUSCAN_AUTOTUNE_PROFILE_NONE)
+    return;
+
+  if (autotune->profile == SUSCAN_AUTOTUNE_PROFILE_LOW_LATENCY)
+    bound = samp_rate * SUSCAN_AUTOTUNE_LATENCY;
+  else
+    bound = samp_rate * SUSCAN_AUTOTUNE_BLOCK_TIME;
+
+  autotune->min_size = SU_MIN(SUSCAN_AUTOTUNE_MIN_SIZE, autotune->capacity);
+  autotune->max_size = SU_MAX(
+      autotune->min_size,
+      SU_MIN(bound, autotune->capacity));
+
+  autotune->size = suscan_autotune_clamp(autotune, autotune->size);
+
+  /* Costs measured at a different rate are meaningless */
+  autotune->last_cost = 0;
+  autotune->probing = SU_FALSE;
+  autotune->hold = 0;
+
+  suscan_autotune_reset_window(autotune);
+}
+
+void
+suscan_autotune_init(
+    suscan_autotune_t *autotune,
+    enum suscan_autotune_profile profile,
+    SUSCOUNT size,
+    SUSCOUNT capacity,
+    SUSCOUNT samp_rate)
+{
+  memset(autotune, 0, sizeof(suscan_autotune_t));
+
+  autotune->profile  = profile;
+  autotune->capacity = capacity;
+  autotune->size     = SU_MIN(size, capacity);
+  autotune->min_size = autotune->size;
+  autotune->max_size = autotune->size;
+
+  suscan_autotune_set_samp_rate(autotune, samp_rate);
+}
+
+SUPRIVATE SUSCOUNT
+suscan_autotune_next_size(suscan_autotune_t *autotune, SUFLOAT cost)
+{
+  SUSCOUNT size = autotune->size;
+  SUFLOAT load;
+
+  /* Detect stage falling behind: bigger blocks, whatever the profile */
+  if (autotune->backlog > SUSCAN_AUTOTUNE_WINDOW / 2) {
+    autotune->probing = SU_FALSE;
+    autotune->hold = SUSCAN_AUTOTUNE_HOLD;
+    return size << 1;
+  }
+
+  if (autotune->hold > 0) {
+    --autotune->hold;
+    return size;
+  }
+
+  switch (autotune->profile) {
+    case SUSCAN_AUTOTUNE_PROFILE_LOW_LATENCY:
+      load = autotune->total_ns > 0
+          ? (SUFLOAT) autotune->busy_ns / autotune->total_ns
+          : 1;
+
+      if (load < SUSCAN_AUTOTUNE_IDLE_LOAD)
+        size >>= 1;
+      break;
+
+    case SUSCAN_AUTOTUNE_PROFILE_THROUGHPUT:
+      if (autotune->probing
+          && cost > autotune->last_cost * (1 - SUSCAN_AUTOTUNE_MIN_GAIN)) {
+        /* Per-block overhead no longer dominates: go back */
+        autotune->probing = SU_FALSE;
+        autotune->hold = SUSCAN_AUTOTUNE_HOLD;
+        size >>= 1;
+      } else {
+        autotune->probing = size < autotune->max_size;
+        size <<= 1;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  return size;
+}
+
+void
+suscan_autotune_feed(
+    suscan_autotune_t *autotune,
+    SUSCOUNT got,
+    uint64_t busy_ns,
+    uint64_t total_ns,
+    unsigned int waiting)
+{
+  SUFLOAT cost;
+
+  if (autotune->profile == SUSCAN_AUTOTUNE_PROFILE_NONE)
+    return;
+
+  ++autotune->blocks;
+  autotune->samples  += got;
+  autotune->busy_ns  += busy_ns;
+  autotune->total_ns += total_ns;
+
+  if (waiting > 0)
+    ++autotune->backlog;
+
+  if (autotune->blocks < SUSCAN_AUTOTUNE_WINDOW || autotune->samples == 0)
+    return;
+
+  cost = (SUFLOAT) autotune->busy_ns / autotune->samples;
+
+  autotune->size = suscan_autotune_clamp(
+      autotune,
+      suscan_autotune_next_size(autotune, cost));
+
+  autotune->last_cost = cost;
+
+  suscan_autotune_reset_window(autotune);
+}
@@ -0,0 +1,111 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _AUTOTUNE_H
+#define _AUTOTUNE_H
+
+#include <stdint.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Read size autotuner. Fed by the detect stage with the processing time
+ * of each block and the number of blocks waiting behind it. Every
+ * SUSCAN_AUTOTUNE_WINDOW blocks, the read size of the acquire stage may be
+ * doubled or halved:
+ *
+ * - If blocks pile up in the pipeline, the detect stage is not keeping
+ *   up: grow, to amortize the per-block overhead. This applies to both
+ *   profiles.
+ * - Low latency: shrink while the detect stage is mostly idle, and never
+ *   read more than SUSCAN_AUTOTUNE_LATENCY seconds of signal per block.
+ * - Throughput: grow while the processing cost per sample keeps
+ *   dropping, up to SUSCAN_AUTOTUNE_BLOCK_TIME seconds of signal.
+ *
+ * After a change that was not worth it, the size is held for
+ * SUSCAN_AUTOTUNE_HOLD windows before probing again.
+ */
+#define SUSCAN_AUTOTUNE_WINDOW     32
+#define SUSCAN_AUTOTUNE_HOLD       64
+#define SUSCAN_AUTOTUNE_MIN_SIZE   512
+#define SUSCAN_AUTOTUNE_MAX_SIZE   65536
+#define SUSCAN_AUTOTUNE_LATENCY    .01  /* Seconds */
+#define SUSCAN_AUTOTUNE_BLOCK_TIME .1   /* Seconds */
+#define SUSCAN_AUTOTUNE_MIN_GAIN   .05  /* Relative cost decrease worth it */
+#define SUSCAN_AUTOTUNE_IDLE_LOAD  .5   /* Low latency: shrink below this */
+
+enum suscan_autotune_profile {
+  SUSCAN_AUTOTUNE_PROFILE_NONE, /* Fixed read size */
+  SUSCAN_AUTOTUNE_PROFILE_LOW_LATENCY,
+  SUSCAN_AUTOTUNE_PROFILE_THROUGHPUT
+};
+
+struct suscan_autotune {
+  enum suscan_autotune_profile profile;
+  SUSCOUNT capacity; /* Of pipeline buffers */
+  SUSCOUNT min_size;
+  SUSCOUNT max_size;
+  SUSCOUNT size;     /* Current read size. Detect stage only */
+
+  /* Current window */
+  unsigned int blocks;
+  unsigned int backlog; /* Blocks with others waiting behind */
+  uint64_t samples;
+  uint64_t busy_ns;
+  uint64_t total_ns;
+
+  SUFLOAT last_cost; /* ns per sample in the previous window. 0: unknown */
+  SUBOOL probing;    /* Last window grew the size to see if it paid off */
+  unsigned int hold; /* Windows left before probing again */
+};
+
+typedef struct suscan_autotune suscan_autotune_t;
+
+void suscan_autotune_init(
+    suscan_autotune_t *autotune,
+    enum suscan_autotune_profile profile,
+    SUSCOUNT size,
+    SUSCOUNT capacity,
+    SUSCOUNT samp_rate);
+
+/* Recomputes bounds, e.g. after retuning the source */
+void suscan_autotune_set_samp_rate(
+    suscan_autotune_t *autotune,
+    SUSCOUNT samp_rate);
+
+/* Pipeline buffer size needed by a profile */
+SUSCOUNT suscan_autotune_get_capacity(
+    enum suscan_autotune_profile profile,
+    SUSCOUNT size);
+
+void suscan_autotune_feed(
+    suscan_autotune_t *autotune,
+    SUSCOUNT got,
+    uint64_t busy_ns,
+    uint64_t total_ns,
+    unsigned int waiting);
+
+/* Handed to the acquire stage through the pipeline */
+SUINLINE SUSCOUNT
+suscan_autotune_get_size(const suscan_autotune_t *autotune)
+{
+  return autotune->size;
+}
+
+#endif /* _AUTOTUNE_H */
@@ -0,0 +1,401 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define SU_LOG_DOMAIN "capture"
+
+#include <sigutils/sigutils.h>
+
+#include "capture.h"
+#include "recorder.h"
+
+/******************************* I/O helpers *********************************/
+SUPRIVATE SUBOOL
+suscan_capture_pread_all(int fd, void *data, size_t size, uint64_t offset)
+{
+  uint8_t *as_bytes = (uint8_t *) data;
+  ssize_t got;
+
+  while (size > 0) {
+    if ((got = pread(fd, as_bytes, size, offset)) < 0) {
+      if (errno == EINTR)
+        continue;
+      return SU_FALSE;
+    } else if (got == 0) {
+      return SU_FALSE; /* Truncated file */
+    }
+
+    as_bytes += got;
+    offset   += got;
+    size     -= got;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_capture_pwrite_all(
+    int fd,
+    const void *data,
+    size_t size,
+    uint64_t offset)
+{
+  const uint8_t *as_bytes = (const uint8_t *) data;
+  ssize_t got;
+
+  while (size > 0) {
+    if ((got = pwrite(fd, as_bytes, size, offset)) < 0) {
+      if (errno == EINTR)
+        continue;
+      return SU_FALSE;
+    }
+
+    as_bytes += got;
+    offset   += got;
+    size     -= got;
+  }
+
+  return SU_TRUE;
+}
+
+/***************************** Writer helpers ********************************/
+void
+suscan_capture_header_init(
+    struct suscan_capture_header *header,
+    uint32_t format,
+    uint32_t chunk_samples,
+    uint64_t samp_rate,
+    uint64_t fc,
+    const struct timespec *start)
+{
+  memset(header, 0, sizeof(struct suscan_capture_header));
+
+  memcpy(header->magic, SUSCAN_CAPTURE_MAGIC, SUSCAN_CAPTURE_MAGIC_SIZE);
+  header->version       = SUSCAN_CAPTURE_VERSION;
+  header->format        = format;
+  header->chunk_samples = chunk_samples;
+  header->samp_rate     = samp_rate;
+  header->fc            = fc;
+  header->start_sec     = start->tv_sec;
+  header->start_nsec    = start->tv_nsec;
+}
+
+SUBOOL
+suscan_capture_write_header(
+    int fd,
+    const struct suscan_capture_header *header)
+{
+  return suscan_capture_pwrite_all(
+      fd,
+      header,
+      sizeof(struct suscan_capture_header),
+      0);
+}
+
+SUBOOL
+suscan_capture_write_index(
+    int fd,
+    struct suscan_capture_header *header,
+    const struct suscan_capture_index_entry *index,
+    uint64_t count)
+{
+  size_t chunk_size;
+  uint64_t offset;
+
+  chunk_size = sizeof(struct suscan_capture_chunk_header)
+      + header->chunk_samples
+      * suscan_recorder_format_get_samp_size(header->format);
+
+  offset = suscan_capture_get_chunk_offset(chunk_size, count);
+
+  SU_TRYCATCH(
+      suscan_capture_pwrite_all(
+          fd,
+          index,
+          count * sizeof(struct suscan_capture_index_entry),
+          offset),
+      return SU_FALSE);
+
+  /* Index is in place, now we can make it visible */
+  header->chunk_count  = count;
+  header->index_offset = offset;
+
+  return suscan_capture_write_header(fd, header);
+}
+
+/****************************** Reader API ***********************************/
+SUPRIVATE SUBOOL
+suscan_capture_load_index(suscan_capture_t *capture)
+{
+  SU_TRYCATCH(
+      capture->index = malloc(
+          capture->chunk_count * sizeof(struct suscan_capture_index_entry)),
+      return SU_FALSE);
+
+  return suscan_capture_pread_all(
+      capture->fd,
+      capture->index,
+      capture->chunk_count * sizeof(struct suscan_capture_index_entry),
+      capture->header.index_offset);
+}
+
+SUPRIVATE SUBOOL
+suscan_capture_rebuild_index(suscan_capture_t *capture)
+{
+  struct suscan_capture_chunk_header chunk;
+  struct stat sbuf;
+  uint64_t max_chunks;
+  uint64_t i;
+
+  SU_TRYCATCH(fstat(capture->fd, &sbuf) != -1, return SU_FALSE);
+
+  if (sbuf.st_size <= SUSCAN_CAPTURE_HEADER_SIZE)
+    return SU_TRUE; /* Empty capture */
+
+  max_chunks = (sbuf.st_size - SUSCAN_CAPTURE_HEADER_SIZE)
+      / capture->chunk_size;
+
+  if (max_chunks == 0)
+    return SU_TRUE;
+
+  SU_TRYCATCH(
+      capture->index = malloc(
+          max_chunks * sizeof(struct suscan_capture_index_entry)),
+      return SU_FALSE);
+
+  for (i = 0; i < max_chunks; ++i) {
+    if (!suscan_capture_pread_all(
+        capture->fd,
+        &chunk,
+        sizeof(struct suscan_capture_chunk_header),
+        suscan_capture_get_chunk_offset(capture->chunk_size, i)))
+      break;
+
+    /* Stop at the first chunk that was not completely written */
+    if (chunk.seq != i || chunk.count > capture->header.chunk_samples)
+      break;
+
+    capture->index[i].first_sample = chunk.first_sample;
+    capture->index[i].count        = chunk.count;
+    capture->index[i].reserved     = 0;
+  }
+
+  capture->chunk_count = i;
+
+  return SU_TRUE;
+}
+
+suscan_capture_t *
+suscan_capture_open(const char *path)
+{
+  suscan_capture_t *new = NULL;
+  const struct suscan_capture_index_entry *last;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_capture_t)), goto fail);
+
+  new->fd = -1;
+
+  if ((new->fd = open(path, O_RDONLY)) == -1) {
+    SU_ERROR("Cannot open `%s': %s\n", path, strerror(errno));
+    goto fail;
+  }
+
+  if (!suscan_capture_pread_all(
+      new->fd,
+      &new->header,
+      sizeof(struct suscan_capture_header),
+      0)
+      || memcmp(
+          new->header.magic,
+          SUSCAN_CAPTURE_MAGIC,
+          SUSCAN_CAPTURE_MAGIC_SIZE) != 0) {
+    SU_ERROR("`%s' is not a capture file\n", path);
+    goto fail;
+  }
+
+  if (new->header.version != SUSCAN_CAPTURE_VERSION) {
+    SU_ERROR(
+        "`%s': unsupported capture version %d\n",
+        path,
+        new->header.version);
+    goto fail;
+  }
+
+  if ((new->samp_size =
+      suscan_recorder_format_get_samp_size(new->header.format)) == 0
+      || new->header.chunk_samples == 0
+      || new->header.samp_rate == 0) {
+    SU_ERROR("`%s': corrupted capture header\n", path);
+    goto fail;
+  }
+
+  new->chunk_size = sizeof(struct suscan_capture_chunk_header)
+      + new->header.chunk_samples * new->samp_size;
+
+  if (new->header.index_offset != 0 && new->header.chunk_count != 0) {
+    new->chunk_count = new->header.chunk_count;
+    SU_TRYCATCH(suscan_capture_load_index(new), goto fail);
+  } else {
+    SU_WARNING("`%s': capture index not found, rebuilding\n", path);
+    SU_TRYCATCH(suscan_capture_rebuild_index(new), goto fail);
+  }
+
+  if (new->chunk_count > 0) {
+    last = new->index + new->chunk_count - 1;
+    new->total_samples = last->first_sample + last->count;
+  }
+
+  SU_TRYCATCH(new->chunk_buf = malloc(new->chunk_size), goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_capture_close(new);
+
+  return NULL;
+}
+
+/*
+ * Chunks are closed early on every gap, so chunks cannot be found from
+ * chunk_samples. The index is sorted by first sample instead.
+ */
+uint64_t
+suscan_capture_get_next_chunk(
+    const suscan_capture_t *capture,
+    uint64_t sample)
+{
+  const struct suscan_capture_index_entry *index = capture->index;
+  uint64_t lo, hi, mid;
+
+  lo = 0;
+  hi = capture->chunk_count;
+
+  while (lo < hi) {
+    mid = (lo + hi) >> 1;
+    if (index[mid].first_sample <= sample)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+SUBOOL
+suscan_capture_lookup(
+    const suscan_capture_t *capture,
+    uint64_t sample,
+    uint64_t *chunk,
+    uint32_t *offset)
+{
+  const struct suscan_capture_index_entry *entry;
+  uint64_t next;
+
+  /* Last chunk starting at or before the sample */
+  if ((next = suscan_capture_get_next_chunk(capture, sample)) == 0)
+    return SU_FALSE;
+
+  entry = capture->index + next - 1;
+
+  /* Past its end: the sample was dropped, or is beyond the capture */
+  if (sample - entry->first_sample >= entry->count)
+    return SU_FALSE;
+
+  *chunk  = next - 1;
+  *offset = sample - entry->first_sample;
+
+  return SU_TRUE;
+}
+
+SUSDIFF
+suscan_capture_read_chunk(
+    suscan_capture_t *capture,
+    uint64_t chunk,
+    SUCOMPLEX *samples)
+{
+  const struct suscan_capture_chunk_header *header;
+  const float   *as_float;
+  const int16_t *as_int16;
+  const int8_t  *as_int8;
+  SUSCOUNT count;
+  SUSCOUNT i;
+
+  if (chunk >= capture->chunk_count)
+    return 0;
+
+  SU_TRYCATCH(
+      suscan_capture_pread_all(
+          capture->fd,
+          capture->chunk_buf,
+          capture->chunk_size,
+          suscan_capture_get_chunk_offset(capture->chunk_size, chunk)),
+      return -1);
+
+  header = (const struct suscan_capture_chunk_header *) capture->chunk_buf;
+
+  count = SU_MIN(header->count, capture->header.chunk_samples);
+
+  switch (capture->header.format) {
+    case SUSCAN_RECORDER_FORMAT_FLOAT32:
+      as_float = (const float *) (header + 1);
+      for (i = 0; i < count; ++i)
+        samples[i] = as_float[i << 1] + I * as_float[(i << 1) + 1];
+      break;
+
+    case SUSCAN_RECORDER_FORMAT_INT16:
+      as_int16 = (const int16_t *) (header + 1);
+      for (i = 0; i < count; ++i)
+        samples[i] =
+            as_int16[i << 1] / 32767. + I * as_int16[(i << 1) + 1] / 32767.;
+      break;
+
+    case SUSCAN_RECORDER_FORMAT_INT8:
+      as_int8 = (const int8_t *) (header + 1);
+      for (i = 0; i < count; ++i)
+        samples[i] =
+            as_int8[i << 1] / 127. + I * as_int8[(i << 1) + 1] / 127.;
+      break;
+  }
+
+  return count;
+}
+
+void
+suscan_capture_close(suscan_capture_t *capture)
+{
+  if (capture->fd != -1)
+    close(capture->fd);
+
+  if (capture->index != NULL)
+    free(capture->index);
+
+  if (capture->chunk_buf != NULL)
+    free(capture->chunk_buf);
+
+  free(capture);
+}
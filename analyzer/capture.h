@@ -0,0 +1,149 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include <stdint.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Suscan capture container. All integers are stored in host byte order.
+ *
+ *   +--------------------+  0
+ *   | File header        |
+ *   +--------------------+  SUSCAN_CAPTURE_HEADER_SIZE
+ *   | Chunk 0            |  chunk header + chunk_samples samples
+ *   +--------------------+  SUSCAN_CAPTURE_HEADER_SIZE + chunk_size
+ *   | Chunk 1            |
+ *   | ...                |
+ *   +--------------------+  index_offset
+ *   | Index              |  chunk_count index entries
+ *   +--------------------+
+ *
+ * All chunks have the same size on disk (the last one may be partially
+ * filled), so the offset of any chunk can be computed directly. Samples
+ * dropped during the recording show up as jumps in the first_sample
+ * field of consecutive chunks. The index is written when the capture is
+ * closed; if it is missing (e.g. the recorder crashed), it is rebuilt by
+ * scanning the chunk headers.
+ */
+
+#define SUSCAN_CAPTURE_MAGIC       "SUSCAPT1"
+#define SUSCAN_CAPTURE_MAGIC_SIZE  8
+#define SUSCAN_CAPTURE_VERSION     1
+#define SUSCAN_CAPTURE_HEADER_SIZE 4096
+#define SUSCAN_CAPTURE_CHUNK_SIZE  (1 << 20)
+
+struct suscan_capture_header {
+  char     magic[SUSCAN_CAPTURE_MAGIC_SIZE];
+  uint32_t version;
+  uint32_t format;        /* enum suscan_recorder_format */
+  uint32_t chunk_samples; /* Sample capacity of each chunk */
+  uint32_t reserved;
+  uint64_t samp_rate;
+  uint64_t fc;
+  uint64_t start_sec;     /* Wall clock time of the first sample */
+  uint64_t start_nsec;
+  uint64_t chunk_count;   /* Zero if the index was not written */
+  uint64_t index_offset;  /* Zero if the index was not written */
+};
+
+struct suscan_capture_chunk_header {
+  uint64_t seq;
+  uint64_t first_sample;  /* Stream position of the first sample */
+  uint64_t timestamp;     /* Reception time, in ns since the epoch */
+  uint32_t count;         /* Valid samples in this chunk */
+  uint32_t reserved;
+};
+
+struct suscan_capture_index_entry {
+  uint64_t first_sample;
+  uint32_t count;
+  uint32_t reserved;
+};
+
+struct suscan_capture {
+  int fd;
+  struct suscan_capture_header header;
+  size_t   samp_size;
+  size_t   chunk_size;
+
+  struct suscan_capture_index_entry *index;
+  uint64_t chunk_count;
+  uint64_t total_samples; /* Stream length, including gaps */
+
+  uint8_t *chunk_buf;
+};
+
+typedef struct suscan_capture suscan_capture_t;
+
+/***************************** Writer helpers ********************************/
+SUINLINE uint64_t
+suscan_capture_get_chunk_offset(size_t chunk_size, uint64_t chunk)
+{
+  return SUSCAN_CAPTURE_HEADER_SIZE + chunk * chunk_size;
+}
+
+void suscan_capture_header_init(
+    struct suscan_capture_header *header,
+    uint32_t format,
+    uint32_t chunk_samples,
+    uint64_t samp_rate,
+    uint64_t fc,
+    const struct timespec *start);
+
+SUBOOL suscan_capture_write_header(
+    int fd,
+    const struct suscan_capture_header *header);
+
+SUBOOL suscan_capture_write_index(
+    int fd,
+    struct suscan_capture_header *header,
+    const struct suscan_capture_index_entry *index,
+    uint64_t count);
+
+/***************************** Reader API ************************************/
+suscan_capture_t *suscan_capture_open(const char *path);
+
+/* First chunk starting after a sample, or chunk_count if none does */
+uint64_t suscan_capture_get_next_chunk(
+    const suscan_capture_t *capture,
+    uint64_t sample);
+
+/*
+ * Returns the chunk and the offset inside it where a sample is found.
+ * Fails if the sample was not recorded (in a gap or past the end).
+ */
+SUBOOL suscan_capture_lookup(
+    const suscan_capture_t *capture,
+    uint64_t sample,
+    uint64_t *chunk,
+    uint32_t *offset);
+
+/* Reads a whole chunk and converts it to complex samples */
+SUSDIFF suscan_capture_read_chunk(
+    suscan_capture_t *capture,
+    uint64_t chunk,
+    SUCOMPLEX *samples);
+
+void suscan_capture_close(suscan_capture_t *capture);
+
+#endif /* _CAPTURE_H */
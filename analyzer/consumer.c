@@ -92,8 +92,8 @@ suscan_consumer_cb(
           break;
 
         default:
-          suscan_analyzer_send_status(
-              consumer->analyzer,
+          suscan_analyzer_send_source_status(
+              consumer->source,
               SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
               got,
               "Consumer worker EOS");
@@ -137,9 +137,14 @@ suscan_consumer_get_buffer_pos(const suscan_consumer_t *consumer)
   return consumer->buffer_pos;
 }
 
+/*
+ * Consumers read from one source at a time. Tasks of a different source
+ * are refused until the consumer becomes idle.
+ */
 SUBOOL
 suscan_consumer_push_task(
     suscan_consumer_t *consumer,
+    struct suscan_analyzer_source *source,
     SUBOOL (*func) (
               struct suscan_mq *mq_out,
               void *wk_private,
@@ -153,11 +158,11 @@ suscan_consumer_push_task(
 
   mutex_acquired = SU_TRUE;
 
-  if (!consumer->consuming) {
-    if (!su_block_port_plug(
-        &consumer->port,
-        consumer->analyzer->source.block,
-        0)) {
+  if (consumer->consuming) {
+    if (consumer->source != source)
+      goto done;
+  } else {
+    if (!su_block_port_plug(&consumer->port, source->block, 0)) {
       SU_ERROR("Failed to push task: cannot plug port\n");
       goto done;
     }
@@ -174,6 +179,7 @@ suscan_consumer_push_task(
       goto done;
     }
 
+    consumer->source = source;
     consumer->consuming = SU_TRUE;
   }
 
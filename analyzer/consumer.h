@@ -26,12 +26,14 @@
 #define SUSCAN_CONSUMER_IDLE_COUNTER 30
 
 struct suscan_analyzer;
+struct suscan_analyzer_source;
 
 /* Per-worker object: used to centralize reads */
 struct suscan_consumer {
   pthread_mutex_t lock; /* Must be recursive */
   suscan_worker_t *worker;
   struct suscan_analyzer *analyzer;
+  struct suscan_analyzer_source *source; /* Being read, while consuming */
   su_block_port_t port; /* Slave reading port */
 
   SUCOMPLEX *buffer; /* TODO: make int const. Don't own this buffer */
@@ -59,6 +61,7 @@ SUSCOUNT suscan_consumer_get_buffer_pos(const suscan_consumer_t *consumer);
 
 SUBOOL suscan_consumer_push_task(
     suscan_consumer_t *consumer,
+    struct suscan_analyzer_source *source,
     SUBOOL (*func) (
               struct suscan_mq *mq_out,
               void *wk_private,
@@ -0,0 +1,208 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "handle"
+
+#include "handle.h"
+
+#define SUSCAN_HANDLE_INDEX_MASK      (SUSCAN_HANDLE_MAX_SLOTS - 1)
+#define SUSCAN_HANDLE_GENERATION_MASK \
+  ((1 << SUSCAN_HANDLE_GENERATION_BITS) - 1)
+
+SUINLINE SUHANDLE
+suscan_handle_make(unsigned int index, uint32_t generation)
+{
+  return (SUHANDLE)
+      (((generation & SUSCAN_HANDLE_GENERATION_MASK)
+          << SUSCAN_HANDLE_INDEX_BITS) | index);
+}
+
+/* NULL unless handle refers to a used slot, retired or not */
+SUPRIVATE struct suscan_handle_slot *
+suscan_handle_table_get_slot(
+    const struct suscan_handle_table *table,
+    SUHANDLE handle)
+{
+  struct suscan_handle_slot *slot;
+  unsigned int index;
+
+  if (handle < 0)
+    return NULL;
+
+  index = handle & SUSCAN_HANDLE_INDEX_MASK;
+
+  if (index >= table->slot_count)
+    return NULL;
+
+  slot = table->slot_list + index;
+
+  if (slot->ptr == NULL
+      || suscan_handle_make(index, slot->generation) != handle)
+    return NULL;
+
+  return slot;
+}
+
+void
+suscan_handle_table_init(struct suscan_handle_table *table)
+{
+  memset(table, 0, sizeof(struct suscan_handle_table));
+
+  table->free_head = -1;
+  table->free_tail = -1;
+}
+
+void
+suscan_handle_table_finalize(struct suscan_handle_table *table)
+{
+  if (table->slot_list != NULL)
+    free(table->slot_list);
+
+  suscan_handle_table_init(table);
+}
+
+SUHANDLE
+suscan_handle_table_alloc(struct suscan_handle_table *table, void *ptr)
+{
+  struct suscan_handle_slot *tmp;
+  unsigned int alloc;
+  unsigned int index;
+
+  if (table->free_head != -1) {
+    index = table->free_head;
+    table->free_head = table->slot_list[index].next_free;
+    if (table->free_head == -1)
+      table->free_tail = -1;
+  } else {
+    if (table->slot_count == SUSCAN_HANDLE_MAX_SLOTS) {
+      SU_ERROR("Too many handles\n");
+      return -1;
+    }
+
+    if (table->slot_count == table->slot_alloc) {
+      alloc = table->slot_alloc > 0 ? table->slot_alloc << 1 : 16;
+
+      SU_TRYCATCH(
+          tmp = realloc(
+              table->slot_list,
+              alloc * sizeof(struct suscan_handle_slot)),
+          return -1);
+
+      table->slot_list = tmp;
+      table->slot_alloc = alloc;
+    }
+
+    index = table->slot_count++;
+    memset(table->slot_list + index, 0, sizeof(struct suscan_handle_slot));
+  }
+
+  table->slot_list[index].ptr = ptr;
+  table->slot_list[index].retired = SU_FALSE;
+  table->slot_list[index].next_free = -1;
+
+  return suscan_handle_make(index, table->slot_list[index].generation);
+}
+
+void *
+suscan_handle_table_get(
+    const struct suscan_handle_table *table,
+    SUHANDLE handle)
+{
+  struct suscan_handle_slot *slot;
+
+  if ((slot = suscan_handle_table_get_slot(table, handle)) == NULL
+      || slot->retired)
+    return NULL;
+
+  return slot->ptr;
+}
+
+SUBOOL
+suscan_handle_table_retire(struct suscan_handle_table *table, SUHANDLE handle)
+{
+  struct suscan_handle_slot *slot;
+
+  if ((slot = suscan_handle_table_get_slot(table, handle)) == NULL
+      || slot->retired)
+    return SU_FALSE;
+
+  slot->retired = SU_TRUE;
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_handle_table_is_retired(
+    const struct suscan_handle_table *table,
+    SUHANDLE handle)
+{
+  struct suscan_handle_slot *slot;
+
+  if ((slot = suscan_handle_table_get_slot(table, handle)) == NULL)
+    return SU_FALSE;
+
+  return slot->retired;
+}
+
+void *
+suscan_handle_table_free(struct suscan_handle_table *table, SUHANDLE handle)
+{
+  struct suscan_handle_slot *slot;
+  unsigned int index;
+  void *ptr;
+
+  if ((slot = suscan_handle_table_get_slot(table, handle)) == NULL)
+    return NULL;
+
+  index = slot - table->slot_list;
+  ptr = slot->ptr;
+
+  slot->ptr = NULL;
+  slot->retired = SU_FALSE;
+  slot->next_free = -1;
+  ++slot->generation;
+
+  if (table->free_tail == -1)
+    table->free_head = index;
+  else
+    table->slot_list[table->free_tail].next_free = index;
+
+  table->free_tail = index;
+
+  return ptr;
+}
+
+void *
+suscan_handle_table_at(
+    const struct suscan_handle_table *table,
+    unsigned int index,
+    SUHANDLE *handle)
+{
+  if (index >= table->slot_count || table->slot_list[index].ptr == NULL)
+    return NULL;
+
+  if (handle != NULL)
+    *handle = suscan_handle_make(index, table->slot_list[index].generation);
+
+  return table->slot_list[index].ptr;
+}
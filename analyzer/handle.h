@@ -0,0 +1,98 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _HANDLE_H
+#define _HANDLE_H
+
+#include <stdint.h>
+#include <sigutils/sigutils.h>
+
+#define SUHANDLE int32_t
+
+/*
+ * Handles are a slot index (low bits) plus the generation of that slot
+ * when the handle was issued. Freeing a slot bumps its generation, so
+ * handles kept by clients after a close never address whatever is stored
+ * in the slot next. Free slots are reused oldest first, which makes a
+ * generation wrap-around on a stale handle as unlikely as possible.
+ */
+#define SUSCAN_HANDLE_INDEX_BITS      20
+#define SUSCAN_HANDLE_GENERATION_BITS 11 /* Handles stay positive */
+#define SUSCAN_HANDLE_MAX_SLOTS       (1 << SUSCAN_HANDLE_INDEX_BITS)
+
+struct suscan_handle_slot {
+  void *ptr;            /* NULL if free */
+  uint32_t generation;
+  SUBOOL retired;       /* Handle invalidated, slot not free yet */
+  int32_t next_free;    /* -1: last free slot */
+};
+
+/*
+ * Open, lookup and free are O(1). Retiring a handle makes lookups fail
+ * while the object it refers to is still being torn down, so that the
+ * slot is reused only once it has been freed. Not thread-safe.
+ */
+struct suscan_handle_table {
+  struct suscan_handle_slot *slot_list;
+  unsigned int slot_count;
+  unsigned int slot_alloc;
+  int32_t free_head;
+  int32_t free_tail;
+};
+
+void suscan_handle_table_init(struct suscan_handle_table *table);
+void suscan_handle_table_finalize(struct suscan_handle_table *table);
+
+/* Returns -1 on failure */
+SUHANDLE suscan_handle_table_alloc(
+    struct suscan_handle_table *table,
+    void *ptr);
+
+/* NULL if handle is invalid, stale or retired */
+void *suscan_handle_table_get(
+    const struct suscan_handle_table *table,
+    SUHANDLE handle);
+
+SUBOOL suscan_handle_table_retire(
+    struct suscan_handle_table *table,
+    SUHANDLE handle);
+
+SUBOOL suscan_handle_table_is_retired(
+    const struct suscan_handle_table *table,
+    SUHANDLE handle);
+
+/* Returns the object stored under handle (retired or not), or NULL */
+void *suscan_handle_table_free(
+    struct suscan_handle_table *table,
+    SUHANDLE handle);
+
+/* For iteration: the object in slot index (retired or not), or NULL */
+void *suscan_handle_table_at(
+    const struct suscan_handle_table *table,
+    unsigned int index,
+    SUHANDLE *handle);
+
+SUINLINE unsigned int
+suscan_handle_table_get_size(const struct suscan_handle_table *table)
+{
+  return table->slot_count;
+}
+
+#endif /* _HANDLE_H */
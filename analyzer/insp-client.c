@@ -39,6 +39,7 @@
 SUBOOL
 suscan_inspector_open_async(
     suscan_analyzer_t *analyzer,
+    uint32_t source_id,
     const struct sigutils_channel *channel,
     uint32_t req_id)
 {
@@ -53,6 +54,7 @@ suscan_inspector_open_async(
     goto done;
   }
 
+  req->source_id = source_id;
   req->channel = *channel;
 
   if (!suscan_analyzer_write(
@@ -77,33 +79,20 @@ done:
 SUHANDLE
 suscan_inspector_open(
     suscan_analyzer_t *analyzer,
+    uint32_t source_id,
     const struct sigutils_channel *channel)
 {
-  struct suscan_analyzer_inspector_msg *resp = NULL;
-  uint32_t req_id = rand();
+  suscan_inspector_future_t future;
   SUHANDLE handle = -1;
 
   SU_TRYCATCH(
-      suscan_inspector_open_async(analyzer, channel, req_id),
-      goto done);
+      suscan_inspector_open_begin(analyzer, source_id, channel, &future),
+      return -1);
 
-  SU_TRYCATCH(
-      resp = suscan_analyzer_read_inspector_msg(analyzer),
-      goto done);
+  if (suscan_inspector_future_wait(&future))
+    handle = future.resp->handle;
 
-  if (resp->req_id != req_id) {
-    SU_ERROR("Unmatched response received\n");
-    goto done;
-  } else if (resp->kind != SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN) {
-    SU_ERROR("Unexpected message kind\n");
-    goto done;
-  }
-
-  handle = resp->handle;
-
-done:
-  if (resp != NULL)
-    suscan_analyzer_inspector_msg_destroy(resp);
+  suscan_inspector_future_finalize(&future);
 
   return handle;
 }
@@ -150,37 +139,16 @@ suscan_inspector_close(
     suscan_analyzer_t *analyzer,
     SUHANDLE handle)
 {
-
-  struct suscan_analyzer_inspector_msg *resp = NULL;
-  uint32_t req_id = rand();
-  SUBOOL ok = SU_FALSE;
-
-  SU_TRYCATCH(
-      suscan_inspector_close_async(analyzer, handle, req_id),
-      goto done);
+  suscan_inspector_future_t future;
+  SUBOOL ok;
 
   SU_TRYCATCH(
-      resp = suscan_analyzer_read_inspector_msg(analyzer),
-      goto done);
-
-  if (resp->req_id != req_id) {
-    SU_ERROR("Unmatched response received\n");
-    goto done;
-  }
+      suscan_inspector_close_begin(analyzer, handle, &future),
+      return SU_FALSE);
 
-  if (resp->kind == SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE) {
-    SU_WARNING("Wrong handle passed to analyzer\n");
-    goto done;
-  } else if (resp->kind != SUSCAN_ANALYZER_INSPECTOR_MSGKIND_CLOSE) {
-    SU_ERROR("Unexpected message kind\n");
-    goto done;
-  }
+  ok = suscan_inspector_future_wait(&future);
 
-  ok = SU_TRUE;
-
-done:
-  if (resp != NULL)
-    suscan_analyzer_inspector_msg_destroy(resp);
+  suscan_inspector_future_finalize(&future);
 
   return ok;
 }
@@ -229,38 +197,17 @@ suscan_inspector_get_info(
     SUHANDLE handle,
     struct suscan_baud_det_result *result)
 {
-  struct suscan_analyzer_inspector_msg *resp = NULL;
-  uint32_t req_id = rand();
-  SUBOOL ok = SU_FALSE;
+  suscan_inspector_future_t future;
+  SUBOOL ok;
 
   SU_TRYCATCH(
-      suscan_inspector_get_info_async(analyzer, handle, req_id),
-      goto done);
+      suscan_inspector_get_info_begin(analyzer, handle, &future),
+      return SU_FALSE);
 
-  SU_TRYCATCH(
-      resp = suscan_analyzer_read_inspector_msg(analyzer),
-      goto done);
+  if ((ok = suscan_inspector_future_wait(&future)))
+    *result = future.resp->baud;
 
-  if (resp->req_id != req_id) {
-    SU_ERROR("Unmatched response received\n");
-    goto done;
-  }
-
-  if (resp->kind == SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE) {
-    SU_WARNING("Wrong handle passed to analyzer\n");
-    goto done;
-  } else if (resp->kind != SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INFO) {
-    SU_ERROR("Unexpected message kind %d\n", resp->kind);
-    goto done;
-  }
-
-  *result = resp->baud;
-
-  ok = SU_TRUE;
-
-done:
-  if (resp != NULL)
-    suscan_analyzer_inspector_msg_destroy(resp);
+  suscan_inspector_future_finalize(&future);
 
   return ok;
 }
@@ -304,3 +251,176 @@ done:
 
   return ok;
 }
+
+/***************************** Inspector futures *****************************/
+SUPRIVATE void
+suscan_inspector_future_init(
+    suscan_inspector_future_t *future,
+    suscan_analyzer_t *analyzer,
+    enum suscan_analyzer_inspector_msgkind kind)
+{
+  future->analyzer = analyzer;
+  future->kind = kind;
+  future->resp = NULL;
+
+  future->req_id = suscan_analyzer_alloc_req_id(analyzer);
+}
+
+SUPRIVATE SUBOOL
+suscan_inspector_future_matches(const void *private, void *data)
+{
+  const struct suscan_analyzer_inspector_msg *msg =
+      (const struct suscan_analyzer_inspector_msg *) private;
+  const suscan_inspector_future_t *future =
+      (const suscan_inspector_future_t *) data;
+
+  return msg->req_id == future->req_id;
+}
+
+SUBOOL
+suscan_inspector_open_begin(
+    suscan_analyzer_t *analyzer,
+    uint32_t source_id,
+    const struct sigutils_channel *channel,
+    suscan_inspector_future_t *future)
+{
+  suscan_inspector_future_init(
+      future,
+      analyzer,
+      SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN);
+
+  return suscan_inspector_open_async(
+      analyzer,
+      source_id,
+      channel,
+      future->req_id);
+}
+
+SUBOOL
+suscan_inspector_close_begin(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    suscan_inspector_future_t *future)
+{
+  suscan_inspector_future_init(
+      future,
+      analyzer,
+      SUSCAN_ANALYZER_INSPECTOR_MSGKIND_CLOSE);
+
+  return suscan_inspector_close_async(analyzer, handle, future->req_id);
+}
+
+SUBOOL
+suscan_inspector_get_info_begin(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    suscan_inspector_future_t *future)
+{
+  suscan_inspector_future_init(
+      future,
+      analyzer,
+      SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INFO);
+
+  return suscan_inspector_get_info_async(analyzer, handle, future->req_id);
+}
+
+SUBOOL
+suscan_inspector_set_params_begin(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    const struct suscan_inspector_params *params,
+    suscan_inspector_future_t *future)
+{
+  suscan_inspector_future_init(
+      future,
+      analyzer,
+      SUSCAN_ANALYZER_INSPECTOR_MSGKIND_PARAMS);
+
+  return suscan_inspector_set_params_async(
+      analyzer,
+      handle,
+      params,
+      future->req_id);
+}
+
+SUBOOL
+suscan_inspector_future_poll(suscan_inspector_future_t *future)
+{
+  void *private;
+
+  if (future->resp == NULL
+      && suscan_mq_poll_w_cond(
+          future->analyzer->mq_out,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+          suscan_inspector_future_matches,
+          future,
+          &private))
+    future->resp = (struct suscan_analyzer_inspector_msg *) private;
+
+  return future->resp != NULL;
+}
+
+SUBOOL
+suscan_inspector_future_wait(suscan_inspector_future_t *future)
+{
+  if (future->resp == NULL)
+    future->resp = suscan_mq_read_w_cond(
+        future->analyzer->mq_out,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+        suscan_inspector_future_matches,
+        future);
+
+  if (future->resp->kind == SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE) {
+    SU_WARNING("Wrong handle passed to analyzer\n");
+    return SU_FALSE;
+  } else if (future->resp->kind != future->kind) {
+    SU_ERROR("Unexpected message kind %d\n", future->resp->kind);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+void
+suscan_inspector_future_finalize(suscan_inspector_future_t *future)
+{
+  if (future->resp != NULL)
+    suscan_analyzer_inspector_msg_destroy(future->resp);
+
+  future->resp = NULL;
+}
+
+/***************************** Inspector batches *****************************/
+SUPRIVATE SUBOOL
+suscan_inspector_batch_matches(const void *private, void *data)
+{
+  const struct suscan_analyzer_inspector_batch_msg *msg =
+      (const struct suscan_analyzer_inspector_batch_msg *) private;
+
+  return msg->req_id == *(const uint32_t *) data;
+}
+
+struct suscan_analyzer_inspector_batch_msg *
+suscan_inspector_batch_call(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_inspector_batch_msg *req)
+{
+  uint32_t req_id = suscan_analyzer_alloc_req_id(analyzer);
+
+  req->req_id = req_id;
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR_BATCH,
+      req)) {
+    SU_ERROR("Failed to send inspector batch\n");
+    suscan_analyzer_inspector_batch_msg_destroy(req);
+    return NULL;
+  }
+
+  return suscan_mq_read_w_cond(
+      analyzer->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR_BATCH,
+      suscan_inspector_batch_matches,
+      &req_id);
+}
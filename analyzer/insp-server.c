@@ -37,6 +37,56 @@
 #include "mq.h"
 #include "msg.h"
 
+#define SUSCAN_INSPECTOR_SYMBOL_CHUNK 64
+
+/*
+ * Inspectors leave their consumer worker on their own (closed, retuned
+ * out of the spectrum or failed). The analyzer thread reclaims them when
+ * this message arrives, as the worker is done with them by then.
+ */
+SUPRIVATE void
+suscan_inspector_notify_halted(struct suscan_mq *mq_out, SUHANDLE handle)
+{
+  struct suscan_analyzer_inspector_msg *msg;
+
+  /* Not fatal: the analyzer frees it on destruction */
+  SU_TRYCATCH(
+      msg = suscan_analyzer_inspector_msg_new(
+          SUSCAN_ANALYZER_INSPECTOR_MSGKIND_HALTED,
+          0),
+      return);
+
+  msg->handle = handle;
+
+  if (!suscan_mq_write(mq_out, SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR, msg))
+    suscan_analyzer_inspector_msg_destroy(msg);
+}
+
+/*
+ * Symbols are gathered on the stack and appended to the batch in chunks.
+ * The batch is sized after the previous one, so that busy inspectors
+ * get a pooled buffer big enough for a whole block.
+ */
+SUPRIVATE SUBOOL
+suscan_inspector_flush_symbols(
+    suscan_inspector_t *insp,
+    struct suscan_analyzer_sample_batch_msg **batch_msg,
+    const SUCOMPLEX *symbols,
+    unsigned int count)
+{
+  if (*batch_msg == NULL) {
+    SU_TRYCATCH(
+        *batch_msg = suscan_analyzer_sample_batch_msg_new(
+            insp->params.inspector_id,
+            insp->sym_batch_size),
+        return SU_FALSE);
+
+    (*batch_msg)->source_id = insp->source_id;
+  }
+
+  return suscan_analyzer_sample_batch_msg_append(*batch_msg, symbols, count);
+}
+
 /*
  * TODO: Store *one port* only per worker. This port is read once all
  * consumers have finished with their buffer.
@@ -54,6 +104,9 @@ suscan_inspector_wk_cb(
   SUSCOUNT samp_count;
   const SUCOMPLEX *samp_buf;
   struct suscan_analyzer_sample_batch_msg *batch_msg = NULL;
+  SUCOMPLEX symbols[SUSCAN_INSPECTOR_SYMBOL_CHUNK];
+  unsigned int symbol_count = 0;
+  SUHANDLE handle;
   SUBOOL restart = SU_FALSE;
 
   samp_buf   = suscan_consumer_get_buffer(consumer);
@@ -71,24 +124,33 @@ suscan_inspector_wk_cb(
 
     if (insp->sym_new_sample) {
       /* Sampler was triggered */
-      if (batch_msg == NULL)
+      symbols[symbol_count++] = insp->sym_sampler_output;
+
+      if (symbol_count == SUSCAN_INSPECTOR_SYMBOL_CHUNK) {
         SU_TRYCATCH(
-            batch_msg = suscan_analyzer_sample_batch_msg_new(
-                insp->params.inspector_id),
+            suscan_inspector_flush_symbols(
+                insp,
+                &batch_msg,
+                symbols,
+                symbol_count),
             goto done);
-
-      SU_TRYCATCH(
-          suscan_analyzer_sample_batch_msg_append_sample(
-              batch_msg,
-              insp->sym_sampler_output),
-          goto done);
-
+        symbol_count = 0;
+      }
     }
 
     samp_buf   += fed;
     samp_count -= fed;
   }
 
+  if (symbol_count > 0)
+    SU_TRYCATCH(
+        suscan_inspector_flush_symbols(
+            insp,
+            &batch_msg,
+            symbols,
+            symbol_count),
+        goto done);
+
   /* Check spectrum update */
   if (insp->interval_psd > 0 && insp->pending)
     if (insp->per_cnt_psd
@@ -117,6 +179,7 @@ suscan_inspector_wk_cb(
 
   /* Got samples, send message batch */
   if (batch_msg != NULL) {
+    insp->sym_batch_size = batch_msg->sample_count;
     SU_TRYCATCH(
         suscan_mq_write(
             consumer->analyzer->mq_out,
@@ -129,13 +192,17 @@ suscan_inspector_wk_cb(
   restart = insp->state == SUSCAN_ASYNC_STATE_RUNNING;
 
 done:
+  if (batch_msg != NULL)
+    suscan_analyzer_sample_batch_msg_destroy(batch_msg);
+
   if (!restart) {
+    /* The analyzer thread may free it from here on */
+    handle = insp->handle;
     insp->state = SUSCAN_ASYNC_STATE_HALTED;
     suscan_consumer_remove_task(consumer);
-  }
 
-  if (batch_msg != NULL)
-    suscan_analyzer_sample_batch_msg_destroy(batch_msg);
+    suscan_inspector_notify_halted(mq_out, handle);
+  }
 
   return restart;
 }
@@ -147,10 +214,7 @@ suscan_analyzer_get_inspector(
 {
   suscan_inspector_t *brinsp;
 
-  if (handle < 0 || handle >= analyzer->inspector_count)
-    return NULL;
-
-  brinsp = analyzer->inspector_list[handle];
+  brinsp = suscan_handle_table_get(&analyzer->inspector_table, handle);
 
   if (brinsp != NULL && brinsp->state != SUSCAN_ASYNC_STATE_RUNNING)
     return NULL;
@@ -158,51 +222,156 @@ suscan_analyzer_get_inspector(
   return brinsp;
 }
 
-SUPRIVATE SUBOOL
-suscan_analyzer_dispose_inspector_handle(
-    suscan_analyzer_t *analyzer,
-    SUHANDLE handle)
-{
-  if (handle < 0 || handle >= analyzer->inspector_count)
-    return SU_FALSE;
-
-  if (analyzer->inspector_list[handle] == NULL)
-    return SU_FALSE;
-
-  analyzer->inspector_list[handle] = NULL;
-
-  return SU_TRUE;
-}
-
 SUPRIVATE SUHANDLE
 suscan_analyzer_register_inspector(
     suscan_analyzer_t *analyzer,
     suscan_inspector_t *brinsp)
 {
+  struct suscan_analyzer_source *source;
   SUHANDLE hnd;
 
   if (brinsp->state != SUSCAN_ASYNC_STATE_CREATED)
-    return SU_FALSE;
+    return -1;
 
-  /* Plugged. Append handle to list */
-  /* TODO: Find inspectors in HALTED state, and free them */
-  if ((hnd = PTR_LIST_APPEND_CHECK(analyzer->inspector, brinsp)) == -1)
+  if ((source = suscan_analyzer_get_source(analyzer, brinsp->source_id))
+      == NULL)
+    return -1;
+
+  if ((hnd = suscan_handle_table_alloc(&analyzer->inspector_table, brinsp))
+      == -1)
     return -1;
 
   /* Mark it as running and push to worker */
+  brinsp->handle = hnd;
   brinsp->state = SUSCAN_ASYNC_STATE_RUNNING;
 
   if (!suscan_analyzer_push_task(
       analyzer,
+      source,
       suscan_inspector_wk_cb,
       brinsp)) {
-    suscan_analyzer_dispose_inspector_handle(analyzer, hnd);
+    /* Caller keeps ownership */
+    brinsp->state = SUSCAN_ASYNC_STATE_CREATED;
+    (void) suscan_handle_table_free(&analyzer->inspector_table, hnd);
     return -1;
   }
 
   return hnd;
 }
 
+/*
+ * Running inspectors cannot be freed here: their consumer worker may be
+ * feeding them right now. They are marked as halting, so they will not
+ * come back to the worker queue, and their handle is retired so that
+ * it stops working immediately. The slot is reclaimed once the worker
+ * lets them go (see suscan_analyzer_reclaim_inspector).
+ */
+SUPRIVATE void
+suscan_analyzer_close_inspector(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    suscan_inspector_t *insp)
+{
+  insp->state = SUSCAN_ASYNC_STATE_HALTING;
+  (void) suscan_handle_table_retire(&analyzer->inspector_table, handle);
+}
+
+/* Unsolicited CLOSE (request ID 0), for inspectors the client didn't close */
+SUPRIVATE SUBOOL
+suscan_analyzer_notify_inspector_close(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    const suscan_inspector_t *insp)
+{
+  struct suscan_analyzer_inspector_msg *msg;
+
+  SU_TRYCATCH(
+      msg = suscan_analyzer_inspector_msg_new(
+          SUSCAN_ANALYZER_INSPECTOR_MSGKIND_CLOSE,
+          0),
+      return SU_FALSE);
+
+  msg->handle = handle;
+  msg->source_id = insp->source_id;
+  msg->inspector_id = insp->params.inspector_id;
+
+  if (!suscan_mq_write(
+      analyzer->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+      msg)) {
+    suscan_analyzer_inspector_msg_destroy(msg);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+/*
+ * Called when an inspector has left its consumer worker. If its handle
+ * was not retired, the inspector stopped on its own (e.g. it failed) and
+ * the client must be told. Stale handles (already reclaimed) are
+ * ignored.
+ */
+SUPRIVATE void
+suscan_analyzer_reclaim_inspector(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle)
+{
+  struct suscan_handle_table *table = &analyzer->inspector_table;
+  suscan_inspector_t *insp;
+  SUBOOL notify;
+
+  notify = !suscan_handle_table_is_retired(table, handle);
+
+  if ((insp = suscan_handle_table_free(table, handle)) == NULL)
+    return;
+
+  if (notify)
+    (void) suscan_analyzer_notify_inspector_close(analyzer, handle, insp);
+
+  suscan_inspector_destroy(insp);
+}
+
+/*
+ * Called by the analyzer thread once a source and its channel detector
+ * have been retuned. Inspectors of that source are retuned in place by
+ * their consumer worker. Inspectors of channels that fell out of the new
+ * spectrum are closed, and their clients are notified.
+ */
+SUBOOL
+suscan_analyzer_retune_inspectors(
+    suscan_analyzer_t *analyzer,
+    const struct suscan_analyzer_source *source)
+{
+  const struct suscan_source_tuning *tuning = &source->tuning;
+  struct suscan_handle_table *table = &analyzer->inspector_table;
+  suscan_inspector_t *insp;
+  SUHANDLE handle;
+  unsigned int i;
+
+  for (i = 0; i < suscan_handle_table_get_size(table); ++i) {
+    if ((insp = suscan_handle_table_at(table, i, &handle)) == NULL
+        || insp->state != SUSCAN_ASYNC_STATE_RUNNING
+        || insp->source_id != source->id)
+      continue;
+
+    if (suscan_inspector_request_retune(
+        insp,
+        tuning->samp_rate,
+        tuning->fc))
+      continue;
+
+    /* Leaves the consumer worker on its next run */
+    suscan_analyzer_close_inspector(analyzer, handle, insp);
+
+    SU_TRYCATCH(
+        suscan_analyzer_notify_inspector_close(analyzer, handle, insp),
+        return SU_FALSE);
+  }
+
+  return SU_TRUE;
+}
+
 /*
  * We have ownership on msg, this messages are urgent: they are placed
  * in the beginning of the queue
@@ -217,6 +386,7 @@ suscan_analyzer_parse_inspector_msg(
     suscan_analyzer_t *analyzer,
     struct suscan_analyzer_inspector_msg *msg)
 {
+  struct suscan_analyzer_source *source;
   suscan_inspector_t *new = NULL;
   suscan_inspector_t *insp = NULL;
   SUHANDLE handle = -1;
@@ -224,12 +394,26 @@ suscan_analyzer_parse_inspector_msg(
   SUBOOL update_baud;
 
   switch (msg->kind) {
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_HALTED:
+      /* Internal: nothing to reply */
+      suscan_analyzer_reclaim_inspector(analyzer, msg->handle);
+      suscan_analyzer_inspector_msg_destroy(msg);
+      return SU_TRUE;
+
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN:
+      if ((source = suscan_analyzer_get_source(analyzer, msg->source_id))
+          == NULL) {
+        msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
+        break;
+      }
+
       if ((new = suscan_inspector_new(
-          su_channel_detector_get_fs(analyzer->source.detector),
+          source->tuning.samp_rate,
           &msg->channel)) == NULL)
         goto done;
 
+      new->source_id = source->id;
+
       handle = suscan_analyzer_register_inspector(analyzer, new);
       if (handle == -1)
         goto done;
@@ -284,23 +468,9 @@ suscan_analyzer_parse_inspector_msg(
         msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
       } else {
         msg->inspector_id = insp->params.inspector_id;
+        msg->source_id = insp->source_id;
 
-        if (insp->state == SUSCAN_ASYNC_STATE_HALTED) {
-          /*
-           * Inspector has been halted. It's safe to dispose the handle
-           * and free the object.
-           */
-          (void) suscan_analyzer_dispose_inspector_handle(
-              analyzer,
-              msg->handle);
-          suscan_inspector_destroy(insp);
-        } else {
-          /*
-           * Inspector is still running. Mark it as halting, so it will not
-           * come back to the worker queue.
-           */
-          insp->state = SUSCAN_ASYNC_STATE_HALTING;
-        }
+        suscan_analyzer_close_inspector(analyzer, msg->handle, insp);
 
         /* We can't trust the inspector contents from here on out */
         insp = NULL;
@@ -316,8 +486,10 @@ suscan_analyzer_parse_inspector_msg(
    * If request has referenced an existing inspector, we include the
    * inspector ID in the response.
    */
-  if (insp != NULL)
+  if (insp != NULL) {
     msg->inspector_id = insp->params.inspector_id;
+    msg->source_id = insp->source_id;
+  }
 
   if (!suscan_mq_write(
       analyzer->mq_out,
@@ -333,3 +505,196 @@ done:
 
   return ok;
 }
+
+/**************************** Inspector batches ******************************/
+SUPRIVATE void
+suscan_inspector_batch_build(struct suscan_analyzer_inspector_batch_msg *msg)
+{
+  struct suscan_analyzer_inspector_batch_entry *entry;
+  unsigned int i;
+
+  /*
+   * Build tasks take entries until none is left, on several consumers
+   * at once. Planning the baud detectors, the bulk of the work, is
+   * serialized by the planner lock: the point is mostly to keep it off
+   * the analyzer thread.
+   */
+  while ((i = __sync_fetch_and_add(&msg->next_entry, 1)) < msg->entry_count) {
+    entry = &msg->entry_list[i];
+
+    if (entry->status != SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_OK)
+      continue;
+
+    if ((entry->inspector = suscan_inspector_new(entry->fs, &entry->channel))
+        == NULL)
+      entry->status = SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_FAILED;
+    else
+      entry->inspector->source_id = entry->source_id;
+  }
+}
+
+/* Runs on consumer workers */
+SUPRIVATE SUBOOL
+suscan_inspector_batch_build_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  struct suscan_analyzer_inspector_batch_msg *msg =
+      (struct suscan_analyzer_inspector_batch_msg *) cb_private;
+
+  suscan_inspector_batch_build(msg);
+
+  /* The last task to finish hands the batch back to the analyzer thread */
+  if (__sync_sub_and_fetch(&msg->pending, 1) == 0) {
+    msg->built = SU_TRUE;
+
+    if (!suscan_mq_write(
+        mq_out,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR_BATCH,
+        msg))
+      suscan_analyzer_inspector_batch_msg_destroy(msg);
+  }
+
+  return SU_FALSE;
+}
+
+SUPRIVATE void
+suscan_analyzer_register_batch_entry(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_inspector_batch_entry *entry)
+{
+  struct suscan_analyzer_source *source;
+
+  if (entry->status != SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_OK)
+    return;
+
+  source = suscan_analyzer_get_source(analyzer, entry->source_id);
+
+  /* Source retuned while building: start over */
+  if (source->tuning.samp_rate != entry->fs) {
+    suscan_inspector_destroy(entry->inspector);
+    entry->fs = source->tuning.samp_rate;
+
+    if ((entry->inspector = suscan_inspector_new(entry->fs, &entry->channel))
+        == NULL) {
+      entry->status = SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_FAILED;
+      return;
+    }
+
+    entry->inspector->source_id = entry->source_id;
+  }
+
+  /* On failure, the inspector is left to the message destructor */
+  if ((entry->handle =
+      suscan_analyzer_register_inspector(analyzer, entry->inspector)) == -1)
+    entry->status = SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_FAILED;
+  else
+    entry->inspector = NULL;
+}
+
+SUPRIVATE SUBOOL
+suscan_analyzer_finish_inspector_batch(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_inspector_batch_msg *msg)
+{
+  struct suscan_analyzer_inspector_batch_entry *entry;
+  suscan_inspector_t *insp;
+  unsigned int i;
+
+  for (i = 0; i < msg->entry_count; ++i) {
+    entry = &msg->entry_list[i];
+
+    switch (msg->kind) {
+      case SUSCAN_ANALYZER_INSPECTOR_BATCH_OPEN:
+        suscan_analyzer_register_batch_entry(analyzer, entry);
+        break;
+
+      case SUSCAN_ANALYZER_INSPECTOR_BATCH_CLOSE:
+        if ((insp = suscan_analyzer_get_inspector(analyzer, entry->handle))
+            == NULL)
+          entry->status = SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_WRONG_HANDLE;
+        else
+          suscan_analyzer_close_inspector(analyzer, entry->handle, insp);
+        break;
+
+      case SUSCAN_ANALYZER_INSPECTOR_BATCH_GET_INFO:
+        if ((insp = suscan_analyzer_get_inspector(analyzer, entry->handle))
+            == NULL) {
+          entry->status = SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_WRONG_HANDLE;
+        } else {
+          entry->baud.fac = insp->fac_baud_det->baud;
+          entry->baud.nln = insp->nln_baud_det->baud;
+        }
+        break;
+    }
+  }
+
+  return suscan_mq_write(
+      analyzer->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR_BATCH,
+      msg);
+}
+
+/*
+ * Inspector construction plans two channel detectors: too slow for the
+ * analyzer thread when there are many of them. OPEN batches are split
+ * among consumer workers, and come back here once all are built.
+ */
+SUBOOL
+suscan_analyzer_parse_inspector_batch_msg(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_inspector_batch_msg *msg)
+{
+  struct suscan_analyzer_inspector_batch_entry *entry;
+  struct suscan_analyzer_source *source;
+  unsigned int tasks = 0;
+  unsigned int pushed;
+  unsigned int i;
+
+  if (msg->kind != SUSCAN_ANALYZER_INSPECTOR_BATCH_OPEN || msg->built)
+    return suscan_analyzer_finish_inspector_batch(analyzer, msg);
+
+  for (i = 0; i < msg->entry_count; ++i) {
+    entry = &msg->entry_list[i];
+    entry->handle = -1;
+    entry->inspector = NULL;
+
+    if ((source = suscan_analyzer_get_source(analyzer, entry->source_id))
+        == NULL) {
+      entry->status = SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_WRONG_HANDLE;
+    } else {
+      entry->status = SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_OK;
+      entry->fs = source->tuning.samp_rate;
+      ++tasks;
+    }
+  }
+
+  if (tasks > analyzer->consumer_count)
+    tasks = analyzer->consumer_count;
+
+  msg->next_entry = 0;
+  msg->pending = tasks;
+
+  /* The message belongs to the workers once the first task is pushed */
+  for (pushed = 0; pushed < tasks; ++pushed)
+    if (!suscan_worker_push(
+        analyzer->consumer_list[pushed]->worker,
+        suscan_inspector_batch_build_cb,
+        msg))
+      break;
+
+  if (pushed == tasks && tasks > 0)
+    return SU_TRUE;
+
+  if (pushed == 0) {
+    suscan_inspector_batch_build(msg);
+  } else if (__sync_sub_and_fetch(&msg->pending, tasks - pushed) != 0) {
+    /* Pushed tasks will finish the job */
+    return SU_TRUE;
+  }
+
+  msg->built = SU_TRUE;
+
+  return suscan_analyzer_finish_inspector_batch(analyzer, msg);
+}
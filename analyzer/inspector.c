@@ -31,6 +31,7 @@
 
 #include "source.h"
 #include "inspector.h"
+#include "planner.h"
 
 #define SUSCAN_INSPECTOR_DEFAULT_ROLL_OFF .35
 #define SUSCAN_INSPECTOR_MAX_MF_SPAN      1024
@@ -74,18 +75,118 @@ suscan_inspector_request_params(
   suscan_inspector_params_unlock(insp);
 }
 
+SUBOOL
+suscan_inspector_request_retune(
+    suscan_inspector_t *insp,
+    SUSCOUNT fs,
+    uint64_t ft)
+{
+  struct sigutils_channel channel;
+  SUFLOAT half = .5 * fs;
+  SUBOOL fits;
+
+  suscan_inspector_params_lock(insp);
+
+  /* Channel frequencies are absolute, ft is the tuner frequency */
+  channel = insp->retune_requested ? insp->retune_channel : insp->channel;
+  channel.ft = ft;
+
+  fits = channel.f_lo - channel.ft >= -half && channel.f_hi - channel.ft <= half;
+
+  if (fits) {
+    insp->retune_fs = fs;
+    insp->retune_channel = channel;
+
+    insp->retune_requested = SU_TRUE;
+  }
+
+  suscan_inspector_params_unlock(insp);
+
+  return fits;
+}
+
+/*
+ * Baud detectors are the only objects that depend on the channel
+ * position. Everything else depends on the equivalent sample rate only.
+ */
+SUPRIVATE SUBOOL
+suscan_inspector_retune(suscan_inspector_t *insp)
+{
+  struct sigutils_channel_detector_params params =
+      sigutils_channel_detector_params_INITIALIZER;
+  su_channel_detector_t *fac_baud_det = NULL;
+  su_channel_detector_t *nln_baud_det = NULL;
+
+  params.samp_rate = insp->retune_fs;
+  params.window_size = SUSCAN_SOURCE_DEFAULT_BUFSIZ;
+  su_channel_params_adjust_to_channel(&params, &insp->retune_channel);
+
+  params.mode = SU_CHANNEL_DETECTOR_MODE_AUTOCORRELATION;
+  SU_TRYCATCH(
+      fac_baud_det = suscan_planner_channel_detector_new(&params),
+      goto fail);
+
+  params.mode = SU_CHANNEL_DETECTOR_MODE_NONLINEAR_DIFF;
+  SU_TRYCATCH(
+      nln_baud_det = suscan_planner_channel_detector_new(&params),
+      goto fail);
+
+  suscan_planner_channel_detector_destroy(insp->fac_baud_det);
+  suscan_planner_channel_detector_destroy(insp->nln_baud_det);
+
+  insp->fac_baud_det = fac_baud_det;
+  insp->nln_baud_det = nln_baud_det;
+
+  insp->channel  = insp->retune_channel;
+  insp->equiv_fs = (SUFLOAT) params.samp_rate / params.decimation;
+
+  insp->per_cnt_psd = 0;
+  insp->pending = SU_FALSE;
+
+  return SU_TRUE;
+
+fail:
+  if (fac_baud_det != NULL)
+    suscan_planner_channel_detector_destroy(fac_baud_det);
+
+  return SU_FALSE;
+}
+
 void
 suscan_inspector_assert_params(suscan_inspector_t *insp)
 {
   SUFLOAT fs;
   SUBOOL mf_changed;
+  SUBOOL resampled = SU_FALSE;
   su_iir_filt_t mf = su_iir_filt_INITIALIZER;
 
+  if (insp->retune_requested) {
+    suscan_inspector_params_lock(insp);
+
+    fs = insp->equiv_fs;
+
+    if (!suscan_inspector_retune(insp)) {
+      SU_ERROR("Failed to retune inspector, keeping previous tuning\n");
+    } else if (insp->equiv_fs != fs) {
+      /* Apply current parameters again, at the new sample rate */
+      if (!insp->params_requested)
+        insp->params_request = insp->params;
+
+      insp->params_requested = SU_TRUE;
+      resampled = SU_TRUE;
+    }
+
+    insp->retune_requested = SU_FALSE;
+
+    suscan_inspector_params_unlock(insp);
+  }
+
   if (insp->params_requested) {
     suscan_inspector_params_lock(insp);
 
     mf_changed =
-        (insp->params.baud != insp->params_request.baud)
+        resampled
+        || (insp->params.baud != insp->params_request.baud)
         || (insp->params.mf_rolloff != insp->params_request.mf_rolloff);
     insp->params = insp->params_request;
 
@@ -143,10 +244,10 @@ suscan_inspector_destroy(suscan_inspector_t *insp)
   pthread_mutex_destroy(&insp->params_mutex);
 
   if (insp->fac_baud_det != NULL)
-    su_channel_detector_destroy(insp->fac_baud_det);
+    suscan_planner_channel_detector_destroy(insp->fac_baud_det);
 
   if (insp->nln_baud_det != NULL)
-    su_channel_detector_destroy(insp->nln_baud_det);
+    suscan_planner_channel_detector_destroy(insp->nln_baud_det);
 
   su_iir_filt_finalize(&insp->mf);
 
@@ -203,6 +304,7 @@ suscan_inspector_new(SUSCOUNT fs, const struct sigutils_channel *channel)
   SU_TRYCATCH(new = calloc(1, sizeof (suscan_inspector_t)), goto fail);
 
   new->state = SUSCAN_ASYNC_STATE_CREATED;
+  new->channel = *channel;
 
   /* Initialize inspector parameters */
   SU_TRYCATCH(pthread_mutex_init(&new->params_mutex, NULL) != -1, goto fail);
@@ -224,11 +326,15 @@ suscan_inspector_new(SUSCOUNT fs, const struct sigutils_channel *channel)
 
   /* Create generic autocorrelation-based detector */
   params.mode = SU_CHANNEL_DETECTOR_MODE_AUTOCORRELATION;
-  SU_TRYCATCH(new->fac_baud_det = su_channel_detector_new(&params), goto fail);
+  SU_TRYCATCH(
+      new->fac_baud_det = suscan_planner_channel_detector_new(&params),
+      goto fail);
 
   /* Create non-linear baud rate detector */
   params.mode = SU_CHANNEL_DETECTOR_MODE_NONLINEAR_DIFF;
-  SU_TRYCATCH(new->nln_baud_det = su_channel_detector_new(&params), goto fail);
+  SU_TRYCATCH(
+      new->nln_baud_det = suscan_planner_channel_detector_new(&params),
+      goto fail);
 
   /* Create clock detector */
   SU_TRYCATCH(
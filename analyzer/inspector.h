@@ -27,7 +27,7 @@
 #include <sigutils/clock.h>
 #include <sigutils/detect.h>
 
-#define SUHANDLE int32_t
+#include "handle.h"
 
 #define SUSCAN_ANALYZER_CPU_USAGE_UPDATE_ALPHA .025
 
@@ -100,6 +100,8 @@ struct suscan_inspector_params {
 
 /* TODO: protect baudrate access with mutexes */
 struct suscan_inspector {
+  uint32_t                source_id; /* Analyzer source being inspected */
+  SUHANDLE                handle;    /* Once registered */
   struct sigutils_channel channel;
   SUFLOAT                 equiv_fs; /* Equivalent sample rate */
   su_channel_detector_t  *fac_baud_det; /* FAC baud detector */
@@ -123,11 +125,15 @@ struct suscan_inspector {
   struct suscan_inspector_params params;
   struct suscan_inspector_params params_request;
   SUBOOL    params_requested;
+  SUSCOUNT  retune_fs;          /* Sample rate after retuning the source */
+  struct sigutils_channel retune_channel;
+  SUBOOL    retune_requested;
   SUBOOL    sym_new_sample;     /* New sample flag */
   SUCOMPLEX sym_last_sample;    /* Last sample fed to inspector */
   SUCOMPLEX sym_sampler_output; /* Sampler output */
   SUFLOAT   sym_phase;          /* Current sampling phase, in samples */
   SUFLOAT   sym_period;         /* In samples */
+  unsigned int sym_batch_size;  /* Symbols sent last time, capacity hint */
 
   enum suscan_aync_state state; /* Used to remove analyzer from queue */
 };
@@ -153,6 +159,12 @@ void suscan_inspector_request_params(
     suscan_inspector_t *insp,
     struct suscan_inspector_params *params_request);
 
+/* Returns SU_FALSE if the channel no longer fits in the source spectrum */
+SUBOOL suscan_inspector_request_retune(
+    suscan_inspector_t *insp,
+    SUSCOUNT fs,
+    uint64_t ft);
+
 void suscan_inspector_assert_params(suscan_inspector_t *insp);
 
 #endif /* _INSPECTOR_H */
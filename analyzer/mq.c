@@ -202,7 +202,11 @@ suscan_mq_pop(struct suscan_mq *mq)
 }
 
 SUPRIVATE struct suscan_msg *
-suscan_mq_pop_w_type(struct suscan_mq *mq, uint32_t type)
+suscan_mq_pop_w_cond(
+    struct suscan_mq *mq,
+    uint32_t type,
+    suscan_mq_cond_t cond,
+    void *data)
 {
   struct suscan_msg *this, *prev;
 
@@ -210,7 +214,7 @@ suscan_mq_pop_w_type(struct suscan_mq *mq, uint32_t type)
   this = mq->head;
 
   while (this != NULL) {
-    if (this->type == type)
+    if (this->type == type && (cond == NULL || (cond) (this->private, data)))
       break;
     prev = this;
     this = this->next;
@@ -231,6 +235,12 @@ suscan_mq_pop_w_type(struct suscan_mq *mq, uint32_t type)
   return this;
 }
 
+SUPRIVATE struct suscan_msg *
+suscan_mq_pop_w_type(struct suscan_mq *mq, uint32_t type)
+{
+  return suscan_mq_pop_w_cond(mq, type, NULL, NULL);
+}
+
 SUPRIVATE struct suscan_msg *
 suscan_mq_read_msg_internal(
     struct suscan_mq *mq,
@@ -364,6 +374,56 @@ suscan_mq_poll_msg_w_type(struct suscan_mq *mq, uint32_t type)
   return suscan_mq_poll_msg_internal(mq, SU_TRUE, type);
 }
 
+void *
+suscan_mq_read_w_cond(
+    struct suscan_mq *mq,
+    uint32_t type,
+    suscan_mq_cond_t cond,
+    void *data)
+{
+  struct suscan_msg *msg;
+  void *private;
+
+  suscan_mq_enter(mq);
+
+  while ((msg = suscan_mq_pop_w_cond(mq, type, cond, data)) == NULL)
+    suscan_mq_wait_unsafe(mq);
+
+  suscan_mq_leave(mq);
+
+  private = msg->private;
+
+  suscan_msg_destroy(msg);
+
+  return private;
+}
+
+SUBOOL
+suscan_mq_poll_w_cond(
+    struct suscan_mq *mq,
+    uint32_t type,
+    suscan_mq_cond_t cond,
+    void *data,
+    void **private)
+{
+  struct suscan_msg *msg;
+
+  suscan_mq_enter(mq);
+
+  msg = suscan_mq_pop_w_cond(mq, type, cond, data);
+
+  suscan_mq_leave(mq);
+
+  if (msg == NULL)
+    return SU_FALSE;
+
+  *private = msg->private;
+
+  suscan_msg_destroy(msg);
+
+  return SU_TRUE;
+}
+
 void
 suscan_mq_write_msg(struct suscan_mq *mq, struct suscan_msg *msg)
 {
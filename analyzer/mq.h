@@ -46,6 +46,9 @@ struct suscan_mq {
   struct suscan_msg *tail;
 };
 
+/* Selects messages of a given type by contents */
+typedef SUBOOL (*suscan_mq_cond_t) (const void *private, void *data);
+
 /*************************** Message queue API *******************************/
 SUBOOL suscan_mq_init(struct suscan_mq *mq);
 void   suscan_mq_finalize(struct suscan_mq *mq);
@@ -57,6 +60,17 @@ SUBOOL suscan_mq_poll(struct suscan_mq *mq, uint32_t *type, void **private);
 SUBOOL suscan_mq_poll_w_type(struct suscan_mq *mq, uint32_t type, void **private);
 struct suscan_msg *suscan_mq_poll_msg(struct suscan_mq *mq);
 struct suscan_msg *suscan_mq_poll_msg_w_type(struct suscan_mq *mq, uint32_t type);
+void  *suscan_mq_read_w_cond(
+    struct suscan_mq *mq,
+    uint32_t type,
+    suscan_mq_cond_t cond,
+    void *data);
+SUBOOL suscan_mq_poll_w_cond(
+    struct suscan_mq *mq,
+    uint32_t type,
+    suscan_mq_cond_t cond,
+    void *data,
+    void **private);
 SUBOOL suscan_mq_write(struct suscan_mq *mq, uint32_t type, void *private);
 void   suscan_mq_wait(struct suscan_mq *mq);
 SUBOOL suscan_mq_write_urgent(struct suscan_mq *mq, uint32_t type, void *private);
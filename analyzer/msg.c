@@ -61,6 +61,8 @@ suscan_analyzer_status_msg_new(uint32_t code, const char *msg)
 
   new->err_msg = msg_dup;
   new->code = code;
+  new->source_id = SUSCAN_ANALYZER_SOURCE_ANY;
+  new->sender = NULL;
 
   return new;
 }
@@ -93,9 +95,56 @@ suscan_analyzer_channel_msg_destroy(struct suscan_analyzer_channel_msg *msg)
   free(msg);
 }
 
+void
+suscan_analyzer_channel_delta_msg_destroy(
+    struct suscan_analyzer_channel_delta_msg *msg)
+{
+  if (msg->delta_list != NULL)
+    free(msg->delta_list);
+
+  free(msg);
+}
+
+struct suscan_analyzer_channel_delta_msg *
+suscan_analyzer_channel_delta_msg_new(
+    const suscan_analyzer_t *analyzer,
+    const suscan_tracker_t *tracker)
+{
+  struct suscan_analyzer_channel_delta_msg *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_channel_delta_msg)),
+      goto fail);
+
+  new->sender = analyzer;
+
+  if (tracker->delta_count > 0) {
+    SU_TRYCATCH(
+        new->delta_list = malloc(
+            tracker->delta_count * sizeof(struct suscan_channel_delta)),
+        goto fail);
+
+    memcpy(
+        new->delta_list,
+        tracker->delta_list,
+        tracker->delta_count * sizeof(struct suscan_channel_delta));
+
+    new->delta_count = tracker->delta_count;
+  }
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_channel_delta_msg_destroy(new);
+
+  return NULL;
+}
+
 struct suscan_analyzer_channel_msg *
 suscan_analyzer_channel_msg_new(
     const suscan_analyzer_t *analyzer,
+    const struct suscan_analyzer_source *source,
     struct sigutils_channel **list,
     unsigned int len)
 {
@@ -112,7 +161,8 @@ suscan_analyzer_channel_msg_new(
       goto fail;
 
   new->channel_count = len;
-  new->source = analyzer->source.config->source;
+  new->source = source->config->source;
+  new->source_id = source->id;
   new->sender = analyzer;
 
   for (i = 0; i < len; ++i)
@@ -121,10 +171,10 @@ suscan_analyzer_channel_msg_new(
         if ((new->channel_list[n] = su_channel_dup(list[i])) == NULL)
           goto fail;
 
-        new->channel_list[n]->fc   += analyzer->source.fc;
-        new->channel_list[n]->f_hi += analyzer->source.fc;
-        new->channel_list[n]->f_lo += analyzer->source.fc;
-        new->channel_list[n]->ft    = analyzer->source.fc;
+        new->channel_list[n]->fc   += source->fc;
+        new->channel_list[n]->f_hi += source->fc;
+        new->channel_list[n]->f_lo += source->fc;
+        new->channel_list[n]->ft    = source->fc;
         ++n;
       }
 
@@ -162,12 +212,65 @@ suscan_analyzer_inspector_msg_destroy(
   free(msg);
 }
 
+void
+suscan_analyzer_inspector_batch_msg_destroy(
+    struct suscan_analyzer_inspector_batch_msg *msg)
+{
+  unsigned int i;
+
+  /* Built but never registered */
+  for (i = 0; i < msg->entry_count; ++i)
+    if (msg->entry_list[i].inspector != NULL)
+      suscan_inspector_destroy(msg->entry_list[i].inspector);
+
+  if (msg->entry_list != NULL)
+    free(msg->entry_list);
+
+  free(msg);
+}
+
+struct suscan_analyzer_inspector_batch_msg *
+suscan_analyzer_inspector_batch_msg_new(
+    enum suscan_analyzer_inspector_batch_kind kind,
+    unsigned int entry_count,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_inspector_batch_msg *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_inspector_batch_msg)),
+      goto fail);
+
+  new->kind = kind;
+  new->req_id = req_id;
+
+  if (entry_count > 0)
+    SU_TRYCATCH(
+        new->entry_list = calloc(
+            entry_count,
+            sizeof(struct suscan_analyzer_inspector_batch_entry)),
+        goto fail);
+
+  new->entry_count = entry_count;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_inspector_batch_msg_destroy(new);
+
+  return NULL;
+}
+
 void
 suscan_analyzer_psd_msg_destroy(struct suscan_analyzer_psd_msg *msg)
 {
   if (msg->psd_data != NULL)
     free(msg->psd_data);
 
+  if (msg->psd_qdata != NULL)
+    free(msg->psd_qdata);
+
   free(msg);
 }
 
@@ -211,41 +314,168 @@ fail:
   return NULL;
 }
 
+struct suscan_analyzer_psd_msg *
+suscan_analyzer_psd_msg_new_formatted(
+    const SUFLOAT *psd_data,
+    SUSCOUNT size,
+    SUFLOAT samp_rate,
+    const struct suscan_psd_format *format,
+    SUFLOAT *hold)
+{
+  struct suscan_analyzer_psd_msg *new = NULL;
+  SUSCOUNT bins;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_psd_msg)),
+      goto fail);
+
+  bins = format->bins == 0 || format->bins > size ? size : format->bins;
+
+  new->psd_size = bins;
+  new->samp_rate = samp_rate;
+
+  SU_TRYCATCH(
+      new->psd_data = malloc(sizeof(SUFLOAT) * bins),
+      goto fail);
+
+  suscan_psd_reduce(psd_data, size, new->psd_data, bins, format->reduction, hold);
+
+  if (format->quantization != SUSCAN_PSD_QUANTIZATION_NONE) {
+    SU_TRYCATCH(
+        new->psd_qdata = malloc(
+            bins * suscan_psd_quantization_get_size(format->quantization)),
+        goto fail);
+
+    suscan_psd_quantize(
+        new->psd_data,
+        bins,
+        format->quantization,
+        format->db_min,
+        format->db_max,
+        new->psd_qdata);
+
+    new->quantization = format->quantization;
+    new->db_min  = format->db_min;
+    new->db_step = (format->db_max - format->db_min)
+        / (format->quantization == SUSCAN_PSD_QUANTIZATION_U8 ? 255 : 65535);
+
+    /* Only quantized data travels */
+    free(new->psd_data);
+    new->psd_data = NULL;
+  }
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_psd_msg_destroy(new);
+
+  return NULL;
+}
+
 SUFLOAT *
 suscan_analyzer_psd_msg_take_psd(struct suscan_analyzer_psd_msg *msg)
 {
   SUFLOAT *result = msg->psd_data;
 
+  /* Quantized spectrums are converted back to power here */
+  if (result == NULL && msg->psd_qdata != NULL) {
+    SU_TRYCATCH(
+        result = malloc(msg->psd_size * sizeof(SUFLOAT)),
+        return NULL);
+
+    suscan_psd_dequantize(
+        msg->psd_qdata,
+        msg->psd_size,
+        msg->quantization,
+        msg->db_min,
+        msg->db_step,
+        result);
+  }
+
   msg->psd_data = NULL;
 
   return result;
 }
 
+/*
+ * Batches are built by consumer workers and destroyed by whoever reads
+ * them (usually the GUI thread), hence the lock.
+ */
+SUPRIVATE pthread_mutex_t sample_batch_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+SUPRIVATE struct suscan_analyzer_sample_batch_msg *
+    sample_batch_pool[SUSCAN_SAMPLE_BATCH_POOL_CLASSES];
+SUPRIVATE unsigned int
+    sample_batch_pool_count[SUSCAN_SAMPLE_BATCH_POOL_CLASSES];
+SUPRIVATE size_t sample_batch_pool_bytes;
+
+/* Smallest class that fits capacity. May be beyond the pooled ones */
+SUPRIVATE unsigned int
+suscan_sample_batch_class(unsigned int capacity)
+{
+  unsigned int class = 0;
+
+  /* Up to 2^31 samples, hints beyond that are clamped */
+  while (class < 25 && (SUSCAN_SAMPLE_BATCH_MIN_CAPACITY << class) < capacity)
+    ++class;
+
+  return class;
+}
+
 struct suscan_analyzer_sample_batch_msg *
-suscan_analyzer_sample_batch_msg_new(uint32_t inspector_id)
+suscan_analyzer_sample_batch_msg_new(
+    uint32_t inspector_id,
+    unsigned int capacity)
 {
   struct suscan_analyzer_sample_batch_msg *new = NULL;
+  unsigned int class = suscan_sample_batch_class(capacity);
 
-  SU_TRYCATCH(
-      new = calloc(1, sizeof(struct suscan_analyzer_sample_batch_msg)),
-      return NULL);
+  if (class < SUSCAN_SAMPLE_BATCH_POOL_CLASSES) {
+    pthread_mutex_lock(&sample_batch_pool_mutex);
+
+    if ((new = sample_batch_pool[class]) != NULL) {
+      sample_batch_pool[class] = new->next;
+      --sample_batch_pool_count[class];
+      sample_batch_pool_bytes -= sizeof(SUCOMPLEX) * new->sample_storage;
+    }
+
+    pthread_mutex_unlock(&sample_batch_pool_mutex);
+  }
+
+  if (new == NULL) {
+    SU_TRYCATCH(
+        new = calloc(1, sizeof(struct suscan_analyzer_sample_batch_msg)),
+        return NULL);
 
+    new->sample_storage = SUSCAN_SAMPLE_BATCH_MIN_CAPACITY << class;
+
+    if ((new->samples = malloc(sizeof(SUCOMPLEX) * new->sample_storage))
+        == NULL) {
+      SU_ERROR("Cannot allocate sample batch\n");
+      free(new);
+      return NULL;
+    }
+  }
+
+  new->source_id = 0;
   new->inspector_id = inspector_id;
+  new->sample_count = 0;
+  new->next = NULL;
 
   return new;
 }
 
 SUBOOL
-suscan_analyzer_sample_batch_msg_append_sample(
+suscan_analyzer_sample_batch_msg_append(
     struct suscan_analyzer_sample_batch_msg *msg,
-    SUCOMPLEX sample)
+    const SUCOMPLEX *samples,
+    unsigned int count)
 {
   unsigned int storage = msg->sample_storage;
   void *new;
 
-  if (storage == 0)
-    storage = 1;
-  else if (msg->sample_count == storage)
+  /* Storage stays a power of two, so that it goes back to its class */
+  while (storage < msg->sample_count + count)
     storage <<= 1;
 
   if (storage != msg->sample_storage) {
@@ -256,27 +486,221 @@ suscan_analyzer_sample_batch_msg_append_sample(
     msg->sample_storage = storage;
   }
 
-  msg->samples[msg->sample_count++] = sample;
+  memcpy(msg->samples + msg->sample_count, samples, count * sizeof(SUCOMPLEX));
+  msg->sample_count += count;
 
   return SU_TRUE;
 }
 
+SUBOOL
+suscan_analyzer_sample_batch_msg_append_sample(
+    struct suscan_analyzer_sample_batch_msg *msg,
+    SUCOMPLEX sample)
+{
+  return suscan_analyzer_sample_batch_msg_append(msg, &sample, 1);
+}
+
 void
 suscan_analyzer_sample_batch_msg_destroy(
     struct suscan_analyzer_sample_batch_msg *msg)
 {
-  if (msg->samples != NULL)
-    free(msg->samples);
+  unsigned int class = suscan_sample_batch_class(msg->sample_storage);
+  size_t bytes = sizeof(SUCOMPLEX) * msg->sample_storage;
+
+  if (class < SUSCAN_SAMPLE_BATCH_POOL_CLASSES) {
+    pthread_mutex_lock(&sample_batch_pool_mutex);
+
+    /* A burst of big batches must not stay allocated forever */
+    if (sample_batch_pool_count[class] < SUSCAN_SAMPLE_BATCH_POOL_DEPTH
+        && sample_batch_pool_bytes + bytes
+            <= SUSCAN_SAMPLE_BATCH_POOL_MAX_BYTES) {
+      msg->next = sample_batch_pool[class];
+      sample_batch_pool[class] = msg;
+      ++sample_batch_pool_count[class];
+      sample_batch_pool_bytes += bytes;
+      msg = NULL;
+    }
+
+    pthread_mutex_unlock(&sample_batch_pool_mutex);
+
+    if (msg == NULL)
+      return;
+  }
+
+  free(msg->samples);
+  free(msg);
+}
+
+void
+suscan_analyzer_sample_batch_pool_drain(void)
+{
+  struct suscan_analyzer_sample_batch_msg *msg;
+  unsigned int i;
+
+  pthread_mutex_lock(&sample_batch_pool_mutex);
+
+  for (i = 0; i < SUSCAN_SAMPLE_BATCH_POOL_CLASSES; ++i) {
+    while ((msg = sample_batch_pool[i]) != NULL) {
+      sample_batch_pool[i] = msg->next;
+      free(msg->samples);
+      free(msg);
+    }
+
+    sample_batch_pool_count[i] = 0;
+  }
+
+  sample_batch_pool_bytes = 0;
+
+  pthread_mutex_unlock(&sample_batch_pool_mutex);
+}
+
+struct suscan_analyzer_seek_msg *
+suscan_analyzer_seek_msg_new(SUFLOAT offset, uint32_t req_id)
+{
+  struct suscan_analyzer_seek_msg *new;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_seek_msg)),
+      return NULL);
+
+  new->offset = offset;
+  new->req_id = req_id;
+
+  return new;
+}
+
+void
+suscan_analyzer_seek_msg_destroy(struct suscan_analyzer_seek_msg *msg)
+{
+  free(msg);
+}
+
+struct suscan_analyzer_retune_msg *
+suscan_analyzer_retune_msg_new(
+    const struct suscan_source_tuning *tuning,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_retune_msg *new;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_retune_msg)),
+      return NULL);
+
+  new->tuning = *tuning;
+  new->req_id = req_id;
+
+  return new;
+}
+
+void
+suscan_analyzer_retune_msg_destroy(struct suscan_analyzer_retune_msg *msg)
+{
+  free(msg);
+}
+
+struct suscan_analyzer_params_msg *
+suscan_analyzer_params_msg_new(
+    const struct suscan_analyzer_params *params,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_params_msg *new;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_params_msg)),
+      return NULL);
+
+  new->params = *params;
+  new->req_id = req_id;
+
+  return new;
+}
+
+void
+suscan_analyzer_params_msg_destroy(struct suscan_analyzer_params_msg *msg)
+{
+  free(msg);
+}
+
+void
+suscan_analyzer_sweep_msg_destroy(struct suscan_analyzer_sweep_msg *msg)
+{
+  unsigned int i;
+
+  if (msg->psd != NULL)
+    suscan_analyzer_psd_msg_destroy(msg->psd);
+
+  for (i = 0; i < msg->channel_count; ++i)
+    if (msg->channel_list[i] != NULL)
+      su_channel_destroy(msg->channel_list[i]);
+
+  if (msg->channel_list != NULL)
+    free(msg->channel_list);
 
   free(msg);
 }
 
+struct suscan_analyzer_sweep_msg *
+suscan_analyzer_sweep_msg_new(
+    const suscan_analyzer_t *analyzer,
+    const struct suscan_analyzer_source *source,
+    suscan_sweep_t *sweep)
+{
+  struct suscan_analyzer_sweep_msg *new = NULL;
+  SUFLOAT *psd_data = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_sweep_msg)),
+      goto fail);
+
+  SU_TRYCATCH(
+      psd_data = malloc(sweep->psd_size * sizeof(SUFLOAT)),
+      goto fail);
+
+  suscan_sweep_get_psd(sweep, psd_data);
+
+  /* Peak hold makes no sense between sweeps of different ranges */
+  SU_TRYCATCH(
+      new->psd = suscan_analyzer_psd_msg_new_formatted(
+          psd_data,
+          sweep->psd_size,
+          suscan_sweep_get_span(sweep),
+          &source->psd_format,
+          NULL),
+      goto fail);
+
+  new->psd->fc = suscan_sweep_get_center(sweep);
+  new->psd->source_id = source->id;
+  new->psd->N0 = sweep->N0;
+
+  new->sender = analyzer;
+  new->source_id = source->id;
+  new->sweep_count = sweep->sweep_count;
+  new->sweep_rate = sweep->sweep_rate;
+
+  suscan_sweep_take_channels(sweep, &new->channel_list, &new->channel_count);
+
+  free(psd_data);
+
+  return new;
+
+fail:
+  if (psd_data != NULL)
+    free(psd_data);
+
+  if (new != NULL)
+    suscan_analyzer_sweep_msg_destroy(new);
+
+  return NULL;
+}
+
 void
 suscan_analyzer_dispose_message(uint32_t type, void *ptr)
 {
   switch (type) {
     case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT:
     case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST:
       suscan_analyzer_status_msg_destroy(ptr);
       break;
 
@@ -284,10 +708,18 @@ suscan_analyzer_dispose_message(uint32_t type, void *ptr)
       suscan_analyzer_channel_msg_destroy(ptr);
       break;
 
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL_DELTA:
+      suscan_analyzer_channel_delta_msg_destroy(ptr);
+      break;
+
     case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
       suscan_analyzer_inspector_msg_destroy(ptr);
       break;
 
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR_BATCH:
+      suscan_analyzer_inspector_batch_msg_destroy(ptr);
+      break;
+
     case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD:
     case SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD:
       suscan_analyzer_psd_msg_destroy(ptr);
@@ -296,24 +728,39 @@ suscan_analyzer_dispose_message(uint32_t type, void *ptr)
     case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
       suscan_analyzer_sample_batch_msg_destroy(ptr);
       break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SEEK:
+      suscan_analyzer_seek_msg_destroy(ptr);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_RETUNE:
+      suscan_analyzer_retune_msg_destroy(ptr);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS:
+      suscan_analyzer_params_msg_destroy(ptr);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP:
+      suscan_analyzer_sweep_msg_destroy(ptr);
+      break;
   }
 }
 
 /****************************** Sender methods *******************************/
-SUBOOL
-suscan_analyzer_send_status(
+SUPRIVATE SUBOOL
+suscan_analyzer_send_status_va(
     suscan_analyzer_t *analyzer,
+    uint32_t source_id,
     uint32_t type,
     int code,
-    const char *err_msg_fmt, ...)
+    const char *err_msg_fmt,
+    va_list ap)
 {
   struct suscan_analyzer_status_msg *msg;
-  va_list ap;
   char *err_msg = NULL;
   SUBOOL ok = SU_FALSE;
 
-  va_start(ap, err_msg_fmt);
-
   if (err_msg_fmt != NULL)
     if ((err_msg = vstrbuild(err_msg_fmt, ap)) == NULL)
       goto done;
@@ -322,6 +769,7 @@ suscan_analyzer_send_status(
     goto done;
 
   msg->sender = analyzer;
+  msg->source_id = source_id;
 
   if (!suscan_mq_write(analyzer->mq_out, type, msg)) {
     suscan_analyzer_dispose_message(type, msg);
@@ -334,6 +782,54 @@ done:
   if (err_msg != NULL)
     free(err_msg);
 
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_send_status(
+    suscan_analyzer_t *analyzer,
+    uint32_t type,
+    int code,
+    const char *err_msg_fmt, ...)
+{
+  va_list ap;
+  SUBOOL ok;
+
+  va_start(ap, err_msg_fmt);
+
+  ok = suscan_analyzer_send_status_va(
+      analyzer,
+      SUSCAN_ANALYZER_SOURCE_ANY,
+      type,
+      code,
+      err_msg_fmt,
+      ap);
+
+  va_end(ap);
+
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_send_source_status(
+    const struct suscan_analyzer_source *source,
+    uint32_t type,
+    int code,
+    const char *err_msg_fmt, ...)
+{
+  va_list ap;
+  SUBOOL ok;
+
+  va_start(ap, err_msg_fmt);
+
+  ok = suscan_analyzer_send_status_va(
+      source->analyzer,
+      source->id,
+      type,
+      code,
+      err_msg_fmt,
+      ap);
+
   va_end(ap);
 
   return ok;
@@ -342,17 +838,20 @@ done:
 SUBOOL
 suscan_analyzer_send_detector_channels(
     suscan_analyzer_t *analyzer,
-    const su_channel_detector_t *detector)
+    struct suscan_analyzer_source *source)
 {
   struct suscan_analyzer_channel_msg *msg = NULL;
   struct sigutils_channel **ch_list;
   unsigned int ch_count;
   SUBOOL ok = SU_FALSE;
 
-  su_channel_detector_get_channel_list(detector, &ch_list, &ch_count);
+  su_channel_detector_get_channel_list(source->detector, &ch_list, &ch_count);
 
-  if ((msg = suscan_analyzer_channel_msg_new(analyzer, ch_list, ch_count))
-      == NULL) {
+  if ((msg = suscan_analyzer_channel_msg_new(
+      analyzer,
+      source,
+      ch_list,
+      ch_count)) == NULL) {
     suscan_analyzer_send_status(
         analyzer,
         SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
@@ -362,6 +861,8 @@ suscan_analyzer_send_detector_channels(
     goto done;
   }
 
+  suscan_analyzer_source_get_time(source, &msg->timestamp);
+
   if (!suscan_mq_write(
       analyzer->mq_out,
       SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL,
@@ -386,15 +887,186 @@ done:
   return ok;
 }
 
+SUPRIVATE SUBOOL
+suscan_analyzer_send_tracker_deltas(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_source *source,
+    SUBOOL snapshot)
+{
+  struct suscan_analyzer_channel_delta_msg *msg = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  if ((msg = suscan_analyzer_channel_delta_msg_new(
+      analyzer,
+      &source->tracker)) == NULL) {
+    suscan_analyzer_send_status(
+        analyzer,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot create message: %s",
+        strerror(errno));
+    goto done;
+  }
+
+  msg->source_id = source->id;
+  msg->snapshot  = snapshot;
+  suscan_analyzer_source_get_time(source, &msg->timestamp);
+
+  if (!suscan_mq_write(
+      analyzer->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL_DELTA,
+      msg)) {
+    suscan_analyzer_send_status(
+        analyzer,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot write message: %s",
+        strerror(errno));
+    goto done;
+  }
+
+  /* Message queued, forget about it */
+  msg = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (msg != NULL)
+    suscan_analyzer_channel_delta_msg_destroy(msg);
+
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_send_channel_deltas(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_source *source)
+{
+  struct sigutils_channel **ch_list;
+  unsigned int ch_count;
+
+  su_channel_detector_get_channel_list(source->detector, &ch_list, &ch_count);
+
+  if (!suscan_tracker_update(
+      &source->tracker,
+      ch_list,
+      ch_count,
+      source->fc)) {
+    suscan_analyzer_send_status(
+        analyzer,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot update channel tracker: %s",
+        strerror(errno));
+    return SU_FALSE;
+  }
+
+  /* Nothing changed, nothing to say */
+  if (source->tracker.delta_count == 0)
+    return SU_TRUE;
+
+  return suscan_analyzer_send_tracker_deltas(analyzer, source, SU_FALSE);
+}
+
+/* Channels as last reported by deltas, with their IDs */
+SUBOOL
+suscan_analyzer_send_channel_snapshot(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_source *source)
+{
+  if (!suscan_tracker_snapshot(&source->tracker)) {
+    suscan_analyzer_send_status(
+        analyzer,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot take channel snapshot: %s",
+        strerror(errno));
+    return SU_FALSE;
+  }
+
+  return suscan_analyzer_send_tracker_deltas(analyzer, source, SU_TRUE);
+}
+
+SUBOOL
+suscan_analyzer_send_sweep(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_source *source)
+{
+  struct suscan_analyzer_sweep_msg *msg = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  if ((msg = suscan_analyzer_sweep_msg_new(
+      analyzer,
+      source,
+      source->sweep)) == NULL) {
+    suscan_analyzer_send_status(
+        analyzer,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot create message: %s",
+        strerror(errno));
+    goto done;
+  }
+
+  suscan_analyzer_source_get_time(source, &msg->timestamp);
+  msg->psd->timestamp = msg->timestamp;
+
+  if (!suscan_mq_write(
+      analyzer->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP,
+      msg)) {
+    suscan_analyzer_send_status(
+        analyzer,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot write message: %s",
+        strerror(errno));
+    goto done;
+  }
+
+  /* Message queued, forget about it */
+  msg = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (msg != NULL)
+    suscan_analyzer_sweep_msg_destroy(msg);
+
+  return ok;
+}
+
 SUBOOL
 suscan_analyzer_send_psd(
     suscan_analyzer_t *analyzer,
-    const su_channel_detector_t *detector)
+    struct suscan_analyzer_source *source)
 {
+  const su_channel_detector_t *detector = source->detector;
   struct suscan_analyzer_psd_msg *msg = NULL;
+  const SUFLOAT *psd_data;
+  SUSCOUNT size;
+  SUFLOAT samp_rate = detector->params.samp_rate;
   SUBOOL ok = SU_FALSE;
 
-  if ((msg = suscan_analyzer_psd_msg_new(detector)) == NULL) {
+  if (source->psd != NULL) {
+    (void) suscan_psd_get(source->psd, source->psd_scratch);
+    psd_data = source->psd_scratch;
+    size = source->psd->params.size;
+  } else {
+    psd_data = detector->spect;
+    size = detector->params.window_size;
+
+    if (detector->params.decimation > 1)
+      samp_rate /= detector->params.decimation;
+  }
+
+  if (!suscan_analyzer_source_prepare_psd_hold(source, size)
+      || (msg = suscan_analyzer_psd_msg_new_formatted(
+          psd_data,
+          size,
+          samp_rate,
+          &source->psd_format,
+          source->psd_hold)) == NULL) {
     suscan_analyzer_send_status(
         analyzer,
         SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
@@ -404,8 +1076,10 @@ suscan_analyzer_send_psd(
     goto done;
   }
 
-  msg->fc = analyzer->source.fc;
+  msg->fc = source->fc;
+  msg->source_id = source->id;
   msg->N0 = detector->N0;
+  suscan_analyzer_source_get_time(source, &msg->timestamp);
 
   if (!suscan_mq_write(
       analyzer->mq_out,
@@ -451,7 +1125,8 @@ suscan_inspector_send_psd(
     goto done;
   }
 
-  msg->fc = consumer->analyzer->source.fc;
+  msg->fc = consumer->source->fc;
+  msg->source_id = insp->source_id;
   msg->N0 = detector->N0;
   msg->inspector_id = insp->params.inspector_id;
 
@@ -36,15 +36,31 @@
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_PSD           0x7 /* Main spectrum */
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES       0x8 /* Sample batch */
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD      0x9 /* Inspector spectrum */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_SEEK          0xa /* Source seek */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL_DELTA 0xb /* Channel changes */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_RETUNE        0xc /* Source retune */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS        0xd /* Params update */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP         0xe /* Wideband sweep */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR_BATCH 0xf /* Inspector batch */
 
 #define SUSCAN_ANALYZER_INIT_SUCCESS               0
 #define SUSCAN_ANALYZER_INIT_FAILURE              -1
 
+/* Messages not related to any source in particular */
+#define SUSCAN_ANALYZER_SOURCE_ANY                 0xffffffff
+
+/*
+ * Messages from a multi-source analyzer are tagged with the ID of the
+ * source they refer to (its index in the analyzer's source list).
+ * Timestamps come from the virtual clock of each source.
+ */
+
 /* Generic status message */
 struct suscan_analyzer_status_msg {
   int code;
   char *err_msg;
   const suscan_analyzer_t *sender;
+  uint32_t source_id;
 };
 
 /* Channel notification message */
@@ -52,24 +68,113 @@ struct suscan_analyzer_channel_msg {
   const struct suscan_source *source;
   PTR_LIST(struct sigutils_channel, channel);
   const suscan_analyzer_t *sender;
+  uint32_t source_id;
+  struct timespec timestamp; /* Virtual clock */
+};
+
+/* Channel changes since the previous update */
+struct suscan_analyzer_channel_delta_msg {
+  const suscan_analyzer_t *sender;
+  uint32_t source_id;
+  struct timespec timestamp; /* Virtual clock */
+  struct suscan_channel_delta *delta_list;
+  unsigned int delta_count;
+  SUBOOL snapshot; /* Every tracked channel: drop the ones not listed */
 };
 
 /* Channel spectrum message */
 struct suscan_analyzer_psd_msg {
   uint64_t fc;
+  uint32_t source_id;
   uint32_t inspector_id;
   SUFLOAT  samp_rate;
   SUSCOUNT psd_size;
-  SUFLOAT *psd_data;
+  SUFLOAT *psd_data;  /* NULL if quantized */
   SUFLOAT  N0;
+
+  /* Quantized spectrum: level (dB) = db_min + db_step * psd_qdata[i] */
+  enum suscan_psd_quantization quantization;
+  SUFLOAT  db_min;
+  SUFLOAT  db_step;
+  void    *psd_qdata;
+  struct timespec timestamp; /* Virtual clock (analyzer PSD only) */
 };
 
-/* Channel sample batch */
+/*
+ * Channel sample batch. Destroyed batches go back to a process-wide pool
+ * with one free list per capacity (powers of two, starting at
+ * SUSCAN_SAMPLE_BATCH_MIN_CAPACITY), up to SUSCAN_SAMPLE_BATCH_POOL_DEPTH
+ * batches each and SUSCAN_SAMPLE_BATCH_POOL_MAX_BYTES of samples in all.
+ * suscan_analyzer_sample_batch_pool_drain frees the pooled batches.
+ */
+#define SUSCAN_SAMPLE_BATCH_MIN_CAPACITY 64
+#define SUSCAN_SAMPLE_BATCH_POOL_CLASSES 12 /* Up to 128k samples */
+#define SUSCAN_SAMPLE_BATCH_POOL_DEPTH   32
+#define SUSCAN_SAMPLE_BATCH_POOL_MAX_BYTES (4 << 20)
+
 struct suscan_analyzer_sample_batch_msg {
+  uint32_t     source_id;
   uint32_t     inspector_id;
   SUCOMPLEX   *samples;
   unsigned int sample_count;
   unsigned int sample_storage;
+
+  struct suscan_analyzer_sample_batch_msg *next; /* Pool free list */
+};
+
+/*
+ * Source seek request. The same message is sent back to the client once
+ * the seek has been performed, with status set accordingly.
+ */
+struct suscan_analyzer_seek_msg {
+  SUFLOAT  offset; /* Seconds from the beginning of the source */
+  uint32_t source_id;
+  uint32_t req_id;
+  int      status;
+};
+
+/*
+ * Source retune request. Once the source and the channel detector have
+ * been reconfigured, the same message is sent back to the client with
+ * the actual tuning and status set accordingly.
+ */
+struct suscan_analyzer_retune_msg {
+  struct suscan_source_tuning tuning;
+  uint32_t source_id;
+  uint32_t req_id;
+  int      status;
+  SUBOOL   applied; /* Internal: detector retuned, inspectors pending */
+  uint32_t sweep;   /* Internal: sweep step serial, 0 if client request */
+  uint32_t sweep_req; /* Internal: sweep request the step belongs to */
+};
+
+/*
+ * Analyzer parameters update. Update intervals and channel detector
+ * parameters are applied to all sources while running, the rest are
+ * ignored. The message is sent back with the parameters in effect. If
+ * any source fails, the ones already updated are restored.
+ */
+struct suscan_analyzer_params_msg {
+  struct suscan_analyzer_params params;
+  uint32_t req_id;
+  int      status;
+  uint32_t next_source; /* Internal: next source to update */
+  SUBOOL   rollback;    /* Internal: restoring the sources below next */
+};
+
+/*
+ * Completed wideband sweep. The spectra of all steps are stitched in a
+ * single PSD message, centered in the swept range and with the whole
+ * span as sample rate. Channels have absolute frequencies.
+ */
+struct suscan_analyzer_sweep_msg {
+  const suscan_analyzer_t *sender;
+  uint32_t source_id;
+  uint32_t sweep_count; /* Sweeps completed so far */
+  SUFLOAT  sweep_rate;  /* Sweeps per second */
+  struct suscan_analyzer_psd_msg *psd;
+  PTR_LIST(struct sigutils_channel, channel);
+  struct timespec timestamp; /* Virtual clock */
 };
 
 /*
@@ -84,7 +189,8 @@ enum suscan_analyzer_inspector_msgkind {
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INFO,
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_PARAMS,
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE,
-  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_KIND
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_KIND,
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_HALTED /* Internal, from consumers */
 };
 
 struct suscan_analyzer_inspector_msg {
@@ -92,6 +198,7 @@ struct suscan_analyzer_inspector_msg {
   uint32_t inspector_id; /* Per-inspector identifier */
   uint32_t req_id;       /* Per-request identifier */
   uint32_t handle;       /* Handle */
+  uint32_t source_id;    /* Source of the inspected channel */
   int status;
 
   union {
@@ -101,6 +208,48 @@ struct suscan_analyzer_inspector_msg {
   };
 };
 
+/*
+ * Batch of inspector commands of the same kind, over a list of channels
+ * (OPEN) or handles (CLOSE, GET_INFO). The reply is the same message,
+ * with per-entry results. Inspectors of an OPEN batch are built by the
+ * consumer workers in parallel, then registered by the analyzer thread.
+ */
+enum suscan_analyzer_inspector_batch_kind {
+  SUSCAN_ANALYZER_INSPECTOR_BATCH_OPEN,
+  SUSCAN_ANALYZER_INSPECTOR_BATCH_CLOSE,
+  SUSCAN_ANALYZER_INSPECTOR_BATCH_GET_INFO
+};
+
+enum suscan_analyzer_inspector_batch_status {
+  SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_OK,
+  SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_WRONG_HANDLE, /* Or source */
+  SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_FAILED
+};
+
+struct suscan_analyzer_inspector_batch_entry {
+  uint32_t source_id;                 /* OPEN */
+  struct sigutils_channel channel;    /* OPEN */
+  SUHANDLE handle;                    /* Result of OPEN, argument otherwise */
+  struct suscan_baud_det_result baud; /* Result of GET_INFO */
+  enum suscan_analyzer_inspector_batch_status status;
+
+  /* Internal, OPEN only */
+  SUSCOUNT fs;                        /* Source sample rate when requested */
+  suscan_inspector_t *inspector;      /* Built, not registered yet */
+};
+
+struct suscan_analyzer_inspector_batch_msg {
+  enum suscan_analyzer_inspector_batch_kind kind;
+  uint32_t req_id;
+  struct suscan_analyzer_inspector_batch_entry *entry_list;
+  unsigned int entry_count;
+
+  /* Internal, while inspectors are being built */
+  unsigned int next_entry; /* To build */
+  unsigned int pending;    /* Build tasks not finished yet */
+  SUBOOL built;
+};
+
 /***************************** Sender methods ********************************/
 void suscan_analyzer_status_msg_destroy(struct suscan_analyzer_status_msg *status);
 struct suscan_analyzer_status_msg *suscan_analyzer_status_msg_new(
@@ -113,13 +262,30 @@ SUBOOL suscan_analyzer_send_status(
     int code,
     const char *err_msg_fmt, ...);
 
+SUBOOL suscan_analyzer_send_source_status(
+    const struct suscan_analyzer_source *source,
+    uint32_t type,
+    int code,
+    const char *err_msg_fmt, ...);
+
 SUBOOL suscan_analyzer_send_detector_channels(
     suscan_analyzer_t *analyzer,
-    const su_channel_detector_t *detector);
+    struct suscan_analyzer_source *source);
 
+SUBOOL suscan_analyzer_send_channel_deltas(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_source *source);
+
+SUBOOL suscan_analyzer_send_channel_snapshot(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_source *source);
+
+SUBOOL suscan_analyzer_send_sweep(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_source *source);
 SUBOOL suscan_analyzer_send_psd(
     suscan_analyzer_t *analyzer,
-    const su_channel_detector_t *detector);
+    struct suscan_analyzer_source *source);
 
 SUBOOL suscan_inspector_send_psd(
     suscan_inspector_t *insp,
@@ -131,6 +297,14 @@ SUBOOL suscan_analyzer_parse_inspector_msg(
     suscan_analyzer_t *analyzer,
     struct suscan_analyzer_inspector_msg *msg);
 
+SUBOOL suscan_analyzer_parse_inspector_batch_msg(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_inspector_batch_msg *msg);
+
+SUBOOL suscan_analyzer_retune_inspectors(
+    suscan_analyzer_t *analyzer,
+    const struct suscan_analyzer_source *source);
+
 /***************** Message constructors and destructors **********************/
 /* Status message */
 struct suscan_analyzer_status_msg *suscan_analyzer_status_msg_new(
@@ -141,6 +315,7 @@ void suscan_analyzer_status_msg_destroy(struct suscan_analyzer_status_msg *statu
 /* Channel list update */
 struct suscan_analyzer_channel_msg *suscan_analyzer_channel_msg_new(
     const suscan_analyzer_t *analyzer,
+    const struct suscan_analyzer_source *source,
     struct sigutils_channel **list,
     unsigned int len);
 void suscan_analyzer_channel_msg_take_channels(
@@ -149,6 +324,14 @@ void suscan_analyzer_channel_msg_take_channels(
     unsigned int *pchannel_count);
 void suscan_analyzer_channel_msg_destroy(struct suscan_analyzer_channel_msg *msg);
 
+/* Channel deltas */
+struct suscan_analyzer_channel_delta_msg *
+suscan_analyzer_channel_delta_msg_new(
+    const suscan_analyzer_t *analyzer,
+    const suscan_tracker_t *tracker);
+void suscan_analyzer_channel_delta_msg_destroy(
+    struct suscan_analyzer_channel_delta_msg *msg);
+
 /* Channel inspector commands */
 struct suscan_analyzer_inspector_msg *suscan_analyzer_inspector_msg_new(
     enum suscan_analyzer_inspector_msgkind kind,
@@ -156,15 +339,36 @@ struct suscan_analyzer_inspector_msg *suscan_analyzer_inspector_msg_new(
 void suscan_analyzer_inspector_msg_destroy(
     struct suscan_analyzer_inspector_msg *msg);
 
+/* Inspector command batch. Entries are zeroed */
+struct suscan_analyzer_inspector_batch_msg *
+suscan_analyzer_inspector_batch_msg_new(
+    enum suscan_analyzer_inspector_batch_kind kind,
+    unsigned int entry_count,
+    uint32_t req_id);
+void suscan_analyzer_inspector_batch_msg_destroy(
+    struct suscan_analyzer_inspector_batch_msg *msg);
+
 /* Spectrum update message */
 struct suscan_analyzer_psd_msg *suscan_analyzer_psd_msg_new(
     const su_channel_detector_t *cd);
+struct suscan_analyzer_psd_msg *suscan_analyzer_psd_msg_new_formatted(
+    const SUFLOAT *psd_data,
+    SUSCOUNT size,
+    SUFLOAT samp_rate,
+    const struct suscan_psd_format *format,
+    SUFLOAT *hold);
 SUFLOAT *suscan_analyzer_psd_msg_take_psd(struct suscan_analyzer_psd_msg *msg);
 void suscan_analyzer_psd_msg_destroy(struct suscan_analyzer_psd_msg *msg);
 
-/* Sample batch message */
+/* Sample batch message. capacity is a hint, 0 for the minimum */
 struct suscan_analyzer_sample_batch_msg *suscan_analyzer_sample_batch_msg_new(
-    uint32_t inspector_id);
+    uint32_t inspector_id,
+    unsigned int capacity);
+
+SUBOOL suscan_analyzer_sample_batch_msg_append(
+    struct suscan_analyzer_sample_batch_msg *msg,
+    const SUCOMPLEX *samples,
+    unsigned int count);
 
 SUBOOL suscan_analyzer_sample_batch_msg_append_sample(
     struct suscan_analyzer_sample_batch_msg *msg,
@@ -173,6 +377,36 @@ SUBOOL suscan_analyzer_sample_batch_msg_append_sample(
 void suscan_analyzer_sample_batch_msg_destroy(
     struct suscan_analyzer_sample_batch_msg *msg);
 
+/* Frees every pooled batch, e.g. on exit */
+void suscan_analyzer_sample_batch_pool_drain(void);
+
+/* Source seek message */
+struct suscan_analyzer_seek_msg *suscan_analyzer_seek_msg_new(
+    SUFLOAT offset,
+    uint32_t req_id);
+void suscan_analyzer_seek_msg_destroy(struct suscan_analyzer_seek_msg *msg);
+
+/* Source retune message */
+struct suscan_analyzer_retune_msg *suscan_analyzer_retune_msg_new(
+    const struct suscan_source_tuning *tuning,
+    uint32_t req_id);
+void suscan_analyzer_retune_msg_destroy(
+    struct suscan_analyzer_retune_msg *msg);
+
+/* Analyzer params message */
+struct suscan_analyzer_params_msg *suscan_analyzer_params_msg_new(
+    const struct suscan_analyzer_params *params,
+    uint32_t req_id);
+void suscan_analyzer_params_msg_destroy(
+    struct suscan_analyzer_params_msg *msg);
+
+/* Sweep message. Channels of the last sweep are moved to the message */
+struct suscan_analyzer_sweep_msg *suscan_analyzer_sweep_msg_new(
+    const suscan_analyzer_t *analyzer,
+    const struct suscan_analyzer_source *source,
+    suscan_sweep_t *sweep);
+void suscan_analyzer_sweep_msg_destroy(struct suscan_analyzer_sweep_msg *msg);
+
 /* Generic message disposer */
 void suscan_analyzer_dispose_message(uint32_t type, void *ptr);
 
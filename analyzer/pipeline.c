@@ -0,0 +1,182 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "pipeline"
+
+#include "pipeline.h"
+
+SUBOOL
+suscan_pipeline_init(suscan_pipeline_t *pipe, SUSCOUNT size)
+{
+  unsigned int i;
+
+  memset(pipe, 0, sizeof(suscan_pipeline_t));
+
+  pipe->size = size;
+  pipe->read_size = size;
+
+  for (i = 0; i < SUSCAN_PIPELINE_DEPTH; ++i)
+    SU_TRYCATCH(
+        pipe->slots[i].data = malloc(size * sizeof(SUCOMPLEX)),
+        goto fail);
+
+  SU_TRYCATCH(pthread_mutex_init(&pipe->lock, NULL) == 0, goto fail);
+
+  if (pthread_cond_init(&pipe->cond, NULL) != 0) {
+    pthread_mutex_destroy(&pipe->lock);
+    goto fail;
+  }
+
+  pipe->initialized = SU_TRUE;
+
+  return SU_TRUE;
+
+fail:
+  suscan_pipeline_finalize(pipe);
+
+  return SU_FALSE;
+}
+
+struct suscan_pipeline_slot *
+suscan_pipeline_get_free(suscan_pipeline_t *pipe)
+{
+  struct suscan_pipeline_slot *slot = NULL;
+
+  pthread_mutex_lock(&pipe->lock);
+
+  while (!pipe->cancelled && pipe->ready == SUSCAN_PIPELINE_DEPTH)
+    pthread_cond_wait(&pipe->cond, &pipe->lock);
+
+  if (!pipe->cancelled)
+    slot = pipe->slots + pipe->head;
+
+  pthread_mutex_unlock(&pipe->lock);
+
+  return slot;
+}
+
+void
+suscan_pipeline_commit(suscan_pipeline_t *pipe)
+{
+  pthread_mutex_lock(&pipe->lock);
+
+  pipe->head = (pipe->head + 1) % SUSCAN_PIPELINE_DEPTH;
+  ++pipe->ready;
+
+  pthread_cond_broadcast(&pipe->cond);
+  pthread_mutex_unlock(&pipe->lock);
+}
+
+struct suscan_pipeline_slot *
+suscan_pipeline_get_ready(suscan_pipeline_t *pipe)
+{
+  struct suscan_pipeline_slot *slot = NULL;
+
+  pthread_mutex_lock(&pipe->lock);
+
+  while (!pipe->cancelled && pipe->ready == 0)
+    pthread_cond_wait(&pipe->cond, &pipe->lock);
+
+  if (!pipe->cancelled)
+    slot = pipe->slots + pipe->tail;
+
+  pthread_mutex_unlock(&pipe->lock);
+
+  return slot;
+}
+
+void
+suscan_pipeline_release(suscan_pipeline_t *pipe)
+{
+  pthread_mutex_lock(&pipe->lock);
+
+  pipe->tail = (pipe->tail + 1) % SUSCAN_PIPELINE_DEPTH;
+  --pipe->ready;
+
+  pthread_cond_broadcast(&pipe->cond);
+  pthread_mutex_unlock(&pipe->lock);
+}
+
+void
+suscan_pipeline_set_read_size(suscan_pipeline_t *pipe, SUSCOUNT size)
+{
+  pthread_mutex_lock(&pipe->lock);
+  pipe->read_size = MIN(size, pipe->size);
+  pthread_mutex_unlock(&pipe->lock);
+}
+
+SUSCOUNT
+suscan_pipeline_get_read_size(suscan_pipeline_t *pipe)
+{
+  SUSCOUNT size;
+
+  pthread_mutex_lock(&pipe->lock);
+  size = pipe->read_size;
+  pthread_mutex_unlock(&pipe->lock);
+
+  return size;
+}
+
+unsigned int
+suscan_pipeline_get_queued(suscan_pipeline_t *pipe)
+{
+  unsigned int ready;
+
+  pthread_mutex_lock(&pipe->lock);
+  ready = pipe->ready;
+  pthread_mutex_unlock(&pipe->lock);
+
+  return ready;
+}
+
+void
+suscan_pipeline_cancel(suscan_pipeline_t *pipe)
+{
+  if (!pipe->initialized)
+    return;
+
+  pthread_mutex_lock(&pipe->lock);
+
+  pipe->cancelled = SU_TRUE;
+
+  pthread_cond_broadcast(&pipe->cond);
+  pthread_mutex_unlock(&pipe->lock);
+}
+
+void
+suscan_pipeline_finalize(suscan_pipeline_t *pipe)
+{
+  unsigned int i;
+
+  if (pipe->initialized) {
+    pthread_cond_destroy(&pipe->cond);
+    pthread_mutex_destroy(&pipe->lock);
+    pipe->initialized = SU_FALSE;
+  }
+
+  for (i = 0; i < SUSCAN_PIPELINE_DEPTH; ++i)
+    if (pipe->slots[i].data != NULL) {
+      free(pipe->slots[i].data);
+      pipe->slots[i].data = NULL;
+    }
+}
@@ -0,0 +1,82 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Ring of sample buffers connecting the acquire stage (source worker) and
+ * the detect stage (detector worker). There is exactly one producer and
+ * one consumer: the producer fills the slot at head, the consumer
+ * processes the slot at tail. Slots are never copied.
+ */
+#define SUSCAN_PIPELINE_DEPTH 4
+
+struct suscan_pipeline_slot {
+  SUCOMPLEX *data;
+  SUSDIFF    got;  /* Samples read, or su_block_port_read error code */
+  uint64_t   pos;  /* Stream position of the first sample */
+  void      *retune; /* Retune message, if these are the first samples */
+};
+
+struct suscan_pipeline {
+  struct suscan_pipeline_slot slots[SUSCAN_PIPELINE_DEPTH];
+  SUSCOUNT size;          /* Capacity of each slot, in samples */
+  SUSCOUNT read_size;     /* Samples the producer should read next */
+  unsigned int head;      /* Next slot to fill */
+  unsigned int tail;      /* Next slot to process */
+  unsigned int ready;     /* Filled slots */
+  SUBOOL cancelled;
+
+  SUBOOL initialized;
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+};
+
+typedef struct suscan_pipeline suscan_pipeline_t;
+
+SUBOOL suscan_pipeline_init(suscan_pipeline_t *pipe, SUSCOUNT size);
+
+/* Producer side. get_free blocks, and returns NULL after cancel */
+struct suscan_pipeline_slot *suscan_pipeline_get_free(suscan_pipeline_t *pipe);
+void suscan_pipeline_commit(suscan_pipeline_t *pipe);
+
+/* Consumer side. get_ready blocks, and returns NULL after cancel */
+struct suscan_pipeline_slot *suscan_pipeline_get_ready(
+    suscan_pipeline_t *pipe);
+void suscan_pipeline_release(suscan_pipeline_t *pipe);
+
+/* Set by the consumer (e.g. the autotuner), read by the producer */
+void suscan_pipeline_set_read_size(suscan_pipeline_t *pipe, SUSCOUNT size);
+SUSCOUNT suscan_pipeline_get_read_size(suscan_pipeline_t *pipe);
+
+/* Filled slots, including the one being processed */
+unsigned int suscan_pipeline_get_queued(suscan_pipeline_t *pipe);
+
+/* Wakes up both stages. Further gets return NULL */
+void suscan_pipeline_cancel(suscan_pipeline_t *pipe);
+
+void suscan_pipeline_finalize(suscan_pipeline_t *pipe);
+
+#endif /* _PIPELINE_H */
@@ -0,0 +1,460 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define SU_LOG_DOMAIN "planner"
+
+#include <util.h>
+
+#include "planner.h"
+
+/*
+ * FFTW planner state is global: the number of threads is a planner
+ * setting that applies to every plan created after it, and the planner
+ * itself is not reentrant. Detectors are created from different threads
+ * (analyzer and consumers), so everything that plans or destroys plans
+ * goes through planner_mutex.
+ */
+SUPRIVATE pthread_mutex_t planner_mutex = PTHREAD_MUTEX_INITIALIZER;
+SUPRIVATE unsigned int planner_threads = 1;
+SUPRIVATE char *planner_wisdom_path = NULL;
+SUPRIVATE char *planner_wisdom = NULL; /* As loaded, to save only changes */
+
+struct suscan_planner_plan {
+  SUSCOUNT size;
+  int sign;
+  SUBOOL in_place;
+  unsigned int refs;
+  SU_FFTW(_plan) plan;
+};
+
+PTR_LIST(struct suscan_planner_plan, planner_plan);
+
+/*
+ * Transforms planned without wisdom in this run. They are measured by
+ * suscan_planner_finalize, so the next run finds them in the wisdom file.
+ */
+struct suscan_planner_transform {
+  SUSCOUNT size;
+  int sign;
+  SUBOOL in_place;
+};
+
+PTR_LIST(struct suscan_planner_transform, planner_unwise);
+
+SUPRIVATE char *
+suscan_planner_get_wisdom_path(const char *path)
+{
+  const char *home;
+
+  if (path == NULL)
+    path = getenv(SUSCAN_PLANNER_WISDOM_ENV);
+
+  if (path != NULL)
+    return *path != '\0' ? strdup(path) : NULL;
+
+  if ((home = getenv("HOME")) == NULL)
+    return NULL;
+
+  return strbuild("%s/%s", home, SUSCAN_PLANNER_WISDOM_FILE);
+}
+
+SUBOOL
+suscan_planner_init(const char *wisdom_path)
+{
+#ifdef HAVE_FFTW3_THREADS
+  long count;
+
+  if ((count = sysconf(_SC_NPROCESSORS_ONLN)) > 1) {
+    if (SU_FFTW(_init_threads)() == 0)
+      SU_WARNING("Cannot initialize FFTW threads, using serial FFTs\n");
+    else
+      planner_threads = count;
+  }
+#endif /* HAVE_FFTW3_THREADS */
+
+  /* Wisdom is an optimization: a missing or stale file is not an error */
+  if ((planner_wisdom_path = suscan_planner_get_wisdom_path(wisdom_path))
+      != NULL
+      && access(planner_wisdom_path, R_OK) == 0) {
+    pthread_mutex_lock(&planner_mutex);
+
+    if (SU_FFTW(_import_wisdom_from_filename)(planner_wisdom_path) == 0)
+      SU_WARNING(
+          "Cannot import FFTW wisdom from `%s'\n",
+          planner_wisdom_path);
+
+    pthread_mutex_unlock(&planner_mutex);
+  }
+
+  if (planner_wisdom_path != NULL) {
+    pthread_mutex_lock(&planner_mutex);
+    planner_wisdom = SU_FFTW(_export_wisdom_to_string)();
+    pthread_mutex_unlock(&planner_mutex);
+  }
+
+  return SU_TRUE;
+}
+
+/* Must be called with planner_mutex held */
+SUPRIVATE SU_FFTW(_plan)
+suscan_planner_plan_new(
+    SUSCOUNT size,
+    int sign,
+    SUBOOL in_place,
+    unsigned int flags)
+{
+  SU_FFTW(_complex) *in = NULL;
+  SU_FFTW(_complex) *out = NULL;
+  SU_FFTW(_plan) plan = NULL;
+
+  SU_TRYCATCH(
+      in = SU_FFTW(_malloc)(size * sizeof(SU_FFTW(_complex))),
+      goto done);
+
+  if (!in_place)
+    SU_TRYCATCH(
+        out = SU_FFTW(_malloc)(size * sizeof(SU_FFTW(_complex))),
+        goto done);
+
+#ifdef HAVE_FFTW3_THREADS
+  if (planner_threads > 1 && size >= SUSCAN_PLANNER_THREADED_MIN_SIZE)
+    SU_FFTW(_plan_with_nthreads)(planner_threads);
+#endif /* HAVE_FFTW3_THREADS */
+
+  plan = SU_FFTW(_plan_dft_1d)(
+      size,
+      in,
+      in_place ? in : out,
+      sign,
+      flags);
+
+#ifdef HAVE_FFTW3_THREADS
+  SU_FFTW(_plan_with_nthreads)(1);
+#endif /* HAVE_FFTW3_THREADS */
+
+done:
+  if (in != NULL)
+    SU_FFTW(_free)(in);
+
+  if (out != NULL)
+    SU_FFTW(_free)(out);
+
+  return plan;
+}
+
+/*
+ * Remembers a transform to measure on finalize, if there is wisdom to
+ * save it to. Must be called with planner_mutex held.
+ */
+SUPRIVATE void
+suscan_planner_learn(SUSCOUNT size, int sign, SUBOOL in_place)
+{
+  struct suscan_planner_transform *transform = NULL;
+  unsigned int i;
+
+  if (planner_wisdom_path == NULL)
+    return;
+
+  for (i = 0; i < planner_unwise_count; ++i)
+    if (planner_unwise_list[i]->size == size
+        && planner_unwise_list[i]->sign == sign
+        && planner_unwise_list[i]->in_place == in_place)
+      return;
+
+  SU_TRYCATCH(
+      transform = malloc(sizeof(struct suscan_planner_transform)),
+      return);
+
+  transform->size = size;
+  transform->sign = sign;
+  transform->in_place = in_place;
+
+  SU_TRYCATCH(
+      PTR_LIST_APPEND_CHECK(planner_unwise, transform) != -1,
+      free(transform));
+}
+
+/*
+ * Measuring a big transform takes seconds, and every other plan waits
+ * for the lock meanwhile. Without wisdom, transforms are estimated
+ * instead, and measured on finalize. Must be called with planner_mutex
+ * held.
+ */
+SUPRIVATE SU_FFTW(_plan)
+suscan_planner_plan_wise(SUSCOUNT size, int sign, SUBOOL in_place)
+{
+  SU_FFTW(_plan) plan;
+
+  if ((plan = suscan_planner_plan_new(
+      size,
+      sign,
+      in_place,
+      FFTW_MEASURE | FFTW_WISDOM_ONLY)) != NULL)
+    return plan;
+
+  suscan_planner_learn(size, sign, in_place);
+
+  return suscan_planner_plan_new(size, sign, in_place, FFTW_ESTIMATE);
+}
+
+/*
+ * Most runs plan the same transforms as the previous one. Must be called
+ * with planner_mutex held.
+ */
+SUPRIVATE SUBOOL
+suscan_planner_wisdom_changed(void)
+{
+  char *wisdom;
+  SUBOOL changed;
+
+  if ((wisdom = SU_FFTW(_export_wisdom_to_string)()) == NULL)
+    return SU_FALSE;
+
+  changed = planner_wisdom == NULL || strcmp(wisdom, planner_wisdom) != 0;
+
+  free(wisdom);
+
+  return changed;
+}
+
+/* Written to a temporary file first: other instances may be reading it */
+SUPRIVATE void
+suscan_planner_save_wisdom(const char *path)
+{
+  char *tmp = NULL;
+
+  SU_TRYCATCH(tmp = strbuild("%s.%d", path, getpid()), goto done);
+
+  if (SU_FFTW(_export_wisdom_to_filename)(tmp) == 0) {
+    SU_WARNING("Cannot export FFTW wisdom to `%s'\n", tmp);
+    goto done;
+  }
+
+  if (rename(tmp, path) == -1) {
+    SU_WARNING("Cannot save FFTW wisdom to `%s'\n", path);
+    unlink(tmp);
+  }
+
+done:
+  if (tmp != NULL)
+    free(tmp);
+}
+
+void
+suscan_planner_finalize(void)
+{
+  SU_FFTW(_plan) plan;
+  unsigned int i;
+
+  pthread_mutex_lock(&planner_mutex);
+
+  for (i = 0; i < planner_unwise_count; ++i) {
+    if ((plan = suscan_planner_plan_new(
+        planner_unwise_list[i]->size,
+        planner_unwise_list[i]->sign,
+        planner_unwise_list[i]->in_place,
+        FFTW_MEASURE)) != NULL)
+      SU_FFTW(_destroy_plan)(plan);
+
+    free(planner_unwise_list[i]);
+  }
+
+  if (planner_unwise_list != NULL)
+    free(planner_unwise_list);
+
+  planner_unwise_list = NULL;
+  planner_unwise_count = 0;
+
+  if (planner_wisdom_path != NULL && suscan_planner_wisdom_changed())
+    suscan_planner_save_wisdom(planner_wisdom_path);
+
+  for (i = 0; i < planner_plan_count; ++i) {
+    if (planner_plan_list[i]->refs > 0)
+      SU_WARNING(
+          "FFT plan of size %lu still in use\n",
+          (unsigned long) planner_plan_list[i]->size);
+
+    SU_FFTW(_destroy_plan)(planner_plan_list[i]->plan);
+    free(planner_plan_list[i]);
+  }
+
+  if (planner_plan_list != NULL)
+    free(planner_plan_list);
+
+  planner_plan_list = NULL;
+  planner_plan_count = 0;
+
+  if (planner_wisdom_path != NULL)
+    free(planner_wisdom_path);
+
+  planner_wisdom_path = NULL;
+
+  if (planner_wisdom != NULL)
+    free(planner_wisdom);
+
+  planner_wisdom = NULL;
+
+  pthread_mutex_unlock(&planner_mutex);
+}
+
+unsigned int
+suscan_planner_get_threads(void)
+{
+  return planner_threads;
+}
+
+/*
+ * Detectors plan inside sigutils, on buffers of their own, and run their
+ * plans with SU_FFTW(_execute): a cached plan cannot be swapped in. What
+ * they share is wisdom, global to FFTW and used for any plan of the same
+ * transform, so their window transform is learned like the cached ones.
+ * Must be called with planner_mutex held.
+ */
+SUPRIVATE void
+suscan_planner_learn_detector(
+    const struct sigutils_channel_detector_params *params)
+{
+  SU_FFTW(_plan) plan;
+
+  if (planner_wisdom_path == NULL)
+    return;
+
+  if ((plan = suscan_planner_plan_new(
+      params->window_size,
+      FFTW_FORWARD,
+      SU_FALSE,
+      FFTW_MEASURE | FFTW_WISDOM_ONLY)) != NULL)
+    SU_FFTW(_destroy_plan)(plan);
+  else
+    suscan_planner_learn(params->window_size, FFTW_FORWARD, SU_FALSE);
+}
+
+su_channel_detector_t *
+suscan_planner_channel_detector_new(
+    const struct sigutils_channel_detector_params *params)
+{
+  su_channel_detector_t *detector;
+
+  pthread_mutex_lock(&planner_mutex);
+
+  suscan_planner_learn_detector(params);
+
+#ifdef HAVE_FFTW3_THREADS
+  if (planner_threads > 1
+      && params->window_size >= SUSCAN_PLANNER_THREADED_MIN_SIZE) {
+    SU_FFTW(_plan_with_nthreads)(planner_threads);
+    detector = su_channel_detector_new(params);
+    SU_FFTW(_plan_with_nthreads)(1);
+  } else {
+    detector = su_channel_detector_new(params);
+  }
+#else
+  detector = su_channel_detector_new(params);
+#endif /* HAVE_FFTW3_THREADS */
+
+  pthread_mutex_unlock(&planner_mutex);
+
+  return detector;
+}
+
+void
+suscan_planner_channel_detector_destroy(su_channel_detector_t *detector)
+{
+  pthread_mutex_lock(&planner_mutex);
+  su_channel_detector_destroy(detector);
+  pthread_mutex_unlock(&planner_mutex);
+}
+
+SU_FFTW(_plan)
+suscan_planner_plan_dft_1d(SUSCOUNT size, int sign, SUBOOL in_place)
+{
+  struct suscan_planner_plan *entry = NULL;
+  SU_FFTW(_plan) plan = NULL;
+  unsigned int i;
+
+  pthread_mutex_lock(&planner_mutex);
+
+  for (i = 0; i < planner_plan_count; ++i)
+    if (planner_plan_list[i]->size == size
+        && planner_plan_list[i]->sign == sign
+        && planner_plan_list[i]->in_place == in_place) {
+      ++planner_plan_list[i]->refs;
+      plan = planner_plan_list[i]->plan;
+      goto done;
+    }
+
+  SU_TRYCATCH(entry = calloc(1, sizeof(struct suscan_planner_plan)), goto done);
+  SU_TRYCATCH(
+      entry->plan = suscan_planner_plan_wise(size, sign, in_place),
+      goto done);
+
+  entry->size = size;
+  entry->sign = sign;
+  entry->in_place = in_place;
+  entry->refs = 1;
+
+  SU_TRYCATCH(PTR_LIST_APPEND_CHECK(planner_plan, entry) != -1, goto done);
+
+  plan = entry->plan;
+  entry = NULL;
+
+done:
+  if (entry != NULL) {
+    if (entry->plan != NULL)
+      SU_FFTW(_destroy_plan)(entry->plan);
+    free(entry);
+  }
+
+  pthread_mutex_unlock(&planner_mutex);
+
+  return plan;
+}
+
+/*
+ * Unused plans are kept until suscan_planner_finalize: callers come and
+ * go (e.g. the PSD of every analyzer) with the same few sizes.
+ */
+void
+suscan_planner_destroy_plan(SU_FFTW(_plan) plan)
+{
+  unsigned int i;
+
+  pthread_mutex_lock(&planner_mutex);
+
+  for (i = 0; i < planner_plan_count; ++i)
+    if (planner_plan_list[i]->plan == plan) {
+      if (planner_plan_list[i]->refs > 0)
+        --planner_plan_list[i]->refs;
+      goto done;
+    }
+
+  SU_WARNING("Attempting to destroy a plan not created by the planner\n");
+
+done:
+  pthread_mutex_unlock(&planner_mutex);
+}
@@ -0,0 +1,86 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _PLANNER_H
+#define _PLANNER_H
+
+#include <sigutils/sigutils.h>
+#include <sigutils/detect.h>
+
+/*
+ * Detectors with windows of this size or bigger are planned with
+ * multithreaded FFTW (if available). Smaller transforms are faster
+ * single-threaded.
+ */
+#define SUSCAN_PLANNER_THREADED_MIN_SIZE 16384
+
+/*
+ * FFTW wisdom is loaded from the path given to suscan_planner_init (if
+ * any) and saved back by suscan_planner_finalize if planning added to
+ * it. When path is NULL, SUSCAN_PLANNER_WISDOM_ENV is looked up, and
+ * then SUSCAN_PLANNER_WISDOM_FILE under $HOME. Transforms missing from
+ * the wisdom are estimated while running and measured on finalize, which
+ * may take a few seconds the first time a size is used.
+ */
+#define SUSCAN_PLANNER_WISDOM_ENV  "SUSCAN_WISDOM"
+#define SUSCAN_PLANNER_WISDOM_FILE ".suscan.wisdom"
+
+SUBOOL suscan_planner_init(const char *wisdom_path);
+void suscan_planner_finalize(void);
+
+/* Number of threads used for big transforms (1 if unsupported) */
+unsigned int suscan_planner_get_threads(void);
+
+/*
+ * Detectors plan their own FFTs inside sigutils, so they cannot share
+ * plans, only wisdom. They are created and destroyed under the planner
+ * lock, as the FFTW planner is not reentrant and inspectors are built
+ * concurrently.
+ */
+su_channel_detector_t *suscan_planner_channel_detector_new(
+    const struct sigutils_channel_detector_params *params);
+
+void suscan_planner_channel_detector_destroy(su_channel_detector_t *detector);
+
+/*
+ * Cached plans for complex 1D transforms, shared by every caller asking
+ * for the same size, direction (FFTW_FORWARD or FFTW_BACKWARD) and
+ * placement. Since they are planned on scratch buffers, they must be
+ * run with suscan_planner_execute on buffers allocated with
+ * SU_FFTW(_malloc). Every plan returned here must be released with
+ * suscan_planner_destroy_plan.
+ */
+SU_FFTW(_plan) suscan_planner_plan_dft_1d(
+    SUSCOUNT size,
+    int sign,
+    SUBOOL in_place);
+
+SUINLINE void
+suscan_planner_execute(SU_FFTW(_plan) plan, SUCOMPLEX *in, SUCOMPLEX *out)
+{
+  SU_FFTW(_execute_dft)(
+      plan,
+      (SU_FFTW(_complex) *) in,
+      (SU_FFTW(_complex) *) out);
+}
+
+void suscan_planner_destroy_plan(SU_FFTW(_plan) plan);
+
+#endif /* _PLANNER_H */
@@ -0,0 +1,361 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SU_LOG_DOMAIN "psd"
+
+#include "psd.h"
+#include "planner.h"
+#include "throttle.h" /* timespecsub */
+
+SUPRIVATE void
+suscan_psd_init_window(suscan_psd_t *psd)
+{
+  SUSCOUNT n = psd->params.size;
+  SUSCOUNT i;
+  SUFLOAT x;
+
+  psd->wnorm = 0;
+
+  for (i = 0; i < n; ++i) {
+    x = n > 1 ? 2 * PI * i / (n - 1) : 0;
+
+    switch (psd->params.window) {
+      case SUSCAN_PSD_WINDOW_HANN:
+        psd->window[i] = .5 - .5 * SU_COS(x);
+        break;
+
+      case SUSCAN_PSD_WINDOW_HAMMING:
+        psd->window[i] = .54 - .46 * SU_COS(x);
+        break;
+
+      case SUSCAN_PSD_WINDOW_BLACKMANN_HARRIS:
+        psd->window[i] = .35875
+            - .48829 * SU_COS(x)
+            + .14128 * SU_COS(2 * x)
+            - .01168 * SU_COS(3 * x);
+        break;
+
+      default:
+        psd->window[i] = 1;
+    }
+
+    psd->wnorm += psd->window[i] * psd->window[i];
+  }
+}
+
+void
+suscan_psd_destroy(suscan_psd_t *psd)
+{
+  if (psd->frames > 0)
+    SU_INFO(
+        "Welch PSD: %llu frames of %lu bins, %.1lf us/frame, "
+        "%.1lf ns/sample\n",
+        (unsigned long long) psd->frames,
+        (unsigned long) psd->params.size,
+        suscan_psd_get_frame_cost(psd) * 1e-3,
+        suscan_psd_get_frame_cost(psd) / psd->hop);
+
+  if (psd->plan != NULL)
+    suscan_planner_destroy_plan(psd->plan);
+
+  if (psd->window != NULL)
+    free(psd->window);
+
+  if (psd->buffer != NULL)
+    free(psd->buffer);
+
+  if (psd->fft != NULL)
+    SU_FFTW(_free)(psd->fft);
+
+  if (psd->acc != NULL)
+    free(psd->acc);
+
+  if (psd->last != NULL)
+    free(psd->last);
+
+  free(psd);
+}
+
+suscan_psd_t *
+suscan_psd_new(const struct suscan_psd_params *params)
+{
+  suscan_psd_t *new = NULL;
+
+  if (params->size < 2) {
+    SU_ERROR("Invalid PSD size %lu\n", (unsigned long) params->size);
+    goto fail;
+  }
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_psd_t)), goto fail);
+
+  new->params = *params;
+
+  if (new->params.overlap < 0)
+    new->params.overlap = 0;
+  else if (new->params.overlap > SUSCAN_PSD_MAX_OVERLAP)
+    new->params.overlap = SUSCAN_PSD_MAX_OVERLAP;
+
+  new->hop = SU_FLOOR(params->size * (1 - new->params.overlap));
+  if (new->hop == 0)
+    new->hop = 1;
+
+  SU_TRYCATCH(
+      new->window = malloc(params->size * sizeof(SUFLOAT)),
+      goto fail);
+  SU_TRYCATCH(
+      new->buffer = malloc(params->size * sizeof(SUCOMPLEX)),
+      goto fail);
+  SU_TRYCATCH(
+      new->fft = SU_FFTW(_malloc)(params->size * sizeof(SUCOMPLEX)),
+      goto fail);
+  SU_TRYCATCH(new->acc = calloc(params->size, sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->last = calloc(params->size, sizeof(SUFLOAT)), goto fail);
+
+  SU_TRYCATCH(
+      new->plan = suscan_planner_plan_dft_1d(
+          params->size,
+          FFTW_FORWARD,
+          SU_TRUE),
+      goto fail);
+
+  suscan_psd_init_window(new);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_psd_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE void
+suscan_psd_compute_frame(suscan_psd_t *psd)
+{
+  struct timespec start, end, sub;
+  SUSCOUNT size = psd->params.size;
+  SUSCOUNT i;
+
+  clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
+  for (i = 0; i < size; ++i)
+    psd->fft[i] = psd->buffer[i] * psd->window[i];
+
+  suscan_planner_execute(psd->plan, psd->fft, psd->fft);
+
+  for (i = 0; i < size; ++i)
+    psd->acc[i] += SU_C_REAL(psd->fft[i] * SU_C_CONJ(psd->fft[i]));
+
+  ++psd->acc_frames;
+
+  /* Keep the overlapping part for the next frame */
+  memmove(
+      psd->buffer,
+      psd->buffer + psd->hop,
+      (size - psd->hop) * sizeof(SUCOMPLEX));
+  psd->ptr = size - psd->hop;
+
+  clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+  timespecsub(&end, &start, &sub);
+
+  ++psd->frames;
+  psd->elapsed_ns += sub.tv_sec * 1000000000ull + sub.tv_nsec;
+}
+
+void
+suscan_psd_feed_bulk(suscan_psd_t *psd, const SUCOMPLEX *data, SUSCOUNT len)
+{
+  SUSCOUNT chunk;
+
+  while (len > 0) {
+    chunk = SU_MIN(psd->params.size - psd->ptr, len);
+
+    memcpy(psd->buffer + psd->ptr, data, chunk * sizeof(SUCOMPLEX));
+
+    psd->ptr += chunk;
+    data     += chunk;
+    len      -= chunk;
+
+    if (psd->ptr == psd->params.size)
+      suscan_psd_compute_frame(psd);
+  }
+}
+
+SUSCOUNT
+suscan_psd_get(suscan_psd_t *psd, SUFLOAT *psd_data)
+{
+  SUSCOUNT frames = psd->acc_frames;
+  SUFLOAT k;
+  SUSCOUNT i;
+
+  if (frames > 0) {
+    k = 1. / (frames * psd->wnorm);
+
+    for (i = 0; i < psd->params.size; ++i) {
+      psd->last[i] = k * psd->acc[i];
+      psd->acc[i] = 0;
+    }
+
+    psd->acc_frames = 0;
+  }
+
+  memcpy(psd_data, psd->last, psd->params.size * sizeof(SUFLOAT));
+
+  return frames;
+}
+
+void
+suscan_psd_reset(suscan_psd_t *psd)
+{
+  memset(psd->acc, 0, psd->params.size * sizeof(SUFLOAT));
+  memset(psd->last, 0, psd->params.size * sizeof(SUFLOAT));
+
+  psd->acc_frames = 0;
+  psd->ptr = 0;
+}
+
+SUFLOAT
+suscan_psd_get_frame_cost(const suscan_psd_t *psd)
+{
+  if (psd->frames == 0)
+    return 0;
+
+  return (SUFLOAT) psd->elapsed_ns / psd->frames;
+}
+
+/************************* Spectrum formatting *******************************/
+void
+suscan_psd_reduce(
+    const SUFLOAT *psd_data,
+    SUSCOUNT size,
+    SUFLOAT *out,
+    SUSCOUNT bins,
+    enum suscan_psd_reduction reduction,
+    SUFLOAT *hold)
+{
+  SUSCOUNT start, end;
+  SUSCOUNT i, j;
+  SUFLOAT acc;
+
+  if (bins == size) {
+    memcpy(out, psd_data, size * sizeof(SUFLOAT));
+  } else {
+    for (j = 0; j < bins; ++j) {
+      start = ((uint64_t) j * size) / bins;
+      end   = ((uint64_t) (j + 1) * size) / bins;
+      if (end == start)
+        end = start + 1;
+
+      acc = psd_data[start];
+
+      if (reduction == SUSCAN_PSD_REDUCTION_MEAN) {
+        for (i = start + 1; i < end; ++i)
+          acc += psd_data[i];
+        acc /= end - start;
+      } else {
+        for (i = start + 1; i < end; ++i)
+          if (psd_data[i] > acc)
+            acc = psd_data[i];
+      }
+
+      out[j] = acc;
+    }
+  }
+
+  if (reduction == SUSCAN_PSD_REDUCTION_PEAK_HOLD && hold != NULL)
+    for (j = 0; j < bins; ++j) {
+      hold[j] *= SUSCAN_PSD_PEAK_HOLD_DECAY;
+      if (out[j] > hold[j])
+        hold[j] = out[j];
+      out[j] = hold[j];
+    }
+}
+
+size_t
+suscan_psd_quantization_get_size(enum suscan_psd_quantization quant)
+{
+  switch (quant) {
+    case SUSCAN_PSD_QUANTIZATION_U8:
+      return sizeof(uint8_t);
+
+    case SUSCAN_PSD_QUANTIZATION_U16:
+      return sizeof(uint16_t);
+
+    default:
+      return sizeof(SUFLOAT);
+  }
+}
+
+void
+suscan_psd_quantize(
+    const SUFLOAT *psd_data,
+    SUSCOUNT size,
+    enum suscan_psd_quantization quant,
+    SUFLOAT db_min,
+    SUFLOAT db_max,
+    void *out)
+{
+  uint8_t  *as_u8  = (uint8_t *) out;
+  uint16_t *as_u16 = (uint16_t *) out;
+  SUFLOAT qmax;
+  SUFLOAT k;
+  SUFLOAT q;
+  SUSCOUNT i;
+
+  qmax = quant == SUSCAN_PSD_QUANTIZATION_U8 ? 255 : 65535;
+  k = db_max > db_min ? qmax / (db_max - db_min) : 0;
+
+  for (i = 0; i < size; ++i) {
+    /* Zero power is -inf dB, which saturates at 0 too */
+    q = (SU_POWER_DB(psd_data[i]) - db_min) * k + .5;
+    if (!(q > 0))
+      q = 0;
+    else if (q > qmax)
+      q = qmax;
+
+    if (quant == SUSCAN_PSD_QUANTIZATION_U8)
+      as_u8[i] = q;
+    else
+      as_u16[i] = q;
+  }
+}
+
+void
+suscan_psd_dequantize(
+    const void *data,
+    SUSCOUNT size,
+    enum suscan_psd_quantization quant,
+    SUFLOAT db_min,
+    SUFLOAT db_step,
+    SUFLOAT *out)
+{
+  const uint8_t  *as_u8  = (const uint8_t *) data;
+  const uint16_t *as_u16 = (const uint16_t *) data;
+  SUSCOUNT i;
+
+  for (i = 0; i < size; ++i)
+    out[i] = SU_POWER_MAG(
+        db_min
+        + db_step * (quant == SUSCAN_PSD_QUANTIZATION_U8 ? as_u8[i] : as_u16[i]));
+}
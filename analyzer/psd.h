@@ -0,0 +1,162 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _PSD_H
+#define _PSD_H
+
+#include <stdint.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Welch PSD estimator. Windows of `size' samples overlap by a fraction
+ * `overlap' of their length, and every periodogram computed between two
+ * calls to suscan_psd_get is averaged with the same weight. Unlike the
+ * channel detector spectrum, no sample is discarded and the number of
+ * frames averaged grows with the overlap, not with the window length.
+ */
+enum suscan_psd_window {
+  SUSCAN_PSD_WINDOW_RECTANGULAR,
+  SUSCAN_PSD_WINDOW_HANN,
+  SUSCAN_PSD_WINDOW_HAMMING,
+  SUSCAN_PSD_WINDOW_BLACKMANN_HARRIS
+};
+
+struct suscan_psd_params {
+  SUSCOUNT size;    /* FFT size. 0: same as the channel detector */
+  SUFLOAT  overlap; /* Between 0 and .95 */
+  enum suscan_psd_window window;
+};
+
+#define suscan_psd_params_INITIALIZER { \
+  0,                          /* size */    \
+  .5,                         /* overlap */ \
+  SUSCAN_PSD_WINDOW_HANN,     /* window */  \
+}
+
+#define SUSCAN_PSD_MAX_OVERLAP .95
+
+struct suscan_psd {
+  struct suscan_psd_params params;
+  SUSCOUNT hop;        /* New samples per frame */
+  SUFLOAT  wnorm;      /* Window energy */
+  SUFLOAT  *window;
+
+  SUCOMPLEX *buffer;   /* Last `size' samples */
+  SUSCOUNT  ptr;
+  SUCOMPLEX *fft;
+  SU_FFTW(_plan) plan;
+
+  SUFLOAT  *acc;       /* Sum of periodograms since last get */
+  SUSCOUNT  acc_frames;
+  SUFLOAT  *last;      /* Last estimation */
+
+  /* Cost accounting */
+  uint64_t frames;
+  uint64_t elapsed_ns;
+};
+
+typedef struct suscan_psd suscan_psd_t;
+
+/*
+ * Output format of spectrum messages. Clients ask for as many bins as
+ * they can display: each output bin summarizes a contiguous range of FFT
+ * bins, and may be sent as a dB level quantized to 8 or 16 bits.
+ */
+enum suscan_psd_reduction {
+  SUSCAN_PSD_REDUCTION_MAX,
+  SUSCAN_PSD_REDUCTION_MEAN,
+  SUSCAN_PSD_REDUCTION_PEAK_HOLD /* Max, holding peaks between updates */
+};
+
+enum suscan_psd_quantization {
+  SUSCAN_PSD_QUANTIZATION_NONE,
+  SUSCAN_PSD_QUANTIZATION_U8,
+  SUSCAN_PSD_QUANTIZATION_U16
+};
+
+struct suscan_psd_format {
+  SUSCOUNT bins; /* 0: one per FFT bin */
+  enum suscan_psd_reduction reduction;
+  enum suscan_psd_quantization quantization;
+  SUFLOAT db_min; /* Quantization range */
+  SUFLOAT db_max;
+};
+
+#define suscan_psd_format_INITIALIZER {                 \
+  0,                                /* bins */          \
+  SUSCAN_PSD_REDUCTION_MAX,         /* reduction */     \
+  SUSCAN_PSD_QUANTIZATION_NONE,     /* quantization */  \
+  -120,                             /* db_min */        \
+  20                                /* db_max */        \
+}
+
+/* Peak hold decay, per update (power ratio) */
+#define SUSCAN_PSD_PEAK_HOLD_DECAY .9
+
+suscan_psd_t *suscan_psd_new(const struct suscan_psd_params *params);
+
+void suscan_psd_feed_bulk(
+    suscan_psd_t *psd,
+    const SUCOMPLEX *data,
+    SUSCOUNT len);
+
+/*
+ * Writes params.size bins and starts a new average. Returns the number
+ * of frames averaged (0 if the previous estimation was repeated).
+ */
+SUSCOUNT suscan_psd_get(suscan_psd_t *psd, SUFLOAT *psd_data);
+
+/* Forget all samples and averages, e.g. after retuning the source */
+void suscan_psd_reset(suscan_psd_t *psd);
+
+/* Mean time spent per frame, in nanoseconds */
+SUFLOAT suscan_psd_get_frame_cost(const suscan_psd_t *psd);
+
+void suscan_psd_destroy(suscan_psd_t *psd);
+
+/************************* Spectrum formatting *******************************/
+/* hold must be `bins' long, and is only used in peak hold mode */
+void suscan_psd_reduce(
+    const SUFLOAT *psd_data,
+    SUSCOUNT size,
+    SUFLOAT *out,
+    SUSCOUNT bins,
+    enum suscan_psd_reduction reduction,
+    SUFLOAT *hold);
+
+size_t suscan_psd_quantization_get_size(enum suscan_psd_quantization quant);
+
+void suscan_psd_quantize(
+    const SUFLOAT *psd_data,
+    SUSCOUNT size,
+    enum suscan_psd_quantization quant,
+    SUFLOAT db_min,
+    SUFLOAT db_max,
+    void *out);
+
+void suscan_psd_dequantize(
+    const void *data,
+    SUSCOUNT size,
+    enum suscan_psd_quantization quant,
+    SUFLOAT db_min,
+    SUFLOAT db_step,
+    SUFLOAT *out);
+
+#endif /* _PSD_H */
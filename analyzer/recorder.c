@@ -0,0 +1,668 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * The recorder taps the source block through a slave port. Reading and
+ * writing are decoupled: the port reader only converts samples into a
+ * set of preallocated buffers, and a separate thread flushes full buffers
+ * to disk. If the disk is not fast enough, the port reader runs out of
+ * free buffers and starts dropping samples (and counting them) instead of
+ * delaying the master port.
+ */
+
+#define SU_LOG_DOMAIN "recorder"
+
+#include <sigutils/sigutils.h>
+
+#include <util.h>
+
+#include "analyzer.h"
+#include "recorder.h"
+
+const char *
+suscan_recorder_format_to_string(enum suscan_recorder_format fmt)
+{
+  switch (fmt) {
+    case SUSCAN_RECORDER_FORMAT_FLOAT32:
+      return "cf32";
+
+    case SUSCAN_RECORDER_FORMAT_INT16:
+      return "cs16";
+
+    case SUSCAN_RECORDER_FORMAT_INT8:
+      return "cs8";
+  }
+
+  return "unknown";
+}
+
+SUBOOL
+suscan_recorder_format_from_string(
+    const char *string,
+    enum suscan_recorder_format *fmt)
+{
+  if (strcasecmp(string, "cf32") == 0 || strcasecmp(string, "float32") == 0)
+    *fmt = SUSCAN_RECORDER_FORMAT_FLOAT32;
+  else if (strcasecmp(string, "cs16") == 0 || strcasecmp(string, "int16") == 0)
+    *fmt = SUSCAN_RECORDER_FORMAT_INT16;
+  else if (strcasecmp(string, "cs8") == 0 || strcasecmp(string, "int8") == 0)
+    *fmt = SUSCAN_RECORDER_FORMAT_INT8;
+  else
+    return SU_FALSE;
+
+  return SU_TRUE;
+}
+
+size_t
+suscan_recorder_format_get_samp_size(enum suscan_recorder_format fmt)
+{
+  switch (fmt) {
+    case SUSCAN_RECORDER_FORMAT_FLOAT32:
+      return 2 * sizeof(float);
+
+    case SUSCAN_RECORDER_FORMAT_INT16:
+      return 2 * sizeof(int16_t);
+
+    case SUSCAN_RECORDER_FORMAT_INT8:
+      return 2 * sizeof(int8_t);
+  }
+
+  return 0;
+}
+
+/*************************** Metadata sidecar ********************************/
+SUPRIVATE SUBOOL
+suscan_recorder_write_metadata(const suscan_recorder_t *recorder)
+{
+  char *meta_path = NULL;
+  char date[32];
+  struct tm tm;
+  FILE *fp = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      meta_path = strbuild("%s" SUSCAN_RECORDER_METADATA_EXT, recorder->path),
+      goto done);
+
+  if ((fp = fopen(meta_path, "w")) == NULL) {
+    SU_ERROR("Cannot open metadata file `%s': %s\n", meta_path, strerror(errno));
+    goto done;
+  }
+
+  gmtime_r(&recorder->start.tv_sec, &tm);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+  fprintf(fp, "format = %s\n", suscan_recorder_format_to_string(recorder->format));
+  fprintf(fp, "fc = %llu\n", (unsigned long long) recorder->fc);
+  fprintf(fp, "samp_rate = %llu\n", (unsigned long long) recorder->samp_rate);
+  fprintf(fp, "start_time = %s\n", date);
+  fprintf(
+      fp,
+      "start_epoch = %lu.%09lu\n",
+      (unsigned long) recorder->start.tv_sec,
+      (unsigned long) recorder->start.tv_nsec);
+  fprintf(
+      fp,
+      "samples = %llu\n",
+      (unsigned long long) recorder->samples_written);
+  fprintf(
+      fp,
+      "dropped = %llu\n",
+      (unsigned long long) recorder->samples_dropped);
+
+  ok = SU_TRUE;
+
+done:
+  if (fp != NULL)
+    fclose(fp);
+
+  if (meta_path != NULL)
+    free(meta_path);
+
+  return ok;
+}
+
+/*************************** Disk writer thread ******************************/
+SUPRIVATE void
+suscan_recorder_append_index(
+    suscan_recorder_t *recorder,
+    const struct suscan_recorder_buffer *buffer)
+{
+  const struct suscan_capture_chunk_header *chunk =
+      (const struct suscan_capture_chunk_header *) buffer->data;
+  struct suscan_capture_index_entry *tmp;
+  uint64_t alloc;
+
+  /* If the index could not be kept, readers will rebuild it */
+  if (recorder->index_count == recorder->index_alloc) {
+    alloc = recorder->index_alloc == 0 ? 1024 : recorder->index_alloc << 1;
+
+    if ((tmp = realloc(
+        recorder->index,
+        alloc * sizeof(struct suscan_capture_index_entry))) == NULL)
+      return;
+
+    recorder->index = tmp;
+    recorder->index_alloc = alloc;
+  }
+
+  recorder->index[recorder->index_count].first_sample = chunk->first_sample;
+  recorder->index[recorder->index_count].count        = chunk->count;
+  recorder->index[recorder->index_count].reserved     = 0;
+
+  ++recorder->index_count;
+}
+
+SUPRIVATE SUBOOL
+suscan_recorder_write_buffer(
+    suscan_recorder_t *recorder,
+    const struct suscan_recorder_buffer *buffer)
+{
+  const uint8_t *data = buffer->data;
+  size_t size = buffer->size;
+  ssize_t got;
+
+  while (size > 0) {
+    if ((got = write(recorder->fd, data, size)) < 0) {
+      if (errno == EINTR)
+        continue;
+
+      SU_ERROR(
+          "Failed to write to `%s': %s\n",
+          recorder->path,
+          strerror(errno));
+      return SU_FALSE;
+    }
+
+    data += got;
+    size -= got;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void *
+suscan_recorder_thread(void *data)
+{
+  suscan_recorder_t *recorder = (suscan_recorder_t *) data;
+  struct suscan_recorder_buffer *buffer;
+  uint64_t count;
+  SUBOOL ok;
+
+  pthread_mutex_lock(&recorder->lock);
+
+  for (;;) {
+    while (recorder->full_head == NULL && !recorder->halting)
+      pthread_cond_wait(&recorder->cond, &recorder->lock);
+
+    if ((buffer = recorder->full_head) == NULL)
+      break; /* Halting, and nothing left to flush */
+
+    if ((recorder->full_head = buffer->next) == NULL)
+      recorder->full_tail = NULL;
+
+    pthread_mutex_unlock(&recorder->lock);
+
+    /* The slow part happens without the lock held */
+    ok = !recorder->failed && suscan_recorder_write_buffer(recorder, buffer);
+
+    pthread_mutex_lock(&recorder->lock);
+
+    if (recorder->container == SUSCAN_RECORDER_CONTAINER_CAPTURE) {
+      count = ((const struct suscan_capture_chunk_header *) buffer->data)->count;
+      if (ok)
+        suscan_recorder_append_index(recorder, buffer);
+    } else {
+      count = buffer->size / recorder->samp_size;
+    }
+
+    if (ok) {
+      recorder->samples_written += count;
+    } else {
+      recorder->failed = SU_TRUE;
+      recorder->samples_dropped += count;
+    }
+
+    buffer->size = 0;
+    buffer->next = recorder->free_list;
+    recorder->free_list = buffer;
+  }
+
+  pthread_mutex_unlock(&recorder->lock);
+
+  return NULL;
+}
+
+/*************************** Port reader methods *****************************/
+/* Must be called with the recorder lock held */
+SUPRIVATE void
+suscan_recorder_queue_current(suscan_recorder_t *recorder)
+{
+  struct suscan_recorder_buffer *buffer = recorder->current;
+  struct suscan_capture_chunk_header *chunk;
+
+  recorder->current = NULL;
+
+  if (buffer == NULL)
+    return;
+
+  if (buffer->size == recorder->payload_offset) {
+    buffer->size = 0;
+    buffer->next = recorder->free_list;
+    recorder->free_list = buffer;
+    return;
+  }
+
+  if (recorder->container == SUSCAN_RECORDER_CONTAINER_CAPTURE) {
+    /* Complete chunk header. Chunks are always written whole */
+    chunk = (struct suscan_capture_chunk_header *) buffer->data;
+    chunk->seq   = recorder->chunk_seq++;
+    chunk->count = (buffer->size - recorder->payload_offset)
+        / recorder->samp_size;
+
+    memset(
+        buffer->data + buffer->size,
+        0,
+        SUSCAN_RECORDER_BUFFER_SIZE - buffer->size);
+    buffer->size = SUSCAN_RECORDER_BUFFER_SIZE;
+  }
+
+  buffer->next = NULL;
+
+  if (recorder->full_tail != NULL)
+    recorder->full_tail->next = buffer;
+  else
+    recorder->full_head = buffer;
+
+  recorder->full_tail = buffer;
+
+  pthread_cond_signal(&recorder->cond);
+}
+
+SUPRIVATE void
+suscan_recorder_start_buffer(
+    suscan_recorder_t *recorder,
+    struct suscan_recorder_buffer *buffer)
+{
+  struct suscan_capture_chunk_header *chunk;
+  struct timespec now;
+
+  buffer->next = NULL;
+  buffer->size = recorder->payload_offset;
+
+  if (recorder->container == SUSCAN_RECORDER_CONTAINER_CAPTURE) {
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    chunk = (struct suscan_capture_chunk_header *) buffer->data;
+    chunk->first_sample = recorder->stream_pos;
+    chunk->timestamp = now.tv_sec * 1000000000ull + now.tv_nsec;
+    chunk->reserved  = 0;
+  }
+}
+
+/* Returns the number of samples converted */
+SUPRIVATE SUSCOUNT
+suscan_recorder_convert(
+    suscan_recorder_t *recorder,
+    struct suscan_recorder_buffer *buffer,
+    const SUCOMPLEX *samples,
+    SUSCOUNT count)
+{
+  SUSCOUNT avail;
+  SUSCOUNT i;
+  SUFLOAT re, im;
+  float   *as_float;
+  int16_t *as_int16;
+  int8_t  *as_int8;
+
+  avail = (SUSCAN_RECORDER_BUFFER_SIZE - buffer->size) / recorder->samp_size;
+
+  if (count > avail)
+    count = avail;
+
+  switch (recorder->format) {
+    case SUSCAN_RECORDER_FORMAT_FLOAT32:
+      as_float = (float *) (buffer->data + buffer->size);
+      for (i = 0; i < count; ++i) {
+        as_float[i << 1]       = SU_C_REAL(samples[i]);
+        as_float[(i << 1) + 1] = SU_C_IMAG(samples[i]);
+      }
+      break;
+
+    case SUSCAN_RECORDER_FORMAT_INT16:
+      as_int16 = (int16_t *) (buffer->data + buffer->size);
+      for (i = 0; i < count; ++i) {
+        re = SU_MAX(SU_MIN(SU_C_REAL(samples[i]), 1.), -1.);
+        im = SU_MAX(SU_MIN(SU_C_IMAG(samples[i]), 1.), -1.);
+        as_int16[i << 1]       = (int16_t) lrint(re * 32767.);
+        as_int16[(i << 1) + 1] = (int16_t) lrint(im * 32767.);
+      }
+      break;
+
+    case SUSCAN_RECORDER_FORMAT_INT8:
+      as_int8 = (int8_t *) (buffer->data + buffer->size);
+      for (i = 0; i < count; ++i) {
+        re = SU_MAX(SU_MIN(SU_C_REAL(samples[i]), 1.), -1.);
+        im = SU_MAX(SU_MIN(SU_C_IMAG(samples[i]), 1.), -1.);
+        as_int8[i << 1]       = (int8_t) lrint(re * 127.);
+        as_int8[(i << 1) + 1] = (int8_t) lrint(im * 127.);
+      }
+      break;
+  }
+
+  buffer->size += count * recorder->samp_size;
+
+  return count;
+}
+
+SUPRIVATE void
+suscan_recorder_push_samples(
+    suscan_recorder_t *recorder,
+    const SUCOMPLEX *samples,
+    SUSCOUNT count)
+{
+  SUSCOUNT got;
+
+  while (count > 0) {
+    if (recorder->current == NULL) {
+      /* Never wait for the disk writer: if no buffers are free, drop */
+      pthread_mutex_lock(&recorder->lock);
+      if ((recorder->current = recorder->free_list) != NULL)
+        recorder->free_list = recorder->current->next;
+      else
+        recorder->samples_dropped += count;
+      pthread_mutex_unlock(&recorder->lock);
+
+      if (recorder->current == NULL) {
+        recorder->stream_pos += count;
+        return;
+      }
+
+      suscan_recorder_start_buffer(recorder, recorder->current);
+    }
+
+    got = suscan_recorder_convert(recorder, recorder->current, samples, count);
+
+    samples += got;
+    count   -= got;
+    recorder->stream_pos += got;
+
+    if (SUSCAN_RECORDER_BUFFER_SIZE - recorder->current->size
+        < recorder->samp_size) {
+      pthread_mutex_lock(&recorder->lock);
+      suscan_recorder_queue_current(recorder);
+      pthread_mutex_unlock(&recorder->lock);
+    }
+  }
+}
+
+SUPRIVATE SUBOOL
+suscan_recorder_wk_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  suscan_recorder_t *recorder = (suscan_recorder_t *) wk_private;
+  su_off_t pos;
+  SUSDIFF got;
+
+  got = su_block_port_read(&recorder->port, recorder->read_buf, recorder->read_size);
+
+  if (got > 0) {
+    suscan_recorder_push_samples(recorder, recorder->read_buf, got);
+  } else if (got == SU_BLOCK_PORT_READ_ERROR_PORT_DESYNC) {
+    /* We were too slow for the master port: account these samples as lost */
+    pos = recorder->port.pos;
+    su_block_port_resync(&recorder->port);
+
+    pthread_mutex_lock(&recorder->lock);
+    recorder->samples_dropped += recorder->port.pos - pos;
+
+    /* Chunks cannot span a gap */
+    if (recorder->container == SUSCAN_RECORDER_CONTAINER_CAPTURE)
+      suscan_recorder_queue_current(recorder);
+    pthread_mutex_unlock(&recorder->lock);
+
+    recorder->stream_pos += recorder->port.pos - pos;
+  } else {
+    /* End of stream or source error. Nothing else to record. */
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+/****************************** Public API ***********************************/
+/* Counters are updated by the writer thread and the worker, under lock */
+uint64_t
+suscan_recorder_get_dropped(suscan_recorder_t *recorder)
+{
+  uint64_t dropped;
+
+  pthread_mutex_lock(&recorder->lock);
+  dropped = recorder->samples_dropped;
+  pthread_mutex_unlock(&recorder->lock);
+
+  return dropped;
+}
+
+uint64_t
+suscan_recorder_get_written(suscan_recorder_t *recorder)
+{
+  uint64_t written;
+
+  pthread_mutex_lock(&recorder->lock);
+  written = recorder->samples_written;
+  pthread_mutex_unlock(&recorder->lock);
+
+  return written;
+}
+
+SUBOOL
+suscan_recorder_destroy(suscan_recorder_t *recorder)
+{
+  unsigned int i;
+
+  /* Stop reading from the source first */
+  if (recorder->worker != NULL)
+    if (!suscan_analyzer_halt_worker(recorder->worker)) {
+      SU_ERROR("Recorder worker destruction failed, memory leak ahead\n");
+      return SU_FALSE;
+    }
+
+  su_block_port_unplug(&recorder->port);
+
+  /* Flush whatever is left and wait for the writer to finish */
+  if (recorder->thread_running) {
+    pthread_mutex_lock(&recorder->lock);
+    suscan_recorder_queue_current(recorder);
+    recorder->halting = SU_TRUE;
+    pthread_cond_signal(&recorder->cond);
+    pthread_mutex_unlock(&recorder->lock);
+
+    if (pthread_join(recorder->thread, NULL) != 0) {
+      SU_ERROR("Recorder thread failed to join, memory leak ahead\n");
+      return SU_FALSE;
+    }
+  }
+
+  if (recorder->fd != -1) {
+    if (recorder->container == SUSCAN_RECORDER_CONTAINER_CAPTURE) {
+      if (recorder->index_count == recorder->chunk_seq)
+        if (!suscan_capture_write_index(
+            recorder->fd,
+            &recorder->header,
+            recorder->index,
+            recorder->index_count))
+          SU_WARNING("Failed to write capture index\n");
+      close(recorder->fd);
+    } else {
+      close(recorder->fd);
+      (void) suscan_recorder_write_metadata(recorder);
+    }
+  }
+
+  if (recorder->index != NULL)
+    free(recorder->index);
+
+  if (recorder->sync_init) {
+    pthread_mutex_destroy(&recorder->lock);
+    pthread_cond_destroy(&recorder->cond);
+  }
+
+  if (recorder->mq_init)
+    suscan_mq_finalize(&recorder->mq_out);
+
+  for (i = 0; i < SUSCAN_RECORDER_BUFFER_COUNT; ++i)
+    if (recorder->buffers[i].data != NULL)
+      free(recorder->buffers[i].data);
+
+  if (recorder->read_buf != NULL)
+    free(recorder->read_buf);
+
+  if (recorder->path != NULL)
+    free(recorder->path);
+
+  free(recorder);
+
+  return SU_TRUE;
+}
+
+suscan_recorder_t *
+suscan_recorder_new(
+    const struct suscan_recorder_params *params,
+    su_block_t *block,
+    uint64_t fc,
+    uint64_t samp_rate,
+    SUSCOUNT read_size)
+{
+  suscan_recorder_t *new = NULL;
+  void *data;
+  unsigned int i;
+
+  SU_TRYCATCH(params->path != NULL, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_recorder_t)), goto fail);
+
+  new->fd = -1;
+  new->format = params->format;
+  new->container = params->container;
+  new->fc = fc;
+  new->samp_rate = samp_rate;
+  new->read_size = read_size;
+
+  SU_TRYCATCH(
+      new->samp_size = suscan_recorder_format_get_samp_size(params->format),
+      goto fail);
+
+  SU_TRYCATCH(new->path = strdup(params->path), goto fail);
+
+  SU_TRYCATCH(
+      new->read_buf = malloc(read_size * sizeof(SUCOMPLEX)),
+      goto fail);
+
+  /* Preallocate all write buffers, aligned for the block layer */
+  for (i = 0; i < SUSCAN_RECORDER_BUFFER_COUNT; ++i) {
+    SU_TRYCATCH(
+        posix_memalign(
+            &data,
+            SUSCAN_RECORDER_BUFFER_ALIGN,
+            SUSCAN_RECORDER_BUFFER_SIZE) == 0,
+        goto fail);
+
+    new->buffers[i].data = data;
+    new->buffers[i].next = new->free_list;
+    new->free_list = &new->buffers[i];
+  }
+
+  SU_TRYCATCH(pthread_mutex_init(&new->lock, NULL) == 0, goto fail);
+
+  if (pthread_cond_init(&new->cond, NULL) != 0) {
+    pthread_mutex_destroy(&new->lock);
+    goto fail;
+  }
+
+  new->sync_init = SU_TRUE;
+
+  SU_TRYCATCH(suscan_mq_init(&new->mq_out), goto fail);
+  new->mq_init = SU_TRUE;
+
+  if ((new->fd = open(new->path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+    SU_ERROR("Cannot open `%s' for writing: %s\n", new->path, strerror(errno));
+    goto fail;
+  }
+
+  clock_gettime(CLOCK_REALTIME, &new->start);
+
+  if (new->container == SUSCAN_RECORDER_CONTAINER_CAPTURE) {
+    /* Each buffer is a chunk, starting with its header */
+    new->payload_offset = sizeof(struct suscan_capture_chunk_header);
+
+    suscan_capture_header_init(
+        &new->header,
+        new->format,
+        (SUSCAN_RECORDER_BUFFER_SIZE - new->payload_offset) / new->samp_size,
+        samp_rate,
+        fc,
+        &new->start);
+
+    SU_TRYCATCH(suscan_capture_write_header(new->fd, &new->header), goto fail);
+    SU_TRYCATCH(
+        lseek(new->fd, SUSCAN_CAPTURE_HEADER_SIZE, SEEK_SET) != -1,
+        goto fail);
+  } else {
+    /* Leave metadata in place as soon as possible */
+    SU_TRYCATCH(suscan_recorder_write_metadata(new), goto fail);
+  }
+
+  SU_TRYCATCH(
+      pthread_create(&new->thread, NULL, suscan_recorder_thread, new) == 0,
+      goto fail);
+
+  new->thread_running = SU_TRUE;
+
+  /* Ready to receive samples: plug port and start reading */
+  SU_TRYCATCH(su_block_port_plug(&new->port, block, 0), goto fail);
+
+  SU_TRYCATCH(new->worker = suscan_worker_new(&new->mq_out, new), goto fail);
+
+  SU_TRYCATCH(
+      suscan_worker_push(new->worker, suscan_recorder_wk_cb, NULL),
+      goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_recorder_destroy(new);
+
+  return NULL;
+}
@@ -0,0 +1,145 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _RECORDER_H
+#define _RECORDER_H
+
+#include <pthread.h>
+#include <time.h>
+#include <sigutils/sigutils.h>
+
+#include "worker.h"
+#include "mq.h"
+#include "capture.h"
+
+/*
+ * Disk writes are performed in units of SUSCAN_RECORDER_BUFFER_SIZE bytes.
+ * This size must be a multiple of all sample sizes. In capture files, each
+ * buffer holds exactly one chunk.
+ */
+#define SUSCAN_RECORDER_BUFFER_SIZE  SUSCAN_CAPTURE_CHUNK_SIZE
+#define SUSCAN_RECORDER_BUFFER_COUNT 16
+#define SUSCAN_RECORDER_BUFFER_ALIGN 4096
+
+#define SUSCAN_RECORDER_METADATA_EXT ".meta"
+
+enum suscan_recorder_format {
+  SUSCAN_RECORDER_FORMAT_FLOAT32, /* Complex float (GQRX's I/Q format) */
+  SUSCAN_RECORDER_FORMAT_INT16,   /* Complex signed 16 bit integers */
+  SUSCAN_RECORDER_FORMAT_INT8     /* Complex signed 8 bit integers */
+};
+
+enum suscan_recorder_container {
+  SUSCAN_RECORDER_CONTAINER_RAW,    /* Raw samples plus metadata sidecar */
+  SUSCAN_RECORDER_CONTAINER_CAPTURE /* Indexed capture file (capture.h) */
+};
+
+struct suscan_recorder_params {
+  const char *path;
+  enum suscan_recorder_format format;
+  enum suscan_recorder_container container;
+};
+
+#define suscan_recorder_params_INITIALIZER {    \
+  NULL,                           /* path */    \
+  SUSCAN_RECORDER_FORMAT_FLOAT32, /* format */  \
+  SUSCAN_RECORDER_CONTAINER_RAW,  /* container */\
+}
+
+struct suscan_recorder_buffer {
+  uint8_t *data;
+  size_t   size;
+  struct suscan_recorder_buffer *next;
+};
+
+struct suscan_recorder {
+  char *path;
+  enum suscan_recorder_format format;
+  enum suscan_recorder_container container;
+  size_t samp_size;
+  size_t payload_offset; /* Room for chunk headers in each buffer */
+
+  /* Source information */
+  uint64_t fc;
+  uint64_t samp_rate;
+  struct timespec start;
+
+  /* Port reader (never writes to disk) */
+  su_block_port_t port; /* Slave reading port */
+  suscan_worker_t *worker;
+  struct suscan_mq mq_out; /* Used for worker halt acks only */
+  SUBOOL mq_init;
+  SUCOMPLEX *read_buf;
+  SUSCOUNT   read_size;
+  uint64_t   stream_pos; /* Samples seen, including dropped ones */
+  uint64_t   chunk_seq;
+
+  /* Disk writer thread */
+  int fd;
+  pthread_t thread;
+  SUBOOL thread_running;
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+  SUBOOL sync_init;
+  SUBOOL halting;
+
+  struct suscan_recorder_buffer buffers[SUSCAN_RECORDER_BUFFER_COUNT];
+  struct suscan_recorder_buffer *free_list;
+  struct suscan_recorder_buffer *full_head;
+  struct suscan_recorder_buffer *full_tail;
+  struct suscan_recorder_buffer *current; /* Owned by the port reader */
+
+  /* Capture container state (owned by the disk writer) */
+  struct suscan_capture_header header;
+  struct suscan_capture_index_entry *index;
+  uint64_t index_count;
+  uint64_t index_alloc;
+
+  /* Statistics */
+  uint64_t samples_written;
+  uint64_t samples_dropped;
+  SUBOOL   failed; /* Disk I/O error */
+};
+
+typedef struct suscan_recorder suscan_recorder_t;
+
+/***************************** Recorder API **********************************/
+const char *suscan_recorder_format_to_string(enum suscan_recorder_format fmt);
+
+size_t suscan_recorder_format_get_samp_size(enum suscan_recorder_format fmt);
+
+SUBOOL suscan_recorder_format_from_string(
+    const char *string,
+    enum suscan_recorder_format *fmt);
+
+uint64_t suscan_recorder_get_dropped(suscan_recorder_t *recorder);
+
+uint64_t suscan_recorder_get_written(suscan_recorder_t *recorder);
+
+SUBOOL suscan_recorder_destroy(suscan_recorder_t *recorder);
+
+suscan_recorder_t *suscan_recorder_new(
+    const struct suscan_recorder_params *params,
+    su_block_t *block,
+    uint64_t fc,
+    uint64_t samp_rate,
+    SUSCOUNT read_size);
+
+#endif /* _RECORDER_H */
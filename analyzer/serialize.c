@@ -0,0 +1,773 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "serialize"
+
+#include "serialize.h"
+#include "msg.h"
+
+/***************************** Frame buffer **********************************/
+void
+suscan_frame_buffer_init(struct suscan_frame_buffer *buf)
+{
+  memset(buf, 0, sizeof(struct suscan_frame_buffer));
+}
+
+void
+suscan_frame_buffer_finalize(struct suscan_frame_buffer *buf)
+{
+  if (buf->data != NULL)
+    free(buf->data);
+
+  suscan_frame_buffer_init(buf);
+}
+
+void
+suscan_frame_buffer_consume(struct suscan_frame_buffer *buf, size_t size)
+{
+  if (size >= buf->size) {
+    buf->size = 0;
+  } else {
+    memmove(buf->data, buf->data + size, buf->size - size);
+    buf->size -= size;
+  }
+}
+
+SUBOOL
+suscan_frame_buffer_append(
+    struct suscan_frame_buffer *buf,
+    const void *data,
+    size_t size)
+{
+  size_t alloc = buf->alloc > 0 ? buf->alloc : 256;
+  uint8_t *tmp;
+
+  while (alloc < buf->size + size)
+    alloc <<= 1;
+
+  if (alloc != buf->alloc) {
+    SU_TRYCATCH(tmp = realloc(buf->data, alloc), return SU_FALSE);
+    buf->data = tmp;
+    buf->alloc = alloc;
+  }
+
+  memcpy(buf->data + buf->size, data, size);
+  buf->size += size;
+
+  return SU_TRUE;
+}
+
+/****************************** Writers **************************************/
+/* Errors are checked once, after the whole frame has been written */
+struct suscan_frame_writer {
+  struct suscan_frame_buffer *buf;
+  SUBOOL ok;
+};
+
+SUPRIVATE void
+suscan_frame_put_u8(struct suscan_frame_writer *wr, uint8_t value)
+{
+  if (wr->ok)
+    wr->ok = suscan_frame_buffer_append(wr->buf, &value, 1);
+}
+
+SUPRIVATE void
+suscan_frame_put_u32(struct suscan_frame_writer *wr, uint32_t value)
+{
+  uint8_t bytes[4];
+
+  bytes[0] = value;
+  bytes[1] = value >> 8;
+  bytes[2] = value >> 16;
+  bytes[3] = value >> 24;
+
+  if (wr->ok)
+    wr->ok = suscan_frame_buffer_append(wr->buf, bytes, 4);
+}
+
+SUPRIVATE void
+suscan_frame_put_u64(struct suscan_frame_writer *wr, uint64_t value)
+{
+  suscan_frame_put_u32(wr, value);
+  suscan_frame_put_u32(wr, value >> 32);
+}
+
+SUPRIVATE void
+suscan_frame_put_f32(struct suscan_frame_writer *wr, float value)
+{
+  uint32_t bits;
+
+  memcpy(&bits, &value, 4);
+  suscan_frame_put_u32(wr, bits);
+}
+
+SUPRIVATE void
+suscan_frame_put_f64(struct suscan_frame_writer *wr, double value)
+{
+  uint64_t bits;
+
+  memcpy(&bits, &value, 8);
+  suscan_frame_put_u64(wr, bits);
+}
+
+SUPRIVATE void
+suscan_frame_put_str(struct suscan_frame_writer *wr, const char *str)
+{
+  size_t len = str != NULL ? strlen(str) : 0;
+
+  suscan_frame_put_u32(wr, len);
+
+  if (wr->ok && len > 0)
+    wr->ok = suscan_frame_buffer_append(wr->buf, str, len);
+}
+
+SUPRIVATE void
+suscan_frame_put_timestamp(
+    struct suscan_frame_writer *wr,
+    const struct timespec *ts)
+{
+  suscan_frame_put_u64(wr, ts->tv_sec);
+  suscan_frame_put_u32(wr, ts->tv_nsec);
+}
+
+/* fc, f_lo, f_hi, ft (f64), bw, snr, S0, N0 (f32), age, present (u32) */
+SUPRIVATE void
+suscan_frame_put_channel(
+    struct suscan_frame_writer *wr,
+    const struct sigutils_channel *channel)
+{
+  suscan_frame_put_f64(wr, channel->fc);
+  suscan_frame_put_f64(wr, channel->f_lo);
+  suscan_frame_put_f64(wr, channel->f_hi);
+  suscan_frame_put_f64(wr, channel->ft);
+  suscan_frame_put_f32(wr, channel->bw);
+  suscan_frame_put_f32(wr, channel->snr);
+  suscan_frame_put_f32(wr, channel->S0);
+  suscan_frame_put_f32(wr, channel->N0);
+  suscan_frame_put_u32(wr, channel->age);
+  suscan_frame_put_u32(wr, channel->present);
+}
+
+/* Enums as u32, in declaration order */
+SUPRIVATE void
+suscan_frame_put_inspector_params(
+    struct suscan_frame_writer *wr,
+    const struct suscan_inspector_params *params)
+{
+  suscan_frame_put_u32(wr, params->inspector_id);
+  suscan_frame_put_u32(wr, params->gc_ctrl);
+  suscan_frame_put_f32(wr, params->gc_gain);
+  suscan_frame_put_u32(wr, params->fc_ctrl);
+  suscan_frame_put_f32(wr, params->fc_off);
+  suscan_frame_put_f32(wr, params->fc_phi);
+  suscan_frame_put_u32(wr, params->mf_conf);
+  suscan_frame_put_f32(wr, params->mf_rolloff);
+  suscan_frame_put_u32(wr, params->br_ctrl);
+  suscan_frame_put_f32(wr, params->br_alpha);
+  suscan_frame_put_f32(wr, params->br_beta);
+  suscan_frame_put_u32(wr, params->psd_source);
+  suscan_frame_put_f32(wr, params->sym_phase);
+  suscan_frame_put_f32(wr, params->baud);
+}
+
+SUPRIVATE void
+suscan_frame_put_channel_list(
+    struct suscan_frame_writer *wr,
+    struct sigutils_channel **list,
+    unsigned int count)
+{
+  unsigned int i;
+  unsigned int valid = 0;
+
+  for (i = 0; i < count; ++i)
+    if (list[i] != NULL)
+      ++valid;
+
+  suscan_frame_put_u32(wr, valid);
+
+  for (i = 0; i < count; ++i)
+    if (list[i] != NULL)
+      suscan_frame_put_channel(wr, list[i]);
+}
+
+/*
+ * fc (u64), source_id, inspector_id (u32), samp_rate, N0 (f32),
+ * timestamp, quantization (u8), then either size (u32) and the spectrum
+ * (f32), or db_min, db_step (f32), size (u32) and the quantized levels.
+ */
+SUPRIVATE void
+suscan_frame_put_psd(
+    struct suscan_frame_writer *wr,
+    const struct suscan_analyzer_psd_msg *msg)
+{
+  SUSCOUNT i;
+  const uint8_t  *q8;
+  const uint16_t *q16;
+
+  suscan_frame_put_u64(wr, msg->fc);
+  suscan_frame_put_u32(wr, msg->source_id);
+  suscan_frame_put_u32(wr, msg->inspector_id);
+  suscan_frame_put_f32(wr, msg->samp_rate);
+  suscan_frame_put_f32(wr, msg->N0);
+  suscan_frame_put_timestamp(wr, &msg->timestamp);
+  suscan_frame_put_u8(wr, msg->quantization);
+
+  if (msg->quantization == SUSCAN_PSD_QUANTIZATION_NONE) {
+    suscan_frame_put_u32(wr, msg->psd_size);
+    for (i = 0; i < msg->psd_size; ++i)
+      suscan_frame_put_f32(wr, msg->psd_data[i]);
+  } else {
+    suscan_frame_put_f32(wr, msg->db_min);
+    suscan_frame_put_f32(wr, msg->db_step);
+    suscan_frame_put_u32(wr, msg->psd_size);
+
+    if (msg->quantization == SUSCAN_PSD_QUANTIZATION_U8) {
+      q8 = (const uint8_t *) msg->psd_qdata;
+      if (wr->ok)
+        wr->ok = suscan_frame_buffer_append(wr->buf, q8, msg->psd_size);
+    } else {
+      q16 = (const uint16_t *) msg->psd_qdata;
+      for (i = 0; i < msg->psd_size; ++i) {
+        suscan_frame_put_u8(wr, q16[i]);
+        suscan_frame_put_u8(wr, q16[i] >> 8);
+      }
+    }
+  }
+}
+
+SUPRIVATE SUBOOL
+suscan_frame_put_msg(
+    struct suscan_frame_writer *wr,
+    uint32_t type,
+    const void *msg)
+{
+  const struct suscan_analyzer_status_msg *status;
+  const struct suscan_analyzer_channel_msg *channel;
+  const struct suscan_analyzer_channel_delta_msg *delta;
+  const struct suscan_analyzer_inspector_msg *insp;
+  const struct suscan_analyzer_sample_batch_msg *batch;
+  const struct suscan_analyzer_seek_msg *seek;
+  const struct suscan_analyzer_retune_msg *retune;
+  const struct suscan_analyzer_params_msg *params;
+  const struct suscan_analyzer_sweep_msg *sweep;
+  const struct suscan_analyzer_inspector_batch_msg *ibatch;
+  unsigned int i;
+
+  switch (type) {
+    /* code (i32), source_id (u32), message (str) */
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST:
+      status = (const struct suscan_analyzer_status_msg *) msg;
+      suscan_frame_put_u32(wr, status->code);
+      suscan_frame_put_u32(wr, status->source_id);
+      suscan_frame_put_str(wr, status->err_msg);
+      break;
+
+    /* source_id, timestamp, channel list */
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
+      channel = (const struct suscan_analyzer_channel_msg *) msg;
+      suscan_frame_put_u32(wr, channel->source_id);
+      suscan_frame_put_timestamp(wr, &channel->timestamp);
+      suscan_frame_put_channel_list(
+          wr,
+          channel->channel_list,
+          channel->channel_count);
+      break;
+
+    /*
+     * source_id, timestamp, snapshot, count (u32), then id, kind (u32)
+     * and channel
+     */
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL_DELTA:
+      delta = (const struct suscan_analyzer_channel_delta_msg *) msg;
+      suscan_frame_put_u32(wr, delta->source_id);
+      suscan_frame_put_timestamp(wr, &delta->timestamp);
+      suscan_frame_put_u32(wr, delta->snapshot);
+      suscan_frame_put_u32(wr, delta->delta_count);
+      for (i = 0; i < delta->delta_count; ++i) {
+        suscan_frame_put_u32(wr, delta->delta_list[i].id);
+        suscan_frame_put_u32(wr, delta->delta_list[i].kind);
+        suscan_frame_put_channel(wr, &delta->delta_list[i].channel);
+      }
+      break;
+
+    /*
+     * kind, inspector_id, req_id, handle, source_id (u32), status (i32),
+     * then a channel (OPEN), the baud estimates (INFO) or the inspector
+     * parameters (PARAMS), depending on kind.
+     */
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
+      insp = (const struct suscan_analyzer_inspector_msg *) msg;
+      suscan_frame_put_u32(wr, insp->kind);
+      suscan_frame_put_u32(wr, insp->inspector_id);
+      suscan_frame_put_u32(wr, insp->req_id);
+      suscan_frame_put_u32(wr, insp->handle);
+      suscan_frame_put_u32(wr, insp->source_id);
+      suscan_frame_put_u32(wr, insp->status);
+
+      switch (insp->kind) {
+        case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN:
+          suscan_frame_put_channel(wr, &insp->channel);
+          break;
+
+        case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INFO:
+          suscan_frame_put_f32(wr, insp->baud.fac);
+          suscan_frame_put_f32(wr, insp->baud.nln);
+          break;
+
+        case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_PARAMS:
+          suscan_frame_put_inspector_params(wr, &insp->params);
+          break;
+
+        default:
+          break;
+      }
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD:
+      suscan_frame_put_psd(wr, (const struct suscan_analyzer_psd_msg *) msg);
+      break;
+
+    /* source_id, inspector_id, count (u32), then I and Q (f32) */
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
+      batch = (const struct suscan_analyzer_sample_batch_msg *) msg;
+      suscan_frame_put_u32(wr, batch->source_id);
+      suscan_frame_put_u32(wr, batch->inspector_id);
+      suscan_frame_put_u32(wr, batch->sample_count);
+      for (i = 0; i < batch->sample_count; ++i) {
+        suscan_frame_put_f32(wr, SU_C_REAL(batch->samples[i]));
+        suscan_frame_put_f32(wr, SU_C_IMAG(batch->samples[i]));
+      }
+      break;
+
+    /* offset (f64), source_id, req_id (u32), status (i32) */
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SEEK:
+      seek = (const struct suscan_analyzer_seek_msg *) msg;
+      suscan_frame_put_f64(wr, seek->offset);
+      suscan_frame_put_u32(wr, seek->source_id);
+      suscan_frame_put_u32(wr, seek->req_id);
+      suscan_frame_put_u32(wr, seek->status);
+      break;
+
+    /*
+     * mask (u32), fc, samp_rate (u64), gain (f32), source_id, req_id (u32),
+     * status (i32)
+     */
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_RETUNE:
+      retune = (const struct suscan_analyzer_retune_msg *) msg;
+      suscan_frame_put_u32(wr, retune->tuning.mask);
+      suscan_frame_put_u64(wr, retune->tuning.fc);
+      suscan_frame_put_u64(wr, retune->tuning.samp_rate);
+      suscan_frame_put_f32(wr, retune->tuning.gain);
+      suscan_frame_put_u32(wr, retune->source_id);
+      suscan_frame_put_u32(wr, retune->req_id);
+      suscan_frame_put_u32(wr, retune->status);
+      break;
+
+    /* req_id (u32), status (i32). Parameters stay in the server */
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS:
+      params = (const struct suscan_analyzer_params_msg *) msg;
+      suscan_frame_put_u32(wr, params->req_id);
+      suscan_frame_put_u32(wr, params->status);
+      break;
+
+    /*
+     * source_id, sweep_count (u32), sweep_rate (f32), timestamp, the
+     * stitched spectrum (as in PSD) and the channel list
+     */
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP:
+      sweep = (const struct suscan_analyzer_sweep_msg *) msg;
+      suscan_frame_put_u32(wr, sweep->source_id);
+      suscan_frame_put_u32(wr, sweep->sweep_count);
+      suscan_frame_put_f32(wr, sweep->sweep_rate);
+      suscan_frame_put_timestamp(wr, &sweep->timestamp);
+      suscan_frame_put_psd(wr, sweep->psd);
+      suscan_frame_put_channel_list(
+          wr,
+          sweep->channel_list,
+          sweep->channel_count);
+      break;
+
+    /*
+     * kind, req_id, count (u32), then source_id, handle (i32), status
+     * (u32) and either a channel (OPEN) or the baud estimates (GET_INFO)
+     */
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR_BATCH:
+      ibatch = (const struct suscan_analyzer_inspector_batch_msg *) msg;
+      suscan_frame_put_u32(wr, ibatch->kind);
+      suscan_frame_put_u32(wr, ibatch->req_id);
+      suscan_frame_put_u32(wr, ibatch->entry_count);
+      for (i = 0; i < ibatch->entry_count; ++i) {
+        suscan_frame_put_u32(wr, ibatch->entry_list[i].source_id);
+        suscan_frame_put_u32(wr, ibatch->entry_list[i].handle);
+        suscan_frame_put_u32(wr, ibatch->entry_list[i].status);
+
+        if (ibatch->kind == SUSCAN_ANALYZER_INSPECTOR_BATCH_OPEN) {
+          suscan_frame_put_channel(wr, &ibatch->entry_list[i].channel);
+        } else if (ibatch->kind == SUSCAN_ANALYZER_INSPECTOR_BATCH_GET_INFO) {
+          suscan_frame_put_f32(wr, ibatch->entry_list[i].baud.fac);
+          suscan_frame_put_f32(wr, ibatch->entry_list[i].baud.nln);
+        }
+      }
+      break;
+
+    default:
+      return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_frame_serialize(
+    struct suscan_frame_buffer *buf,
+    uint32_t type,
+    const void *msg)
+{
+  struct suscan_frame_writer wr;
+  size_t start = buf->size;
+  size_t size;
+  uint8_t *hdr;
+
+  wr.buf = buf;
+  wr.ok = SU_TRUE;
+
+  /* Payload size is known at the end */
+  suscan_frame_put_u32(&wr, SUSCAN_FRAME_MAGIC);
+  suscan_frame_put_u32(&wr, type);
+  suscan_frame_put_u32(&wr, 0);
+
+  if (!suscan_frame_put_msg(&wr, type, msg) || !wr.ok)
+    goto fail;
+
+  size = buf->size - start - SUSCAN_FRAME_HEADER_SIZE;
+  if (size > SUSCAN_FRAME_MAX_SIZE) {
+    SU_ERROR("Message of type 0x%x too big to serialize\n", type);
+    goto fail;
+  }
+
+  hdr = buf->data + start + 8;
+  hdr[0] = size;
+  hdr[1] = size >> 8;
+  hdr[2] = size >> 16;
+  hdr[3] = size >> 24;
+
+  return SU_TRUE;
+
+fail:
+  buf->size = start;
+
+  return SU_FALSE;
+}
+
+/****************************** Readers **************************************/
+struct suscan_frame_reader {
+  const uint8_t *data;
+  size_t size;
+  size_t ptr;
+  SUBOOL ok; /* No overruns so far */
+};
+
+SUPRIVATE uint32_t
+suscan_frame_get_u32(struct suscan_frame_reader *rd)
+{
+  const uint8_t *p;
+
+  if (!rd->ok || rd->size - rd->ptr < 4) {
+    rd->ok = SU_FALSE;
+    return 0;
+  }
+
+  p = rd->data + rd->ptr;
+  rd->ptr += 4;
+
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+SUPRIVATE uint64_t
+suscan_frame_get_u64(struct suscan_frame_reader *rd)
+{
+  uint64_t lo = suscan_frame_get_u32(rd);
+
+  return lo | ((uint64_t) suscan_frame_get_u32(rd) << 32);
+}
+
+SUPRIVATE float
+suscan_frame_get_f32(struct suscan_frame_reader *rd)
+{
+  uint32_t bits = suscan_frame_get_u32(rd);
+  float value;
+
+  memcpy(&value, &bits, 4);
+
+  return value;
+}
+
+SUPRIVATE double
+suscan_frame_get_f64(struct suscan_frame_reader *rd)
+{
+  uint64_t bits = suscan_frame_get_u64(rd);
+  double value;
+
+  memcpy(&value, &bits, 8);
+
+  return value;
+}
+
+SUPRIVATE void
+suscan_frame_get_channel(
+    struct suscan_frame_reader *rd,
+    struct sigutils_channel *channel)
+{
+  channel->fc      = suscan_frame_get_f64(rd);
+  channel->f_lo    = suscan_frame_get_f64(rd);
+  channel->f_hi    = suscan_frame_get_f64(rd);
+  channel->ft      = suscan_frame_get_f64(rd);
+  channel->bw      = suscan_frame_get_f32(rd);
+  channel->snr     = suscan_frame_get_f32(rd);
+  channel->S0      = suscan_frame_get_f32(rd);
+  channel->N0      = suscan_frame_get_f32(rd);
+  channel->age     = suscan_frame_get_u32(rd);
+  channel->present = suscan_frame_get_u32(rd);
+}
+
+SUPRIVATE void
+suscan_frame_get_inspector_params(
+    struct suscan_frame_reader *rd,
+    struct suscan_inspector_params *params)
+{
+  params->inspector_id = suscan_frame_get_u32(rd);
+  params->gc_ctrl      = suscan_frame_get_u32(rd);
+  params->gc_gain      = suscan_frame_get_f32(rd);
+  params->fc_ctrl      = suscan_frame_get_u32(rd);
+  params->fc_off       = suscan_frame_get_f32(rd);
+  params->fc_phi       = suscan_frame_get_f32(rd);
+  params->mf_conf      = suscan_frame_get_u32(rd);
+  params->mf_rolloff   = suscan_frame_get_f32(rd);
+  params->br_ctrl      = suscan_frame_get_u32(rd);
+  params->br_alpha     = suscan_frame_get_f32(rd);
+  params->br_beta      = suscan_frame_get_f32(rd);
+  params->psd_source   = suscan_frame_get_u32(rd);
+  params->sym_phase    = suscan_frame_get_f32(rd);
+  params->baud         = suscan_frame_get_f32(rd);
+}
+
+ssize_t
+suscan_frame_get_size(const uint8_t *data, size_t size)
+{
+  struct suscan_frame_reader rd = {data, size, 0, SU_TRUE};
+  uint32_t payload;
+
+  if (size < SUSCAN_FRAME_HEADER_SIZE)
+    return 0;
+
+  if (suscan_frame_get_u32(&rd) != SUSCAN_FRAME_MAGIC)
+    return -1;
+
+  (void) suscan_frame_get_u32(&rd);
+
+  if ((payload = suscan_frame_get_u32(&rd)) > SUSCAN_FRAME_MAX_SIZE)
+    return -1;
+
+  if (size < SUSCAN_FRAME_HEADER_SIZE + payload)
+    return 0;
+
+  return SUSCAN_FRAME_HEADER_SIZE + payload;
+}
+
+uint32_t
+suscan_frame_get_type(const uint8_t *frame)
+{
+  struct suscan_frame_reader rd = {frame, 8, 4, SU_TRUE};
+
+  return suscan_frame_get_u32(&rd);
+}
+
+/* Payload of a complete frame, as checked by suscan_frame_get_size */
+SUPRIVATE void
+suscan_frame_reader_init(
+    struct suscan_frame_reader *rd,
+    const uint8_t *frame)
+{
+  struct suscan_frame_reader hdr = {frame, 12, 8, SU_TRUE};
+
+  rd->data = frame + SUSCAN_FRAME_HEADER_SIZE;
+  rd->size = suscan_frame_get_u32(&hdr);
+  rd->ptr  = 0;
+  rd->ok   = SU_TRUE;
+}
+
+SUBOOL
+suscan_frame_deserialize_subscribe(const uint8_t *frame, uint32_t *mask)
+{
+  struct suscan_frame_reader rd;
+
+  suscan_frame_reader_init(&rd, frame);
+
+  *mask = suscan_frame_get_u32(&rd);
+
+  return rd.ok;
+}
+
+void *
+suscan_frame_deserialize_request(const uint8_t *frame, uint32_t *type)
+{
+  struct suscan_frame_reader rd;
+  struct suscan_analyzer_inspector_msg *insp = NULL;
+  struct suscan_analyzer_seek_msg *seek = NULL;
+  struct suscan_analyzer_retune_msg *retune = NULL;
+  struct suscan_analyzer_inspector_batch_msg *ibatch = NULL;
+  enum suscan_analyzer_inspector_batch_kind batch_kind;
+  struct suscan_source_tuning tuning;
+  enum suscan_analyzer_inspector_msgkind kind;
+  SUFLOAT offset;
+  uint32_t req_id;
+  uint32_t count;
+  unsigned int i;
+
+  suscan_frame_reader_init(&rd, frame);
+
+  *type = suscan_frame_get_type(frame);
+
+  /* Same layouts as in suscan_frame_put_msg */
+  switch (*type) {
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
+      kind = suscan_frame_get_u32(&rd);
+      (void) suscan_frame_get_u32(&rd); /* inspector_id */
+      req_id = suscan_frame_get_u32(&rd);
+
+      /* Analyzer-internal */
+      if (kind == SUSCAN_ANALYZER_INSPECTOR_MSGKIND_HALTED)
+        goto fail;
+
+      SU_TRYCATCH(
+          insp = suscan_analyzer_inspector_msg_new(kind, req_id),
+          goto fail);
+
+      insp->handle    = suscan_frame_get_u32(&rd);
+      insp->source_id = suscan_frame_get_u32(&rd);
+      (void) suscan_frame_get_u32(&rd); /* status */
+
+      if (kind == SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN)
+        suscan_frame_get_channel(&rd, &insp->channel);
+      else if (kind == SUSCAN_ANALYZER_INSPECTOR_MSGKIND_PARAMS)
+        suscan_frame_get_inspector_params(&rd, &insp->params);
+
+      if (!rd.ok)
+        goto fail;
+
+      return insp;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SEEK:
+      offset = suscan_frame_get_f64(&rd);
+
+      SU_TRYCATCH(
+          seek = suscan_analyzer_seek_msg_new(offset, 0),
+          goto fail);
+
+      seek->source_id = suscan_frame_get_u32(&rd);
+      seek->req_id    = suscan_frame_get_u32(&rd);
+
+      if (!rd.ok)
+        goto fail;
+
+      return seek;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_RETUNE:
+      memset(&tuning, 0, sizeof(struct suscan_source_tuning));
+
+      tuning.mask      = suscan_frame_get_u32(&rd);
+      tuning.fc        = suscan_frame_get_u64(&rd);
+      tuning.samp_rate = suscan_frame_get_u64(&rd);
+      tuning.gain      = suscan_frame_get_f32(&rd);
+
+      SU_TRYCATCH(
+          retune = suscan_analyzer_retune_msg_new(&tuning, 0),
+          goto fail);
+
+      retune->source_id = suscan_frame_get_u32(&rd);
+      retune->req_id    = suscan_frame_get_u32(&rd);
+
+      if (!rd.ok)
+        goto fail;
+
+      return retune;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR_BATCH:
+      batch_kind = suscan_frame_get_u32(&rd);
+      req_id = suscan_frame_get_u32(&rd);
+      count = suscan_frame_get_u32(&rd);
+
+      /* Smallest entry is 12 bytes: don't trust count blindly */
+      if (!rd.ok
+          || batch_kind > SUSCAN_ANALYZER_INSPECTOR_BATCH_GET_INFO
+          || count > (rd.size - rd.ptr) / 12)
+        goto fail;
+
+      SU_TRYCATCH(
+          ibatch = suscan_analyzer_inspector_batch_msg_new(
+              batch_kind,
+              count,
+              req_id),
+          goto fail);
+
+      for (i = 0; i < count; ++i) {
+        ibatch->entry_list[i].source_id = suscan_frame_get_u32(&rd);
+        ibatch->entry_list[i].handle = (int32_t) suscan_frame_get_u32(&rd);
+        (void) suscan_frame_get_u32(&rd); /* status */
+
+        if (batch_kind == SUSCAN_ANALYZER_INSPECTOR_BATCH_OPEN) {
+          suscan_frame_get_channel(&rd, &ibatch->entry_list[i].channel);
+        } else if (batch_kind == SUSCAN_ANALYZER_INSPECTOR_BATCH_GET_INFO) {
+          (void) suscan_frame_get_f32(&rd);
+          (void) suscan_frame_get_f32(&rd);
+        }
+      }
+
+      if (!rd.ok)
+        goto fail;
+
+      return ibatch;
+
+    default:
+      SU_ERROR("Frames of type 0x%x cannot be sent to the analyzer\n", *type);
+  }
+
+fail:
+  if (insp != NULL)
+    suscan_analyzer_inspector_msg_destroy(insp);
+
+  if (seek != NULL)
+    suscan_analyzer_seek_msg_destroy(seek);
+
+  if (retune != NULL)
+    suscan_analyzer_retune_msg_destroy(retune);
+
+  if (ibatch != NULL)
+    suscan_analyzer_inspector_batch_msg_destroy(ibatch);
+
+  return NULL;
+}
@@ -0,0 +1,90 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _SERIALIZE_H
+#define _SERIALIZE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Binary framing of analyzer messages, for clients in other processes.
+ * A frame is a header (magic, message type and payload size) followed by
+ * the payload. Everything is little-endian. Frequencies are doubles,
+ * other real numbers are single precision floats, timestamps are 64-bit
+ * seconds plus 32-bit nanoseconds and strings are a 32-bit length
+ * followed by the bytes, without terminator.
+ */
+#define SUSCAN_FRAME_MAGIC       0x4e435355 /* "USCN" */
+#define SUSCAN_FRAME_HEADER_SIZE 12
+#define SUSCAN_FRAME_MAX_SIZE    (16 << 20) /* Payload */
+
+/*
+ * Frame types from clients, beyond analyzer message types. SUBSCRIBE
+ * carries a 32-bit mask of the message types the client wants to get
+ * (bit n for type n). Clients get everything until they subscribe.
+ */
+#define SUSCAN_FRAME_TYPE_SUBSCRIBE 0x100
+
+struct suscan_frame_buffer {
+  uint8_t *data;
+  size_t   size;
+  size_t   alloc;
+};
+
+void suscan_frame_buffer_init(struct suscan_frame_buffer *buf);
+void suscan_frame_buffer_finalize(struct suscan_frame_buffer *buf);
+
+/* Drops the first size bytes */
+void suscan_frame_buffer_consume(struct suscan_frame_buffer *buf, size_t size);
+
+SUBOOL suscan_frame_buffer_append(
+    struct suscan_frame_buffer *buf,
+    const void *data,
+    size_t size);
+
+/* Appends a whole frame. Fails for messages that cannot be serialized */
+SUBOOL suscan_frame_serialize(
+    struct suscan_frame_buffer *buf,
+    uint32_t type,
+    const void *msg);
+
+/*
+ * Returns the size of the first frame in data (header included), 0 if
+ * it is not complete yet and -1 if data doesn't start with a frame.
+ */
+ssize_t suscan_frame_get_size(const uint8_t *data, size_t size);
+
+uint32_t suscan_frame_get_type(const uint8_t *frame);
+
+/*
+ * Client requests: INSPECTOR, INSPECTOR_BATCH, SEEK and RETUNE messages.
+ * Returns a new message, to be written to the analyzer, or NULL if the
+ * frame is invalid. SUBSCRIBE frames are handled by the server.
+ */
+void *suscan_frame_deserialize_request(const uint8_t *frame, uint32_t *type);
+
+SUBOOL suscan_frame_deserialize_subscribe(
+    const uint8_t *frame,
+    uint32_t *mask);
+
+#endif /* _SERIALIZE_H */
@@ -31,6 +31,9 @@
 #include "sources/bladerf.h"
 #include "sources/hack_rf.h"
 #include "sources/alsa.h"
+#include "sources/capfile.h"
+#include "sources/synth.h"
+#include "sources/netiq.h"
 
 /* Will never be freed */
 PTR_LIST(struct suscan_source, source);
@@ -665,15 +668,21 @@ suscan_init_sources(void)
 {
   SU_TRYCATCH(suscan_null_source_init(), return SU_FALSE);
 
+  SU_TRYCATCH(suscan_synth_source_init(), return SU_FALSE);
+
   SU_TRYCATCH(suscan_wav_source_init(), return SU_FALSE);
 
   SU_TRYCATCH(suscan_iqfile_source_init(), return SU_FALSE);
 
+  SU_TRYCATCH(suscan_capfile_source_init(), return SU_FALSE);
+
   SU_TRYCATCH(suscan_bladeRF_source_init(), return SU_FALSE);
 
   SU_TRYCATCH(suscan_hackRF_source_init(), return SU_FALSE);
 
   SU_TRYCATCH(suscan_alsa_source_init(), return SU_FALSE);
 
+  SU_TRYCATCH(suscan_netiq_source_init(), return SU_FALSE);
+
   return SU_TRUE;
 }
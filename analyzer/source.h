@@ -56,6 +56,18 @@ struct suscan_field {
 
 struct suscan_source_config;
 
+/* Retune request. Settings not in mask are left untouched */
+#define SUSCAN_SOURCE_TUNING_FC        1
+#define SUSCAN_SOURCE_TUNING_SAMP_RATE 2
+#define SUSCAN_SOURCE_TUNING_GAIN      4
+
+struct suscan_source_tuning {
+  unsigned int mask;
+  uint64_t fc;        /* Center frequency (Hz) */
+  uint64_t samp_rate; /* Sample rate */
+  SUFLOAT  gain;      /* Baseband gain (dB) */
+};
+
 struct suscan_source {
   const char *name;
   const char *desc;
@@ -66,6 +78,17 @@ struct suscan_source {
   PTR_LIST(struct suscan_field, field);
 
   su_block_t *(*ctor) (const struct suscan_source_config *);
+
+  /* Optional: jump to a time offset (in seconds) from the start of data */
+  SUBOOL (*seek) (su_block_t *block, SUFLOAT offset);
+
+  /*
+   * Optional: change tuning while streaming. The samp_rate and fc block
+   * properties must reflect the actual values afterwards.
+   */
+  SUBOOL (*retune) (
+      su_block_t *block,
+      const struct suscan_source_tuning *tuning);
 };
 
 struct suscan_source_config {
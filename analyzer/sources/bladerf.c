@@ -268,10 +268,6 @@ fail:
   return SU_FALSE;
 }
 
-#ifdef BLADERF_SAVE_SAMPLES
-FILE *fp;
-#endif /* BLADERF_SAVE_SAMPLES */
-
 SUPRIVATE SUSDIFF
 su_block_bladeRF_acquire(
     void *priv,
@@ -285,12 +281,6 @@ su_block_bladeRF_acquire(
   SUCOMPLEX *start;
   SUCOMPLEX samp;
   int status;
-#ifdef BLADERF_SAVE_SAMPLES
-  complex float iq;
-
-  if (fp == NULL)
-    fp = fopen("output.raw", "wb");
-#endif /* BLADERF_SAVE_SAMPLES */
 
   /* Get the number of complex samples to acquire */
   size = su_stream_get_contiguous(
@@ -310,10 +300,6 @@ su_block_bladeRF_acquire(
         start[i] =
             state->buffer[i << 1] / 2048.0
             + I * state->buffer[(i << 1) + 1] / 2048.0;
-#ifdef BLADERF_SAVE_SAMPLES
-        iq = start[i];
-        fwrite(&iq, 1, sizeof(complex float), fp);
-#endif /* BLADERF_SAVE_SAMPLES */
       }
 
       /* Increment position */
@@ -339,6 +325,75 @@ SUPRIVATE struct sigutils_block_class su_block_class_BLADERF = {
     su_block_bladeRF_acquire, /* acquire */
 };
 
+/* Called from the source worker, between reads */
+SUPRIVATE SUBOOL
+suscan_bladeRF_source_retune(
+    su_block_t *block,
+    const struct suscan_source_tuning *tuning)
+{
+  struct bladeRF_state *state = (struct bladeRF_state *) block->private;
+  unsigned int actual_samp_rate;
+  unsigned int actual_fc;
+  unsigned int actual_bw;
+  int status;
+
+  if (tuning->mask & SUSCAN_SOURCE_TUNING_SAMP_RATE) {
+    status = bladerf_set_sample_rate(
+        state->dev,
+        BLADERF_MODULE_RX,
+        tuning->samp_rate,
+        &actual_samp_rate);
+    if (status != 0) {
+      SU_ERROR("Cannot set sample rate: %s\n", bladerf_strerror(status));
+      return SU_FALSE;
+    }
+
+    /* Configure bandwidth according to actual sample rate */
+    if ((actual_bw = round(actual_samp_rate * .75)) < BLADERF_BANDWIDTH_MIN)
+      actual_bw = BLADERF_BANDWIDTH_MIN;
+
+    status = bladerf_set_bandwidth(
+        state->dev,
+        BLADERF_MODULE_RX,
+        actual_bw,
+        &actual_bw);
+    if (status != 0) {
+      SU_ERROR("Failed to set bandwidth: %s\n", bladerf_strerror(status));
+      return SU_FALSE;
+    }
+
+    state->samp_rate = actual_samp_rate;
+  }
+
+  if (tuning->mask & SUSCAN_SOURCE_TUNING_FC) {
+    status = bladerf_set_frequency(state->dev, BLADERF_MODULE_RX, tuning->fc);
+    if (status != 0) {
+      SU_ERROR("Cannot set frequency: %s\n", bladerf_strerror(status));
+      return SU_FALSE;
+    }
+
+    status = bladerf_get_frequency(state->dev, BLADERF_MODULE_RX, &actual_fc);
+    if (status != 0) {
+      SU_ERROR("Failed to get frequency: %s\n", bladerf_strerror(status));
+      return SU_FALSE;
+    }
+
+    state->fc = actual_fc;
+  }
+
+  if (tuning->mask & SUSCAN_SOURCE_TUNING_GAIN) {
+    status = bladerf_set_rxvga2(state->dev, tuning->gain);
+    if (status != 0) {
+      SU_ERROR("Failed to set VGA2 gain: %s\n", bladerf_strerror(status));
+      return SU_FALSE;
+    }
+
+    state->params.vga2 = tuning->gain;
+  }
+
+  return SU_TRUE;
+}
+
 SUPRIVATE su_block_t *
 suscan_bladeRF_source_ctor(const struct suscan_source_config *config)
 {
@@ -403,6 +458,7 @@ suscan_bladeRF_source_init(void)
     return SU_FALSE;
 
   source->real_time = SU_TRUE;
+  source->retune = suscan_bladeRF_source_retune;
 
   if (!suscan_source_add_field(
       source,
@@ -0,0 +1,351 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "capfile"
+
+#include "source.h"
+#include "capfile.h"
+
+SUPRIVATE void
+capfile_state_destroy(struct capfile_state *state)
+{
+  if (state->capture != NULL)
+    suscan_capture_close(state->capture);
+
+  if (state->buffer != NULL)
+    free(state->buffer);
+
+  free(state);
+}
+
+/* Load chunk and leave it ready for the acquire method */
+SUPRIVATE SUBOOL
+capfile_state_load_chunk(
+    struct capfile_state *state,
+    uint64_t chunk,
+    uint32_t offset)
+{
+  SUSDIFF got;
+
+  if ((got = suscan_capture_read_chunk(state->capture, chunk, state->buffer))
+      < 0)
+    return SU_FALSE;
+
+  if (offset > got)
+    offset = got;
+
+  state->next_chunk = chunk + 1;
+  state->ptr   = offset;
+  state->avail = got - offset;
+  state->pos   = state->capture->index[chunk].first_sample + offset;
+  state->gap   = 0;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+capfile_state_seek(struct capfile_state *state, SUFLOAT offset)
+{
+  uint64_t chunk;
+  uint32_t chunk_offset;
+  uint64_t sample;
+
+  if (offset < 0)
+    offset = 0;
+
+  sample = offset * state->samp_rate;
+
+  if (sample >= state->capture->total_samples) {
+    SU_ERROR(
+        "Cannot seek to %lgs: capture is %lgs long\n",
+        offset,
+        (SUFLOAT) state->capture->total_samples / state->samp_rate);
+    return SU_FALSE;
+  }
+
+  if (suscan_capture_lookup(state->capture, sample, &chunk, &chunk_offset)) {
+    if (!capfile_state_load_chunk(state, chunk, chunk_offset))
+      return SU_FALSE;
+  } else {
+    /* Dropped samples: the rest of the gap is played as silence */
+    state->next_chunk = suscan_capture_get_next_chunk(state->capture, sample);
+    state->ptr   = 0;
+    state->avail = 0;
+    state->pos   = sample;
+    state->gap   = 0;
+  }
+
+  /* Where playback actually resumes */
+  state->start_sample = state->pos;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE struct capfile_state *
+capfile_state_new(const struct capfile_params *params)
+{
+  struct capfile_state *new = NULL;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(struct capfile_state)), goto fail);
+
+  new->params = *params;
+  new->params.path = NULL; /* Not needed after open */
+
+  SU_TRYCATCH(new->capture = suscan_capture_open(params->path), goto fail);
+
+  new->samp_rate = new->capture->header.samp_rate;
+  new->fc = new->capture->header.fc;
+  new->t0 = new->capture->header.start_sec * 1000000000ull
+      + new->capture->header.start_nsec;
+
+  SU_TRYCATCH(
+      new->buffer = malloc(
+          new->capture->header.chunk_samples * sizeof(SUCOMPLEX)),
+      goto fail);
+
+  if (params->start > 0)
+    SU_TRYCATCH(capfile_state_seek(new, params->start), goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    capfile_state_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE void
+su_block_capfile_dtor(void *private)
+{
+  struct capfile_state *state = (struct capfile_state *) private;
+
+  capfile_state_destroy(state);
+}
+
+SUPRIVATE SUBOOL
+su_block_capfile_ctor(struct sigutils_block *block, void **private, va_list ap)
+{
+  struct capfile_state *state = NULL;
+  const struct capfile_params *params;
+
+  params = va_arg(ap, const struct capfile_params *);
+
+  if ((state = capfile_state_new(params)) == NULL) {
+    SU_ERROR("Create capture file state failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "samp_rate",
+      &state->samp_rate)) {
+    SU_ERROR("Expose samp_rate failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "fc",
+      &state->fc)) {
+    SU_ERROR("Expose fc failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "t0",
+      &state->t0)) {
+    SU_ERROR("Expose t0 failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "start_sample",
+      &state->start_sample)) {
+    SU_ERROR("Expose start_sample failed\n");
+    goto fail;
+  }
+
+  *private = state;
+
+  return SU_TRUE;
+
+fail:
+  if (state != NULL)
+    capfile_state_destroy(state);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE SUSDIFF
+su_block_capfile_acquire(
+    void *priv,
+    su_stream_t *out,
+    unsigned int port_id,
+    su_block_port_t *in)
+{
+  struct capfile_state *state = (struct capfile_state *) priv;
+  const struct suscan_capture_index_entry *next;
+  SUCOMPLEX *start;
+  SUSDIFF size;
+
+  while (state->avail == 0 && state->gap == 0) {
+    if (state->next_chunk >= state->capture->chunk_count) {
+      if (!state->params.loop || state->capture->chunk_count == 0)
+        return SU_BLOCK_PORT_READ_END_OF_STREAM;
+
+      state->next_chunk = 0;
+      state->pos = state->capture->index[0].first_sample;
+    }
+
+    next = &state->capture->index[state->next_chunk];
+
+    if (next->first_sample > state->pos) {
+      state->gap = next->first_sample - state->pos;
+      break;
+    }
+
+    if (!capfile_state_load_chunk(state, state->next_chunk, 0))
+      return SU_BLOCK_PORT_READ_ERROR_ACQUIRE;
+  }
+
+  if (state->gap > 0) {
+    size = su_stream_get_contiguous(
+        out,
+        &start,
+        SU_MIN(state->gap, state->capture->header.chunk_samples));
+    memset(start, 0, size * sizeof(SUCOMPLEX));
+  } else {
+    size = su_stream_get_contiguous(out, &start, state->avail);
+    memcpy(start, state->buffer + state->ptr, size * sizeof(SUCOMPLEX));
+  }
+
+  if (su_stream_advance_contiguous(out, size) != size) {
+    SU_ERROR("Unexpected size after su_stream_advance_contiguous\n");
+    return -1;
+  }
+
+  if (state->gap > 0) {
+    state->gap -= size;
+  } else {
+    state->ptr   += size;
+    state->avail -= size;
+  }
+
+  state->pos += size;
+
+  return size;
+}
+
+struct sigutils_block_class su_block_class_CAPFILE = {
+    "capfile", /* name */
+    0,         /* in_size */
+    1,         /* out_size */
+    su_block_capfile_ctor,     /* constructor */
+    su_block_capfile_dtor,     /* destructor */
+    su_block_capfile_acquire,  /* acquire */
+};
+
+/*
+ * Called from the source worker, between reads. Samples already in the
+ * block stream are still delivered to slow readers.
+ */
+SUPRIVATE SUBOOL
+suscan_capfile_source_seek(su_block_t *block, SUFLOAT offset)
+{
+  return capfile_state_seek((struct capfile_state *) block->private, offset);
+}
+
+SUPRIVATE su_block_t *
+suscan_capfile_source_ctor(const struct suscan_source_config *config)
+{
+  struct capfile_params params;
+  const struct suscan_field_value *value;
+
+  memset(&params, 0, sizeof(struct capfile_params));
+
+  if ((value = suscan_source_config_get_value(config, "path")) == NULL)
+    return NULL;
+  params.path = value->as_string;
+
+  if ((value = suscan_source_config_get_value(config, "start")) == NULL)
+    return NULL;
+  if (value->set)
+    params.start = value->as_float;
+
+  if ((value = suscan_source_config_get_value(config, "loop")) == NULL)
+    return NULL;
+  if (value->set)
+    params.loop = value->as_bool;
+
+  return su_block_new("capfile", &params);
+}
+
+SUBOOL
+suscan_capfile_source_init(void)
+{
+  struct suscan_source *source = NULL;
+
+  if (!su_block_class_register(&su_block_class_CAPFILE))
+    return SU_FALSE;
+
+  if ((source = suscan_source_register(
+      "capture",
+      "Suscan indexed capture file",
+      suscan_capfile_source_ctor)) == NULL)
+    return SU_FALSE;
+
+  source->seek = suscan_capfile_source_seek;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_FILE,
+      SU_FALSE,
+      "path",
+      "File path"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_FLOAT,
+      SU_TRUE,
+      "start",
+      "Start offset (seconds)"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_BOOLEAN,
+      SU_TRUE,
+      "loop",
+      "Loop"))
+    return SU_FALSE;
+
+  return SU_TRUE;
+}
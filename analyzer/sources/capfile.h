@@ -0,0 +1,57 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _ANALYZER_SOURCES_CAPFILE_H
+#define _ANALYZER_SOURCES_CAPFILE_H
+
+#include <sigutils/sigutils.h>
+
+#include "../capture.h"
+
+struct capfile_params {
+  const char *path;
+  SUFLOAT start; /* Initial playback offset, in seconds */
+  SUBOOL loop;
+};
+
+struct capfile_state {
+  struct capfile_params params;
+  suscan_capture_t *capture;
+  uint64_t samp_rate;
+  uint64_t fc;
+  uint64_t t0;           /* Capture start, ns since the epoch */
+  uint64_t start_sample; /* Stream position of the first delivered sample */
+
+  SUCOMPLEX *buffer;  /* Contents of the current chunk */
+  uint64_t next_chunk;
+  SUSCOUNT ptr;
+  SUSCOUNT avail;
+
+  /*
+   * Gaps are played back as silence of the same length, so that stream
+   * positions (and the virtual clock) match those of the recording.
+   */
+  uint64_t pos;  /* Stream position of the next sample to deliver */
+  uint64_t gap;  /* Samples of silence left before the next chunk */
+};
+
+SUBOOL suscan_capfile_source_init(void);
+
+#endif /* _ANALYZER_SOURCES_CAPFILE_H */
@@ -164,6 +164,27 @@ xsig_source_acquire(struct xsig_source *source)
   return SU_TRUE;
 }
 
+SUBOOL
+xsig_source_seek(struct xsig_source *source, SUFLOAT offset)
+{
+  sf_count_t frame;
+
+  if (offset < 0)
+    offset = 0;
+
+  frame = offset * source->info.samplerate;
+
+  if (sf_seek(source->sf, frame, SEEK_SET) == -1) {
+    SU_ERROR("Cannot seek to %lgs: %s\n", offset, sf_strerror(source->sf));
+    return SU_FALSE;
+  }
+
+  /* Discard whatever was left from the previous window */
+  source->avail = 0;
+
+  return SU_TRUE;
+}
+
 /* Source as block */
 SUPRIVATE SUBOOL
 xsig_source_block_ctor(struct sigutils_block *block, void **private, va_list ap)
@@ -301,6 +322,12 @@ xsig_source_create_block(const struct xsig_source_params *params)
   return block;
 }
 
+SUPRIVATE SUBOOL
+xsig_source_block_seek(su_block_t *block, SUFLOAT offset)
+{
+  return xsig_source_seek((struct xsig_source *) block->private, offset);
+}
+
 SUPRIVATE su_block_t *
 suscan_wav_source_ctor(const struct suscan_source_config *config)
 {
@@ -340,6 +367,7 @@ suscan_wav_source_init(void)
     return SU_FALSE;
 
   source->real_samp = SU_TRUE;
+  source->seek = xsig_source_block_seek;
 
   if (!suscan_source_add_field(
       source,
@@ -410,6 +438,8 @@ suscan_iqfile_source_init(void)
       suscan_iqfile_source_ctor)) == NULL)
     return SU_FALSE;
 
+  source->seek = xsig_source_block_seek;
+
   if (!suscan_source_add_field(
       source,
       SUSCAN_FIELD_TYPE_FILE,
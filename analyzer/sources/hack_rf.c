@@ -242,10 +242,6 @@ fail:
   return SU_FALSE;
 }
 
-#ifdef HACKRF_SAVE_SAMPLES
-FILE *fp;
-#endif /* HACKRF_SAVE_SAMPLES */
-
 SUPRIVATE SUSDIFF
 su_block_hackRF_acquire(
     void *priv,
@@ -260,13 +256,6 @@ su_block_hackRF_acquire(
   unsigned int i;
   int result;
 
-#ifdef HACKRF_SAVE_SAMPLES
-  complex float iq;
-
-  if (fp == NULL)
-    fp = fopen("output.raw", "wb");
-#endif /* HACKRF_SAVE_SAMPLES */
-
   /* Get the number of complex samples to acquire */
   size = su_stream_get_contiguous(
       out,
@@ -322,6 +311,57 @@ SUPRIVATE struct sigutils_block_class su_block_class_HACKRF = {
     su_block_hackRF_acquire, /* acquire */
 };
 
+/* Called from the source worker, between reads */
+SUPRIVATE SUBOOL
+suscan_hackRF_source_retune(
+    su_block_t *block,
+    const struct suscan_source_tuning *tuning)
+{
+  struct hackRF_state *state = (struct hackRF_state *) block->private;
+  int result;
+
+  if (tuning->mask & SUSCAN_SOURCE_TUNING_SAMP_RATE) {
+    result = hackrf_set_sample_rate(state->dev, tuning->samp_rate);
+    if (result != HACKRF_SUCCESS) {
+      SU_ERROR(
+          "Failed to set sample rate of HackRF device: %s (%d)\n",
+          hackrf_error_name(result),
+          result);
+      return SU_FALSE;
+    }
+
+    state->samp_rate = tuning->samp_rate;
+  }
+
+  if (tuning->mask & SUSCAN_SOURCE_TUNING_FC) {
+    result = hackrf_set_freq(state->dev, tuning->fc);
+    if (result != HACKRF_SUCCESS) {
+      SU_ERROR(
+          "Failed to set center frequency of HackRF device: %s (%d)\n",
+          hackrf_error_name(result),
+          result);
+      return SU_FALSE;
+    }
+
+    state->fc = tuning->fc;
+  }
+
+  if (tuning->mask & SUSCAN_SOURCE_TUNING_GAIN) {
+    result = hackrf_set_vga_gain(state->dev, tuning->gain);
+    if (result != HACKRF_SUCCESS) {
+      SU_ERROR(
+          "Failed to set VGA (BB) gain HackRF device: %s (%d)\n",
+          hackrf_error_name(result),
+          result);
+      return SU_FALSE;
+    }
+
+    state->params.vga_gain = tuning->gain;
+  }
+
+  return SU_TRUE;
+}
+
 SUPRIVATE su_block_t *
 suscan_hackRF_source_ctor(const struct suscan_source_config *config)
 {
@@ -396,6 +436,7 @@ suscan_hackRF_source_init(void)
     return SU_FALSE;
 
   source->real_time = SU_TRUE;
+  source->retune = suscan_hackRF_source_retune;
 
   if (!suscan_source_add_field(
       source,
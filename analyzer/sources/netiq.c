@@ -0,0 +1,887 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <endian.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define SU_LOG_DOMAIN "netiq"
+
+#include "source.h"
+#include "throttle.h"
+#include "netiq.h"
+
+/*
+ * The receiver thread converts incoming frames into the slots of a jitter
+ * buffer, indexed by sequence number. The acquire method delivers slots
+ * in order. A missing frame is given up on (and replaced by silence) once
+ * later frames have been waiting for NETIQ_LOSS_TIMEOUT_MS. If the reader
+ * falls more than a whole buffer behind, the oldest frames are discarded.
+ * Both cases are added to the "lost" block property.
+ *
+ * Samples are copied to the block stream without the lock held. While
+ * that happens, the receiver must not discard or recycle the slot being
+ * read, so it waits for the copy to finish (see netiq_state_wait_reader).
+ *
+ * When listening for TCP connections, a peer that disconnects is not the
+ * end of the stream: the receiver goes back to accepting a new one.
+ */
+
+/****************************** Conversion ***********************************/
+SUPRIVATE size_t
+netiq_format_get_samp_size(enum netiq_format format)
+{
+  switch (format) {
+    case NETIQ_FORMAT_CS8:
+      return 2 * sizeof(int8_t);
+
+    case NETIQ_FORMAT_CS16:
+      return 2 * sizeof(int16_t);
+
+    case NETIQ_FORMAT_CF32:
+      return 2 * sizeof(float);
+  }
+
+  return 0;
+}
+
+SUPRIVATE void
+netiq_convert(
+    enum netiq_format format,
+    const uint8_t *data,
+    SUCOMPLEX *samples,
+    SUSCOUNT count)
+{
+  const int8_t *as_int8;
+  uint16_t u16[2];
+  uint32_t u32[2];
+  float f[2];
+  SUSCOUNT i;
+
+  switch (format) {
+    case NETIQ_FORMAT_CS8:
+      as_int8 = (const int8_t *) data;
+      for (i = 0; i < count; ++i)
+        samples[i] = as_int8[i << 1] / 127. + I * as_int8[(i << 1) + 1] / 127.;
+      break;
+
+    case NETIQ_FORMAT_CS16:
+      for (i = 0; i < count; ++i) {
+        memcpy(u16, data + 4 * i, sizeof(u16));
+        samples[i] =
+            (int16_t) le16toh(u16[0]) / 32767.
+            + I * (int16_t) le16toh(u16[1]) / 32767.;
+      }
+      break;
+
+    case NETIQ_FORMAT_CF32:
+      for (i = 0; i < count; ++i) {
+        memcpy(u32, data + 8 * i, sizeof(u32));
+        u32[0] = le32toh(u32[0]);
+        u32[1] = le32toh(u32[1]);
+        memcpy(f, u32, sizeof(f));
+        samples[i] = f[0] + I * f[1];
+      }
+      break;
+  }
+}
+
+/***************************** Jitter buffer *********************************/
+/* Must be called with the state lock held */
+SUPRIVATE void
+netiq_state_wait_reader(struct netiq_state *state)
+{
+  while (state->reading)
+    pthread_cond_wait(&state->cond, &state->lock);
+}
+
+/* Must be called with the state lock held */
+SUPRIVATE void
+netiq_state_reset_buffer(struct netiq_state *state, uint32_t seq)
+{
+  unsigned int i;
+
+  netiq_state_wait_reader(state);
+
+  for (i = 0; i < state->params.depth; ++i)
+    if (state->slots[i].state == NETIQ_SLOT_STATE_READY)
+      state->slots[i].state = NETIQ_SLOT_STATE_FREE;
+
+  state->started  = SU_TRUE;
+  state->next_seq = seq;
+  state->last_seq = seq;
+  state->ptr      = 0;
+  state->waiting  = SU_FALSE;
+}
+
+/* Must be called with the state lock held */
+SUPRIVATE void
+netiq_state_discard_oldest(struct netiq_state *state)
+{
+  struct netiq_slot *slot;
+
+  netiq_state_wait_reader(state);
+
+  slot = &state->slots[state->next_seq % state->params.depth];
+
+  if (slot->state == NETIQ_SLOT_STATE_READY && slot->seq == state->next_seq) {
+    state->lost_count += slot->count - state->ptr;
+    slot->state = NETIQ_SLOT_STATE_FREE;
+  } else {
+    state->lost_count += state->last_count;
+  }
+
+  state->ptr = 0;
+  state->waiting = SU_FALSE;
+  ++state->next_seq;
+}
+
+SUPRIVATE void
+netiq_state_push_frame(
+    struct netiq_state *state,
+    uint32_t seq,
+    enum netiq_format format,
+    const uint8_t *data,
+    SUSCOUNT count)
+{
+  struct netiq_slot *slot;
+  int32_t diff;
+
+  pthread_mutex_lock(&state->lock);
+
+  if (!state->started)
+    netiq_state_reset_buffer(state, seq);
+
+  diff = (int32_t) (seq - state->next_seq);
+
+  if (diff < -(int32_t) state->params.depth) {
+    /* Far in the past: sender was restarted */
+    SU_WARNING("Sequence jumped back to %u, resyncing\n", seq);
+    netiq_state_reset_buffer(state, seq);
+    diff = 0;
+  } else if (diff < 0) {
+    /* Too late, this frame was already given up */
+    pthread_mutex_unlock(&state->lock);
+    return;
+  }
+
+  /* Reader is too slow: make room for this frame */
+  while (diff >= (int32_t) state->params.depth) {
+    netiq_state_discard_oldest(state);
+    --diff;
+  }
+
+  slot = &state->slots[seq % state->params.depth];
+
+  if (slot->state != NETIQ_SLOT_STATE_FREE) {
+    /* Duplicate */
+    pthread_mutex_unlock(&state->lock);
+    return;
+  }
+
+  slot->state = NETIQ_SLOT_STATE_FILLING;
+  slot->seq = seq;
+
+  pthread_mutex_unlock(&state->lock);
+
+  /* Conversion happens outside the lock, the slot is ours */
+  netiq_convert(format, data, slot->samples, count);
+
+  pthread_mutex_lock(&state->lock);
+
+  slot->count = count;
+  slot->state = NETIQ_SLOT_STATE_READY;
+
+  if ((int32_t) (seq - state->last_seq) >= 0) {
+    state->last_seq   = seq;
+    state->last_count = count;
+  }
+
+  pthread_cond_broadcast(&state->cond);
+  pthread_mutex_unlock(&state->lock);
+}
+
+/***************************** Receiver thread *******************************/
+SUPRIVATE SUBOOL
+netiq_recv_all(int fd, void *data, size_t size)
+{
+  uint8_t *as_bytes = (uint8_t *) data;
+  ssize_t got;
+
+  while (size > 0) {
+    if ((got = recv(fd, as_bytes, size, MSG_WAITALL)) < 0) {
+      if (errno == EINTR)
+        continue;
+      return SU_FALSE;
+    } else if (got == 0) {
+      return SU_FALSE; /* Peer closed the connection */
+    }
+
+    as_bytes += got;
+    size     -= got;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+netiq_set_socket_buffer(int fd)
+{
+  int size = NETIQ_SOCKET_BUFFER_SIZE;
+
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(int)) == -1)
+    SU_WARNING("Cannot set socket receive buffer size: %s\n", strerror(errno));
+}
+
+/* Returns 1 on frame, 0 on timeout and -1 on error */
+SUPRIVATE int
+netiq_state_recv_frame(
+    struct netiq_state *state,
+    struct netiq_frame_header *header)
+{
+  struct pollfd pfd;
+  size_t samp_size;
+  ssize_t got = 0;
+  int ready;
+
+  pfd.fd = state->fd;
+  pfd.events = POLLIN;
+
+  if ((ready = poll(&pfd, 1, NETIQ_POLL_TIMEOUT_MS)) == 0)
+    return 0;
+  else if (ready < 0)
+    return errno == EINTR ? 0 : -1;
+
+  if (!(pfd.revents & POLLIN))
+    return -1;
+
+  if (state->params.tcp) {
+    if (!netiq_recv_all(state->fd, state->frame, sizeof(struct netiq_frame_header)))
+      return -1;
+  } else {
+    if ((got = recv(
+        state->fd,
+        state->frame,
+        sizeof(struct netiq_frame_header) + NETIQ_MAX_FRAME_SIZE,
+        0)) < 0)
+      return errno == EINTR || errno == EAGAIN ? 0 : -1;
+
+    if (got < sizeof(struct netiq_frame_header))
+      return 0; /* Runt datagram */
+  }
+
+  memcpy(header, state->frame, sizeof(struct netiq_frame_header));
+
+  header->magic  = ntohl(header->magic);
+  header->seq    = ntohl(header->seq);
+  header->count  = ntohl(header->count);
+  header->format = ntohs(header->format);
+
+  if (header->magic != NETIQ_MAGIC
+      || header->count > NETIQ_MAX_FRAME_SAMPLES
+      || (samp_size = netiq_format_get_samp_size(header->format)) == 0) {
+    SU_ERROR("Malformed frame received\n");
+    /* No way to recover framing in a stream */
+    return state->params.tcp ? -1 : 0;
+  }
+
+  if (state->params.tcp) {
+    if (!netiq_recv_all(
+        state->fd,
+        state->frame + sizeof(struct netiq_frame_header),
+        header->count * samp_size))
+      return -1;
+  } else if (got != sizeof(struct netiq_frame_header)
+      + header->count * samp_size) {
+    SU_ERROR("Truncated datagram received\n");
+    return 0;
+  }
+
+  return 1;
+}
+
+SUPRIVATE SUBOOL
+netiq_state_accept(struct netiq_state *state)
+{
+  struct pollfd pfd;
+  int fd;
+
+  pfd.fd = state->listen_fd;
+  pfd.events = POLLIN;
+
+  if (poll(&pfd, 1, NETIQ_POLL_TIMEOUT_MS) <= 0)
+    return SU_TRUE;
+
+  if ((fd = accept(state->listen_fd, NULL, NULL)) == -1)
+    return errno == EINTR || errno == EAGAIN;
+
+  netiq_set_socket_buffer(fd);
+
+  pthread_mutex_lock(&state->lock);
+  state->fd = fd;
+  pthread_mutex_unlock(&state->lock);
+
+  return SU_TRUE;
+}
+
+/* The next peer starts its own sequence */
+SUPRIVATE void
+netiq_state_drop_peer(struct netiq_state *state)
+{
+  pthread_mutex_lock(&state->lock);
+
+  close(state->fd);
+  state->fd = -1;
+  state->started = SU_FALSE;
+
+  pthread_mutex_unlock(&state->lock);
+
+  SU_INFO("Peer disconnected, waiting for a new connection\n");
+}
+
+SUPRIVATE void *
+netiq_state_thread(void *data)
+{
+  struct netiq_state *state = (struct netiq_state *) data;
+  struct netiq_frame_header header;
+  int result;
+
+  while (!state->halting) {
+    if (state->fd == -1) {
+      if (!netiq_state_accept(state))
+        break;
+      continue;
+    }
+
+    if ((result = netiq_state_recv_frame(state, &header)) < 0) {
+      if (state->listen_fd == -1 || state->halting)
+        break;
+
+      netiq_state_drop_peer(state);
+      continue;
+    }
+
+    if (result > 0)
+      netiq_state_push_frame(
+          state,
+          header.seq,
+          header.format,
+          state->frame + sizeof(struct netiq_frame_header),
+          header.count);
+  }
+
+  pthread_mutex_lock(&state->lock);
+  state->eos = SU_TRUE;
+  pthread_cond_broadcast(&state->cond);
+  pthread_mutex_unlock(&state->lock);
+
+  return NULL;
+}
+
+/***************************** Socket setup **********************************/
+SUPRIVATE int
+netiq_open_socket(const struct netiq_params *params)
+{
+  struct addrinfo hints, *res = NULL, *rp;
+  char port[8];
+  int fd = -1;
+  int one = 1;
+  int status;
+
+  memset(&hints, 0, sizeof(struct addrinfo));
+
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = params->tcp ? SOCK_STREAM : SOCK_DGRAM;
+  hints.ai_flags    = params->connect ? 0 : AI_PASSIVE;
+
+  snprintf(port, sizeof(port), "%u", params->port);
+
+  if ((status = getaddrinfo(params->host, port, &hints, &res)) != 0) {
+    SU_ERROR(
+        "Cannot resolve `%s': %s\n",
+        params->host == NULL ? "*" : params->host,
+        gai_strerror(status));
+    return -1;
+  }
+
+  for (rp = res; rp != NULL; rp = rp->ai_next) {
+    if ((fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol)) == -1)
+      continue;
+
+    if (params->connect) {
+      if (connect(fd, rp->ai_addr, rp->ai_addrlen) == 0)
+        break;
+    } else {
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(int));
+      if (bind(fd, rp->ai_addr, rp->ai_addrlen) == 0)
+        break;
+    }
+
+    close(fd);
+    fd = -1;
+  }
+
+  freeaddrinfo(res);
+
+  if (fd == -1) {
+    SU_ERROR(
+        "Cannot %s %s port %d: %s\n",
+        params->connect ? "connect to" : "bind to",
+        params->tcp ? "TCP" : "UDP",
+        params->port,
+        strerror(errno));
+    return -1;
+  }
+
+  if (params->tcp && !params->connect) {
+    if (listen(fd, 1) == -1) {
+      SU_ERROR("Cannot listen on TCP port %d: %s\n", params->port, strerror(errno));
+      close(fd);
+      return -1;
+    }
+  } else {
+    netiq_set_socket_buffer(fd);
+  }
+
+  return fd;
+}
+
+/****************************** Source state *********************************/
+SUPRIVATE void
+netiq_state_destroy(struct netiq_state *state)
+{
+  unsigned int i;
+
+  if (state->thread_running) {
+    state->halting = SU_TRUE;
+
+    /* Wake up the receiver if it is blocked in a TCP read */
+    pthread_mutex_lock(&state->lock);
+    if (state->fd != -1 && state->params.tcp)
+      shutdown(state->fd, SHUT_RDWR);
+    pthread_mutex_unlock(&state->lock);
+
+    pthread_join(state->thread, NULL);
+  }
+
+  if (state->fd != -1)
+    close(state->fd);
+
+  if (state->listen_fd != -1)
+    close(state->listen_fd);
+
+  if (state->sync_init) {
+    pthread_mutex_destroy(&state->lock);
+    pthread_cond_destroy(&state->cond);
+  }
+
+  if (state->slots != NULL) {
+    for (i = 0; i < state->params.depth; ++i)
+      if (state->slots[i].samples != NULL)
+        free(state->slots[i].samples);
+
+    free(state->slots);
+  }
+
+  if (state->frame != NULL)
+    free(state->frame);
+
+  free(state);
+}
+
+SUPRIVATE struct netiq_state *
+netiq_state_new(const struct netiq_params *params)
+{
+  struct netiq_state *new = NULL;
+  unsigned int i;
+  int fd;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(struct netiq_state)), goto fail);
+
+  new->fd = -1;
+  new->listen_fd = -1;
+  new->params = *params;
+  new->params.host = NULL; /* Not needed after setup */
+
+  if (params->samp_rate == 0 || params->depth < 2) {
+    SU_ERROR("Invalid network source parameters\n");
+    goto fail;
+  }
+
+  new->samp_rate = params->samp_rate;
+  new->fc = params->fc;
+
+  SU_TRYCATCH(
+      new->slots = calloc(params->depth, sizeof(struct netiq_slot)),
+      goto fail);
+
+  for (i = 0; i < params->depth; ++i)
+    SU_TRYCATCH(
+        new->slots[i].samples =
+            malloc(NETIQ_MAX_FRAME_SAMPLES * sizeof(SUCOMPLEX)),
+        goto fail);
+
+  SU_TRYCATCH(
+      new->frame = malloc(
+          sizeof(struct netiq_frame_header) + NETIQ_MAX_FRAME_SIZE),
+      goto fail);
+
+  SU_TRYCATCH(pthread_mutex_init(&new->lock, NULL) == 0, goto fail);
+
+  if (pthread_cond_init(&new->cond, NULL) != 0) {
+    pthread_mutex_destroy(&new->lock);
+    goto fail;
+  }
+
+  new->sync_init = SU_TRUE;
+
+  SU_TRYCATCH((fd = netiq_open_socket(params)) != -1, goto fail);
+
+  if (params->tcp && !params->connect)
+    new->listen_fd = fd;
+  else
+    new->fd = fd;
+
+  SU_TRYCATCH(
+      pthread_create(&new->thread, NULL, netiq_state_thread, new) == 0,
+      goto fail);
+
+  new->thread_running = SU_TRUE;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    netiq_state_destroy(new);
+
+  return NULL;
+}
+
+/****************************** Block class **********************************/
+SUPRIVATE void
+su_block_netiq_dtor(void *private)
+{
+  struct netiq_state *state = (struct netiq_state *) private;
+
+  netiq_state_destroy(state);
+}
+
+SUPRIVATE SUBOOL
+su_block_netiq_ctor(struct sigutils_block *block, void **private, va_list ap)
+{
+  struct netiq_state *state = NULL;
+  const struct netiq_params *params;
+
+  params = va_arg(ap, const struct netiq_params *);
+
+  if ((state = netiq_state_new(params)) == NULL) {
+    SU_ERROR("Create network source state failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "samp_rate",
+      &state->samp_rate)) {
+    SU_ERROR("Expose samp_rate failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "fc",
+      &state->fc)) {
+    SU_ERROR("Expose fc failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "lost",
+      &state->lost)) {
+    SU_ERROR("Expose lost failed\n");
+    goto fail;
+  }
+
+  *private = state;
+
+  return SU_TRUE;
+
+fail:
+  if (state != NULL)
+    netiq_state_destroy(state);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE SUSDIFF
+su_block_netiq_acquire(
+    void *priv,
+    su_stream_t *out,
+    unsigned int port_id,
+    su_block_port_t *in)
+{
+  struct netiq_state *state = (struct netiq_state *) priv;
+  struct netiq_slot *slot;
+  struct timespec now, sub, deadline;
+  SUCOMPLEX *start;
+  SUSDIFF size = 0;
+
+  pthread_mutex_lock(&state->lock);
+
+  /* Only read from the thread that reads the property */
+  state->lost = state->lost_count;
+
+  for (;;) {
+    slot = &state->slots[state->next_seq % state->params.depth];
+
+    if (state->started
+        && slot->state == NETIQ_SLOT_STATE_READY
+        && slot->seq == state->next_seq) {
+      if (slot->count == 0) {
+        /* Empty frame, nothing to deliver */
+        slot->state = NETIQ_SLOT_STATE_FREE;
+        ++state->next_seq;
+        continue;
+      }
+
+      size = su_stream_get_contiguous(out, &start, slot->count - state->ptr);
+
+      state->waiting = SU_FALSE;
+      state->reading = SU_TRUE;
+      pthread_mutex_unlock(&state->lock);
+
+      memcpy(start, slot->samples + state->ptr, size * sizeof(SUCOMPLEX));
+
+      pthread_mutex_lock(&state->lock);
+      state->reading = SU_FALSE;
+
+      if ((state->ptr += size) == slot->count) {
+        slot->state = NETIQ_SLOT_STATE_FREE;
+        state->ptr = 0;
+        ++state->next_seq;
+      }
+
+      pthread_cond_broadcast(&state->cond);
+
+      break;
+    }
+
+    if (state->eos) {
+      size = SU_BLOCK_PORT_READ_END_OF_STREAM;
+      break;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    /* Later frames are waiting for this one. Is it lost? */
+    if (state->started
+        && slot->state == NETIQ_SLOT_STATE_FREE
+        && (int32_t) (state->last_seq - state->next_seq) > 0) {
+      if (!state->waiting) {
+        state->waiting = SU_TRUE;
+        state->wait_start = now;
+      } else {
+        timespecsub(&now, &state->wait_start, &sub);
+        if (sub.tv_sec * 1000 + sub.tv_nsec / 1000000
+            >= NETIQ_LOSS_TIMEOUT_MS) {
+          /* Give up: deliver silence in its place */
+          memset(slot->samples, 0, state->last_count * sizeof(SUCOMPLEX));
+          slot->seq   = state->next_seq;
+          slot->count = state->last_count;
+          slot->state = NETIQ_SLOT_STATE_READY;
+          state->lost_count += state->last_count;
+          state->ptr = 0;
+          continue;
+        }
+      }
+    }
+
+    deadline = now;
+    deadline.tv_nsec += 10000000;
+    if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_nsec -= 1000000000;
+      ++deadline.tv_sec;
+    }
+
+    pthread_cond_timedwait(&state->cond, &state->lock, &deadline);
+  }
+
+  pthread_mutex_unlock(&state->lock);
+
+  if (size > 0)
+    if (su_stream_advance_contiguous(out, size) != size) {
+      SU_ERROR("Unexpected size after su_stream_advance_contiguous\n");
+      return -1;
+    }
+
+  return size;
+}
+
+struct sigutils_block_class su_block_class_NETIQ = {
+    "netiq",   /* name */
+    0,         /* in_size */
+    1,         /* out_size */
+    su_block_netiq_ctor,     /* constructor */
+    su_block_netiq_dtor,     /* destructor */
+    su_block_netiq_acquire,  /* acquire */
+};
+
+/****************************** Source API ***********************************/
+SUPRIVATE su_block_t *
+suscan_netiq_source_ctor(const struct suscan_source_config *config)
+{
+  struct netiq_params params = netiq_params_INITIALIZER;
+  const struct suscan_field_value *value;
+
+  if ((value = suscan_source_config_get_value(config, "proto")) == NULL)
+    return NULL;
+  if (value->set) {
+    if (strcasecmp(value->as_string, "tcp") == 0) {
+      params.tcp = SU_TRUE;
+    } else if (strcasecmp(value->as_string, "udp") != 0) {
+      SU_ERROR("Unknown protocol `%s'\n", value->as_string);
+      return NULL;
+    }
+  }
+
+  if ((value = suscan_source_config_get_value(config, "host")) == NULL)
+    return NULL;
+  if (value->set)
+    params.host = value->as_string;
+
+  if ((value = suscan_source_config_get_value(config, "port")) == NULL)
+    return NULL;
+  if (value->set)
+    params.port = value->as_int;
+
+  if ((value = suscan_source_config_get_value(config, "connect")) == NULL)
+    return NULL;
+  if (value->set)
+    params.connect = value->as_bool && params.tcp;
+
+  if ((value = suscan_source_config_get_value(config, "fs")) == NULL)
+    return NULL;
+  params.samp_rate = value->as_int;
+
+  if ((value = suscan_source_config_get_value(config, "fc")) == NULL)
+    return NULL;
+  if (value->set)
+    params.fc = value->as_int;
+
+  if ((value = suscan_source_config_get_value(config, "depth")) == NULL)
+    return NULL;
+  if (value->set)
+    params.depth = value->as_int;
+
+  if (params.connect && params.host == NULL) {
+    SU_ERROR("No host given to connect to\n");
+    return NULL;
+  }
+
+  return su_block_new("netiq", &params);
+}
+
+SUBOOL
+suscan_netiq_source_init(void)
+{
+  struct suscan_source *source = NULL;
+
+  if (!su_block_class_register(&su_block_class_NETIQ))
+    return SU_FALSE;
+
+  if ((source = suscan_source_register(
+      "netiq",
+      "Network I/Q stream (TCP/UDP)",
+      suscan_netiq_source_ctor)) == NULL)
+    return SU_FALSE;
+
+  source->real_time = SU_TRUE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_STRING,
+      SU_TRUE,
+      "proto",
+      "Protocol (udp or tcp)"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_STRING,
+      SU_TRUE,
+      "host",
+      "Local address, or remote host with connect=true"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "port",
+      "Port"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_BOOLEAN,
+      SU_TRUE,
+      "connect",
+      "Connect to host (TCP only)"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_FALSE,
+      "fs",
+      "Sampling frequency"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "fc",
+      "Center frequency"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "depth",
+      "Jitter buffer size (frames)"))
+    return SU_FALSE;
+
+  return SU_TRUE;
+}
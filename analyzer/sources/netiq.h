@@ -0,0 +1,133 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _ANALYZER_SOURCES_NETIQ_H
+#define _ANALYZER_SOURCES_NETIQ_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Network IQ frames. The header is in network byte order, samples are
+ * interleaved I/Q in little endian:
+ *
+ *   0       4       8       12      14      16
+ *   +-------+-------+-------+-------+-------+----------------
+ *   | magic |  seq  | count |format | rsvd  | count samples...
+ *   +-------+-------+-------+-------+-------+----------------
+ *
+ * Over UDP, each datagram carries exactly one frame. Over TCP, frames are
+ * sent back to back.
+ */
+
+#define NETIQ_MAGIC                0x53514951 /* "SQIQ" */
+#define NETIQ_DEFAULT_PORT         5555
+#define NETIQ_DEFAULT_DEPTH        32
+#define NETIQ_MAX_FRAME_SAMPLES    16384
+#define NETIQ_MAX_FRAME_SIZE       (NETIQ_MAX_FRAME_SAMPLES * 8)
+#define NETIQ_SOCKET_BUFFER_SIZE   (32 << 20)
+#define NETIQ_LOSS_TIMEOUT_MS      50   /* Wait for late frames up to this */
+#define NETIQ_POLL_TIMEOUT_MS      500  /* Receiver thread halt check */
+
+enum netiq_format {
+  NETIQ_FORMAT_CS8  = 0,
+  NETIQ_FORMAT_CS16 = 1,
+  NETIQ_FORMAT_CF32 = 2
+};
+
+struct netiq_frame_header {
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t count;
+  uint16_t format;
+  uint16_t reserved;
+};
+
+struct netiq_params {
+  SUBOOL tcp;
+  const char *host; /* UDP/TCP listen address, or TCP peer to connect to */
+  uint16_t port;
+  SUBOOL connect;   /* TCP only: connect to host instead of listening */
+  uint64_t samp_rate;
+  uint64_t fc;
+  unsigned int depth; /* Jitter buffer size, in frames */
+};
+
+#define netiq_params_INITIALIZER {               \
+  SU_FALSE,            /* tcp */                 \
+  NULL,                /* host */                \
+  NETIQ_DEFAULT_PORT,  /* port */                \
+  SU_FALSE,            /* connect */             \
+  0,                   /* samp_rate */           \
+  0,                   /* fc */                  \
+  NETIQ_DEFAULT_DEPTH, /* depth */               \
+}
+
+enum netiq_slot_state {
+  NETIQ_SLOT_STATE_FREE,
+  NETIQ_SLOT_STATE_FILLING, /* Owned by the receiver thread */
+  NETIQ_SLOT_STATE_READY
+};
+
+struct netiq_slot {
+  enum netiq_slot_state state;
+  uint32_t seq;
+  SUSCOUNT count;
+  SUCOMPLEX *samples;
+};
+
+struct netiq_state {
+  struct netiq_params params;
+  int listen_fd;
+  int fd;
+
+  /* Exposed as block properties */
+  uint64_t samp_rate;
+  uint64_t fc;
+  uint64_t lost; /* Copy of lost_count, updated by the acquire method */
+
+  /* Receiver thread */
+  pthread_t thread;
+  SUBOOL thread_running;
+  SUBOOL halting;
+  SUBOOL eos;
+  uint8_t *frame;
+
+  /* Jitter buffer */
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+  SUBOOL sync_init;
+  struct netiq_slot *slots;
+  SUBOOL   started;   /* First frame received */
+  SUBOOL   reading;   /* Acquire is copying from the next slot */
+  uint64_t lost_count;
+  uint32_t next_seq;  /* Next frame to deliver */
+  uint32_t skip_to;   /* Frames before this one must be discarded */
+  uint32_t last_seq;  /* Most recent frame received */
+  SUSCOUNT last_count;
+  SUSCOUNT ptr;       /* Position inside the frame being delivered */
+  struct timespec wait_start;
+  SUBOOL waiting;
+};
+
+SUBOOL suscan_netiq_source_init(void);
+
+#endif /* _ANALYZER_SOURCES_NETIQ_H */
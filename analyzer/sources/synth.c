@@ -0,0 +1,767 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define SU_LOG_DOMAIN "synth"
+
+#include "source.h"
+#include "synth.h"
+
+/*
+ * Synthetic signal source. Everything it generates depends on the seed
+ * only, so two runs with the same configuration produce exactly the same
+ * samples. Symbols are joined with raised cosine transitions instead of
+ * being pulse-shaped: spectra are close enough to the real thing for
+ * detector benchmarks, at a constant cost per sample and channel.
+ */
+
+/* Average power of a raised cosine interpolation of unit power symbols */
+#define SYNTH_INTERP_POWER .75
+
+SUPRIVATE const char *synth_kind_names[SYNTH_CHANNEL_KIND_COUNT] = {
+    "bpsk", "qpsk", "8psk", "fsk", "noise"
+};
+
+/***************************** Random numbers ********************************/
+SUPRIVATE void
+synth_rng_init(struct synth_rng *rng, uint64_t seed)
+{
+  /* Splitmix64 step, so that consecutive seeds give unrelated sequences */
+  seed += 0x9e3779b97f4a7c15ull;
+  seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+  seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+  seed ^= seed >> 31;
+
+  rng->state = seed != 0 ? seed : 1;
+  rng->have_spare = SU_FALSE;
+}
+
+SUINLINE uint64_t
+synth_rng_next(struct synth_rng *rng)
+{
+  /* xorshift64* */
+  rng->state ^= rng->state >> 12;
+  rng->state ^= rng->state << 25;
+  rng->state ^= rng->state >> 27;
+
+  return rng->state * 0x2545f4914f6cdd1dull;
+}
+
+/* Uniform in (0, 1] */
+SUINLINE SUFLOAT
+synth_rng_uniform(struct synth_rng *rng)
+{
+  return ((synth_rng_next(rng) >> 11) + 1) * (1. / 9007199254740992.);
+}
+
+/* Standard normal, Box-Muller */
+SUPRIVATE SUFLOAT
+synth_rng_gauss(struct synth_rng *rng)
+{
+  SUFLOAT r, theta;
+
+  if (rng->have_spare) {
+    rng->have_spare = SU_FALSE;
+    return rng->spare;
+  }
+
+  r = SU_SQRT(-2 * log(synth_rng_uniform(rng)));
+  theta = 2 * PI * synth_rng_uniform(rng);
+
+  rng->spare = r * SU_SIN(theta);
+  rng->have_spare = SU_TRUE;
+
+  return r * SU_COS(theta);
+}
+
+/* Complex gaussian with unit variance */
+SUINLINE SUCOMPLEX
+synth_rng_cgauss(struct synth_rng *rng)
+{
+  return M_SQRT1_2 * (synth_rng_gauss(rng) + I * synth_rng_gauss(rng));
+}
+
+/****************************** Channels *************************************/
+SUPRIVATE SUBOOL
+synth_channel_kind_from_string(
+    const char *string,
+    enum synth_channel_kind *kind)
+{
+  unsigned int i;
+
+  for (i = 0; i < SYNTH_CHANNEL_KIND_COUNT; ++i)
+    if (strcasecmp(string, synth_kind_names[i]) == 0) {
+      *kind = i;
+      return SU_TRUE;
+    }
+
+  return SU_FALSE;
+}
+
+SUPRIVATE SUCOMPLEX
+synth_channel_next_symbol(struct synth_channel *channel)
+{
+  uint64_t r;
+
+  switch (channel->params.kind) {
+    case SYNTH_CHANNEL_KIND_BPSK:
+      return (synth_rng_next(&channel->rng) >> 63) ? 1 : -1;
+
+    case SYNTH_CHANNEL_KIND_QPSK:
+      r = synth_rng_next(&channel->rng) >> 62;
+      return SU_C_EXP(I * (PI / 4 + r * PI / 2));
+
+    case SYNTH_CHANNEL_KIND_8PSK:
+      r = synth_rng_next(&channel->rng) >> 61;
+      return SU_C_EXP(I * (r * PI / 4));
+
+    case SYNTH_CHANNEL_KIND_FSK:
+      return synth_rng_next(&channel->rng) >> 63;
+
+    case SYNTH_CHANNEL_KIND_NOISE:
+      return synth_rng_cgauss(&channel->rng);
+  }
+
+  return 0;
+}
+
+SUPRIVATE void
+synth_channel_destroy(struct synth_channel *channel)
+{
+  free(channel);
+}
+
+/* Offset is the channel frequency relative to the current tuning */
+SUPRIVATE void
+synth_channel_tune(
+    struct synth_channel *channel,
+    SUFLOAT offset,
+    uint64_t samp_rate)
+{
+  SUFLOAT bw = channel->params.bw;
+  SUFLOAT baud = channel->params.baud;
+  SUFLOAT dev;
+
+  /* Channels crossing the band edges would show up aliased */
+  channel->visible = SU_ABS(offset) + .5 * bw < .5 * samp_rate;
+
+  channel->lo_step = SU_C_EXP(I * 2 * PI * offset / samp_rate);
+
+  if (channel->params.kind == SYNTH_CHANNEL_KIND_FSK) {
+    dev = SU_MAX(.5 * (bw - baud), .25 * baud);
+    channel->fsk_step[0] = SU_C_EXP(I * 2 * PI * (offset - dev) / samp_rate);
+    channel->fsk_step[1] = SU_C_EXP(I * 2 * PI * (offset + dev) / samp_rate);
+  }
+}
+
+SUPRIVATE struct synth_channel *
+synth_channel_new(
+    const struct synth_channel_params *params,
+    uint64_t samp_rate,
+    uint64_t seed)
+{
+  struct synth_channel *new = NULL;
+  SUFLOAT bw, power;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(struct synth_channel)), goto fail);
+
+  new->params = *params;
+
+  if (new->params.baud <= 0 || new->params.baud >= samp_rate) {
+    SU_ERROR("Invalid baud rate %lg for synthetic channel\n", params->baud);
+    goto fail;
+  }
+
+  synth_rng_init(&new->rng, seed);
+
+  /* Default bandwidths */
+  bw = params->bw;
+  if (bw <= 0)
+    switch (params->kind) {
+      case SYNTH_CHANNEL_KIND_FSK:
+        bw = 2 * params->baud;
+        break;
+
+      default:
+        bw = params->baud;
+    }
+
+  new->params.bw = bw;
+
+  /* Noise channels are just band-limited noise of width bw */
+  if (params->kind == SYNTH_CHANNEL_KIND_NOISE)
+    new->sym_incr = bw / samp_rate;
+  else
+    new->sym_incr = params->baud / samp_rate;
+
+  new->lo = 1;
+  synth_channel_tune(new, params->fc, samp_rate);
+
+  power = params->kind == SYNTH_CHANNEL_KIND_FSK ? 1 : SYNTH_INTERP_POWER;
+
+  /* Noise floor inside the channel, scaled by the requested SNR */
+  new->amplitude = SU_SQRT(
+      SU_POW(10., params->snr / 10.)
+      * SYNTH_NOISE_AMPLITUDE * SYNTH_NOISE_AMPLITUDE
+      * bw / samp_rate
+      / power);
+
+  new->prev = synth_channel_next_symbol(new);
+  new->next = synth_channel_next_symbol(new);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    synth_channel_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE void
+synth_channel_add(
+    struct synth_channel *channel,
+    SUCOMPLEX *buffer,
+    SUSCOUNT size,
+    SUBOOL renorm)
+{
+  SUSCOUNT i;
+  SUFLOAT w;
+
+  if (channel->params.kind == SYNTH_CHANNEL_KIND_FSK) {
+    for (i = 0; i < size; ++i) {
+      if ((channel->sym_phase += channel->sym_incr) >= 1) {
+        channel->sym_phase -= 1;
+        channel->next = synth_channel_next_symbol(channel);
+      }
+
+      buffer[i] += channel->amplitude * channel->lo;
+      channel->lo *= channel->fsk_step[channel->next != 0];
+    }
+  } else {
+    for (i = 0; i < size; ++i) {
+      if ((channel->sym_phase += channel->sym_incr) >= 1) {
+        channel->sym_phase -= 1;
+        channel->prev = channel->next;
+        channel->next = synth_channel_next_symbol(channel);
+      }
+
+      w = .5 * (1 - SU_COS(PI * channel->sym_phase));
+
+      buffer[i] += channel->amplitude
+          * ((1 - w) * channel->prev + w * channel->next)
+          * channel->lo;
+      channel->lo *= channel->lo_step;
+    }
+  }
+
+  /* Keep rounding errors from changing the oscillator amplitude */
+  if (renorm)
+    channel->lo /= SU_C_ABS(channel->lo);
+}
+
+/****************************** Source state *********************************/
+SUPRIVATE void
+synth_state_destroy(struct synth_state *state)
+{
+  unsigned int i;
+
+  for (i = 0; i < state->channel_count; ++i)
+    if (state->channel_list[i] != NULL)
+      synth_channel_destroy(state->channel_list[i]);
+
+  if (state->channel_list != NULL)
+    free(state->channel_list);
+
+  free(state);
+}
+
+SUPRIVATE void
+synth_state_tune(struct synth_state *state, uint64_t fc)
+{
+  SUFLOAT delta = (SUFLOAT) ((int64_t) state->fc0 - (int64_t) fc);
+  unsigned int i;
+
+  state->fc = fc;
+
+  for (i = 0; i < state->channel_count; ++i)
+    synth_channel_tune(
+        state->channel_list[i],
+        state->channel_list[i]->params.fc + delta,
+        state->samp_rate);
+}
+
+SUPRIVATE SUBOOL
+synth_state_add_channel(
+    struct synth_state *state,
+    const struct synth_channel_params *params,
+    uint64_t seed)
+{
+  struct synth_channel *channel = NULL;
+
+  SU_TRYCATCH(
+      channel = synth_channel_new(
+          params,
+          state->samp_rate,
+          seed + state->channel_count + 1),
+      goto fail);
+
+  SU_TRYCATCH(PTR_LIST_APPEND_CHECK(state->channel, channel) != -1, goto fail);
+
+  return SU_TRUE;
+
+fail:
+  if (channel != NULL)
+    synth_channel_destroy(channel);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE SUBOOL
+synth_state_parse_channels(
+    struct synth_state *state,
+    const char *spec,
+    uint64_t seed)
+{
+  struct synth_channel_params params;
+  char *copy = NULL;
+  char *entry, *field;
+  char *save_entry, *save_field;
+  unsigned int n;
+  SUFLOAT *values[4];
+  SUBOOL ok = SU_FALSE;
+
+  values[0] = &params.fc;
+  values[1] = &params.baud;
+  values[2] = &params.snr;
+  values[3] = &params.bw;
+
+  SU_TRYCATCH(copy = strdup(spec), goto done);
+
+  for (entry = strtok_r(copy, ";", &save_entry);
+      entry != NULL;
+      entry = strtok_r(NULL, ";", &save_entry)) {
+    memset(&params, 0, sizeof(struct synth_channel_params));
+
+    if ((field = strtok_r(entry, ":", &save_field)) == NULL
+        || !synth_channel_kind_from_string(field, &params.kind)) {
+      SU_ERROR("Invalid synthetic channel kind in `%s'\n", entry);
+      goto done;
+    }
+
+    for (n = 0; n < 4; ++n) {
+      if ((field = strtok_r(NULL, ":", &save_field)) == NULL)
+        break;
+
+      if (sscanf(field, SUFLOAT_FMT, values[n]) < 1) {
+        SU_ERROR("Invalid synthetic channel parameter `%s'\n", field);
+        goto done;
+      }
+    }
+
+    if (n < 3) {
+      SU_ERROR("Synthetic channels must be given as kind:fc:baud:snr[:bw]\n");
+      goto done;
+    }
+
+    SU_TRYCATCH(synth_state_add_channel(state, &params, seed), goto done);
+  }
+
+  ok = SU_TRUE;
+
+done:
+  if (copy != NULL)
+    free(copy);
+
+  return ok;
+}
+
+/* Spread channels evenly over the span, with random parameters */
+SUPRIVATE SUBOOL
+synth_state_make_random_channels(
+    struct synth_state *state,
+    unsigned int count,
+    uint64_t span,
+    uint64_t seed)
+{
+  static const SUFLOAT bauds[] = {300, 1200, 2400, 4800, 9600, 19200};
+  struct synth_channel_params params;
+  struct synth_rng rng;
+  SUFLOAT slot;
+  unsigned int i, j;
+
+  if (count == 0)
+    return SU_TRUE;
+
+  synth_rng_init(&rng, seed);
+
+  slot = .8 * span / count;
+
+  for (i = 0; i < count; ++i) {
+    params.kind = i % SYNTH_CHANNEL_KIND_COUNT;
+    params.fc   = -.4 * span + (i + .5) * slot
+        + .1 * slot * (synth_rng_uniform(&rng) - .5);
+    params.snr  = 10 + 15 * synth_rng_uniform(&rng);
+    params.bw   = 0;
+
+    /* Fastest baud rate that leaves some room between channels */
+    params.baud = 0;
+    j = synth_rng_next(&rng) % (sizeof(bauds) / sizeof(bauds[0]));
+    do {
+      if (2 * bauds[j] < .6 * slot) {
+        params.baud = bauds[j];
+        break;
+      }
+    } while (j-- > 0);
+
+    if (params.baud == 0)
+      params.baud = .25 * slot;
+
+    SU_TRYCATCH(synth_state_add_channel(state, &params, seed), return SU_FALSE);
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE struct synth_state *
+synth_state_new(const struct synth_params *params)
+{
+  struct synth_state *new = NULL;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(struct synth_state)), goto fail);
+
+  if (params->samp_rate == 0) {
+    SU_ERROR("Invalid sample rate for synthetic source\n");
+    goto fail;
+  }
+
+  new->samp_rate = params->samp_rate;
+  new->fc = params->fc;
+  new->fc0 = params->fc;
+  new->throttle = params->throttle;
+  new->settle = params->settle;
+
+  synth_rng_init(&new->noise, params->seed);
+
+  if (params->channels != NULL && *params->channels != '\0') {
+    SU_TRYCATCH(
+        synth_state_parse_channels(new, params->channels, params->seed),
+        goto fail);
+  } else {
+    SU_TRYCATCH(
+        synth_state_make_random_channels(
+            new,
+            params->count,
+            params->span > 0 ? params->span : params->samp_rate,
+            params->seed),
+        goto fail);
+  }
+
+  return new;
+
+fail:
+  if (new != NULL)
+    synth_state_destroy(new);
+
+  return NULL;
+}
+
+/****************************** Block class **********************************/
+SUPRIVATE void
+su_block_synth_dtor(void *private)
+{
+  struct synth_state *state = (struct synth_state *) private;
+
+  synth_state_destroy(state);
+}
+
+SUPRIVATE SUBOOL
+su_block_synth_ctor(struct sigutils_block *block, void **private, va_list ap)
+{
+  struct synth_state *state = NULL;
+  const struct synth_params *params;
+
+  params = va_arg(ap, const struct synth_params *);
+
+  if ((state = synth_state_new(params)) == NULL) {
+    SU_ERROR("Create synthetic source state failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "samp_rate",
+      &state->samp_rate)) {
+    SU_ERROR("Expose samp_rate failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "fc",
+      &state->fc)) {
+    SU_ERROR("Expose fc failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_BOOL,
+      "throttle",
+      &state->throttle)) {
+    SU_ERROR("Expose throttle failed\n");
+    goto fail;
+  }
+
+  *private = state;
+
+  return SU_TRUE;
+
+fail:
+  if (state != NULL)
+    synth_state_destroy(state);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE SUSDIFF
+su_block_synth_acquire(
+    void *priv,
+    su_stream_t *out,
+    unsigned int port_id,
+    su_block_port_t *in)
+{
+  struct synth_state *state = (struct synth_state *) priv;
+  SUCOMPLEX *start;
+  SUSDIFF size;
+  SUSDIFF i;
+  SUBOOL renorm;
+  unsigned int j;
+
+  size = SU_MIN(SYNTH_BUFFER_SIZE, out->size);
+
+  /* Tuner transient: a louder noise burst, without channels */
+  if (state->settle_left > 0) {
+    size = su_stream_get_contiguous(
+        out,
+        &start,
+        SU_MIN(size, state->settle_left));
+
+    for (i = 0; i < size; ++i)
+      start[i] = SYNTH_SETTLE_NOISE_GAIN * SYNTH_NOISE_AMPLITUDE
+          * synth_rng_cgauss(&state->noise);
+
+    state->settle_left -= size;
+
+    goto done;
+  }
+
+  size = su_stream_get_contiguous(out, &start, size);
+
+  /* Noise floor first, then every channel on top of it */
+  for (i = 0; i < size; ++i)
+    start[i] = SYNTH_NOISE_AMPLITUDE * synth_rng_cgauss(&state->noise);
+
+  renorm = (state->samp_count / SYNTH_RENORM_INTERVAL)
+      != ((state->samp_count + size) / SYNTH_RENORM_INTERVAL);
+
+  for (j = 0; j < state->channel_count; ++j)
+    if (state->channel_list[j]->visible)
+      synth_channel_add(state->channel_list[j], start, size, renorm);
+
+  state->samp_count += size;
+
+done:
+  if (su_stream_advance_contiguous(out, size) != size) {
+    SU_ERROR("Unexpected size after su_stream_advance_contiguous\n");
+    return -1;
+  }
+
+  return size;
+}
+
+struct sigutils_block_class su_block_class_SYNTH = {
+    "synth",   /* name */
+    0,         /* in_size */
+    1,         /* out_size */
+    su_block_synth_ctor,     /* constructor */
+    su_block_synth_dtor,     /* destructor */
+    su_block_synth_acquire,  /* acquire */
+};
+
+/****************************** Source API ***********************************/
+/* Simulated tuner. Called from the source worker, between reads */
+SUPRIVATE SUBOOL
+suscan_synth_source_retune(
+    su_block_t *block,
+    const struct suscan_source_tuning *tuning)
+{
+  struct synth_state *state = (struct synth_state *) block->private;
+
+  if ((tuning->mask & SUSCAN_SOURCE_TUNING_SAMP_RATE)
+      && tuning->samp_rate != state->samp_rate) {
+    SU_ERROR("Cannot change sample rate of synthetic source\n");
+    return SU_FALSE;
+  }
+
+  if (tuning->mask & SUSCAN_SOURCE_TUNING_FC) {
+    synth_state_tune(state, tuning->fc);
+    state->settle_left = state->settle;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE su_block_t *
+suscan_synth_source_ctor(const struct suscan_source_config *config)
+{
+  struct synth_params params = synth_params_INITIALIZER;
+  const struct suscan_field_value *value;
+
+  if ((value = suscan_source_config_get_value(config, "fs")) == NULL)
+    return NULL;
+  if (value->set)
+    params.samp_rate = value->as_int;
+
+  if ((value = suscan_source_config_get_value(config, "fc")) == NULL)
+    return NULL;
+  if (value->set)
+    params.fc = value->as_int;
+
+  if ((value = suscan_source_config_get_value(config, "seed")) == NULL)
+    return NULL;
+  if (value->set)
+    params.seed = value->as_int;
+
+  if ((value = suscan_source_config_get_value(config, "count")) == NULL)
+    return NULL;
+  if (value->set)
+    params.count = value->as_int;
+
+  if ((value = suscan_source_config_get_value(config, "span")) == NULL)
+    return NULL;
+  if (value->set)
+    params.span = value->as_int;
+
+  if ((value = suscan_source_config_get_value(config, "channels")) == NULL)
+    return NULL;
+  if (value->set)
+    params.channels = value->as_string;
+
+  if ((value = suscan_source_config_get_value(config, "throttle")) == NULL)
+    return NULL;
+  if (value->set)
+    params.throttle = value->as_bool;
+
+  if ((value = suscan_source_config_get_value(config, "settle")) == NULL)
+    return NULL;
+  if (value->set)
+    params.settle = value->as_int;
+
+  return su_block_new("synth", &params);
+}
+
+SUBOOL
+suscan_synth_source_init(void)
+{
+  struct suscan_source *source = NULL;
+
+  if (!su_block_class_register(&su_block_class_SYNTH))
+    return SU_FALSE;
+
+  if ((source = suscan_source_register(
+      "synth",
+      "Synthetic signal generator",
+      suscan_synth_source_ctor)) == NULL)
+    return SU_FALSE;
+
+  source->retune = suscan_synth_source_retune;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "fs",
+      "Sampling frequency"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "fc",
+      "Center frequency"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "seed",
+      "Random seed"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "count",
+      "Number of random channels"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "span",
+      "Bandwidth of random channels"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_STRING,
+      SU_TRUE,
+      "channels",
+      "Channel list (kind:fc:baud:snr[:bw];...)"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_BOOLEAN,
+      SU_TRUE,
+      "throttle",
+      "Deliver samples at the nominal rate"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "settle",
+      "Samples of tuner transient after a retune"))
+    return SU_FALSE;
+
+  return SU_TRUE;
+}
@@ -0,0 +1,125 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _ANALYZER_SOURCES_SYNTH_H
+#define _ANALYZER_SOURCES_SYNTH_H
+
+#include <sigutils/sigutils.h>
+#include <util.h>
+
+#define SYNTH_DEFAULT_SAMP_RATE  250000
+#define SYNTH_DEFAULT_SEED       0x5eed5eedull
+#define SYNTH_DEFAULT_COUNT      4
+#define SYNTH_BUFFER_SIZE        4096
+#define SYNTH_NOISE_AMPLITUDE    1e-2 /* RMS of the complex noise floor */
+#define SYNTH_RENORM_INTERVAL    1024 /* Oscillator renormalization period */
+#define SYNTH_SETTLE_NOISE_GAIN  10   /* Of the noise burst after a retune */
+
+/*
+ * Channels are described by a semicolon-separated list of
+ * kind:fc:baud:snr[:bw] entries, e.g. "bpsk:10000:2400:20;fsk:-30000:1200:15"
+ * fc is relative to the initial center frequency, snr is in dB. For noise
+ * channels, baud is the bandwidth unless bw is given.
+ *
+ * The source can be retuned like a real tuner: channels stay at the
+ * same absolute frequency, and only those inside the band are generated.
+ * Channels may be placed outside the initial band, to be found by a
+ * wideband sweep.
+ */
+enum synth_channel_kind {
+  SYNTH_CHANNEL_KIND_BPSK,
+  SYNTH_CHANNEL_KIND_QPSK,
+  SYNTH_CHANNEL_KIND_8PSK,
+  SYNTH_CHANNEL_KIND_FSK,
+  SYNTH_CHANNEL_KIND_NOISE
+};
+
+#define SYNTH_CHANNEL_KIND_COUNT 5
+
+struct synth_channel_params {
+  enum synth_channel_kind kind;
+  SUFLOAT fc;   /* Hz, relative to center frequency */
+  SUFLOAT baud;
+  SUFLOAT bw;   /* Hz, 0 means default for this kind */
+  SUFLOAT snr;  /* dB, measured inside the channel bandwidth */
+};
+
+struct synth_rng {
+  uint64_t state;
+  SUBOOL   have_spare;
+  SUFLOAT  spare;
+};
+
+struct synth_channel {
+  struct synth_channel_params params;
+  struct synth_rng rng;
+  SUFLOAT amplitude;
+  SUBOOL  visible;    /* Inside the band of the current tuning */
+
+  SUCOMPLEX lo;       /* Carrier phasor */
+  SUCOMPLEX lo_step;
+
+  SUFLOAT sym_phase;  /* Position inside the current symbol, [0, 1) */
+  SUFLOAT sym_incr;
+  SUCOMPLEX prev;     /* Symbols being interpolated */
+  SUCOMPLEX next;
+
+  SUCOMPLEX fsk_step[2];
+};
+
+struct synth_params {
+  uint64_t samp_rate;
+  uint64_t fc;
+  uint64_t seed;
+  unsigned int count;   /* Random channels, if no channel list was given */
+  uint64_t span;        /* Of random channels. 0: sample rate */
+  const char *channels;
+  SUBOOL throttle;
+  SUSCOUNT settle;      /* Samples of tuner transient after a retune */
+};
+
+#define synth_params_INITIALIZER {     \
+  SYNTH_DEFAULT_SAMP_RATE, /* samp_rate */ \
+  0,                       /* fc */        \
+  SYNTH_DEFAULT_SEED,      /* seed */      \
+  SYNTH_DEFAULT_COUNT,     /* count */     \
+  0,                       /* span */      \
+  NULL,                    /* channels */  \
+  SU_TRUE,                 /* throttle */  \
+  0,                       /* settle */    \
+}
+
+struct synth_state {
+  uint64_t samp_rate;
+  uint64_t fc;
+  uint64_t fc0;         /* Channel frequencies are relative to this one */
+  SUBOOL   throttle;
+  SUSCOUNT samp_count;
+  SUSCOUNT settle;
+  SUSCOUNT settle_left; /* Of the current tuner transient */
+
+  struct synth_rng noise;
+
+  PTR_LIST(struct synth_channel, channel);
+};
+
+SUBOOL suscan_synth_source_init(void);
+
+#endif /* _ANALYZER_SOURCES_SYNTH_H */
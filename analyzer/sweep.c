@@ -0,0 +1,282 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SU_LOG_DOMAIN "sweep"
+
+#include "sweep.h"
+#include "throttle.h"
+
+SUPRIVATE void
+suscan_sweep_clear_channels(suscan_sweep_t *sweep)
+{
+  unsigned int i;
+
+  for (i = 0; i < sweep->channel_count; ++i)
+    if (sweep->channel_list[i] != NULL)
+      su_channel_destroy(sweep->channel_list[i]);
+
+  if (sweep->channel_list != NULL)
+    free(sweep->channel_list);
+
+  sweep->channel_list = NULL;
+  sweep->channel_count = 0;
+}
+
+void
+suscan_sweep_destroy(suscan_sweep_t *sweep)
+{
+  suscan_sweep_clear_channels(sweep);
+
+  if (sweep->psd != NULL)
+    free(sweep->psd);
+
+  free(sweep);
+}
+
+suscan_sweep_t *
+suscan_sweep_new(
+    const struct suscan_sweep_params *params,
+    const struct sigutils_channel_detector_params *det_params)
+{
+  suscan_sweep_t *new = NULL;
+  unsigned int decimation;
+  SUFLOAT half;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_sweep_t)), goto fail);
+
+  new->params = *params;
+
+  if (params->fc_max < params->fc_min) {
+    SU_ERROR("Invalid sweep range\n");
+    goto fail;
+  }
+
+  if (params->dwell <= 0 || params->settle < 0) {
+    SU_ERROR("Invalid sweep timing\n");
+    goto fail;
+  }
+
+  decimation = det_params->decimation > 1 ? det_params->decimation : 1;
+
+  new->fs  = (SUFLOAT) det_params->samp_rate / decimation;
+  new->rbw = new->fs / det_params->window_size;
+  half = .5 * SUSCAN_SWEEP_USABLE_BW * new->fs;
+
+  if (new->params.step == 0)
+    new->params.step = SU_FLOOR(2 * half);
+
+  if (new->params.step == 0) {
+    SU_ERROR("Sample rate too low for sweeping\n");
+    goto fail;
+  }
+
+  new->step_count =
+      (params->fc_max - params->fc_min) / new->params.step + 1;
+
+  if (new->step_count > SUSCAN_SWEEP_MAX_STEPS) {
+    SU_ERROR("Too many sweep steps (%u)\n", new->step_count);
+    goto fail;
+  }
+
+  /* Every step needs at least a full detector window */
+  new->settle_samples = params->settle * det_params->samp_rate;
+  new->dwell_samples  = params->dwell * det_params->samp_rate;
+  if (new->dwell_samples < det_params->window_size * decimation)
+    new->dwell_samples = det_params->window_size * decimation;
+
+  new->f_start  = (SUFLOAT) params->fc_min - half;
+  new->psd_size = SU_CEIL(
+      ((new->step_count - 1) * (SUFLOAT) new->params.step + 2 * half)
+      / new->rbw);
+
+  SU_TRYCATCH(
+      new->psd = calloc(new->psd_size, sizeof(SUFLOAT)),
+      goto fail);
+
+  new->state = SUSCAN_SWEEP_STATE_RETUNING;
+
+  clock_gettime(CLOCK_MONOTONIC, &new->t_start);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_sweep_destroy(new);
+
+  return NULL;
+}
+
+uint64_t
+suscan_sweep_get_fc(const suscan_sweep_t *sweep)
+{
+  return sweep->params.fc_min + sweep->step * sweep->params.step;
+}
+
+void
+suscan_sweep_begin_step(suscan_sweep_t *sweep)
+{
+  if (sweep->settle_samples > 0) {
+    sweep->state = SUSCAN_SWEEP_STATE_SETTLING;
+    sweep->left  = sweep->settle_samples;
+  } else {
+    sweep->state = SUSCAN_SWEEP_STATE_DWELLING;
+    sweep->left  = sweep->dwell_samples;
+  }
+}
+
+SUPRIVATE SUBOOL
+suscan_sweep_add_channel(
+    suscan_sweep_t *sweep,
+    const struct sigutils_channel *channel,
+    SUFLOAT fc)
+{
+  struct sigutils_channel *new = NULL;
+  unsigned int i;
+
+  /* Channels seen by two overlapping steps are kept once */
+  for (i = 0; i < sweep->channel_count; ++i)
+    if (SU_ABS(sweep->channel_list[i]->fc - (channel->fc + fc))
+        < .5 * channel->bw)
+      return SU_TRUE;
+
+  SU_TRYCATCH(new = su_channel_dup(channel), goto fail);
+
+  new->fc   += fc;
+  new->f_lo += fc;
+  new->f_hi += fc;
+  new->ft    = fc;
+
+  SU_TRYCATCH(PTR_LIST_APPEND_CHECK(sweep->channel, new) != -1, goto fail);
+
+  return SU_TRUE;
+
+fail:
+  if (new != NULL)
+    su_channel_destroy(new);
+
+  return SU_FALSE;
+}
+
+SUBOOL
+suscan_sweep_end_step(
+    suscan_sweep_t *sweep,
+    const su_channel_detector_t *detector,
+    SUBOOL *done)
+{
+  struct sigutils_channel **ch_list;
+  unsigned int ch_count;
+  struct timespec now, sub;
+  SUSCOUNT size = detector->params.window_size;
+  SUFLOAT fc = suscan_sweep_get_fc(sweep);
+  SUFLOAT half = .5 * SUSCAN_SWEEP_USABLE_BW * sweep->fs;
+  SUFLOAT f, elapsed;
+  SUSDIFF k;
+  SUSDIFF idx;
+  unsigned int i;
+
+  /* First step: channels of the previous sweep were already sent */
+  if (sweep->step == 0) {
+    suscan_sweep_clear_channels(sweep);
+    sweep->N0 = 0;
+  }
+
+  /* Detector spectrum is in FFT order: DC first, negative half last */
+  for (i = 0; i < size; ++i) {
+    k = i < size / 2 ? (SUSDIFF) i : (SUSDIFF) i - (SUSDIFF) size;
+    f = k * sweep->rbw;
+
+    if (SU_ABS(f) > half)
+      continue;
+
+    idx = SU_FLOOR((fc + f - sweep->f_start) / sweep->rbw + .5);
+    if (idx >= 0 && idx < sweep->psd_size)
+      sweep->psd[idx] = detector->spect[i];
+  }
+
+  su_channel_detector_get_channel_list(detector, &ch_list, &ch_count);
+
+  for (i = 0; i < ch_count; ++i)
+    if (ch_list[i] != NULL
+        && SU_CHANNEL_IS_VALID(ch_list[i])
+        && SU_ABS(ch_list[i]->fc) <= half)
+      SU_TRYCATCH(
+          suscan_sweep_add_channel(sweep, ch_list[i], fc),
+          return SU_FALSE);
+
+  sweep->N0 += detector->N0 / sweep->step_count;
+
+  sweep->state = SUSCAN_SWEEP_STATE_RETUNING;
+  *done = SU_FALSE;
+
+  if (++sweep->step == sweep->step_count) {
+    sweep->step = 0;
+    ++sweep->sweep_count;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    timespecsub(&now, &sweep->t_start, &sub);
+    elapsed = sub.tv_sec + 1e-9 * sub.tv_nsec;
+    sweep->t_start = now;
+
+    if (elapsed > 0) {
+      if (sweep->sweep_count == 1)
+        sweep->sweep_rate = 1. / elapsed;
+      else
+        sweep->sweep_rate +=
+            SUSCAN_SWEEP_RATE_ALPHA * (1. / elapsed - sweep->sweep_rate);
+    }
+
+    *done = SU_TRUE;
+  }
+
+  return SU_TRUE;
+}
+
+void
+suscan_sweep_get_psd(const suscan_sweep_t *sweep, SUFLOAT *psd)
+{
+  SUSCOUNT center = sweep->psd_size / 2;
+  SUSCOUNT i;
+
+  for (i = 0; i < sweep->psd_size; ++i)
+    psd[i] = sweep->psd[(i + center) % sweep->psd_size];
+}
+
+SUFLOAT
+suscan_sweep_get_center(const suscan_sweep_t *sweep)
+{
+  return sweep->f_start + (sweep->psd_size / 2) * sweep->rbw;
+}
+
+void
+suscan_sweep_take_channels(
+    suscan_sweep_t *sweep,
+    struct sigutils_channel ***pchannel_list,
+    unsigned int *pchannel_count)
+{
+  *pchannel_list = sweep->channel_list;
+  *pchannel_count = sweep->channel_count;
+
+  sweep->channel_list = NULL;
+  sweep->channel_count = 0;
+}
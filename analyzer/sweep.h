@@ -0,0 +1,131 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _SWEEP_H
+#define _SWEEP_H
+
+#include <stdint.h>
+#include <time.h>
+#include <util.h>
+#include <sigutils/sigutils.h>
+#include <sigutils/detect.h>
+
+/*
+ * Wideband sweep. The source is retuned in steps from fc_min to fc_max.
+ * After each retune, samples taken while the tuner settles are discarded
+ * and the following ones are fed to a fresh channel detector. The center
+ * of each step's spectrum is then copied into a wideband spectrum, and
+ * the channels found there are kept with absolute frequencies.
+ */
+#define SUSCAN_SWEEP_USABLE_BW   .75 /* Of the band, edges are filtered out */
+#define SUSCAN_SWEEP_MAX_STEPS   4096
+#define SUSCAN_SWEEP_RATE_ALPHA  .25 /* Sweep rate smoothing */
+
+struct suscan_sweep_params {
+  uint64_t fc_min; /* Center frequency of the first step (Hz) */
+  uint64_t fc_max; /* Last center frequency, at most (Hz) */
+  uint64_t step;   /* Between center frequencies. 0: usable bandwidth */
+  SUFLOAT  dwell;  /* Seconds of samples analyzed in every step */
+  SUFLOAT  settle; /* Seconds of samples discarded after every retune */
+};
+
+#define suscan_sweep_params_INITIALIZER { \
+  0,   /* fc_min */                       \
+  0,   /* fc_max */                       \
+  0,   /* step */                         \
+  .05, /* dwell */                        \
+  .005 /* settle */                       \
+}
+
+enum suscan_sweep_state {
+  SUSCAN_SWEEP_STATE_RETUNING, /* Samples still have the previous tuning */
+  SUSCAN_SWEEP_STATE_SETTLING, /* Discarding samples */
+  SUSCAN_SWEEP_STATE_DWELLING  /* Feeding the channel detector */
+};
+
+struct suscan_sweep {
+  struct suscan_sweep_params params;
+  enum suscan_sweep_state state;
+
+  SUFLOAT  fs;       /* Of the channel detector spectrum */
+  SUFLOAT  rbw;      /* Bin width */
+  SUSCOUNT settle_samples;
+  SUSCOUNT dwell_samples;
+  SUSCOUNT left;     /* Samples left in the current state */
+
+  unsigned int step_count;
+  unsigned int step; /* Current step */
+
+  /* Wideband spectrum, lowest frequency first */
+  SUFLOAT  f_start;  /* Frequency of the first bin */
+  SUFLOAT *psd;
+  SUSCOUNT psd_size;
+  SUFLOAT  N0;       /* Averaged over steps */
+
+  PTR_LIST(struct sigutils_channel, channel); /* Absolute frequencies */
+
+  uint32_t sweep_count; /* Sweeps completed */
+  SUFLOAT  sweep_rate;  /* Sweeps per second (wall clock) */
+  struct timespec t_start; /* Of the current sweep */
+};
+
+typedef struct suscan_sweep suscan_sweep_t;
+
+/* Detector parameters give the sample rate and resolution of each step */
+suscan_sweep_t *suscan_sweep_new(
+    const struct suscan_sweep_params *params,
+    const struct sigutils_channel_detector_params *det_params);
+
+void suscan_sweep_destroy(suscan_sweep_t *sweep);
+
+/* Center frequency of the current step */
+uint64_t suscan_sweep_get_fc(const suscan_sweep_t *sweep);
+
+/* Called once the first samples of the current step arrive */
+void suscan_sweep_begin_step(suscan_sweep_t *sweep);
+
+/*
+ * Copies the spectrum and channels of a detector fed with the current
+ * step and moves to the next one. Returns SU_TRUE in *done if that
+ * completed a sweep.
+ */
+SUBOOL suscan_sweep_end_step(
+    suscan_sweep_t *sweep,
+    const su_channel_detector_t *detector,
+    SUBOOL *done);
+
+/* Wideband spectrum in FFT order, centered at the middle of the span */
+void suscan_sweep_get_psd(const suscan_sweep_t *sweep, SUFLOAT *psd);
+
+SUFLOAT suscan_sweep_get_center(const suscan_sweep_t *sweep);
+
+SUINLINE SUFLOAT
+suscan_sweep_get_span(const suscan_sweep_t *sweep)
+{
+  return sweep->psd_size * sweep->rbw;
+}
+
+/* Channels of the last sweep. The sweep forgets about them */
+void suscan_sweep_take_channels(
+    suscan_sweep_t *sweep,
+    struct sigutils_channel ***pchannel_list,
+    unsigned int *pchannel_count);
+
+#endif /* _SWEEP_H */
@@ -24,6 +24,7 @@
 #include <pthread.h>
 #include <stdint.h>
 #include <time.h>
+#include <errno.h>
 
 #define SU_LOG_DOMAIN "throttle"
 
@@ -34,65 +35,90 @@ void
 suscan_throttle_init(suscan_throttle_t *throttle, SUSCOUNT samp_rate)
 {
   throttle->samp_count = 0;
-  throttle->samp_rate = samp_rate;
+  throttle->samp_rate = samp_rate > 0 ? samp_rate : 1;
 
-  clock_gettime(CLOCK_MONOTONIC_RAW, &throttle->t0);
+  clock_gettime(CLOCK_MONOTONIC, &throttle->t0);
+}
+
+void
+suscan_throttle_init_with_speed(
+    suscan_throttle_t *throttle,
+    SUSCOUNT samp_rate,
+    SUFLOAT speed)
+{
+  if (speed < SUSCAN_THROTTLE_MIN_SPEED)
+    speed = SUSCAN_THROTTLE_MIN_SPEED;
+
+  suscan_throttle_init(throttle, SU_FLOOR(samp_rate * speed + .5));
+}
+
+/* Samples that should have been delivered by time tn */
+SUPRIVATE SUSDIFF
+suscan_throttle_get_expected(
+    const suscan_throttle_t *throttle,
+    const struct timespec *tn)
+{
+  struct timespec sub;
+
+  timespecsub((struct timespec *) tn, (struct timespec *) &throttle->t0, &sub);
+
+  /* Split to avoid overflows with long runs at high sample rates */
+  return throttle->samp_rate * sub.tv_sec
+      + (throttle->samp_rate * sub.tv_nsec) / 1000000000ll;
 }
 
 SUSCOUNT
 suscan_throttle_get_portion(suscan_throttle_t *throttle, SUSCOUNT h)
 {
   struct timespec tn;
-  struct timespec sleep_time;
-  struct timespec sub;
+  struct timespec deadline;
   SUSCOUNT samps;
   SUSDIFF  nsecs;
   SUSDIFF  avail;
 
-  if (h > 0) {
-    do {
-      clock_gettime(CLOCK_MONOTONIC_RAW, &tn);
-
-      timespecsub(&tn, &throttle->t0, &sub);
-
-      if (sub.tv_sec > 0) {
-        /* Reader is really late, get a rough estimate */
-        avail = throttle->samp_rate * sub.tv_sec - throttle->samp_count;
-      } else {
-        nsecs = sub.tv_sec * 1000000000ll + sub.tv_nsec;
-        avail = (throttle->samp_rate * nsecs) / 1000000000ll
-            - throttle->samp_count;
-      }
-
-      if (avail == 0) {
-        /*
-         * Stream exhausted. We wait a fraction of the time it would take
-         * for h samples to be available, then we try again.
-         */
-        throttle->samp_count = 0;
-        throttle->t0 = tn;
-
-        samps = SUSCAN_THROTTLE_MAX_READ_UNIT_FRAC * h;
-        nsecs = (samps * 1000000000) / throttle->samp_rate;
-
-        sleep_time.tv_sec  = nsecs / 1000000000;
-        sleep_time.tv_nsec = nsecs % 1000000000;
-
-        (void) nanosleep(&sleep_time, NULL);
-        continue;
-      } else {
-        /* Check to avoid slow readers to overflow the available counter */
-        if (avail > SUSCAN_THROTTLE_RESET_THRESHOLD) {
-          throttle->samp_count = 0;
-          throttle->t0 = tn;
-        }
-
-        h = MIN(avail, h);
-      }
-    } while (SU_FALSE);
+  if (h == 0)
+    return 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &tn);
+
+  avail = suscan_throttle_get_expected(throttle, &tn) - throttle->samp_count;
+
+  if (avail > SUSCAN_THROTTLE_RESET_THRESHOLD) {
+    /* Reader is really late. Don't try to catch up, start over */
+    throttle->samp_count = 0;
+    throttle->t0 = tn;
+  } else if (avail <= 0) {
+    /*
+     * Stream exhausted. Sleep once, until a fraction of h samples is
+     * available. Absolute deadlines keep the rate exact regardless of
+     * how late we are woken up.
+     */
+    samps = SUSCAN_THROTTLE_MAX_READ_UNIT_FRAC * h;
+    if (samps == 0)
+      samps = 1;
+
+    nsecs = ((throttle->samp_count + samps) % throttle->samp_rate)
+        * 1000000000ll / throttle->samp_rate;
+
+    deadline.tv_sec  = throttle->t0.tv_sec
+        + (throttle->samp_count + samps) / throttle->samp_rate;
+    deadline.tv_nsec = throttle->t0.tv_nsec + nsecs;
+
+    if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_nsec -= 1000000000;
+      ++deadline.tv_sec;
+    }
+
+    while (clock_nanosleep(
+        CLOCK_MONOTONIC,
+        TIMER_ABSTIME,
+        &deadline,
+        NULL) == EINTR);
+
+    avail = samps;
   }
 
-  return h;
+  return MIN(avail, h);
 }
 
 void
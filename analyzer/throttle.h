@@ -30,9 +30,10 @@
  */
 #define SUSCAN_THROTTLE_RESET_THRESHOLD 1000000000ll
 #define SUSCAN_THROTTLE_MAX_READ_UNIT_FRAC .25
+#define SUSCAN_THROTTLE_MIN_SPEED .1
 
 struct suscan_throttle {
-  SUSCOUNT samp_rate;
+  SUSCOUNT samp_rate; /* Delivery rate, i.e. sample rate times speed */
   SUSCOUNT samp_count;
   struct timespec t0;
 };
@@ -56,6 +57,11 @@ timespecsub(
 
 void suscan_throttle_init(suscan_throttle_t *throttle, SUSCOUNT samp_rate);
 
+void suscan_throttle_init_with_speed(
+    suscan_throttle_t *throttle,
+    SUSCOUNT samp_rate,
+    SUFLOAT speed);
+
 SUSCOUNT suscan_throttle_get_portion(suscan_throttle_t *throttle, SUSCOUNT h);
 
 void suscan_throttle_advance(suscan_throttle_t *throttle, SUSCOUNT got);
@@ -0,0 +1,231 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "tracker"
+
+#include "tracker.h"
+
+void
+suscan_tracker_init(suscan_tracker_t *tracker)
+{
+  memset(tracker, 0, sizeof(suscan_tracker_t));
+
+  tracker->next_id = 1; /* 0 is never a valid channel ID */
+}
+
+void
+suscan_tracker_finalize(suscan_tracker_t *tracker)
+{
+  if (tracker->channel_list != NULL)
+    free(tracker->channel_list);
+
+  if (tracker->delta_list != NULL)
+    free(tracker->delta_list);
+
+  memset(tracker, 0, sizeof(suscan_tracker_t));
+}
+
+SUPRIVATE SUBOOL
+suscan_tracker_push_delta(
+    suscan_tracker_t *tracker,
+    enum suscan_channel_delta_kind kind,
+    const struct suscan_tracked_channel *tracked)
+{
+  struct suscan_channel_delta *tmp;
+  unsigned int alloc;
+
+  if (tracker->delta_count == tracker->delta_alloc) {
+    alloc = tracker->delta_alloc == 0 ? 16 : 2 * tracker->delta_alloc;
+    SU_TRYCATCH(
+        tmp = realloc(
+            tracker->delta_list,
+            alloc * sizeof(struct suscan_channel_delta)),
+        return SU_FALSE);
+
+    tracker->delta_list  = tmp;
+    tracker->delta_alloc = alloc;
+  }
+
+  tracker->delta_list[tracker->delta_count].id      = tracked->id;
+  tracker->delta_list[tracker->delta_count].kind    = kind;
+  tracker->delta_list[tracker->delta_count].channel = tracked->channel;
+  ++tracker->delta_count;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE struct suscan_tracked_channel *
+suscan_tracker_add(suscan_tracker_t *tracker)
+{
+  struct suscan_tracked_channel *tmp;
+  unsigned int alloc;
+
+  if (tracker->channel_count == tracker->channel_alloc) {
+    alloc = tracker->channel_alloc == 0 ? 16 : 2 * tracker->channel_alloc;
+    SU_TRYCATCH(
+        tmp = realloc(
+            tracker->channel_list,
+            alloc * sizeof(struct suscan_tracked_channel)),
+        return NULL);
+
+    tracker->channel_list  = tmp;
+    tracker->channel_alloc = alloc;
+  }
+
+  tmp = tracker->channel_list + tracker->channel_count++;
+  tmp->id = tracker->next_id++;
+
+  if (tracker->next_id == 0)
+    tracker->next_id = 1;
+
+  return tmp;
+}
+
+/* Nearest unmatched channel overlapping the center frequency of channel */
+SUPRIVATE struct suscan_tracked_channel *
+suscan_tracker_lookup(
+    suscan_tracker_t *tracker,
+    const struct sigutils_channel *channel)
+{
+  struct suscan_tracked_channel *best = NULL;
+  SUFLOAT best_dist = 0;
+  SUFLOAT dist;
+  SUFLOAT bw;
+  unsigned int i;
+
+  for (i = 0; i < tracker->channel_count; ++i) {
+    if (tracker->channel_list[i].matched)
+      continue;
+
+    dist = SU_ABS(tracker->channel_list[i].channel.fc - channel->fc);
+    bw   = SU_MAX(tracker->channel_list[i].channel.bw, channel->bw);
+
+    if (dist < .5 * bw && (best == NULL || dist < best_dist)) {
+      best = tracker->channel_list + i;
+      best_dist = dist;
+    }
+  }
+
+  return best;
+}
+
+SUPRIVATE SUBOOL
+suscan_tracker_channel_changed(
+    const struct sigutils_channel *old,
+    const struct sigutils_channel *new)
+{
+  SUFLOAT bw = SU_MAX(old->bw, new->bw);
+
+  return SU_ABS(old->fc - new->fc) > SUSCAN_TRACKER_FC_TOLERANCE * bw
+      || SU_ABS(old->bw - new->bw) > SUSCAN_TRACKER_BW_TOLERANCE * bw
+      || SU_ABS(old->snr - new->snr) > SUSCAN_TRACKER_SNR_TOLERANCE;
+}
+
+SUBOOL
+suscan_tracker_update(
+    suscan_tracker_t *tracker,
+    struct sigutils_channel **list,
+    unsigned int len,
+    SUFLOAT fc)
+{
+  struct suscan_tracked_channel *tracked;
+  struct sigutils_channel channel;
+  unsigned int i;
+
+  tracker->delta_count = 0;
+
+  for (i = 0; i < tracker->channel_count; ++i)
+    tracker->channel_list[i].matched = SU_FALSE;
+
+  for (i = 0; i < len; ++i) {
+    if (list[i] == NULL || !SU_CHANNEL_IS_VALID(list[i]))
+      continue;
+
+    channel = *list[i];
+    channel.fc   += fc;
+    channel.f_lo += fc;
+    channel.f_hi += fc;
+    channel.ft    = fc;
+
+    if ((tracked = suscan_tracker_lookup(tracker, &channel)) != NULL) {
+      tracked->matched = SU_TRUE;
+
+      if (suscan_tracker_channel_changed(&tracked->channel, &channel)) {
+        tracked->channel = channel;
+        SU_TRYCATCH(
+            suscan_tracker_push_delta(
+                tracker,
+                SUSCAN_CHANNEL_DELTA_UPDATE,
+                tracked),
+            return SU_FALSE);
+      }
+    } else {
+      SU_TRYCATCH(tracked = suscan_tracker_add(tracker), return SU_FALSE);
+
+      tracked->matched = SU_TRUE;
+      tracked->channel = channel;
+
+      SU_TRYCATCH(
+          suscan_tracker_push_delta(tracker, SUSCAN_CHANNEL_DELTA_ADD, tracked),
+          return SU_FALSE);
+    }
+  }
+
+  /* Channels not seen in this update are gone */
+  i = 0;
+  while (i < tracker->channel_count) {
+    if (!tracker->channel_list[i].matched) {
+      SU_TRYCATCH(
+          suscan_tracker_push_delta(
+              tracker,
+              SUSCAN_CHANNEL_DELTA_REMOVE,
+              tracker->channel_list + i),
+          return SU_FALSE);
+
+      tracker->channel_list[i] =
+          tracker->channel_list[--tracker->channel_count];
+    } else {
+      ++i;
+    }
+  }
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_tracker_snapshot(suscan_tracker_t *tracker)
+{
+  unsigned int i;
+
+  tracker->delta_count = 0;
+
+  for (i = 0; i < tracker->channel_count; ++i)
+    SU_TRYCATCH(
+        suscan_tracker_push_delta(
+            tracker,
+            SUSCAN_CHANNEL_DELTA_ADD,
+            tracker->channel_list + i),
+        return SU_FALSE);
+
+  return SU_TRUE;
+}
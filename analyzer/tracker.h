@@ -0,0 +1,90 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _TRACKER_H
+#define _TRACKER_H
+
+#include <stdint.h>
+#include <sigutils/sigutils.h>
+#include <sigutils/detect.h>
+
+/*
+ * Channel tracker. Assigns stable IDs to the channels found by the
+ * channel detector and turns consecutive channel lists into deltas. A
+ * channel keeps its ID as long as some detected channel overlaps its
+ * center frequency in every update.
+ */
+#define SUSCAN_TRACKER_FC_TOLERANCE  .02 /* Fraction of bandwidth */
+#define SUSCAN_TRACKER_BW_TOLERANCE  .05 /* Fraction of bandwidth */
+#define SUSCAN_TRACKER_SNR_TOLERANCE .5  /* dB */
+
+enum suscan_channel_delta_kind {
+  SUSCAN_CHANNEL_DELTA_ADD,
+  SUSCAN_CHANNEL_DELTA_UPDATE,
+  SUSCAN_CHANNEL_DELTA_REMOVE
+};
+
+struct suscan_channel_delta {
+  uint32_t id;
+  enum suscan_channel_delta_kind kind;
+  struct sigutils_channel channel; /* Last known state on REMOVE */
+};
+
+struct suscan_tracked_channel {
+  uint32_t id;
+  SUBOOL   matched;
+  struct sigutils_channel channel; /* As last reported */
+};
+
+struct suscan_tracker {
+  struct suscan_tracked_channel *channel_list;
+  unsigned int channel_count;
+  unsigned int channel_alloc;
+
+  struct suscan_channel_delta *delta_list; /* Deltas of the last update */
+  unsigned int delta_count;
+  unsigned int delta_alloc;
+
+  uint32_t next_id;
+};
+
+typedef struct suscan_tracker suscan_tracker_t;
+
+void suscan_tracker_init(suscan_tracker_t *tracker);
+
+/*
+ * Matches a new detector channel list (frequencies relative to fc) and
+ * leaves the differences in delta_list.
+ */
+SUBOOL suscan_tracker_update(
+    suscan_tracker_t *tracker,
+    struct sigutils_channel **list,
+    unsigned int len,
+    SUFLOAT fc);
+
+/*
+ * Leaves an ADD delta for every tracked channel in delta_list, so that
+ * receivers that lost track of the deltas can start over.
+ */
+SUBOOL suscan_tracker_snapshot(suscan_tracker_t *tracker);
+
+void suscan_tracker_finalize(suscan_tracker_t *tracker);
+
+#endif /* _TRACKER_H */
@@ -56,6 +56,7 @@ struct xsig_source {
 void xsig_source_destroy(struct xsig_source *source);
 struct xsig_source *xsig_source_new(const struct xsig_source_params *params);
 SUBOOL xsig_source_acquire(struct xsig_source *source);
+SUBOOL xsig_source_seek(struct xsig_source *source, SUFLOAT offset);
 su_block_t *xsig_source_create_block(const struct xsig_source_params *params);
 
 SUBOOL suscan_wav_source_init(void);
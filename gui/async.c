@@ -173,24 +173,180 @@ suscan_async_stopped_cb(gpointer user_data)
   return G_SOURCE_REMOVE;
 }
 
+SUPRIVATE void
+suscan_gui_update_cpu_stats(struct suscan_gui *gui)
+{
+  const struct suscan_analyzer_source *source;
+  SUFLOAT cpu = 0;
+  char cpu_str[10];
+  char stats_str[512];
+  size_t len = 0;
+  unsigned int i;
+
+  stats_str[0] = '\0';
+
+  for (i = 0; i < gui->analyzer->source_count; ++i) {
+    source = gui->analyzer->source_list[i];
+
+    /* The detect stage is the one doing the heavy lifting */
+    if (source->detect_stats.busy > cpu)
+      cpu = source->detect_stats.busy;
+
+    if (len < sizeof(stats_str))
+      len += snprintf(
+          stats_str + len,
+          sizeof(stats_str) - len,
+          "%sSource #%u\n"
+          "Acquire: %.1lf%% busy, %.1lf%% stalled\n"
+          "Detect: %.1lf%% busy, %.1lf%% stalled\n"
+          "Block size: %lu samples",
+          i > 0 ? "\n" : "",
+          i,
+          source->acquire_stats.busy * 100,
+          source->acquire_stats.stall * 100,
+          source->detect_stats.busy * 100,
+          source->detect_stats.stall * 100,
+          (unsigned long) suscan_autotune_get_size(&source->autotune));
+  }
+
+  snprintf(cpu_str, sizeof(cpu_str), "%.1lf%%", cpu * 100);
+
+  gtk_label_set_text(gui->cpuLabel, cpu_str);
+  gtk_level_bar_set_value(gui->cpuLevelBar, cpu);
+
+  gtk_widget_set_tooltip_text(GTK_WIDGET(gui->cpuLabel), stats_str);
+}
+
+SUPRIVATE void
+suscan_gui_set_channel_row(
+    struct suscan_gui *gui,
+    GtkTreeIter *iter,
+    const struct sigutils_channel *channel)
+{
+  gtk_list_store_set(
+      gui->channelListStore,
+      iter,
+      0, channel->fc,
+      1, channel->snr,
+      2, channel->S0,
+      3, channel->N0,
+      4, channel->bw,
+      -1);
+}
+
+SUPRIVATE int
+suscan_gui_find_channel_row(const struct suscan_gui *gui, uint32_t id)
+{
+  unsigned int i;
+
+  for (i = 0; i < gui->channel_row_count; ++i)
+    if (gui->channel_rows[i].id == id)
+      return i;
+
+  return -1;
+}
+
+SUPRIVATE void
+suscan_gui_append_channel_row(
+    struct suscan_gui *gui,
+    uint32_t id,
+    const struct sigutils_channel *channel)
+{
+  struct suscan_gui_channel_row *row =
+      gui->channel_rows + gui->channel_row_count++;
+
+  row->id = id;
+  gtk_list_store_append(gui->channelListStore, &row->iter);
+  suscan_gui_set_channel_row(gui, &row->iter, channel);
+}
+
+/* Only rows of channels that actually changed are touched */
+SUPRIVATE gboolean
+suscan_async_update_channel_deltas_cb(gpointer user_data)
+{
+  struct suscan_gui_msg_envelope *envelope;
+  struct suscan_analyzer_channel_delta_msg *msg;
+  struct suscan_gui *gui;
+  const struct suscan_channel_delta *delta;
+  const struct suscan_gui_spectrum *spectrum;
+  unsigned int i;
+  int j;
+
+  envelope = (struct suscan_gui_msg_envelope *) user_data;
+  msg = (struct suscan_analyzer_channel_delta_msg *) envelope->private;
+  gui = envelope->gui;
+  spectrum = &gui->main_spectrum;
+
+  suscan_gui_update_cpu_stats(gui);
+
+  /* Start over from the tracker state */
+  if (msg->snapshot) {
+    suscan_gui_spectrum_update_channels(&gui->main_spectrum, NULL, 0);
+    gtk_list_store_clear(gui->channelListStore);
+    gui->channel_row_count = 0;
+  }
+
+  if (!suscan_gui_spectrum_apply_channel_deltas(
+      &gui->main_spectrum,
+      msg->delta_list,
+      msg->delta_count))
+    goto done;
+
+  for (i = 0; i < msg->delta_count; ++i) {
+    delta = msg->delta_list + i;
+    j = suscan_gui_find_channel_row(gui, delta->id);
+
+    switch (delta->kind) {
+      case SUSCAN_CHANNEL_DELTA_ADD:
+      case SUSCAN_CHANNEL_DELTA_UPDATE:
+        if (j != -1)
+          suscan_gui_set_channel_row(
+              gui,
+              &gui->channel_rows[j].iter,
+              &delta->channel);
+        else if (gui->channel_row_count < SUSCAN_GUI_MAX_CHANNELS)
+          suscan_gui_append_channel_row(gui, delta->id, &delta->channel);
+        break;
+
+      case SUSCAN_CHANNEL_DELTA_REMOVE:
+        if (j != -1) {
+          gtk_list_store_remove(
+              gui->channelListStore,
+              &gui->channel_rows[j].iter);
+          gui->channel_rows[j] = gui->channel_rows[--gui->channel_row_count];
+        }
+        break;
+    }
+  }
+
+  /* Use the rows left by removed channels for channels not listed yet */
+  for (i = 0;
+      i < spectrum->channel_count
+      && gui->channel_row_count < SUSCAN_GUI_MAX_CHANNELS;
+      ++i)
+    if (suscan_gui_find_channel_row(gui, spectrum->channel_id_list[i]) == -1)
+      suscan_gui_append_channel_row(
+          gui,
+          spectrum->channel_id_list[i],
+          spectrum->channel_list[i]);
+
+done:
+  suscan_gui_msg_envelope_destroy(envelope);
+
+  return G_SOURCE_REMOVE;
+}
+
 SUPRIVATE gboolean
 suscan_async_update_channels_cb(gpointer user_data)
 {
   struct suscan_gui_msg_envelope *envelope;
   PTR_LIST(struct sigutils_channel, channel);
-  SUFLOAT cpu;
-  char cpu_str[10];
   unsigned int i;
   GtkTreeIter new_element;
 
   envelope = (struct suscan_gui_msg_envelope *) user_data;
 
-  cpu = envelope->gui->analyzer->cpu_usage;
-
-  snprintf(cpu_str, sizeof(cpu_str), "%.1lf%%", cpu * 100);
-
-  gtk_label_set_text(envelope->gui->cpuLabel, cpu_str);
-  gtk_level_bar_set_value(envelope->gui->cpuLevelBar, cpu);
+  suscan_gui_update_cpu_stats(envelope->gui);
 
   /* Move channel list to GUI */
   suscan_analyzer_channel_msg_take_channels(
@@ -207,6 +363,7 @@ suscan_async_update_channels_cb(gpointer user_data)
 
   /* Update channel list */
   gtk_list_store_clear(envelope->gui->channelListStore);
+  envelope->gui->channel_row_count = 0;
   for (i = 0; i < channel_count; ++i) {
     gtk_list_store_append(
         envelope->gui->channelListStore,
@@ -431,6 +588,18 @@ suscan_gui_async_thread(gpointer data)
         g_idle_add(suscan_async_update_channels_cb, envelope);
         break;
 
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL_DELTA:
+        if ((envelope = suscan_gui_msg_envelope_new(
+            gui,
+            type,
+            private)) == NULL) {
+          suscan_analyzer_dispose_message(type, private);
+          break;
+        }
+
+        g_idle_add(suscan_async_update_channel_deltas_cb, envelope);
+        break;
+
       case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD:
         if ((envelope = suscan_gui_msg_envelope_new(
             gui,
@@ -513,6 +682,11 @@ suscan_gui_connect(struct suscan_gui *gui)
         "Existing inspectors",
         "The opened inspector tabs will remain in idle state");
 
+  /* Channel IDs of a previous analyzer mean nothing to the new one */
+  gtk_list_store_clear(gui->channelListStore);
+  gui->channel_row_count = 0;
+  suscan_gui_spectrum_update_channels(&gui->main_spectrum, NULL, 0);
+
   if ((gui->analyzer = suscan_analyzer_new(
       &gui->analyzer_params,
       gui->selected_config->config,
@@ -530,6 +704,10 @@ suscan_gui_connect(struct suscan_gui *gui)
   /* Append recent. Not critical */
   (void) suscan_gui_append_recent(gui, gui->selected_config->config);
 
+  /* Spectrum messages only need as many bins as can be displayed */
+  gui->psd_bins = 0;
+  suscan_gui_update_psd_bins(gui);
+
   /* Change state and succeed */
   suscan_gui_update_state(gui, SUSCAN_GUI_STATE_RUNNING);
 
@@ -108,6 +108,13 @@ struct suscan_gui_spectrum {
 
   /* Current channel list */
   PTR_LIST(struct sigutils_channel, channel);
+  uint32_t *channel_id_list; /* Tracker IDs, if updated with deltas */
+};
+
+/* Row of the channel list, by tracker ID */
+struct suscan_gui_channel_row {
+  uint32_t id;
+  GtkTreeIter iter;
 };
 
 
@@ -210,6 +217,9 @@ struct suscan_gui {
 
   /* Main spectrum */
   SUSCOUNT current_samp_rate;
+  SUSCOUNT psd_bins; /* Requested to the analyzer */
+  struct suscan_gui_channel_row channel_rows[SUSCAN_GUI_MAX_CHANNELS];
+  unsigned int channel_row_count;
   struct sigutils_channel selected_channel;
   struct suscan_gui_spectrum main_spectrum;
 
@@ -373,6 +383,17 @@ void suscan_gui_spectrum_configure(
     struct suscan_gui_spectrum *spectrum,
     GtkWidget *widget);
 
+void suscan_gui_update_psd_bins(struct suscan_gui *gui);
+
+SUBOOL suscan_gui_spectrum_apply_channel_deltas(
+    struct suscan_gui_spectrum *spectrum,
+    const struct suscan_channel_delta *delta_list,
+    unsigned int delta_count);
+
+const struct sigutils_channel *suscan_gui_spectrum_get_channel_by_id(
+    const struct suscan_gui_spectrum *spectrum,
+    uint32_t id);
+
 void suscan_gui_spectrum_redraw(
     struct suscan_gui_spectrum *spectrum,
     cairo_t *cr);
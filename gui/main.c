@@ -74,6 +74,17 @@ suscan_on_settings(GtkWidget *widget, gpointer data)
       }
 
       suscan_gui_set_config(gui, config);
+
+      /* No need to reconnect for these */
+      if (gui->state == SUSCAN_GUI_STATE_RUNNING)
+        if (!suscan_analyzer_set_params_async(
+            gui->analyzer,
+            &gui->analyzer_params,
+            0))
+          suscan_error(
+              gui,
+              "Analyzer params",
+              "Failed to update analyzer parameters (see log)");
     }
 
     break;
@@ -114,6 +125,7 @@ suscan_on_open_inspector(GtkWidget *widget, gpointer data)
   SU_TRYCATCH(
       suscan_inspector_open_async(
           gui->analyzer,
+          0,
           &gui->selected_channel,
           rand()),
       return);
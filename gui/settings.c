@@ -112,6 +112,9 @@ suscan_gui_retrieve_analyzer_params(struct suscan_gui *gui)
       gui->settings,
       "psd-interval");
 
+  /* Interactive use: keep blocks short unless the CPU cannot keep up */
+  analyzer_params.read_profile = SUSCAN_AUTOTUNE_PROFILE_LOW_LATENCY;
+
   /* TODO: send update message to analyzer */
   gui->analyzer_params = analyzer_params;
 
@@ -169,6 +169,9 @@ suscan_spectrum_finalize(struct suscan_gui_spectrum *spectrum)
   if (spectrum->channel_list != NULL)
     free(spectrum->channel_list);
 
+  if (spectrum->channel_id_list != NULL)
+    free(spectrum->channel_id_list);
+
   if (spectrum->psd_data != NULL)
     free(spectrum->psd_data);
 
@@ -491,6 +494,110 @@ suscan_gui_spectrum_update_channels(
 
   spectrum->channel_list  = channel_list;
   spectrum->channel_count = channel_count;
+
+  /* Full lists carry no IDs */
+  if (spectrum->channel_id_list != NULL) {
+    free(spectrum->channel_id_list);
+    spectrum->channel_id_list = NULL;
+  }
+}
+
+SUPRIVATE int
+suscan_gui_spectrum_find_channel_id(
+    const struct suscan_gui_spectrum *spectrum,
+    uint32_t id)
+{
+  int i;
+
+  if (spectrum->channel_id_list != NULL)
+    for (i = 0; i < spectrum->channel_count; ++i)
+      if (spectrum->channel_id_list[i] == id)
+        return i;
+
+  return -1;
+}
+
+const struct sigutils_channel *
+suscan_gui_spectrum_get_channel_by_id(
+    const struct suscan_gui_spectrum *spectrum,
+    uint32_t id)
+{
+  int i;
+
+  if ((i = suscan_gui_spectrum_find_channel_id(spectrum, id)) == -1)
+    return NULL;
+
+  return spectrum->channel_list[i];
+}
+
+SUBOOL
+suscan_gui_spectrum_apply_channel_deltas(
+    struct suscan_gui_spectrum *spectrum,
+    const struct suscan_channel_delta *delta_list,
+    unsigned int delta_count)
+{
+  struct sigutils_channel *channel = NULL;
+  uint32_t *id_list;
+  unsigned int i;
+  int last;
+  int j;
+
+  /* Channels from a full list cannot be matched against deltas */
+  if (spectrum->channel_id_list == NULL && spectrum->channel_count > 0)
+    suscan_gui_spectrum_update_channels(spectrum, NULL, 0);
+
+  for (i = 0; i < delta_count; ++i) {
+    j = suscan_gui_spectrum_find_channel_id(spectrum, delta_list[i].id);
+
+    switch (delta_list[i].kind) {
+      case SUSCAN_CHANNEL_DELTA_ADD:
+      case SUSCAN_CHANNEL_DELTA_UPDATE:
+        if (j != -1) {
+          *spectrum->channel_list[j] = delta_list[i].channel;
+        } else {
+          SU_TRYCATCH(
+              channel = malloc(sizeof(struct sigutils_channel)),
+              return SU_FALSE);
+          *channel = delta_list[i].channel;
+
+          SU_TRYCATCH(
+              id_list = realloc(
+                  spectrum->channel_id_list,
+                  (spectrum->channel_count + 1) * sizeof(uint32_t)),
+              goto fail);
+          spectrum->channel_id_list = id_list;
+
+          SU_TRYCATCH(
+              (j = PTR_LIST_APPEND_CHECK(spectrum->channel, channel)) != -1,
+              goto fail);
+
+          spectrum->channel_id_list[j] = delta_list[i].id;
+          channel = NULL;
+        }
+        break;
+
+      case SUSCAN_CHANNEL_DELTA_REMOVE:
+        if (j != -1) {
+          /* Move the last channel here */
+          last = spectrum->channel_count - 1;
+
+          free(spectrum->channel_list[j]);
+          spectrum->channel_list[j] = spectrum->channel_list[last];
+          spectrum->channel_id_list[j] = spectrum->channel_id_list[last];
+          spectrum->channel_list[last] = NULL;
+          --spectrum->channel_count;
+        }
+        break;
+    }
+  }
+
+  return SU_TRUE;
+
+fail:
+  if (channel != NULL)
+    free(channel);
+
+  return SU_FALSE;
 }
 
 /*************************** Waterfall methods *******************************/
@@ -1170,6 +1277,32 @@ suscan_gui_spectrum_reset_selection(struct suscan_gui_spectrum *spectrum)
       = 0;
 }
 
+/*
+ * Ask the analyzer for just the bins the main spectrum can display.
+ * Zooming in shows a fraction of the band, so the resolution requested
+ * grows with the frequency scale.
+ */
+void
+suscan_gui_update_psd_bins(struct suscan_gui *gui)
+{
+  struct suscan_psd_format format = gui->analyzer_params.psd_format;
+  SUSCOUNT bins = 1;
+
+  if (gui->analyzer == NULL || gui->main_spectrum.width == 0)
+    return;
+
+  while (bins < gui->main_spectrum.width * gui->main_spectrum.freq_scale)
+    bins <<= 1;
+
+  if (bins == gui->psd_bins)
+    return;
+
+  format.bins = bins;
+
+  if (suscan_analyzer_set_psd_format(gui->analyzer, &format))
+    gui->psd_bins = bins;
+}
+
 /******************* These callbacks belong to the GUI API ********************/
 gboolean
 suscan_spectrum_on_configure_event(
@@ -1181,6 +1314,8 @@ suscan_spectrum_on_configure_event(
 
   suscan_gui_spectrum_configure(&gui->main_spectrum, widget);
 
+  suscan_gui_update_psd_bins(gui);
+
   return TRUE;
 }
 
@@ -1210,6 +1345,8 @@ suscan_spectrum_on_scroll(GtkWidget *widget, GdkEventScroll *ev, gpointer data)
 
   suscan_gui_spectrum_parse_scroll(&gui->main_spectrum, ev);
 
+  suscan_gui_update_psd_bins(gui);
+
   snprintf(text, sizeof(text), "%.2lg dB", gui->main_spectrum.dbs_per_div);
   gtk_label_set_text(gui->spectrumDbsPerDivLabel, text);
 
@@ -0,0 +1,373 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "suscan.h"
+
+#define SUSCAN_BENCH_SOURCE "synth,throttle=false"
+
+/*
+ * Each scenario runs a fresh analyzer, unthrottled, for the given time.
+ * Inspectors are opened on the first channels found (cycling through
+ * them if there are fewer channels than inspectors), with the channel
+ * bandwidth as symbol rate so that they produce symbols.
+ */
+struct suscan_bench_scenario {
+  const char  *name;
+  SUSCOUNT     block_size;
+  unsigned int inspectors;
+  unsigned int consumers; /* 0: one per CPU, minus 1 */
+};
+
+SUPRIVATE const struct suscan_bench_scenario suscan_bench_scenarios[] = {
+  {"detector",              SUSCAN_SOURCE_DEFAULT_BUFSIZ,  0, 1},
+  {"detector-small",        512,                           0, 1},
+  {"detector-large",        65536,                         0, 1},
+  {"inspector-1",           SUSCAN_SOURCE_DEFAULT_BUFSIZ,  1, 1},
+  {"inspector-4",           SUSCAN_SOURCE_DEFAULT_BUFSIZ,  4, 1},
+  {"inspector-4-parallel",  SUSCAN_SOURCE_DEFAULT_BUFSIZ,  4, 0},
+  {"inspector-16-parallel", SUSCAN_SOURCE_DEFAULT_BUFSIZ, 16, 0},
+};
+
+struct suscan_bench_result {
+  uint64_t samples;
+  uint64_t symbols;
+  SUFLOAT  elapsed; /* Seconds */
+  unsigned int consumers; /* As created by the analyzer */
+  struct suscan_analyzer_latency acquire_latency;
+  struct suscan_analyzer_latency detect_latency;
+  long rss_growth; /* kB, peak RSS during the scenario over the one before */
+};
+
+/*
+ * Current resident set size in kB, or -1 if unknown. The peak reported
+ * by getrusage covers the whole process, previous scenarios included.
+ */
+SUPRIVATE long
+suscan_bench_get_rss(void)
+{
+  FILE *fp;
+  unsigned long size, resident;
+  long rss = -1;
+
+  if ((fp = fopen("/proc/self/statm", "r")) == NULL)
+    return -1;
+
+  if (fscanf(fp, "%lu %lu", &size, &resident) == 2)
+    rss = resident * (sysconf(_SC_PAGESIZE) / 1024);
+
+  fclose(fp);
+
+  return rss;
+}
+
+/* Iterations recorded since a snapshot of the same histogram */
+SUPRIVATE void
+suscan_bench_latency_since(
+    struct suscan_analyzer_latency *latency,
+    const struct suscan_analyzer_latency *snapshot)
+{
+  unsigned int i;
+
+  for (i = 0; i < SUSCAN_ANALYZER_LATENCY_BINS; ++i)
+    latency->bins[i] -= snapshot->bins[i];
+}
+
+SUPRIVATE SUFLOAT
+suscan_bench_elapsed(const struct timespec *since)
+{
+  struct timespec now, sub;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  timespecsub(&now, since, &sub);
+
+  return sub.tv_sec + 1e-9 * sub.tv_nsec;
+}
+
+SUPRIVATE SUBOOL
+suscan_bench_open_inspectors(
+    suscan_analyzer_t *analyzer,
+    const struct suscan_analyzer_channel_msg *msg,
+    unsigned int count)
+{
+  struct suscan_inspector_params params;
+  const struct sigutils_channel *channel;
+  unsigned int i;
+  SUHANDLE handle;
+
+  if (msg->channel_count == 0) {
+    SU_ERROR("No channels to inspect\n");
+    return SU_FALSE;
+  }
+
+  for (i = 0; i < count; ++i) {
+    channel = msg->channel_list[i % msg->channel_count];
+
+    SU_TRYCATCH(
+        (handle = suscan_inspector_open(analyzer, 0, channel)) != -1,
+        return SU_FALSE);
+
+    suscan_inspector_params_initialize(&params);
+    params.inspector_id = i;
+    params.baud = channel->bw;
+
+    SU_TRYCATCH(
+        suscan_inspector_set_params_async(analyzer, handle, &params, 0),
+        return SU_FALSE);
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_bench_run(
+    struct suscan_source_config *config,
+    const struct suscan_analyzer_params *params,
+    const struct suscan_bench_scenario *scenario,
+    SUFLOAT duration,
+    struct suscan_bench_result *result)
+{
+  struct suscan_analyzer_params bench_params = *params;
+  struct suscan_mq mq;
+  struct timespec start;
+  struct suscan_analyzer_latency acquire_latency;
+  struct suscan_analyzer_latency detect_latency;
+  suscan_analyzer_t *analyzer = NULL;
+  struct suscan_analyzer_source *source;
+  struct suscan_analyzer_channel_msg *ch_msg;
+  const struct suscan_analyzer_sample_batch_msg *batch;
+  const struct suscan_analyzer_status_msg *st_msg;
+  SUSCOUNT bufsiz = config->bufsiz;
+  uint64_t samples = 0;
+  uint64_t consumed;
+  long rss, base_rss, peak_rss;
+  SUBOOL started = SU_FALSE;
+  SUBOOL running = SU_TRUE;
+  uint32_t type;
+  void *private;
+  SUBOOL ok = SU_FALSE;
+
+  memset(result, 0, sizeof(struct suscan_bench_result));
+
+  if (!suscan_mq_init(&mq))
+    return SU_FALSE;
+
+  bench_params.playback_speed = 0;
+  bench_params.channel_deltas = SU_FALSE;
+  bench_params.consumer_count = scenario->consumers;
+  config->bufsiz = scenario->block_size;
+
+  base_rss = peak_rss = suscan_bench_get_rss();
+
+  SU_TRYCATCH(
+      analyzer = suscan_analyzer_new(&bench_params, config, &mq),
+      goto done);
+
+  source = suscan_analyzer_get_source(analyzer, 0);
+  result->consumers = analyzer->consumer_count;
+
+  /* The clock starts once inspectors are open */
+  while (running) {
+    private = suscan_analyzer_read(analyzer, &type);
+
+    switch (type) {
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
+        ch_msg = (struct suscan_analyzer_channel_msg *) private;
+
+        /* Sampled once per channel update */
+        if ((rss = suscan_bench_get_rss()) > peak_rss)
+          peak_rss = rss;
+
+        if (!started) {
+          if (scenario->inspectors > 0
+              && !suscan_bench_open_inspectors(
+                  analyzer,
+                  ch_msg,
+                  scenario->inspectors)) {
+            running = SU_FALSE;
+            break;
+          }
+
+          /* Warm-up iterations are left out of the histograms */
+          suscan_analyzer_source_get_counters(
+              source,
+              &samples,
+              &acquire_latency,
+              &detect_latency);
+          clock_gettime(CLOCK_MONOTONIC, &start);
+          started = SU_TRUE;
+        }
+        break;
+
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
+        batch = (const struct suscan_analyzer_sample_batch_msg *) private;
+        if (started)
+          result->symbols += batch->sample_count;
+        break;
+
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+        st_msg = (const struct suscan_analyzer_status_msg *) private;
+        if (!started)
+          SU_ERROR(
+              "%s\n",
+              st_msg->err_msg != NULL
+                  ? st_msg->err_msg
+                  : "Source ended before the benchmark started");
+
+        /* Short files: measure what we have */
+        running = SU_FALSE;
+        break;
+    }
+
+    suscan_analyzer_dispose_message(type, private);
+
+    if (started && suscan_bench_elapsed(&start) >= duration)
+      running = SU_FALSE;
+  }
+
+  if (!started)
+    goto done;
+
+  result->elapsed = suscan_bench_elapsed(&start);
+  suscan_analyzer_source_get_counters(
+      source,
+      &consumed,
+      &result->acquire_latency,
+      &result->detect_latency);
+  result->samples = consumed - samples;
+
+  suscan_bench_latency_since(&result->acquire_latency, &acquire_latency);
+  suscan_bench_latency_since(&result->detect_latency, &detect_latency);
+
+  if ((rss = suscan_bench_get_rss()) > peak_rss)
+    peak_rss = rss;
+
+  result->rss_growth = base_rss != -1 ? peak_rss - base_rss : -1;
+
+  ok = SU_TRUE;
+
+done:
+  config->bufsiz = bufsiz;
+
+  if (analyzer != NULL)
+    suscan_analyzer_destroy(analyzer);
+
+  suscan_analyzer_consume_mq(&mq);
+  suscan_mq_finalize(&mq);
+
+  return ok;
+}
+
+SUPRIVATE void
+suscan_bench_print_latency(
+    const char *name,
+    const struct suscan_analyzer_latency *latency)
+{
+  printf(
+      "\"%s\": {\"p50\": %.3lf, \"p90\": %.3lf, \"p99\": %.3lf, "
+      "\"p999\": %.3lf}",
+      name,
+      1e-3 * suscan_analyzer_latency_get_percentile(latency, .5),
+      1e-3 * suscan_analyzer_latency_get_percentile(latency, .9),
+      1e-3 * suscan_analyzer_latency_get_percentile(latency, .99),
+      1e-3 * suscan_analyzer_latency_get_percentile(latency, .999));
+}
+
+SUPRIVATE void
+suscan_bench_print_result(
+    const struct suscan_bench_scenario *scenario,
+    const struct suscan_bench_result *result)
+{
+  SUFLOAT elapsed = result->elapsed > 0 ? result->elapsed : 1;
+
+  printf("    {\"name\": \"%s\", ", scenario->name);
+  printf("\"block_size\": %lu, ", (unsigned long) scenario->block_size);
+  printf("\"inspectors\": %u, ", scenario->inspectors);
+  printf("\"consumers\": %u, ", result->consumers);
+  printf("\"elapsed\": %.3lf, ", result->elapsed);
+  printf("\"samples_per_sec\": %.1lf, ", result->samples / elapsed);
+  printf("\"symbols_per_sec\": %.1lf, ", result->symbols / elapsed);
+  suscan_bench_print_latency("acquire_latency_us", &result->acquire_latency);
+  printf(", ");
+  suscan_bench_print_latency("detect_latency_us", &result->detect_latency);
+  printf(", \"rss_growth_kb\": %ld}", result->rss_growth);
+}
+
+SUBOOL
+suscan_perform_bench(
+    struct suscan_source_config *config,
+    const struct suscan_analyzer_params *params,
+    SUFLOAT duration)
+{
+  struct suscan_source_config *synth = NULL;
+  struct suscan_bench_result result;
+  unsigned int i;
+  SUBOOL first = SU_TRUE;
+  SUBOOL ok = SU_FALSE;
+
+  if (config == NULL) {
+    SU_TRYCATCH(
+        config = synth = suscan_source_string_to_config(SUSCAN_BENCH_SOURCE),
+        goto done);
+  }
+
+  /* Sample precision is a build option: report it to compare builds */
+  printf("{\n");
+  printf("  \"source\": \"%s\",\n", config->source->name);
+  printf("  \"sample_size\": %lu,\n", (unsigned long) sizeof(SUCOMPLEX));
+  printf("  \"duration\": %.3lf,\n", duration);
+  printf("  \"scenarios\": [\n");
+
+  for (i = 0; i < ARRAY_SZ(suscan_bench_scenarios); ++i) {
+    fprintf(stderr, "Running `%s'...\n", suscan_bench_scenarios[i].name);
+
+    if (!suscan_bench_run(
+        config,
+        params,
+        &suscan_bench_scenarios[i],
+        duration,
+        &result)) {
+      SU_ERROR("Scenario `%s' failed\n", suscan_bench_scenarios[i].name);
+      continue;
+    }
+
+    if (!first)
+      printf(",\n");
+    first = SU_FALSE;
+
+    suscan_bench_print_result(&suscan_bench_scenarios[i], &result);
+    fflush(stdout);
+  }
+
+  printf("\n  ]\n}\n");
+
+  ok = !first;
+
+done:
+  if (synth != NULL)
+    suscan_source_config_destroy(synth);
+
+  return ok;
+}
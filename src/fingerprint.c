@@ -21,8 +21,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <pthread.h>
 #include <errno.h>
+#include <unistd.h>
+#include <inttypes.h>
 #include <getopt.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -30,18 +33,35 @@
 
 #include "suscan.h"
 
-#define SUSCAN_CHLIST_SKIP_CHANNELS 50
-#define SUSCAN_BRINSP_SKIP_CHANNELS 50
+/*
+ * Fingerprints end as soon as results are stable. The channel list is
+ * taken once it stops changing, and baud rates are read once their
+ * estimates stop changing. Both need some signal first, and both are
+ * taken anyway after a maximum number of channel updates.
+ */
+#define SUSCAN_CHLIST_MAX_UPDATES      50
+#define SUSCAN_BRINSP_MAX_UPDATES      50
+#define SUSCAN_CHLIST_MIN_TIME         .5  /* Seconds of signal */
+#define SUSCAN_BRINSP_MIN_TIME         .5  /* Seconds of signal */
+#define SUSCAN_FINGERPRINT_STABLE      5   /* Updates without changes */
+#define SUSCAN_FINGERPRINT_FREQ_TOL    .1  /* Of channel bandwidth */
+#define SUSCAN_FINGERPRINT_BAUD_TOL    .01 /* Relative */
 
 struct suscan_fingerprint_chresult {
   struct sigutils_channel channel;
   SUHANDLE br_handle; /* Baudrate inspector handle */
   struct suscan_baud_det_result baudrate;
+  struct suscan_baud_det_result prev_baudrate; /* Previous update */
 };
 
 struct suscan_fingerprint_report {
   struct suscan_fingerprint_chresult *results;
   unsigned int result_count;
+
+  /* Signal analyzed, virtual clock */
+  struct timespec t_start;
+  struct timespec t_end;
+  uint64_t samples;
 };
 
 void
@@ -64,7 +84,7 @@ suscan_fingerprint_report_new(
   struct suscan_fingerprint_report *new = NULL;
   unsigned int i;
 
-  if ((new = malloc(sizeof (struct suscan_fingerprint_report))) == NULL)
+  if ((new = calloc(1, sizeof (struct suscan_fingerprint_report))) == NULL)
     goto fail;
 
   new->result_count = count;
@@ -87,27 +107,64 @@ fail:
   return NULL;
 }
 
+/*
+ * Each of these is a single batch for all channels: one round trip to
+ * the analyzer thread, with inspectors built in parallel by consumers.
+ */
+SUPRIVATE struct suscan_analyzer_inspector_batch_msg *
+suscan_fingerprint_batch_new(
+    enum suscan_analyzer_inspector_batch_kind kind,
+    const struct suscan_fingerprint_report *report)
+{
+  struct suscan_analyzer_inspector_batch_msg *msg;
+  unsigned int i;
+
+  SU_TRYCATCH(
+      msg = suscan_analyzer_inspector_batch_msg_new(
+          kind,
+          report->result_count,
+          0),
+      return NULL);
+
+  for (i = 0; i < report->result_count; ++i) {
+    msg->entry_list[i].source_id = 0;
+    msg->entry_list[i].channel = report->results[i].channel;
+    msg->entry_list[i].handle = report->results[i].br_handle;
+  }
+
+  return msg;
+}
+
 SUBOOL
 suscan_open_all_channels(
     suscan_analyzer_t *analyzer,
     struct suscan_fingerprint_report *report)
 {
+  struct suscan_analyzer_inspector_batch_msg *msg;
   unsigned int i;
-  SUHANDLE handle;
+  SUBOOL ok = SU_TRUE;
 
-  for (i = 0; i < report->result_count; ++i) {
-    handle = suscan_inspector_open(
-        analyzer,
-        &report->results[i].channel);
-    if (handle == -1) {
-      SU_ERROR("Failed to open baud inspector\n");
-      return SU_FALSE;
-    }
+  SU_TRYCATCH(
+      msg = suscan_fingerprint_batch_new(
+          SUSCAN_ANALYZER_INSPECTOR_BATCH_OPEN,
+          report),
+      return SU_FALSE);
 
-    report->results[i].br_handle = handle;
-  }
+  SU_TRYCATCH(msg = suscan_inspector_batch_call(analyzer, msg), return SU_FALSE);
 
-  return SU_TRUE;
+  /* Keep successful handles, so that they get closed */
+  for (i = 0; i < msg->entry_count; ++i)
+    if (msg->entry_list[i].status == SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_OK)
+      report->results[i].br_handle = msg->entry_list[i].handle;
+    else
+      ok = SU_FALSE;
+
+  if (!ok)
+    SU_ERROR("Failed to open baud inspector\n");
+
+  suscan_analyzer_inspector_batch_msg_destroy(msg);
+
+  return ok;
 }
 
 void
@@ -115,14 +172,17 @@ suscan_close_all_channels(
     suscan_analyzer_t *analyzer,
     struct suscan_fingerprint_report *report)
 {
-  unsigned int i;
-  SUHANDLE handle;
+  struct suscan_analyzer_inspector_batch_msg *msg;
 
-  for (i = 0; i < report->result_count; ++i)
-    if (report->results[i].br_handle >= 0)
-      (void) suscan_inspector_close(
-          analyzer,
-          report->results[i].br_handle);
+  SU_TRYCATCH(
+      msg = suscan_fingerprint_batch_new(
+          SUSCAN_ANALYZER_INSPECTOR_BATCH_CLOSE,
+          report),
+      return);
+
+  /* Entries that were never opened are just reported as wrong handles */
+  if ((msg = suscan_inspector_batch_call(analyzer, msg)) != NULL)
+    suscan_analyzer_inspector_batch_msg_destroy(msg);
 }
 
 SUBOOL
@@ -130,22 +190,95 @@ suscan_get_all_baudrates(
     suscan_analyzer_t *analyzer,
     struct suscan_fingerprint_report *report)
 {
+  struct suscan_analyzer_inspector_batch_msg *msg;
+  unsigned int i;
+  SUBOOL ok = SU_TRUE;
+
+  SU_TRYCATCH(
+      msg = suscan_fingerprint_batch_new(
+          SUSCAN_ANALYZER_INSPECTOR_BATCH_GET_INFO,
+          report),
+      return SU_FALSE);
+
+  SU_TRYCATCH(msg = suscan_inspector_batch_call(analyzer, msg), return SU_FALSE);
+
+  for (i = 0; i < msg->entry_count; ++i)
+    if (msg->entry_list[i].status == SUSCAN_ANALYZER_INSPECTOR_BATCH_STATUS_OK)
+      report->results[i].baudrate = msg->entry_list[i].baud;
+    else
+      ok = SU_FALSE;
+
+  if (!ok)
+    SU_ERROR("Failed to get all baudrates\n");
+
+  suscan_analyzer_inspector_batch_msg_destroy(msg);
+
+  return ok;
+}
+
+/* Same channels as in the report, within tolerance. Lists are sorted */
+SUPRIVATE SUBOOL
+suscan_fingerprint_report_matches(
+    const struct suscan_fingerprint_report *report,
+    struct sigutils_channel **list,
+    unsigned int count)
+{
+  const struct sigutils_channel *channel;
+  unsigned int i;
+
+  if (report->result_count != count)
+    return SU_FALSE;
+
+  for (i = 0; i < count; ++i) {
+    channel = &report->results[i].channel;
+
+    if (SU_ABS(channel->fc - list[i]->fc)
+        > SUSCAN_FINGERPRINT_FREQ_TOL * SU_MAX(channel->bw, list[i]->bw))
+      return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+SUINLINE SUBOOL
+suscan_fingerprint_baud_matches(SUFLOAT a, SUFLOAT b)
+{
+  return SU_ABS(a - b)
+      <= SUSCAN_FINGERPRINT_BAUD_TOL * SU_MAX(SU_ABS(a), SU_ABS(b));
+}
+
+/* Estimates did not change since the previous update */
+SUPRIVATE SUBOOL
+suscan_fingerprint_report_baud_stable(
+    const struct suscan_fingerprint_report *report)
+{
+  const struct suscan_fingerprint_chresult *result;
   unsigned int i;
-  SUHANDLE handle;
 
   for (i = 0; i < report->result_count; ++i) {
-    if (!suscan_inspector_get_info(
-        analyzer,
-        report->results[i].br_handle,
-        &report->results[i].baudrate)) {
-      SU_ERROR("Failed to get baudrate for channel #%d\n", i + 1);
+    result = &report->results[i];
+
+    if (!suscan_fingerprint_baud_matches(
+        result->baudrate.fac,
+        result->prev_baudrate.fac)
+        || !suscan_fingerprint_baud_matches(
+            result->baudrate.nln,
+            result->prev_baudrate.nln))
       return SU_FALSE;
-    }
   }
 
   return SU_TRUE;
 }
 
+SUINLINE SUFLOAT
+suscan_fingerprint_elapsed(
+    const struct timespec *since,
+    const struct timespec *now)
+{
+  return (now->tv_sec - since->tv_sec)
+      + 1e-9 * (now->tv_nsec - since->tv_nsec);
+}
+
 void
 suscan_print_report(
     const struct suscan_fingerprint_report *report)
@@ -167,27 +300,155 @@ suscan_print_report(
         round(report->results[i].baudrate.nln));
 }
 
-SUBOOL
-suscan_perform_fingerprint(struct suscan_source_config *config)
+/********************** Machine-readable output ******************************/
+SUPRIVATE void
+suscan_print_json_string(const char *string)
+{
+  putchar('"');
+
+  for (; *string != '\0'; ++string)
+    if (*string == '"' || *string == '\\')
+      printf("\\%c", *string);
+    else if ((unsigned char) *string < 0x20)
+      printf("\\u%04x", (unsigned char) *string);
+    else
+      putchar(*string);
+
+  putchar('"');
+}
+
+/* JSON has no representation for NaN or infinities */
+SUPRIVATE void
+suscan_print_json_number(const char *key, const char *fmt, double value)
+{
+  printf(",\"%s\":", key);
+
+  if (isfinite(value))
+    printf(fmt, value);
+  else
+    printf("null");
+}
+
+SUPRIVATE void
+suscan_print_csv_string(const char *string)
 {
+  putchar('"');
+
+  for (; *string != '\0'; ++string) {
+    if (*string == '"')
+      putchar('"');
+    putchar(*string);
+  }
+
+  putchar('"');
+}
+
+void
+suscan_fingerprint_print_header(enum suscan_fingerprint_format format)
+{
+  if (format == SUSCAN_FINGERPRINT_FORMAT_CSV) {
+    printf("source,channel,fc,bw,snr,baud_fac,baud_nln,t_start,t_end,samples\n");
+    fflush(stdout);
+  }
+}
+
+/*
+ * One record per channel. Records of a report are written at once and
+ * flushed, so that concurrent fingerprints don't mix lines and readers
+ * get them as soon as they are ready.
+ */
+SUPRIVATE void
+suscan_print_records(
+    const char *name,
+    const struct suscan_fingerprint_report *report,
+    enum suscan_fingerprint_format format)
+{
+  const struct suscan_fingerprint_chresult *result;
+  unsigned int i;
+
+  for (i = 0; i < report->result_count; ++i) {
+    result = &report->results[i];
+
+    if (format == SUSCAN_FINGERPRINT_FORMAT_JSONL) {
+      printf("{\"source\":");
+      suscan_print_json_string(name);
+      printf(",\"channel\":%u", i + 1);
+      suscan_print_json_number("fc", "%.1lf", result->channel.fc);
+      suscan_print_json_number("bw", "%.1lf", result->channel.bw);
+      suscan_print_json_number("snr", "%.2lf", result->channel.snr);
+      suscan_print_json_number("baud_fac", "%lg", result->baudrate.fac);
+      suscan_print_json_number("baud_nln", "%lg", result->baudrate.nln);
+      printf(
+          ",\"t_start\":%ld.%09ld,\"t_end\":%ld.%09ld,"
+          "\"samples\":%" PRIu64 "}\n",
+          (long) report->t_start.tv_sec,
+          (long) report->t_start.tv_nsec,
+          (long) report->t_end.tv_sec,
+          (long) report->t_end.tv_nsec,
+          report->samples);
+    } else {
+      suscan_print_csv_string(name);
+      printf(
+          ",%u,%.1lf,%.1lf,%.2lf,%lg,%lg,%ld.%09ld,%ld.%09ld,%" PRIu64 "\n",
+          i + 1,
+          result->channel.fc,
+          result->channel.bw,
+          result->channel.snr,
+          result->baudrate.fac,
+          result->baudrate.nln,
+          (long) report->t_start.tv_sec,
+          (long) report->t_start.tv_nsec,
+          (long) report->t_end.tv_sec,
+          (long) report->t_end.tv_nsec,
+          report->samples);
+    }
+  }
+
+  fflush(stdout);
+}
+
+/*
+ * Report is left in *result, or NULL if the source ended too soon. A
+ * source that ends too soon is not a failure.
+ */
+SUPRIVATE SUBOOL
+suscan_fingerprint_run(
+    struct suscan_source_config *config,
+    const struct suscan_analyzer_params *params,
+    struct suscan_fingerprint_report **result)
+{
+  struct suscan_analyzer_params fp_params = *params;
   struct suscan_mq mq;
   void *private;
   uint32_t type;
   suscan_analyzer_t *analyzer = NULL;
-  struct suscan_analyzer_params params = suscan_analyzer_params_INITIALIZER;
+  const struct suscan_analyzer_source *source;
   const struct suscan_analyzer_channel_msg *ch_msg;
   const struct suscan_analyzer_status_msg  *st_msg;
+  struct suscan_fingerprint_report *candidate = NULL;
   struct suscan_fingerprint_report *report = NULL;
-  unsigned int chskip = SUSCAN_CHLIST_SKIP_CHANNELS;
+  struct timespec since; /* Virtual time the current phase started */
+  unsigned int updates = 0; /* In the current phase */
+  unsigned int stable = 0;
   unsigned int i;
-  unsigned int n = 0;
   SUBOOL running = SU_TRUE;
+  SUBOOL complete = SU_FALSE;
+  SUBOOL failed = SU_FALSE;
   SUBOOL ok = SU_FALSE;
 
+  *result = NULL;
+
   if (!suscan_mq_init(&mq))
     return SU_FALSE;
 
-  SU_TRYCATCH(analyzer = suscan_analyzer_new(&params, config, &mq), goto done);
+  /* Reports are built from full channel lists */
+  fp_params.channel_deltas = SU_FALSE;
+
+  SU_TRYCATCH(
+      analyzer = suscan_analyzer_new(&fp_params, config, &mq),
+      goto done);
+
+  source = suscan_analyzer_get_source(analyzer, 0);
 
   while (running) {
     private = suscan_analyzer_read(analyzer, &type);
@@ -195,33 +456,87 @@ suscan_perform_fingerprint(struct suscan_source_config *config)
     switch (type) {
       case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
         ch_msg = (struct suscan_analyzer_channel_msg *) private;
-        if (chskip > 0) {
-          --chskip;
-        } else if (report == NULL) {
+
+        if (updates++ == 0)
+          since = ch_msg->timestamp;
+
+        if (report == NULL) {
+          /* Channel list phase: wait for the list to settle */
           suscan_channel_list_sort(ch_msg->channel_list, ch_msg->channel_count);
-          if ((report = suscan_fingerprint_report_new(
-              ch_msg->channel_list,
-              ch_msg->channel_count)) == NULL) {
-            SU_ERROR("Failed to create report\n");
-            running = SU_FALSE;
-          } else if (!suscan_open_all_channels(analyzer, report)) {
+
+          if (candidate != NULL
+              && suscan_fingerprint_report_matches(
+                  candidate,
+                  ch_msg->channel_list,
+                  ch_msg->channel_count)) {
+            ++stable;
+          } else {
+            stable = 0;
+
+            if (candidate != NULL)
+              suscan_fingerprint_report_destroy(candidate);
+
+            if ((candidate = suscan_fingerprint_report_new(
+                ch_msg->channel_list,
+                ch_msg->channel_count)) == NULL) {
+              SU_ERROR("Failed to create report\n");
+              failed = SU_TRUE;
+              running = SU_FALSE;
+              break;
+            }
+          }
+
+          if (updates < SUSCAN_CHLIST_MAX_UPDATES
+              && (stable < SUSCAN_FINGERPRINT_STABLE
+                  || suscan_fingerprint_elapsed(&since, &ch_msg->timestamp)
+                  < SUSCAN_CHLIST_MIN_TIME))
+            break;
+
+          report = candidate;
+          candidate = NULL;
+
+          if (!suscan_open_all_channels(analyzer, report)) {
             SU_ERROR("Failed to open all channels\n");
+            failed = SU_TRUE;
             running = SU_FALSE;
           } else {
-            chskip = SUSCAN_BRINSP_SKIP_CHANNELS;
             SU_INFO(
-                "Found %d channels, wait for %d channel updates\n",
+                "Found %d channels after %d updates\n",
                 report->result_count,
-                chskip);
+                updates);
+            updates = 0;
+            stable = 0;
           }
         } else {
+          /* Baud rate phase: wait for the estimates to settle */
+          for (i = 0; i < report->result_count; ++i)
+            report->results[i].prev_baudrate = report->results[i].baudrate;
+
           if (!suscan_get_all_baudrates(analyzer, report)) {
             SU_ERROR("Failed to get all baudrates\n");
-          } else {
-            suscan_print_report(report);
+            failed = SU_TRUE;
+            running = SU_FALSE;
+            break;
           }
 
-          running = SU_FALSE;
+          if (updates > 1 && suscan_fingerprint_report_baud_stable(report))
+            ++stable;
+          else
+            stable = 0;
+
+          if (updates >= SUSCAN_BRINSP_MAX_UPDATES
+              || (stable >= SUSCAN_FINGERPRINT_STABLE
+                  && suscan_fingerprint_elapsed(&since, &ch_msg->timestamp)
+                  >= SUSCAN_BRINSP_MIN_TIME)) {
+            report->t_start = source->vt0;
+            report->t_end = ch_msg->timestamp;
+            report->samples = SU_FLOOR(
+                suscan_fingerprint_elapsed(&report->t_start, &report->t_end)
+                * source->samp_rate + .5);
+
+            complete = SU_TRUE;
+            running = SU_FALSE;
+          }
         }
 
         break;
@@ -241,12 +556,19 @@ suscan_perform_fingerprint(struct suscan_source_config *config)
     suscan_analyzer_dispose_message(type, private);
   }
 
-  ok = SU_TRUE;
+  ok = !failed;
 
 done:
+  if (candidate != NULL)
+    suscan_fingerprint_report_destroy(candidate);
+
   if (report != NULL) {
     suscan_close_all_channels(analyzer, report);
-    suscan_fingerprint_report_destroy(report);
+
+    if (complete)
+      *result = report;
+    else
+      suscan_fingerprint_report_destroy(report);
   }
 
   if (analyzer != NULL)
@@ -257,3 +579,216 @@ done:
 
   return ok;
 }
+
+SUBOOL
+suscan_perform_fingerprint(
+    struct suscan_source_config *config,
+    const char *name,
+    const struct suscan_analyzer_params *params,
+    enum suscan_fingerprint_format format)
+{
+  struct suscan_fingerprint_report *report;
+
+  if (!suscan_fingerprint_run(config, params, &report))
+    return SU_FALSE;
+
+  if (report != NULL) {
+    if (format == SUSCAN_FINGERPRINT_FORMAT_TABLE)
+      suscan_print_report(report);
+    else
+      suscan_print_records(name, report, format);
+
+    suscan_fingerprint_report_destroy(report);
+  }
+
+  return SU_TRUE;
+}
+
+/*
+ * Batch fingerprinting. Fingerprint threads take the next source from
+ * the list until none is left. Each source gets an analyzer of its own:
+ * channels and inspectors are opened and closed per source, the virtual
+ * clock of a report starts with its analyzer, and an analyzer is built
+ * for a fixed source list. Consumer workers are split among the
+ * analyzers running at the same time, and no more analyzers than CPUs
+ * (minus one for the threads that drive them) run at once, so that the
+ * CPUs are shared instead of oversubscribed. Tables are printed in
+ * source order at the end, records are streamed in completion order.
+ */
+struct suscan_fingerprint_batch {
+  pthread_mutex_t mutex;
+  unsigned int next; /* Next source to fingerprint */
+
+  struct suscan_source_config **config_list;
+  const char **name_list;
+  unsigned int config_count;
+  struct suscan_analyzer_params params;
+  enum suscan_fingerprint_format format;
+
+  /* Per source, in input order */
+  struct suscan_fingerprint_report **report_list;
+  SUBOOL *ok_list;
+};
+
+SUPRIVATE void *
+suscan_fingerprint_batch_thread(void *data)
+{
+  struct suscan_fingerprint_batch *batch =
+      (struct suscan_fingerprint_batch *) data;
+  unsigned int i;
+
+  for (;;) {
+    pthread_mutex_lock(&batch->mutex);
+    i = batch->next++;
+    pthread_mutex_unlock(&batch->mutex);
+
+    if (i >= batch->config_count)
+      break;
+
+    fprintf(stderr, "fingerprinting `%s'...\n", batch->name_list[i]);
+
+    batch->ok_list[i] = suscan_fingerprint_run(
+        batch->config_list[i],
+        &batch->params,
+        &batch->report_list[i]);
+
+    if (batch->format != SUSCAN_FINGERPRINT_FORMAT_TABLE
+        && batch->report_list[i] != NULL) {
+      pthread_mutex_lock(&batch->mutex);
+      suscan_print_records(
+          batch->name_list[i],
+          batch->report_list[i],
+          batch->format);
+      pthread_mutex_unlock(&batch->mutex);
+
+      suscan_fingerprint_report_destroy(batch->report_list[i]);
+      batch->report_list[i] = NULL;
+    }
+  }
+
+  return NULL;
+}
+
+SUBOOL
+suscan_perform_fingerprint_batch(
+    struct suscan_source_config **config_list,
+    const char **name_list,
+    unsigned int config_count,
+    const struct suscan_analyzer_params *params,
+    enum suscan_fingerprint_format format,
+    unsigned int jobs)
+{
+  struct suscan_fingerprint_batch batch;
+  pthread_t *thread_list = NULL;
+  unsigned int thread_count = 0;
+  SUBOOL mutex_init = SU_FALSE;
+  long cpus;
+  unsigned int i;
+  SUBOOL ok = SU_FALSE;
+
+  memset(&batch, 0, sizeof(struct suscan_fingerprint_batch));
+
+  if ((cpus = sysconf(_SC_NPROCESSORS_ONLN)) < 2)
+    cpus = 2;
+
+  if (jobs > cpus - 1) {
+    SU_WARNING(
+        "%u jobs requested, running %ld (one per available CPU)\n",
+        jobs,
+        cpus - 1);
+    jobs = cpus - 1;
+  }
+
+  if (jobs > config_count)
+    jobs = config_count;
+
+  if (jobs == 0)
+    return SU_TRUE;
+
+  batch.config_list = config_list;
+  batch.name_list = name_list;
+  batch.config_count = config_count;
+  batch.params = *params;
+  batch.format = format;
+
+  /* At least one, as jobs < cpus */
+  batch.params.consumer_count = (cpus - 1) / jobs;
+
+  SU_TRYCATCH(
+      batch.report_list = calloc(
+          config_count,
+          sizeof(struct suscan_fingerprint_report *)),
+      goto done);
+
+  SU_TRYCATCH(batch.ok_list = calloc(config_count, sizeof(SUBOOL)), goto done);
+
+  SU_TRYCATCH(thread_list = calloc(jobs, sizeof(pthread_t)), goto done);
+
+  SU_TRYCATCH(pthread_mutex_init(&batch.mutex, NULL) == 0, goto done);
+  mutex_init = SU_TRUE;
+
+  for (i = 0; i < jobs; ++i) {
+    if (pthread_create(
+        &thread_list[i],
+        NULL,
+        suscan_fingerprint_batch_thread,
+        &batch) != 0) {
+      SU_ERROR("Cannot create fingerprint thread: %s\n", strerror(errno));
+      break;
+    }
+
+    ++thread_count;
+  }
+
+  /* Threads already running take care of the whole list */
+  for (i = 0; i < thread_count; ++i)
+    pthread_join(thread_list[i], NULL);
+
+  if (thread_count == 0)
+    goto done;
+
+  /* Failed sources make the whole batch fail, once all are printed */
+  ok = SU_TRUE;
+
+  for (i = 0; i < config_count; ++i) {
+    if (!batch.ok_list[i])
+      ok = SU_FALSE;
+
+    if (format != SUSCAN_FINGERPRINT_FORMAT_TABLE) {
+      if (!batch.ok_list[i])
+        fprintf(stderr, "cannot fingerprint `%s'\n", name_list[i]);
+      continue;
+    }
+
+    printf("Source #%u: %s\n", i + 1, name_list[i]);
+
+    if (batch.report_list[i] != NULL)
+      suscan_print_report(batch.report_list[i]);
+    else if (batch.ok_list[i])
+      printf("  (stream ended before fingerprint was complete)\n");
+    else
+      printf("  (fingerprint failed)\n");
+
+    printf("\n");
+  }
+
+done:
+  if (mutex_init)
+    pthread_mutex_destroy(&batch.mutex);
+
+  if (batch.report_list != NULL) {
+    for (i = 0; i < config_count; ++i)
+      if (batch.report_list[i] != NULL)
+        suscan_fingerprint_report_destroy(batch.report_list[i]);
+
+    free(batch.report_list);
+  }
+
+  if (batch.ok_list != NULL)
+    free(batch.ok_list);
+
+  if (thread_list != NULL)
+    free(thread_list);
+
+  return ok;
+}
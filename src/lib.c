@@ -188,19 +188,22 @@ fail:
 }
 
 SUBOOL
-suscan_sigutils_init(enum suscan_mode mode)
+suscan_sigutils_init(enum suscan_mode mode, const char *wisdom_path)
 {
   struct sigutils_log_config config = sigutils_log_config_INITIALIZER;
   struct sigutils_log_config *config_p = NULL;
 
-  if (mode != SUSCAN_MODE_FINGERPRINT) {
+  if (mode == SUSCAN_MODE_GTK_UI) {
     config.exclusive = SU_FALSE; /* We handle concurrency manually */
     config.log_func = suscan_log_func;
 
     config_p = &config;
   }
 
-  return su_lib_init_ex(config_p);
+  if (!su_lib_init_ex(config_p))
+    return SU_FALSE;
+
+  return suscan_planner_init(wisdom_path);
 }
 
 
@@ -9,6 +9,7 @@
 #include <pthread.h>
 #include <errno.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/select.h>
@@ -17,6 +18,16 @@
 
 SUPRIVATE struct option long_options[] = {
     {"fingerprint", no_argument, NULL, 'f'},
+    {"jobs", required_argument, NULL, 'j'},
+    {"format", required_argument, NULL, 'F'},
+    {"speed", required_argument, NULL, 's'},
+    {"welch", required_argument, NULL, 'w'},
+    {"profile", required_argument, NULL, 'p'},
+    {"sweep", required_argument, NULL, 'S'},
+    {"dwell", required_argument, NULL, 'd'},
+    {"server", optional_argument, NULL, 'D'},
+    {"bench", optional_argument, NULL, 'b'},
+    {"wisdom", required_argument, NULL, 'W'},
     {"help", no_argument, NULL, 'h'},
     {NULL, 0, NULL, 0}
 };
@@ -34,6 +45,37 @@ help(const char *argv0)
   fprintf(stderr, "Options:\n\n");
   fprintf(stderr, "     -f, --fingerprint     Performs fingerprinting on all\n");
   fprintf(stderr, "                           specified sources\n");
+  fprintf(stderr, "     -j, --jobs=COUNT      Fingerprint up to COUNT sources at\n");
+  fprintf(stderr, "                           the same time (one less than the\n");
+  fprintf(stderr, "                           number of CPUs at most). Reports are\n");
+  fprintf(stderr, "                           printed in source order once all\n");
+  fprintf(stderr, "                           are done\n");
+  fprintf(stderr, "     -F, --format=FORMAT   Fingerprint output: table, jsonl or\n");
+  fprintf(stderr, "                           csv. jsonl and csv stream one record\n");
+  fprintf(stderr, "                           per channel as soon as it is ready\n");
+  fprintf(stderr, "     -s, --speed=FACTOR    Playback speed of non-real time\n");
+  fprintf(stderr, "                           sources (0: as fast as possible,\n");
+  fprintf(stderr, "                           default when fingerprinting)\n");
+  fprintf(stderr, "     -w, --welch=OVERLAP   Use a Welch estimator for the main\n");
+  fprintf(stderr, "                           spectrum, with overlap 0 to 0.95\n");
+  fprintf(stderr, "     -p, --profile=PROFILE Read size autotuning: fixed,\n");
+  fprintf(stderr, "                           latency or throughput\n");
+  fprintf(stderr, "     -S, --sweep=FMIN:FMAX[:STEP]\n");
+  fprintf(stderr, "                           Sweeps the first source from FMIN\n");
+  fprintf(stderr, "                           to FMAX Hz and prints the channels\n");
+  fprintf(stderr, "                           found in the whole range\n");
+  fprintf(stderr, "     -d, --dwell=SECONDS   Time spent in every sweep step\n");
+  fprintf(stderr, "     -D, --server[=PATH]   Runs without GUI, serving the analyzer\n");
+  fprintf(stderr, "                           of all sources on a Unix socket\n");
+  fprintf(stderr, "                           (default: %s under\n", SUSCAN_SERVER_DEFAULT_NAME);
+  fprintf(stderr, "                           $XDG_RUNTIME_DIR, or /tmp)\n");
+  fprintf(stderr, "     -b, --bench[=SECONDS] Runs the benchmark scenarios on the\n");
+  fprintf(stderr, "                           first source (default: synthetic\n");
+  fprintf(stderr, "                           signal) and prints results as JSON\n");
+  fprintf(stderr, "     -W, --wisdom=PATH     FFTW wisdom file, loaded at startup\n");
+  fprintf(stderr, "                           and updated on exit (default:\n");
+  fprintf(stderr, "                           $%s or ~/%s,\n", SUSCAN_PLANNER_WISDOM_ENV, SUSCAN_PLANNER_WISDOM_FILE);
+  fprintf(stderr, "                           empty to disable)\n");
   fprintf(stderr, "     -h, --help            This help\n\n");
   fprintf(stderr, "(c) 2017 Gonzalo J. Caracedo <BatchDrake@gmail.com>\n");
 }
@@ -43,7 +85,19 @@ main(int argc, char *argv[], char *envp[])
 {
   struct suscan_source_config *config = NULL;
   PTR_LIST_LOCAL(struct suscan_source_config, config);
+  struct suscan_analyzer_params params = suscan_analyzer_params_INITIALIZER;
+  struct suscan_sweep_params sweep_params = suscan_sweep_params_INITIALIZER;
   struct timeval tv;
+  double speed;
+  double overlap;
+  double dwell;
+  unsigned int jobs = 1;
+  enum suscan_fingerprint_format format = SUSCAN_FINGERPRINT_FORMAT_TABLE;
+  const char *server_path = NULL;
+  double bench_time = SUSCAN_BENCH_DEFAULT_TIME;
+  const char *wisdom_path = NULL;
+  SUBOOL sigutils_init = SU_FALSE;
+  SUBOOL speed_set = SU_FALSE;
   enum suscan_mode mode = SUSCAN_MODE_GTK_UI;
   int exit_code = EXIT_FAILURE;
   char *msgs;
@@ -55,12 +109,104 @@ main(int argc, char *argv[], char *envp[])
   mtrace();
 #endif
 
-  while ((c = getopt_long(argc, argv, "fh", long_options, &index)) != -1) {
+  while ((c = getopt_long(argc, argv, "fj:F:s:w:p:S:d:D::b::W:h", long_options, &index))
+      != -1) {
     switch (c) {
       case 'f':
         mode = SUSCAN_MODE_FINGERPRINT;
         break;
 
+      case 'j':
+        if (sscanf(optarg, "%u", &jobs) != 1 || jobs == 0) {
+          fprintf(stderr, "%s: invalid job count `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      case 'F':
+        if (strcmp(optarg, "table") == 0) {
+          format = SUSCAN_FINGERPRINT_FORMAT_TABLE;
+        } else if (strcmp(optarg, "jsonl") == 0) {
+          format = SUSCAN_FINGERPRINT_FORMAT_JSONL;
+        } else if (strcmp(optarg, "csv") == 0) {
+          format = SUSCAN_FINGERPRINT_FORMAT_CSV;
+        } else {
+          fprintf(stderr, "%s: invalid format `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      case 's':
+        if (sscanf(optarg, "%lf", &speed) != 1) {
+          fprintf(stderr, "%s: invalid playback speed `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        params.playback_speed = speed;
+        speed_set = SU_TRUE;
+        break;
+
+      case 'w':
+        if (sscanf(optarg, "%lf", &overlap) != 1) {
+          fprintf(stderr, "%s: invalid overlap `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        params.psd_mode = SUSCAN_ANALYZER_PSD_MODE_WELCH;
+        params.psd_params.overlap = overlap;
+        break;
+
+      case 'p':
+        if (strcmp(optarg, "fixed") == 0) {
+          params.read_profile = SUSCAN_AUTOTUNE_PROFILE_NONE;
+        } else if (strcmp(optarg, "latency") == 0) {
+          params.read_profile = SUSCAN_AUTOTUNE_PROFILE_LOW_LATENCY;
+        } else if (strcmp(optarg, "throughput") == 0) {
+          params.read_profile = SUSCAN_AUTOTUNE_PROFILE_THROUGHPUT;
+        } else {
+          fprintf(stderr, "%s: invalid profile `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      case 'S':
+        if (sscanf(
+            optarg,
+            "%" SCNu64 ":%" SCNu64 ":%" SCNu64,
+            &sweep_params.fc_min,
+            &sweep_params.fc_max,
+            &sweep_params.step) < 2) {
+          fprintf(stderr, "%s: invalid sweep range `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        mode = SUSCAN_MODE_SWEEP;
+        break;
+
+      case 'd':
+        if (sscanf(optarg, "%lf", &dwell) != 1 || dwell <= 0) {
+          fprintf(stderr, "%s: invalid dwell time `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        sweep_params.dwell = dwell;
+        break;
+
+      case 'D':
+        if (optarg != NULL)
+          server_path = optarg;
+        mode = SUSCAN_MODE_SERVER;
+        break;
+
+      case 'b':
+        if (optarg != NULL
+            && (sscanf(optarg, "%lf", &bench_time) != 1 || bench_time <= 0)) {
+          fprintf(stderr, "%s: invalid benchmark time `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        mode = SUSCAN_MODE_BENCH;
+        break;
+
+      case 'W':
+        wisdom_path = optarg;
+        break;
+
       case 'h':
         help(argv[0]);
         exit(EXIT_SUCCESS);
@@ -76,11 +222,17 @@ main(int argc, char *argv[], char *envp[])
     }
   }
 
-  if (!suscan_sigutils_init(mode)) {
+  /* Fingerprints end when results are stable, no need to wait for files */
+  if (mode == SUSCAN_MODE_FINGERPRINT && !speed_set)
+    params.playback_speed = 0;
+
+  if (!suscan_sigutils_init(mode, wisdom_path)) {
     fprintf(stderr, "%s: failed to initialize sigutils library\n", argv[0]);
     goto done;
   }
 
+  sigutils_init = SU_TRUE;
+
   if (!suscan_init_sources()) {
     fprintf(stderr, "%s: failed to initialize sources\n", argv[0]);
     goto done;
@@ -119,24 +271,82 @@ main(int argc, char *argv[], char *envp[])
       if (config_count == 0) {
         fprintf(stderr, "%s: no sources given for fingerprint\n", argv[0]);
         goto done;
+      }
+
+      suscan_fingerprint_print_header(format);
+
+      if (jobs > 1) {
+        if (suscan_perform_fingerprint_batch(
+            config_list,
+            (const char **) argv + optind,
+            config_count,
+            &params,
+            format,
+            jobs))
+          exit_code = EXIT_SUCCESS;
+        else
+          fprintf(stderr, "%s: batch fingerprint failed\n", argv[0]);
       } else {
+        exit_code = EXIT_SUCCESS;
+
         for (i = 0; i < config_count; ++i) {
           fprintf(
               stderr,
               "%s: fingerprinting `%s'...\n",
               argv[0],
               argv[optind + i]);
-          if (!suscan_perform_fingerprint(config_list[i]))
+          if (!suscan_perform_fingerprint(
+              config_list[i],
+              argv[optind + i],
+              &params,
+              format)) {
             fprintf(
                 stderr,
                 "%s: cannot fingerprint `%s'\n",
                 argv[0],
                 argv[optind + i]);
+            exit_code = EXIT_FAILURE;
+          }
         }
+      }
+
+      break;
+
+    case SUSCAN_MODE_SWEEP:
+      if (config_count == 0) {
+        fprintf(stderr, "%s: no source given for sweep\n", argv[0]);
+        goto done;
+      }
 
+      if (suscan_perform_sweep(config_list[0], &params, &sweep_params))
         exit_code = EXIT_SUCCESS;
+      else
+        fprintf(stderr, "%s: cannot sweep `%s'\n", argv[0], argv[optind]);
+
+      break;
+
+    case SUSCAN_MODE_SERVER:
+      if (config_count == 0) {
+        fprintf(stderr, "%s: no sources given for server\n", argv[0]);
+        goto done;
       }
 
+      if (suscan_perform_server(config_list, config_count, &params, server_path))
+        exit_code = EXIT_SUCCESS;
+      else
+        fprintf(stderr, "%s: server failed\n", argv[0]);
+
+      break;
+
+    case SUSCAN_MODE_BENCH:
+      if (suscan_perform_bench(
+          config_count > 0 ? config_list[0] : NULL,
+          &params,
+          bench_time))
+        exit_code = EXIT_SUCCESS;
+      else
+        fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+
       break;
   }
 
@@ -153,6 +363,11 @@ done:
   for (i = 0; i < config_count; ++i)
     suscan_source_config_destroy(config_list[i]);
 
+  if (sigutils_init)
+    suscan_planner_finalize();
+
+  suscan_analyzer_sample_batch_pool_drain();
+
 #ifdef DEBUG_WITH_MTRACE
   muntrace();
 #endif
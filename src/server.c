@@ -0,0 +1,581 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "suscan.h"
+#include <analyzer/serialize.h>
+
+#define SUSCAN_SERVER_MAX_CLIENTS 32
+#define SUSCAN_SERVER_READ_SIZE   4096
+#define SUSCAN_SERVER_MAX_QUEUED  (4 << 20) /* Bytes before dropping a client */
+#define SUSCAN_SERVER_FLUSH_MS    100       /* Retry interval of queued data */
+
+/*
+ * Every client gets the serialized output of the analyzer, filtered by
+ * its subscription mask, and may send inspector, seek and retune
+ * requests. Clients share the analyzer: inspector handles opened by one
+ * of them are valid for everybody.
+ *
+ * Output is sent without blocking. What the socket does not take is
+ * queued per client and sent later, either by the next broadcast or by
+ * the request thread. Clients that let their queue grow too big are
+ * dropped, so a client that stops reading never stalls the analyzer.
+ */
+struct suscan_server_client {
+  int fd;
+  uint32_t mask;
+  SUBOOL dropped; /* Shut down, waiting for the request thread */
+  struct suscan_frame_buffer in;
+  struct suscan_frame_buffer out; /* Protected by the server mutex */
+};
+
+struct suscan_server {
+  suscan_analyzer_t *analyzer;
+  int listen_fd;
+  int wake_fd[2]; /* Wakes up the request thread on exit */
+
+  pthread_mutex_t mutex; /* Protects the client list */
+  PTR_LIST(struct suscan_server_client, client);
+
+  pthread_t thread;
+  SUBOOL thread_running;
+};
+
+SUPRIVATE void
+suscan_server_client_destroy(struct suscan_server_client *client)
+{
+  if (client->fd != -1)
+    close(client->fd);
+
+  suscan_frame_buffer_finalize(&client->in);
+  suscan_frame_buffer_finalize(&client->out);
+
+  free(client);
+}
+
+SUPRIVATE struct suscan_server_client *
+suscan_server_client_new(int fd)
+{
+  struct suscan_server_client *new = NULL;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(struct suscan_server_client)), return NULL);
+
+  new->fd = fd;
+  new->mask = 0xffffffff;
+  suscan_frame_buffer_init(&new->in);
+  suscan_frame_buffer_init(&new->out);
+
+  return new;
+}
+
+/* Must be called with the server mutex held */
+SUPRIVATE void
+suscan_server_client_drop(struct suscan_server_client *client)
+{
+  if (!client->dropped) {
+    /* The request thread sees the hangup and removes it */
+    shutdown(client->fd, SHUT_RDWR);
+    client->dropped = SU_TRUE;
+    client->out.size = 0;
+  }
+}
+
+/* Sends as much queued output as the socket takes, without blocking */
+SUPRIVATE void
+suscan_server_client_flush(struct suscan_server_client *client)
+{
+  ssize_t sent;
+
+  while (!client->dropped && client->out.size > 0) {
+    if ((sent = send(
+        client->fd,
+        client->out.data,
+        client->out.size,
+        MSG_DONTWAIT | MSG_NOSIGNAL)) == -1) {
+      if (errno == EINTR)
+        continue;
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        SU_WARNING("Client gone, disconnecting\n");
+        suscan_server_client_drop(client);
+      }
+
+      break;
+    }
+
+    suscan_frame_buffer_consume(&client->out, sent);
+  }
+}
+
+SUPRIVATE SUBOOL
+suscan_server_accept(struct suscan_server *server)
+{
+  struct suscan_server_client *client = NULL;
+  int fd;
+
+  if ((fd = accept(server->listen_fd, NULL, NULL)) == -1) {
+    SU_WARNING("accept() failed: %s\n", strerror(errno));
+    return SU_TRUE;
+  }
+
+  pthread_mutex_lock(&server->mutex);
+
+  if (server->client_count >= SUSCAN_SERVER_MAX_CLIENTS) {
+    SU_WARNING("Too many clients, connection refused\n");
+    close(fd);
+  } else if ((client = suscan_server_client_new(fd)) == NULL) {
+    close(fd);
+  } else if (PTR_LIST_APPEND_CHECK(server->client, client) == -1) {
+    suscan_server_client_destroy(client);
+    client = NULL;
+  }
+
+  pthread_mutex_unlock(&server->mutex);
+
+  return SU_TRUE;
+}
+
+/* Returns SU_FALSE if the client sent garbage */
+SUPRIVATE SUBOOL
+suscan_server_process_frame(
+    struct suscan_server *server,
+    struct suscan_server_client *client,
+    const uint8_t *frame)
+{
+  uint32_t type;
+  uint32_t mask;
+  void *msg;
+
+  if (suscan_frame_get_type(frame) == SUSCAN_FRAME_TYPE_SUBSCRIBE) {
+    if (!suscan_frame_deserialize_subscribe(frame, &mask))
+      return SU_FALSE;
+
+    pthread_mutex_lock(&server->mutex);
+    client->mask = mask;
+    pthread_mutex_unlock(&server->mutex);
+
+    return SU_TRUE;
+  }
+
+  if ((msg = suscan_frame_deserialize_request(frame, &type)) == NULL)
+    return SU_FALSE;
+
+  if (!suscan_analyzer_write(server->analyzer, type, msg)) {
+    suscan_analyzer_dispose_message(type, msg);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_server_read_client(
+    struct suscan_server *server,
+    struct suscan_server_client *client)
+{
+  uint8_t data[SUSCAN_SERVER_READ_SIZE];
+  ssize_t got;
+  ssize_t size;
+
+  if ((got = read(client->fd, data, sizeof(data))) <= 0)
+    return SU_FALSE;
+
+  SU_TRYCATCH(suscan_frame_buffer_append(&client->in, data, got), return SU_FALSE);
+
+  while ((size = suscan_frame_get_size(client->in.data, client->in.size)) > 0) {
+    if (!suscan_server_process_frame(server, client, client->in.data)) {
+      SU_WARNING("Invalid request from client, disconnecting\n");
+      return SU_FALSE;
+    }
+
+    suscan_frame_buffer_consume(&client->in, size);
+  }
+
+  return size == 0;
+}
+
+SUPRIVATE void
+suscan_server_remove_client(
+    struct suscan_server *server,
+    struct suscan_server_client *client)
+{
+  unsigned int i;
+
+  pthread_mutex_lock(&server->mutex);
+
+  for (i = 0; i < server->client_count; ++i)
+    if (server->client_list[i] == client)
+      server->client_list[i] = server->client_list[--server->client_count];
+
+  pthread_mutex_unlock(&server->mutex);
+
+  suscan_server_client_destroy(client);
+}
+
+/*
+ * Request thread: accepts connections, reads client requests and sends
+ * queued output. Only this thread adds or removes clients, so it may use
+ * them without the mutex as long as it doesn't modify the list or touch
+ * their output queues.
+ */
+SUPRIVATE void *
+suscan_server_thread(void *data)
+{
+  struct suscan_server *server = (struct suscan_server *) data;
+  struct pollfd fds[SUSCAN_SERVER_MAX_CLIENTS + 2];
+  struct suscan_server_client *clients[SUSCAN_SERVER_MAX_CLIENTS];
+  unsigned int count;
+  unsigned int i;
+
+  for (;;) {
+    fds[0].fd = server->wake_fd[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = server->listen_fd;
+    fds[1].events = POLLIN;
+
+    pthread_mutex_lock(&server->mutex);
+
+    count = server->client_count;
+    for (i = 0; i < count; ++i) {
+      clients[i] = server->client_list[i];
+      fds[i + 2].fd = clients[i]->fd;
+      fds[i + 2].events = POLLIN;
+      if (clients[i]->out.size > 0)
+        fds[i + 2].events |= POLLOUT;
+    }
+
+    pthread_mutex_unlock(&server->mutex);
+
+    /* Broadcasts may queue output while we wait: check it now and then */
+    if (poll(fds, count + 2, SUSCAN_SERVER_FLUSH_MS) == -1) {
+      if (errno == EINTR)
+        continue;
+
+      SU_ERROR("poll() failed: %s\n", strerror(errno));
+      break;
+    }
+
+    if (fds[0].revents)
+      break;
+
+    pthread_mutex_lock(&server->mutex);
+    for (i = 0; i < count; ++i)
+      suscan_server_client_flush(clients[i]);
+    pthread_mutex_unlock(&server->mutex);
+
+    for (i = 0; i < count; ++i)
+      if (fds[i + 2].revents & ~POLLOUT)
+        if (!suscan_server_read_client(server, clients[i]))
+          suscan_server_remove_client(server, clients[i]);
+
+    if (fds[1].revents & POLLIN)
+      suscan_server_accept(server);
+  }
+
+  return NULL;
+}
+
+/*
+ * Message is serialized once, whatever the number of clients. Sends
+ * never block, so the mutex is held for the duration of a copy at most.
+ */
+SUPRIVATE void
+suscan_server_broadcast(
+    struct suscan_server *server,
+    struct suscan_frame_buffer *out,
+    uint32_t type,
+    const void *msg)
+{
+  struct suscan_server_client *client;
+  SUBOOL serialized = SU_FALSE;
+  unsigned int i;
+
+  out->size = 0;
+
+  pthread_mutex_lock(&server->mutex);
+
+  for (i = 0; i < server->client_count; ++i) {
+    client = server->client_list[i];
+
+    if (client->dropped || type >= 32 || !(client->mask & (1u << type)))
+      continue;
+
+    if (!serialized) {
+      if (!suscan_frame_serialize(out, type, msg))
+        break;
+      serialized = SU_TRUE;
+    }
+
+    /* Frames are queued whole: a partial frame would corrupt the stream */
+    if (client->out.size + out->size > SUSCAN_SERVER_MAX_QUEUED
+        || !suscan_frame_buffer_append(&client->out, out->data, out->size)) {
+      SU_WARNING("Client too slow, disconnecting\n");
+      suscan_server_client_drop(client);
+      continue;
+    }
+
+    suscan_server_client_flush(client);
+  }
+
+  pthread_mutex_unlock(&server->mutex);
+}
+
+SUPRIVATE char *
+suscan_server_get_default_path(void)
+{
+  const char *dir;
+
+  if ((dir = getenv("XDG_RUNTIME_DIR")) == NULL || *dir == '\0')
+    dir = "/tmp";
+
+  return strbuild("%s/%s", dir, SUSCAN_SERVER_DEFAULT_NAME);
+}
+
+/*
+ * Sockets left behind by a server that died are removed. Anything else
+ * at the path (a file, or the socket of a running server) is kept.
+ */
+SUPRIVATE SUBOOL
+suscan_server_remove_stale(const struct sockaddr_un *addr)
+{
+  struct stat sbuf;
+  int fd = -1;
+  SUBOOL ok = SU_FALSE;
+
+  if (lstat(addr->sun_path, &sbuf) == -1) {
+    if (errno == ENOENT)
+      return SU_TRUE;
+
+    SU_ERROR("Cannot stat %s: %s\n", addr->sun_path, strerror(errno));
+    return SU_FALSE;
+  }
+
+  if (!S_ISSOCK(sbuf.st_mode)) {
+    SU_ERROR("%s exists and is not a socket\n", addr->sun_path);
+    return SU_FALSE;
+  }
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+    SU_ERROR("socket() failed: %s\n", strerror(errno));
+    goto done;
+  }
+
+  if (connect(
+      fd,
+      (const struct sockaddr *) addr,
+      sizeof(struct sockaddr_un)) == 0) {
+    SU_ERROR("Another server is listening on %s\n", addr->sun_path);
+    goto done;
+  }
+
+  if (errno != ECONNREFUSED) {
+    SU_ERROR("Cannot connect to %s: %s\n", addr->sun_path, strerror(errno));
+    goto done;
+  }
+
+  if (unlink(addr->sun_path) == -1) {
+    SU_ERROR("Cannot remove %s: %s\n", addr->sun_path, strerror(errno));
+    goto done;
+  }
+
+  ok = SU_TRUE;
+
+done:
+  if (fd != -1)
+    close(fd);
+
+  return ok;
+}
+
+SUPRIVATE int
+suscan_server_listen(const char *path)
+{
+  struct sockaddr_un addr;
+  int fd = -1;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    SU_ERROR("Socket path too long: %s\n", path);
+    goto fail;
+  }
+
+  memset(&addr, 0, sizeof(struct sockaddr_un));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  if (!suscan_server_remove_stale(&addr))
+    goto fail;
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+    SU_ERROR("socket() failed: %s\n", strerror(errno));
+    goto fail;
+  }
+
+  if (bind(fd, (struct sockaddr *) &addr, sizeof(struct sockaddr_un)) == -1) {
+    SU_ERROR("Cannot bind to %s: %s\n", path, strerror(errno));
+    goto fail;
+  }
+
+  /* Clients control the analyzer: owner only */
+  if (chmod(path, S_IRUSR | S_IWUSR) == -1) {
+    SU_ERROR("Cannot restrict access to %s: %s\n", path, strerror(errno));
+    (void) unlink(path);
+    goto fail;
+  }
+
+  if (listen(fd, 5) == -1) {
+    SU_ERROR("listen() failed: %s\n", strerror(errno));
+    goto fail;
+  }
+
+  return fd;
+
+fail:
+  if (fd != -1)
+    close(fd);
+
+  return -1;
+}
+
+SUBOOL
+suscan_perform_server(
+    struct suscan_source_config **config_list,
+    unsigned int config_count,
+    const struct suscan_analyzer_params *params,
+    const char *path)
+{
+  struct suscan_server server;
+  struct suscan_frame_buffer out;
+  struct suscan_mq mq;
+  const struct suscan_analyzer_status_msg *st_msg;
+  char *default_path = NULL;
+  SUBOOL mq_init = SU_FALSE;
+  SUBOOL mutex_init = SU_FALSE;
+  unsigned int eos_count = 0;
+  unsigned int i;
+  uint32_t type;
+  void *private;
+  SUBOOL ok = SU_FALSE;
+
+  memset(&server, 0, sizeof(struct suscan_server));
+  server.listen_fd = -1;
+  server.wake_fd[0] = server.wake_fd[1] = -1;
+
+  suscan_frame_buffer_init(&out);
+
+  if (path == NULL)
+    SU_TRYCATCH(
+        path = default_path = suscan_server_get_default_path(),
+        goto done);
+
+  SU_TRYCATCH(mq_init = suscan_mq_init(&mq), goto done);
+
+  SU_TRYCATCH(pthread_mutex_init(&server.mutex, NULL) == 0, goto done);
+  mutex_init = SU_TRUE;
+
+  SU_TRYCATCH(pipe(server.wake_fd) == 0, goto done);
+
+  SU_TRYCATCH((server.listen_fd = suscan_server_listen(path)) != -1, goto done);
+
+  SU_TRYCATCH(
+      server.analyzer = suscan_analyzer_new_multi(
+          params,
+          config_list,
+          config_count,
+          &mq),
+      goto done);
+
+  SU_TRYCATCH(
+      pthread_create(&server.thread, NULL, suscan_server_thread, &server) == 0,
+      goto done);
+  server.thread_running = SU_TRUE;
+
+  fprintf(stderr, "Listening on %s\n", path);
+
+  /* Runs until every source is over */
+  while (eos_count < config_count) {
+    private = suscan_analyzer_read(server.analyzer, &type);
+
+    if (type == SUSCAN_ANALYZER_MESSAGE_TYPE_EOS) {
+      ++eos_count;
+    } else if (type == SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL) {
+      st_msg = (const struct suscan_analyzer_status_msg *) private;
+      if (st_msg->code != 0)
+        SU_ERROR(
+            "%s\n",
+            st_msg->err_msg != NULL ? st_msg->err_msg : "Internal error");
+    }
+
+    suscan_server_broadcast(&server, &out, type, private);
+
+    suscan_analyzer_dispose_message(type, private);
+  }
+
+  ok = SU_TRUE;
+
+done:
+  if (server.thread_running) {
+    (void) !write(server.wake_fd[1], "", 1);
+    pthread_join(server.thread, NULL);
+  }
+
+  if (server.analyzer != NULL)
+    suscan_analyzer_destroy(server.analyzer);
+
+  for (i = 0; i < server.client_count; ++i)
+    suscan_server_client_destroy(server.client_list[i]);
+
+  if (server.client_list != NULL)
+    free(server.client_list);
+
+  if (server.listen_fd != -1) {
+    close(server.listen_fd);
+    unlink(path);
+  }
+
+  if (server.wake_fd[0] != -1) {
+    close(server.wake_fd[0]);
+    close(server.wake_fd[1]);
+  }
+
+  if (mutex_init)
+    pthread_mutex_destroy(&server.mutex);
+
+  if (mq_init) {
+    suscan_analyzer_consume_mq(&mq);
+    suscan_mq_finalize(&mq);
+  }
+
+  suscan_frame_buffer_finalize(&out);
+
+  if (default_path != NULL)
+    free(default_path);
+
+  return ok;
+}
@@ -13,6 +13,7 @@
 #include <analyzer/xsig.h>   /* File sources */
 #include <analyzer/mq.h>     /* Message queue object */
 #include <analyzer/analyzer.h>
+#include <analyzer/planner.h> /* FFT planning */
 
 #include <analyzer/msg.h>    /* Suscan-specific messages */
 
@@ -42,7 +43,20 @@
 
 enum suscan_mode {
   SUSCAN_MODE_GTK_UI,
-  SUSCAN_MODE_FINGERPRINT
+  SUSCAN_MODE_FINGERPRINT,
+  SUSCAN_MODE_SWEEP,
+  SUSCAN_MODE_SERVER,
+  SUSCAN_MODE_BENCH
+};
+
+/* Under $XDG_RUNTIME_DIR, or /tmp if unset */
+#define SUSCAN_SERVER_DEFAULT_NAME "suscan.sock"
+#define SUSCAN_BENCH_DEFAULT_TIME  5 /* Seconds per scenario */
+
+enum suscan_fingerprint_format {
+  SUSCAN_FINGERPRINT_FORMAT_TABLE, /* Human-readable, one table per source */
+  SUSCAN_FINGERPRINT_FORMAT_JSONL, /* One JSON object per line and channel */
+  SUSCAN_FINGERPRINT_FORMAT_CSV    /* One row per channel, with header */
 };
 
 SUBOOL suscan_channel_is_dc(const struct sigutils_channel *ch);
@@ -53,7 +67,8 @@ void suscan_channel_list_sort(
 
 char *suscan_log_get_last_messages(struct timeval since, unsigned int max);
 
-SUBOOL suscan_sigutils_init(enum suscan_mode mode);
+/* wisdom_path may be NULL, see suscan_planner_init */
+SUBOOL suscan_sigutils_init(enum suscan_mode mode, const char *wisdom_path);
 
 SUBOOL suscan_gui_start(
     int argc,
@@ -61,6 +76,38 @@ SUBOOL suscan_gui_start(
     struct suscan_source_config **config_list,
     unsigned int config_count);
 
-SUBOOL suscan_perform_fingerprint(struct suscan_source_config *config);
+void suscan_fingerprint_print_header(enum suscan_fingerprint_format format);
+
+SUBOOL suscan_perform_fingerprint(
+    struct suscan_source_config *config,
+    const char *name,
+    const struct suscan_analyzer_params *params,
+    enum suscan_fingerprint_format format);
+
+SUBOOL suscan_perform_fingerprint_batch(
+    struct suscan_source_config **config_list,
+    const char **name_list,
+    unsigned int config_count,
+    const struct suscan_analyzer_params *params,
+    enum suscan_fingerprint_format format,
+    unsigned int jobs);
+
+SUBOOL suscan_perform_sweep(
+    struct suscan_source_config *config,
+    const struct suscan_analyzer_params *params,
+    const struct suscan_sweep_params *sweep_params);
+
+/* Path may be NULL, for the default socket */
+SUBOOL suscan_perform_server(
+    struct suscan_source_config **config_list,
+    unsigned int config_count,
+    const struct suscan_analyzer_params *params,
+    const char *path);
+
+/* Config may be NULL, to use a synthetic source */
+SUBOOL suscan_perform_bench(
+    struct suscan_source_config *config,
+    const struct suscan_analyzer_params *params,
+    SUFLOAT duration);
 
 #endif /* _MAIN_INCLUDE_H */
@@ -0,0 +1,137 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "suscan.h"
+
+#define SUSCAN_SWEEP_REPORT_COUNT 10 /* Sweeps before printing channels */
+
+SUPRIVATE void
+suscan_print_sweep_channels(const struct suscan_analyzer_sweep_msg *msg)
+{
+  unsigned int i;
+
+  printf(" id |    Channel freq.    |  Bandwidth  |    SNR\n");
+  printf("----+---------------------+-------------+----------\n");
+
+  for (i = 0; i < msg->channel_count; ++i)
+    printf(
+        "%2d. | %14.1lf Hz | %8.1lf Hz | %5.1lf dB\n",
+        i + 1,
+        msg->channel_list[i]->fc,
+        msg->channel_list[i]->bw,
+        msg->channel_list[i]->snr);
+}
+
+SUBOOL
+suscan_perform_sweep(
+    struct suscan_source_config *config,
+    const struct suscan_analyzer_params *params,
+    const struct suscan_sweep_params *sweep_params)
+{
+  struct suscan_analyzer_params sw_params = *params;
+  struct suscan_mq mq;
+  void *private;
+  uint32_t type;
+  suscan_analyzer_t *analyzer = NULL;
+  struct suscan_analyzer_sweep_msg *sw_msg;
+  const struct suscan_analyzer_status_msg *st_msg;
+  SUBOOL running = SU_TRUE;
+  SUBOOL ok = SU_FALSE;
+
+  if (!suscan_mq_init(&mq))
+    return SU_FALSE;
+
+  /* Sweep messages are all we need */
+  sw_params.channel_deltas = SU_FALSE;
+
+  SU_TRYCATCH(
+      analyzer = suscan_analyzer_new(&sw_params, config, &mq),
+      goto done);
+
+  SU_TRYCATCH(
+      suscan_analyzer_start_sweep(analyzer, 0, sweep_params),
+      goto done);
+
+  while (running) {
+    private = suscan_analyzer_read(analyzer, &type);
+
+    switch (type) {
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_SWEEP:
+        sw_msg = (struct suscan_analyzer_sweep_msg *) private;
+
+        suscan_channel_list_sort(sw_msg->channel_list, sw_msg->channel_count);
+
+        fprintf(
+            stderr,
+            "Sweep #%u: %u channels in %lg MHz (%.2lf sweeps/s)\n",
+            sw_msg->sweep_count,
+            sw_msg->channel_count,
+            sw_msg->psd->samp_rate * 1e-6,
+            sw_msg->sweep_rate);
+
+        if (sw_msg->sweep_count >= SUSCAN_SWEEP_REPORT_COUNT) {
+          suscan_print_sweep_channels(sw_msg);
+          running = SU_FALSE;
+        }
+
+        break;
+
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL:
+        st_msg = (struct suscan_analyzer_status_msg *) private;
+
+        if (st_msg->code != 0) {
+          SU_ERROR(
+              "%s\n",
+              st_msg->err_msg != NULL ? st_msg->err_msg : "Internal error");
+          running = SU_FALSE;
+        }
+
+        break;
+
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+        st_msg = (struct suscan_analyzer_status_msg *) private;
+
+        if (st_msg->err_msg != NULL)
+          SU_WARNING("End of stream: %s\n", st_msg->err_msg);
+        else
+          SU_WARNING("Unexpected end of stream\n");
+
+        running = SU_FALSE;
+        break;
+    }
+
+    suscan_analyzer_dispose_message(type, private);
+  }
+
+  ok = SU_TRUE;
+
+done:
+  if (analyzer != NULL)
+    suscan_analyzer_destroy(analyzer);
+
+  suscan_analyzer_consume_mq(&mq);
+  suscan_mq_finalize(&mq);
+
+  return ok;
+}